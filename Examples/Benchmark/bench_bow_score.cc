@@ -0,0 +1,156 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* 词袋相似度性能测试：比较std::map形式的BowVector与扁平FlatBowVector计算两帧图像相似度的耗时和内存，
+* 并检查两者的得分完全一致。
+*/
+
+
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<vector>
+#include<string>
+
+#include<opencv2/core/core.hpp>
+#include<opencv2/highgui/highgui.hpp>
+#include<opencv2/imgproc/imgproc.hpp>
+
+#include<ORBextractor.h>
+#include<ORBVocabulary.h>
+#include<DescriptorBlock.h>
+
+
+using namespace std;
+
+// 读取灰度图像并提取ORB描述子
+bool ExtractDescriptors(ORB_SLAM2::ORBextractor &extractor, const string &strFile, cv::Mat &descriptors)
+{
+    cv::Mat im = cv::imread(strFile, CV_LOAD_IMAGE_UNCHANGED);
+    if (im.empty())
+    {
+        cerr << "Failed to load image at: " << strFile << endl;
+        return false;
+    }
+    if (im.channels() == 3)
+        cv::cvtColor(im, im, CV_BGR2GRAY);
+    else if (im.channels() == 4)
+        cv::cvtColor(im, im, CV_BGRA2GRAY);
+
+    vector<cv::KeyPoint> vKeys;
+    extractor(im, cv::Mat(), vKeys, descriptors);
+    return true;
+}
+
+// 对两个向量重复计算nIterations轮相似度(每轮nRepeats次)，返回排序后的单次耗时(us)
+template<class TBowVector>
+vector<double> TimeScore(const ORB_SLAM2::ORBVocabulary &voc, const TBowVector &v1, const TBowVector &v2,
+                         const int nIterations, const int nRepeats, double &score)
+{
+    vector<double> vTimes;
+    vTimes.reserve(nIterations);
+
+    for (int i = 0; i < nIterations; i++)
+    {
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        for (int j = 0; j < nRepeats; j++)
+            score = voc.score(v1, v2);
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+        vTimes.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(t2 - t1).count() /
+                         nRepeats);
+    }
+
+    sort(vTimes.begin(), vTimes.end());
+    return vTimes;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 5)
+    {
+        cerr << endl << "Usage: ./bench_bow_score vocabulary settings image1 image2 [iterations]" << endl;
+        return 1;
+    }
+
+    const string strVocFile = argv[1];
+    ORB_SLAM2::ORBVocabulary voc;
+    bool bVocLoad;
+    if (strVocFile.size() > 4 && strVocFile.compare(strVocFile.size() - 4, 4, ".bin") == 0)
+        bVocLoad = voc.loadFromBinaryFile(strVocFile);
+    else
+        bVocLoad = voc.loadFromTextFile(strVocFile);
+    if (!bVocLoad)
+    {
+        cerr << "Failed to open vocabulary at: " << strVocFile << endl;
+        return 1;
+    }
+
+    cv::FileStorage fSettings(argv[2], cv::FileStorage::READ);
+    if (!fSettings.isOpened())
+    {
+        cerr << "Failed to open settings file at: " << argv[2] << endl;
+        return 1;
+    }
+
+    const int nIterations = argc > 5 ? atoi(argv[5]) : 100;
+    const int nRepeats = 1000;
+
+    int nFeatures = fSettings["ORBextractor.nFeatures"];
+    float fScaleFactor = fSettings["ORBextractor.scaleFactor"];
+    int nLevels = fSettings["ORBextractor.nLevels"];
+    int fIniThFAST = fSettings["ORBextractor.iniThFAST"];
+    int fMinThFAST = fSettings["ORBextractor.minThFAST"];
+
+    ORB_SLAM2::ORBextractor extractor(nFeatures, fScaleFactor, nLevels, fIniThFAST, fMinThFAST);
+    cv::Mat descriptors1, descriptors2;
+    if (!ExtractDescriptors(extractor, argv[3], descriptors1) || !ExtractDescriptors(extractor, argv[4], descriptors2))
+        return 1;
+
+    // 与Frame::ComputeBoW相同的词袋向量，再转换为std::map形式作对比
+    ORB_SLAM2::DescriptorBlock block1(descriptors1), block2(descriptors2);
+    DBoW2::FlatBowVector flat1, flat2;
+    DBoW2::FlatFeatureVector flatFeat1, flatFeat2;
+    ORB_SLAM2::ComputeBowVectors(voc, block1, 4, flat1, flatFeat1, NULL);
+    ORB_SLAM2::ComputeBowVectors(voc, block2, 4, flat2, flatFeat2, NULL);
+
+    DBoW2::BowVector map1, map2;
+    DBoW2::FeatureVector mapFeat1;
+    flat1.toBowVector(map1);
+    flat2.toBowVector(map2);
+    flatFeat1.toFeatureVector(mapFeat1);
+
+    double scoreMap = 0, scoreFlat = 0;
+    vector<double> vTimesMap = TimeScore(voc, map1, map2, nIterations, nRepeats, scoreMap);
+    vector<double> vTimesFlat = TimeScore(voc, flat1, flat2, nIterations, nRepeats, scoreFlat);
+
+    // 估计内存：红黑树每个节点有3个指针和颜色，加上元素本身，不计malloc的额外开销
+    const size_t nodeOverhead = 3 * sizeof(void *) + sizeof(int);
+    size_t nFeatIndices = 0;
+    for (DBoW2::FeatureVector::const_iterator fit = mapFeat1.begin(); fit != mapFeat1.end(); fit++)
+        nFeatIndices += fit->second.size();
+    const size_t mapBytes = map1.size() * (nodeOverhead + sizeof(DBoW2::BowVector::value_type)) +
+                            mapFeat1.size() * (nodeOverhead + sizeof(DBoW2::FeatureVector::value_type)) +
+                            nFeatIndices * sizeof(unsigned int);
+    const size_t flatBytes = flat1.size() * (sizeof(DBoW2::WordId) + sizeof(DBoW2::WordValue)) +
+                             flatFeat1.size() * (sizeof(DBoW2::NodeId) + sizeof(unsigned int)) +
+                             nFeatIndices * sizeof(unsigned int);
+
+    cout << "words: " << flat1.size() << " / " << flat2.size() << ", nodes: " << flatFeat1.size()
+         << ", iterations: " << nIterations << " x " << nRepeats << endl;
+    cout << "map score median: " << vTimesMap[nIterations / 2] << " us, p99: "
+         << vTimesMap[nIterations * 99 / 100] << " us" << endl;
+    cout << "flat score median: " << vTimesFlat[nIterations / 2] << " us, p99: "
+         << vTimesFlat[nIterations * 99 / 100] << " us" << endl;
+    cout << "speedup: " << vTimesMap[nIterations / 2] / vTimesFlat[nIterations / 2] << "x" << endl;
+    cout << "memory per frame: map ~" << mapBytes << " bytes, flat ~" << flatBytes << " bytes" << endl;
+
+    if (scoreMap != scoreFlat)
+    {
+        cerr << "ERROR: flat score " << scoreFlat << " differs from map score " << scoreMap << endl;
+        return 1;
+    }
+    cout << "score identical: yes (" << scoreFlat << ")" << endl;
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* 词袋向量计算性能测试：比较词典树与扁平词典树计算一帧图像BowVector和FeatureVector的耗时，
+* 以及直接从连续描述子串行、并行计算的耗时，并检查结果完全一致。
+*/
+
+
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<vector>
+#include<string>
+
+#include<opencv2/core/core.hpp>
+#include<opencv2/highgui/highgui.hpp>
+#include<opencv2/imgproc/imgproc.hpp>
+
+#include<ORBextractor.h>
+#include<ORBVocabulary.h>
+#include<Converter.h>
+#include<DescriptorBlock.h>
+#include<ThreadPool.h>
+
+
+using namespace std;
+
+// 对词典重复计算nIterations次，返回排序后的耗时(ms)
+vector<double> TimeTransform(const ORB_SLAM2::ORBVocabulary &voc, const vector<cv::Mat> &vDesc, const int nIterations,
+                             DBoW2::BowVector &bowVec, DBoW2::FeatureVector &featVec)
+{
+    vector<double> vTimes;
+    vTimes.reserve(nIterations);
+
+    for (int i = 0; i < nIterations; i++)
+    {
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        voc.transform(vDesc, bowVec, featVec, 4);
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+        vTimes.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t2 - t1).count());
+    }
+
+    sort(vTimes.begin(), vTimes.end());
+    return vTimes;
+}
+
+// 对连续存放的描述子重复计算nIterations次，返回排序后的耗时(ms)
+vector<double> TimeBatch(const ORB_SLAM2::ORBVocabulary &voc, const ORB_SLAM2::DescriptorBlock &descriptors,
+                         const int nIterations, ORB_SLAM2::ThreadPool *pThreadPool,
+                         DBoW2::FlatBowVector &bowVec, DBoW2::FlatFeatureVector &featVec)
+{
+    vector<double> vTimes;
+    vTimes.reserve(nIterations);
+
+    for (int i = 0; i < nIterations; i++)
+    {
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        ORB_SLAM2::ComputeBowVectors(voc, descriptors, 4, bowVec, featVec, pThreadPool);
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+        vTimes.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t2 - t1).count());
+    }
+
+    sort(vTimes.begin(), vTimes.end());
+    return vTimes;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        cerr << endl << "Usage: ./bench_bow_transform vocabulary settings image [iterations] [threads]" << endl;
+        return 1;
+    }
+
+    const string strVocFile = argv[1];
+    ORB_SLAM2::ORBVocabulary voc;
+    bool bVocLoad;
+    if (strVocFile.size() > 4 && strVocFile.compare(strVocFile.size() - 4, 4, ".bin") == 0)
+        bVocLoad = voc.loadFromBinaryFile(strVocFile);
+    else
+        bVocLoad = voc.loadFromTextFile(strVocFile);
+    if (!bVocLoad)
+    {
+        cerr << "Failed to open vocabulary at: " << strVocFile << endl;
+        return 1;
+    }
+
+    cv::FileStorage fSettings(argv[2], cv::FileStorage::READ);
+    if (!fSettings.isOpened())
+    {
+        cerr << "Failed to open settings file at: " << argv[2] << endl;
+        return 1;
+    }
+
+    cv::Mat im = cv::imread(argv[3], CV_LOAD_IMAGE_UNCHANGED);
+    if (im.empty())
+    {
+        cerr << "Failed to load image at: " << argv[3] << endl;
+        return 1;
+    }
+    if (im.channels() == 3)
+        cv::cvtColor(im, im, CV_BGR2GRAY);
+    else if (im.channels() == 4)
+        cv::cvtColor(im, im, CV_BGRA2GRAY);
+
+    const int nIterations = argc > 4 ? atoi(argv[4]) : 100;
+    const int nThreads = argc > 5 ? atoi(argv[5]) : 4;
+
+    int nFeatures = fSettings["ORBextractor.nFeatures"];
+    float fScaleFactor = fSettings["ORBextractor.scaleFactor"];
+    int nLevels = fSettings["ORBextractor.nLevels"];
+    int fIniThFAST = fSettings["ORBextractor.iniThFAST"];
+    int fMinThFAST = fSettings["ORBextractor.minThFAST"];
+
+    ORB_SLAM2::ORBextractor extractor(nFeatures, fScaleFactor, nLevels, fIniThFAST, fMinThFAST);
+    vector<cv::KeyPoint> vKeys;
+    cv::Mat descriptors;
+    extractor(im, cv::Mat(), vKeys, descriptors);
+    vector<cv::Mat> vDesc = ORB_SLAM2::Converter::toDescriptorVector(descriptors);
+
+    DBoW2::BowVector bowTree, bowFlat;
+    DBoW2::FeatureVector featTree, featFlat;
+    vector<double> vTimesTree = TimeTransform(voc, vDesc, nIterations, bowTree, featTree);
+
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    voc.flatten();
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    const double flattenTime = std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t2 - t1).count();
+
+    vector<double> vTimesFlat = TimeTransform(voc, vDesc, nIterations, bowFlat, featFlat);
+
+    // 与Frame::ComputeBoW相同，直接使用连续存放的描述子
+    ORB_SLAM2::DescriptorBlock descriptorBlock(descriptors);
+    ORB_SLAM2::ThreadPool threadPool(max(nThreads - 1, 0));
+    DBoW2::FlatBowVector bowBatch, bowParallel;
+    DBoW2::FlatFeatureVector featBatch, featParallel;
+    vector<double> vTimesBatch = TimeBatch(voc, descriptorBlock, nIterations, NULL, bowBatch, featBatch);
+    vector<double> vTimesParallel = TimeBatch(voc, descriptorBlock, nIterations, &threadPool, bowParallel,
+                                              featParallel);
+
+    cout << "words: " << voc.size() << ", descriptors: " << vDesc.size() << ", iterations: " << nIterations << endl;
+    cout << "flatten: " << flattenTime << " ms" << endl;
+    cout << "tree median: " << vTimesTree[nIterations / 2] << " ms, p99: "
+         << vTimesTree[nIterations * 99 / 100] << " ms" << endl;
+    cout << "flat median: " << vTimesFlat[nIterations / 2] << " ms, p99: "
+         << vTimesFlat[nIterations * 99 / 100] << " ms" << endl;
+    cout << "speedup: " << vTimesTree[nIterations / 2] / vTimesFlat[nIterations / 2] << "x" << endl;
+    cout << "flat batch median: " << vTimesBatch[nIterations / 2] << " ms, p99: "
+         << vTimesBatch[nIterations * 99 / 100] << " ms" << endl;
+    cout << "flat batch " << nThreads << " threads median: " << vTimesParallel[nIterations / 2] << " ms, p99: "
+         << vTimesParallel[nIterations * 99 / 100] << " ms" << endl;
+
+    const DBoW2::FlatBowVector bowTreeFlat(bowTree);
+    const DBoW2::FlatFeatureVector featTreeFlat(featTree);
+    if (bowTree != bowFlat || featTree != featFlat || bowTreeFlat != bowBatch || featTreeFlat != featBatch ||
+        bowTreeFlat != bowParallel || featTreeFlat != featParallel)
+    {
+        cerr << "ERROR: flat or batch vocabulary output differs from tree output" << endl;
+        return 1;
+    }
+    cout << "output identical: yes" << endl;
+
+    return 0;
+}
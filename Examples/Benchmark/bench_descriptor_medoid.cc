@@ -0,0 +1,177 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* 地图点代表性描述子性能测试：对不同观测数量的地图点，模拟观测逐个加入以及之后的删除和替换，
+* 每次变化后选择代表性描述子。比较原来每次重新计算所有两两距离的方法与DescriptorMedoid增量方法的耗时，
+* 并检查两者选出的描述子完全相同。
+*/
+
+
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<random>
+#include<vector>
+#include<climits>
+
+#include<DescriptorMedoid.h>
+#include<ORBmatcher.h>
+
+
+using namespace std;
+
+const int DESC_SIZE = 32;
+
+// 一个观测：关键帧Id和描述子
+struct Observation
+{
+    unsigned long nKey;
+    uchar descriptor[DESC_SIZE];
+};
+
+// 原来的MapPoint::ComputeDistinctiveDescriptors：观测按关键帧Id排序，计算所有两两距离，取距离中值最小的。
+unsigned long BatchBest(const vector<Observation> &vObs)
+{
+    const size_t N = vObs.size();
+    std::vector<std::vector<float> > Distances;
+    Distances.resize(N, vector<float>(N, 0));
+    for (size_t i = 0; i < N; i++)
+    {
+        Distances[i][i] = 0;
+        for (size_t j = i + 1; j < N; j++)
+        {
+            int distij = ORB_SLAM2::ORBmatcher::DescriptorDistance(vObs[i].descriptor, vObs[j].descriptor);
+            Distances[i][j] = distij;
+            Distances[j][i] = distij;
+        }
+    }
+
+    int BestMedian = INT_MAX;
+    int BestIdx = 0;
+    for (size_t i = 0; i < N; i++)
+    {
+        vector<int> vDists(Distances[i].begin(), Distances[i].end());
+        sort(vDists.begin(), vDists.end());
+        int median = vDists[0.5 * (N - 1)];
+        if (median < BestMedian)
+        {
+            BestMedian = median;
+            BestIdx = i;
+        }
+    }
+    return vObs[BestIdx].nKey;
+}
+
+// 同一个地图点在不同关键帧中的描述子：在基准描述子上随机翻转最多nMaxFlips位
+Observation MakeObservation(const uchar *pBase, const unsigned long nKey, const int nMaxFlips, std::mt19937 &rng)
+{
+    Observation obs;
+    obs.nKey = nKey;
+    copy(pBase, pBase + DESC_SIZE, obs.descriptor);
+    const int nFlips = rng() % (nMaxFlips + 1);
+    for (int i = 0; i < nFlips; i++)
+    {
+        const int bit = rng() % (DESC_SIZE * 8);
+        obs.descriptor[bit / 8] ^= (uchar) (1 << (bit % 8));
+    }
+    return obs;
+}
+
+int main(int argc, char **argv)
+{
+    const int nPoints = argc > 1 ? atoi(argv[1]) : 200;
+    // 观测数达到n后，再删除并加入观测的次数
+    const int nChurn = argc > 2 ? atoi(argv[2]) : 50;
+    const int vnObservations[] = {2, 4, 8, 16, 32, 64, 128};
+    const int nMaxFlips = 40;
+
+    cout << "points: " << nPoints << ", churn updates per point: " << nChurn << endl;
+    cout << "observations\tbatch us/update\tincremental us/update\tspeedup\tidentical" << endl;
+
+    bool bAllIdentical = true;
+    for (size_t t = 0; t < sizeof(vnObservations) / sizeof(vnObservations[0]); t++)
+    {
+        const int n = vnObservations[t];
+        std::mt19937 rng(n);
+
+        // 每个地图点的更新序列：先逐个加入n个观测，然后nChurn次删除一个随机观测、加入一个新观测
+        vector<vector<Observation> > vvAdds(nPoints);
+        vector<vector<int> > vvRemoves(nPoints);
+        for (int p = 0; p < nPoints; p++)
+        {
+            uchar base[DESC_SIZE];
+            for (int i = 0; i < DESC_SIZE; i++)
+                base[i] = (uchar) rng();
+            for (int i = 0; i < n + nChurn; i++)
+                vvAdds[p].push_back(MakeObservation(base, i, nMaxFlips, rng));
+            for (int i = 0; i < nChurn; i++)
+                vvRemoves[p].push_back(rng() % n);
+        }
+
+        const int nUpdates = nPoints * (n + nChurn);
+        vector<unsigned long> vBatchKeys, vIncrementalKeys;
+        vBatchKeys.reserve(nUpdates);
+        vIncrementalKeys.reserve(nUpdates);
+
+        // 原来的方法：每次变化后重新计算
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        for (int p = 0; p < nPoints; p++)
+        {
+            vector<Observation> vObs;
+            for (int i = 0; i < n + nChurn; i++)
+            {
+                if (i >= n)
+                    vObs.erase(vObs.begin() + vvRemoves[p][i - n]);
+                // 新关键帧的Id最大，加在最后仍然按Id排序
+                vObs.push_back(vvAdds[p][i]);
+                vBatchKeys.push_back(BatchBest(vObs));
+            }
+        }
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+        // 增量方法
+        for (int p = 0; p < nPoints; p++)
+        {
+            ORB_SLAM2::DescriptorMedoid medoid;
+            vector<unsigned long> vKeys;
+            for (int i = 0; i < n + nChurn; i++)
+            {
+                if (i >= n)
+                {
+                    // 删除与原来方法相同的观测(第k小的关键帧Id)
+                    const unsigned long nKey = vKeys[vvRemoves[p][i - n]];
+                    vKeys.erase(vKeys.begin() + vvRemoves[p][i - n]);
+                    for (int j = 0; j < medoid.Size(); j++)
+                    {
+                        if (medoid.Key(j) == nKey)
+                        {
+                            medoid.Remove(j);
+                            break;
+                        }
+                    }
+                }
+                medoid.Add(vvAdds[p][i].descriptor, vvAdds[p][i].nKey, 0);
+                vKeys.push_back(vvAdds[p][i].nKey);
+                vIncrementalKeys.push_back(medoid.Key(medoid.Best()));
+            }
+        }
+        std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+
+        const double batchUs = std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(t2 - t1).count();
+        const double incrementalUs =
+                std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(t3 - t2).count();
+        const bool bIdentical = vBatchKeys == vIncrementalKeys;
+        bAllIdentical = bAllIdentical && bIdentical;
+
+        cout << n << "\t\t" << batchUs / nUpdates << "\t\t" << incrementalUs / nUpdates << "\t\t\t"
+             << batchUs / incrementalUs << "\t" << (bIdentical ? "yes" : "NO") << endl;
+    }
+
+    if (!bAllIdentical)
+    {
+        cerr << "ERROR: incremental medoid differs from batch computation" << endl;
+        return 1;
+    }
+
+    return 0;
+}
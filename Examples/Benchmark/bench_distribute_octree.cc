@@ -0,0 +1,440 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* DistributeOctTree性能测试：比较原先基于std::list的四叉树与扁平数组四叉树的耗时。
+* 对图像缩放到752x480(EuRoC)和1241x376(KITTI)，用FAST提取候选点后均匀化到1000~2000个特征。
+*/
+
+
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<list>
+#include<vector>
+#include<cmath>
+
+#include<opencv2/core/core.hpp>
+#include<opencv2/features2d/features2d.hpp>
+#include<opencv2/highgui/highgui.hpp>
+#include<opencv2/imgproc/imgproc.hpp>
+
+#include<ORBextractor.h>
+
+
+using namespace std;
+
+// 原先的实现，作为性能对比的基准
+class LegacyNode
+{
+public:
+
+    LegacyNode() : bNoMore(false)
+    {}
+
+    void DivideNode(LegacyNode &n1, LegacyNode &n2, LegacyNode &n3, LegacyNode &n4);
+
+    std::vector<cv::KeyPoint> vKeys;
+    cv::Point2i UL, UR, BL, BR;
+    std::list<LegacyNode>::iterator lit;
+    bool bNoMore;
+};
+
+void LegacyNode::DivideNode(LegacyNode &n1, LegacyNode &n2, LegacyNode &n3, LegacyNode &n4)
+{
+    const int halfX = ceil(static_cast<float>(UR.x - UL.x) / 2);
+    const int halfY = ceil(static_cast<float>(BR.y - UL.y) / 2);
+
+    //Define boundaries of childs
+    n1.UL = UL;
+    n1.UR = cv::Point2i(UL.x + halfX, UL.y);
+    n1.BL = cv::Point2i(UL.x, UL.y + halfY);
+    n1.BR = cv::Point2i(UL.x + halfX, UL.y + halfY);
+    n1.vKeys.reserve(vKeys.size());
+
+    n2.UL = n1.UR;
+    n2.UR = UR;
+    n2.BL = n1.BR;
+    n2.BR = cv::Point2i(UR.x, UL.y + halfY);
+    n2.vKeys.reserve(vKeys.size());
+
+    n3.UL = n1.BL;
+    n3.UR = n1.BR;
+    n3.BL = BL;
+    n3.BR = cv::Point2i(n1.BR.x, BL.y);
+    n3.vKeys.reserve(vKeys.size());
+
+    n4.UL = n3.UR;
+    n4.UR = n2.BR;
+    n4.BL = n3.BR;
+    n4.BR = BR;
+    n4.vKeys.reserve(vKeys.size());
+
+    //Associate points to childs
+    for (size_t i = 0; i < vKeys.size(); i++)
+    {
+        const cv::KeyPoint &kp = vKeys[i];
+        if (kp.pt.x < n1.UR.x)
+        {
+            if (kp.pt.y < n1.BR.y)
+                n1.vKeys.push_back(kp);
+            else
+                n3.vKeys.push_back(kp);
+        }
+        else if (kp.pt.y < n1.BR.y)
+            n2.vKeys.push_back(kp);
+        else
+            n4.vKeys.push_back(kp);
+    }
+
+    if (n1.vKeys.size() == 1)
+        n1.bNoMore = true;
+    if (n2.vKeys.size() == 1)
+        n2.bNoMore = true;
+    if (n3.vKeys.size() == 1)
+        n3.bNoMore = true;
+    if (n4.vKeys.size() == 1)
+        n4.bNoMore = true;
+
+}
+
+vector<cv::KeyPoint> LegacyDistributeOctTree(const vector<cv::KeyPoint> &vToDistributeKeys, const int &minX,
+                                            const int &maxX, const int &minY, const int &maxY,
+                                            const int &N)
+{
+    // Compute how many initial nodes
+    const int nIni = round(static_cast<float>(maxX - minX) / (maxY - minY));
+
+    const float hX = static_cast<float>(maxX - minX) / nIni;
+
+    list<LegacyNode> lNodes;
+
+    vector<LegacyNode *> vpIniNodes;
+    vpIniNodes.resize(nIni);
+
+    for (int i = 0; i < nIni; i++)
+    {
+        LegacyNode ni;
+        ni.UL = cv::Point2i(hX * static_cast<float>(i), 0);
+        ni.UR = cv::Point2i(hX * static_cast<float>(i + 1), 0);
+        ni.BL = cv::Point2i(ni.UL.x, maxY - minY);
+        ni.BR = cv::Point2i(ni.UR.x, maxY - minY);
+        ni.vKeys.reserve(vToDistributeKeys.size());
+
+        lNodes.push_back(ni);
+        vpIniNodes[i] = &lNodes.back();
+    }
+
+    //Associate points to childs
+    for (size_t i = 0; i < vToDistributeKeys.size(); i++)
+    {
+        const cv::KeyPoint &kp = vToDistributeKeys[i];
+        vpIniNodes[kp.pt.x / hX]->vKeys.push_back(kp);
+    }
+
+    list<LegacyNode>::iterator lit = lNodes.begin();
+
+    while (lit != lNodes.end())
+    {
+        if (lit->vKeys.size() == 1)
+        {
+            lit->bNoMore = true;
+            lit++;
+        }
+        else if (lit->vKeys.empty())
+            lit = lNodes.erase(lit);
+        else
+            lit++;
+    }
+
+    bool bFinish = false;
+
+    int iteration = 0;
+
+    vector<pair<int, LegacyNode *> > vSizeAndPointerToNode;
+    vSizeAndPointerToNode.reserve(lNodes.size() * 4);
+
+    // 根据兴趣点分布,利用N叉树方法对图像进行划分区域
+    while (!bFinish)
+    {
+        iteration++;
+
+        int prevSize = lNodes.size();
+
+        lit = lNodes.begin();
+
+        int nToExpand = 0;
+
+        vSizeAndPointerToNode.clear();
+
+        // 将目前的子区域经行划分
+        while (lit != lNodes.end())
+        {
+            if (lit->bNoMore)
+            {
+                // If node only contains one point do not subdivide and continue
+                lit++;
+                continue;
+            }
+            else
+            {
+                // If more than one point, subdivide
+                LegacyNode n1, n2, n3, n4;
+                lit->DivideNode(n1, n2, n3, n4); // 再细分成四个子区域
+
+                // Add childs if they contain points
+                if (n1.vKeys.size() > 0)
+                {
+                    lNodes.push_front(n1);
+                    if (n1.vKeys.size() > 1)
+                    {
+                        nToExpand++;
+                        vSizeAndPointerToNode.push_back(make_pair(n1.vKeys.size(), &lNodes.front()));
+                        lNodes.front().lit = lNodes.begin();
+                    }
+                }
+                if (n2.vKeys.size() > 0)
+                {
+                    lNodes.push_front(n2);
+                    if (n2.vKeys.size() > 1)
+                    {
+                        nToExpand++;
+                        vSizeAndPointerToNode.push_back(make_pair(n2.vKeys.size(), &lNodes.front()));
+                        lNodes.front().lit = lNodes.begin();
+                    }
+                }
+                if (n3.vKeys.size() > 0)
+                {
+                    lNodes.push_front(n3);
+                    if (n3.vKeys.size() > 1)
+                    {
+                        nToExpand++;
+                        vSizeAndPointerToNode.push_back(make_pair(n3.vKeys.size(), &lNodes.front()));
+                        lNodes.front().lit = lNodes.begin();
+                    }
+                }
+                if (n4.vKeys.size() > 0)
+                {
+                    lNodes.push_front(n4);
+                    if (n4.vKeys.size() > 1)
+                    {
+                        nToExpand++;
+                        vSizeAndPointerToNode.push_back(make_pair(n4.vKeys.size(), &lNodes.front()));
+                        lNodes.front().lit = lNodes.begin();
+                    }
+                }
+
+                lit = lNodes.erase(lit);
+                continue;
+            }
+        }
+
+        // Finish if there are more nodes than required features
+        // or all nodes contain just one point
+        if ((int) lNodes.size() >= N || (int) lNodes.size() == prevSize)
+        {
+            bFinish = true;
+        }
+            // 当再划分之后所有的Node数大于要求数目时
+        else if (((int) lNodes.size() + nToExpand * 3) > N)
+        {
+
+            while (!bFinish)
+            {
+
+                prevSize = lNodes.size();
+
+                vector<pair<int, LegacyNode *> > vPrevSizeAndPointerToNode = vSizeAndPointerToNode;
+                vSizeAndPointerToNode.clear();
+
+                // 对需要划分的部分进行排序, 即对兴趣点数较多的区域进行划分
+                sort(vPrevSizeAndPointerToNode.begin(), vPrevSizeAndPointerToNode.end());
+                for (int j = vPrevSizeAndPointerToNode.size() - 1; j >= 0; j--)
+                {
+                    LegacyNode n1, n2, n3, n4;
+                    vPrevSizeAndPointerToNode[j].second->DivideNode(n1, n2, n3, n4);
+
+                    // Add childs if they contain points
+                    if (n1.vKeys.size() > 0)
+                    {
+                        lNodes.push_front(n1);
+                        if (n1.vKeys.size() > 1)
+                        {
+                            vSizeAndPointerToNode.push_back(make_pair(n1.vKeys.size(), &lNodes.front()));
+                            lNodes.front().lit = lNodes.begin();
+                        }
+                    }
+                    if (n2.vKeys.size() > 0)
+                    {
+                        lNodes.push_front(n2);
+                        if (n2.vKeys.size() > 1)
+                        {
+                            vSizeAndPointerToNode.push_back(make_pair(n2.vKeys.size(), &lNodes.front()));
+                            lNodes.front().lit = lNodes.begin();
+                        }
+                    }
+                    if (n3.vKeys.size() > 0)
+                    {
+                        lNodes.push_front(n3);
+                        if (n3.vKeys.size() > 1)
+                        {
+                            vSizeAndPointerToNode.push_back(make_pair(n3.vKeys.size(), &lNodes.front()));
+                            lNodes.front().lit = lNodes.begin();
+                        }
+                    }
+                    if (n4.vKeys.size() > 0)
+                    {
+                        lNodes.push_front(n4);
+                        if (n4.vKeys.size() > 1)
+                        {
+                            vSizeAndPointerToNode.push_back(make_pair(n4.vKeys.size(), &lNodes.front()));
+                            lNodes.front().lit = lNodes.begin();
+                        }
+                    }
+
+                    lNodes.erase(vPrevSizeAndPointerToNode[j].second->lit);
+
+                    if ((int) lNodes.size() >= N)
+                        break;
+                }
+
+                if ((int) lNodes.size() >= N || (int) lNodes.size() == prevSize)
+                    bFinish = true;
+
+            }
+        }
+    }
+
+    // Retain the best point in each node
+    // 保留每个区域响应值最大的一个兴趣点
+    vector<cv::KeyPoint> vResultKeys;
+    vResultKeys.reserve(N);
+    for (list<LegacyNode>::iterator lit = lNodes.begin(); lit != lNodes.end(); lit++)
+    {
+        vector<cv::KeyPoint> &vNodeKeys = lit->vKeys;
+        cv::KeyPoint *pKP = &vNodeKeys[0];
+        float maxResponse = pKP->response;
+
+        for (size_t k = 1; k < vNodeKeys.size(); k++)
+        {
+            if (vNodeKeys[k].response > maxResponse)
+            {
+                pKP = &vNodeKeys[k];
+                maxResponse = vNodeKeys[k].response;
+            }
+        }
+
+        vResultKeys.push_back(*pKP);
+    }
+
+    return vResultKeys;
+}
+
+// 暴露ORBextractor中受保护的DistributeOctTree
+class OctTreeExtractor : public ORB_SLAM2::ORBextractor
+{
+public:
+    OctTreeExtractor(int nfeatures) : ORBextractor(nfeatures, 1.2f, 8, 20, 7)
+    {}
+
+    using ORBextractor::DistributeOctTree;
+};
+
+double Median(vector<double> &vTimes)
+{
+    sort(vTimes.begin(), vTimes.end());
+    return vTimes[vTimes.size() / 2];
+}
+
+// 两组结果中位置相同的特征点数(点数相同的节点划分顺序不同，结果可能有少量差异)
+int CountCommon(vector<cv::KeyPoint> vKeys1, vector<cv::KeyPoint> vKeys2)
+{
+    auto lessPt = [](const cv::KeyPoint &a, const cv::KeyPoint &b)
+    {
+        return a.pt.x < b.pt.x || (a.pt.x == b.pt.x && a.pt.y < b.pt.y);
+    };
+    sort(vKeys1.begin(), vKeys1.end(), lessPt);
+    sort(vKeys2.begin(), vKeys2.end(), lessPt);
+
+    vector<cv::KeyPoint> vCommon;
+    set_intersection(vKeys1.begin(), vKeys1.end(), vKeys2.begin(), vKeys2.end(), back_inserter(vCommon), lessPt);
+    return (int) vCommon.size();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        cerr << endl << "Usage: ./bench_distribute_octree image [iterations]" << endl;
+        return 1;
+    }
+
+    cv::Mat im = cv::imread(argv[1], CV_LOAD_IMAGE_UNCHANGED);
+    if (im.empty())
+    {
+        cerr << "Failed to load image at: " << argv[1] << endl;
+        return 1;
+    }
+    if (im.channels() == 3)
+        cv::cvtColor(im, im, CV_BGR2GRAY);
+    else if (im.channels() == 4)
+        cv::cvtColor(im, im, CV_BGRA2GRAY);
+
+    const int nIterations = argc > 2 ? atoi(argv[2]) : 200;
+
+    const cv::Size vSizes[2] = {cv::Size(752, 480), cv::Size(1241, 376)};
+    const int vFeatures[3] = {1000, 1500, 2000};
+
+    // 与ORBextractor::ComputeKeyPointsLevel相同的边界
+    const int EDGE_THRESHOLD = 19;
+    const int minBorderX = EDGE_THRESHOLD - 3;
+    const int minBorderY = minBorderX;
+
+    for (int s = 0; s < 2; s++)
+    {
+        cv::Mat imResized;
+        cv::resize(im, imResized, vSizes[s]);
+
+        const int maxBorderX = imResized.cols - EDGE_THRESHOLD + 3;
+        const int maxBorderY = imResized.rows - EDGE_THRESHOLD + 3;
+
+        // 候选点坐标相对于(minBorderX, minBorderY)
+        vector<cv::KeyPoint> vToDistributeKeys;
+        cv::FAST(imResized.rowRange(minBorderY, maxBorderY).colRange(minBorderX, maxBorderX),
+                 vToDistributeKeys, 7, true);
+
+        for (int f = 0; f < 3; f++)
+        {
+            const int N = vFeatures[f];
+            OctTreeExtractor extractor(N);
+
+            vector<cv::KeyPoint> vLegacyKeys, vFlatKeys;
+            vector<double> vLegacyTimes, vFlatTimes;
+            for (int i = 0; i < nIterations; i++)
+            {
+                std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+                vLegacyKeys = LegacyDistributeOctTree(vToDistributeKeys, minBorderX, maxBorderX,
+                                                      minBorderY, maxBorderY, N);
+                std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+                extractor.DistributeOctTree(vToDistributeKeys, minBorderX, maxBorderX,
+                                            minBorderY, maxBorderY, N, 0, vFlatKeys);
+                std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+
+                vLegacyTimes.push_back(
+                        std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t2 - t1).count());
+                vFlatTimes.push_back(
+                        std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t3 - t2).count());
+            }
+
+            const double legacy = Median(vLegacyTimes);
+            const double flat = Median(vFlatTimes);
+            cout << imResized.cols << "x" << imResized.rows << ", candidates: " << vToDistributeKeys.size()
+                 << ", features: " << N << endl;
+            cout << "  list median: " << legacy << " ms, flat median: " << flat << " ms, speedup: "
+                 << legacy / flat << "x" << endl;
+            cout << "  retained: " << vLegacyKeys.size() << " / " << vFlatKeys.size()
+                 << ", common: " << CountCommon(vLegacyKeys, vFlatKeys) << endl;
+        }
+    }
+
+    return 0;
+}
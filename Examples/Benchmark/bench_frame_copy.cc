@@ -0,0 +1,190 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Frame拷贝性能测试：比较共享特征数据的拷贝与复制全部特征数据的深拷贝的耗时和内存分配次数，
+* 并模拟Tracking中mLastFrame、mInitialFrame和mv20FramesReloc的拷贝方式。
+*/
+
+
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<vector>
+#include<cerrno>
+#include<atomic>
+#include<memory>
+
+#include<opencv2/core/core.hpp>
+#include<opencv2/highgui/highgui.hpp>
+#include<opencv2/imgproc/imgproc.hpp>
+
+#include<Frame.h>
+#include<ORBextractor.h>
+
+
+using namespace std;
+
+// 替换glibc的分配函数以统计分配次数(包括OpenCV的cv::fastMalloc)
+static std::atomic<long> nAllocations(0);
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    nAllocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    nAllocations++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    nAllocations++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    nAllocations++;
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+}
+#endif
+
+// 共享特征数据的拷贝
+void SharedCopy(const ORB_SLAM2::Frame &F, ORB_SLAM2::Frame &copy)
+{
+    copy = ORB_SLAM2::Frame(F);
+}
+
+// 同时复制特征数据，相当于特征数据还是Frame成员时的拷贝
+void DeepCopy(const ORB_SLAM2::Frame &F, ORB_SLAM2::Frame &copy)
+{
+    copy = ORB_SLAM2::Frame(F);
+    copy.mpFeatures = std::make_shared<ORB_SLAM2::FrameFeatures>(*F.mpFeatures);
+}
+
+// 每帧跟踪中的拷贝：mLastFrame = Frame(mCurrentFrame)，重定位后的20帧存入mv20FramesReloc
+void TrackingCopies(const ORB_SLAM2::Frame &F, ORB_SLAM2::Frame &lastFrame,
+                    vector<ORB_SLAM2::Frame> &vFramesReloc, bool bDeep)
+{
+    if (bDeep)
+        DeepCopy(F, lastFrame);
+    else
+        SharedCopy(F, lastFrame);
+
+    vFramesReloc.clear();
+    for (int i = 0; i < 20; i++)
+    {
+        vFramesReloc.push_back(F);
+        if (bDeep)
+            vFramesReloc.back().mpFeatures = std::make_shared<ORB_SLAM2::FrameFeatures>(*F.mpFeatures);
+    }
+}
+
+// 重复nIterations次，返回排序后的耗时(us)和每次的平均分配次数
+vector<double> TimeCopies(const ORB_SLAM2::Frame &F, const int nIterations, bool bDeep, double &allocations)
+{
+    ORB_SLAM2::Frame lastFrame;
+    vector<ORB_SLAM2::Frame> vFramesReloc;
+    vFramesReloc.reserve(20);
+
+    // 预热
+    TrackingCopies(F, lastFrame, vFramesReloc, bDeep);
+
+    vector<double> vTimes;
+    vTimes.reserve(nIterations);
+
+    const long nBefore = nAllocations.load();
+    for (int i = 0; i < nIterations; i++)
+    {
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        TrackingCopies(F, lastFrame, vFramesReloc, bDeep);
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+        vTimes.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(t2 - t1).count());
+    }
+    allocations = (double) (nAllocations.load() - nBefore) / nIterations;
+
+    sort(vTimes.begin(), vTimes.end());
+    return vTimes;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << endl << "Usage: ./bench_frame_copy settings image [iterations]" << endl;
+        return 1;
+    }
+
+    cv::FileStorage fSettings(argv[1], cv::FileStorage::READ);
+    if (!fSettings.isOpened())
+    {
+        cerr << "Failed to open settings file at: " << argv[1] << endl;
+        return 1;
+    }
+
+    cv::Mat im = cv::imread(argv[2], CV_LOAD_IMAGE_UNCHANGED);
+    if (im.empty())
+    {
+        cerr << "Failed to load image at: " << argv[2] << endl;
+        return 1;
+    }
+    if (im.channels() == 3)
+        cv::cvtColor(im, im, CV_BGR2GRAY);
+    else if (im.channels() == 4)
+        cv::cvtColor(im, im, CV_BGRA2GRAY);
+
+    const int nIterations = argc > 3 ? atoi(argv[3]) : 1000;
+
+    cv::Mat K = cv::Mat::eye(3, 3, CV_32F);
+    K.at<float>(0, 0) = fSettings["Camera.fx"];
+    K.at<float>(1, 1) = fSettings["Camera.fy"];
+    K.at<float>(0, 2) = fSettings["Camera.cx"];
+    K.at<float>(1, 2) = fSettings["Camera.cy"];
+
+    cv::Mat DistCoef(4, 1, CV_32F);
+    DistCoef.at<float>(0) = fSettings["Camera.k1"];
+    DistCoef.at<float>(1) = fSettings["Camera.k2"];
+    DistCoef.at<float>(2) = fSettings["Camera.p1"];
+    DistCoef.at<float>(3) = fSettings["Camera.p2"];
+
+    const float bf = fSettings["Camera.bf"];
+
+    int nFeatures = fSettings["ORBextractor.nFeatures"];
+    float fScaleFactor = fSettings["ORBextractor.scaleFactor"];
+    int nLevels = fSettings["ORBextractor.nLevels"];
+    int fIniThFAST = fSettings["ORBextractor.iniThFAST"];
+    int fMinThFAST = fSettings["ORBextractor.minThFAST"];
+
+    ORB_SLAM2::ORBextractor extractor(nFeatures, fScaleFactor, nLevels, fIniThFAST, fMinThFAST);
+
+    // 不需要词袋向量，词典为空
+    ORB_SLAM2::Frame F(im, 0, &extractor, static_cast<ORB_SLAM2::ORBVocabulary *>(NULL), K, DistCoef, bf, 0);
+    F.SetPose(cv::Mat::eye(4, 4, CV_32F));
+
+    double allocationsShared, allocationsDeep;
+    vector<double> vTimesShared = TimeCopies(F, nIterations, false, allocationsShared);
+    vector<double> vTimesDeep = TimeCopies(F, nIterations, true, allocationsDeep);
+
+    cout << "features: " << F.N << ", iterations: " << nIterations << " (1 + 20 frame copies each)" << endl;
+    cout << "shared copy median: " << vTimesShared[nIterations / 2] << " us, p99: "
+         << vTimesShared[nIterations * 99 / 100] << " us" << endl;
+    cout << "deep copy   median: " << vTimesDeep[nIterations / 2] << " us, p99: "
+         << vTimesDeep[nIterations * 99 / 100] << " us" << endl;
+    cout << "speedup: " << vTimesDeep[nIterations / 2] / vTimesShared[nIterations / 2] << "x" << endl;
+#ifdef __GLIBC__
+    cout << "allocations per iteration, shared: " << allocationsShared << ", deep: " << allocationsDeep << endl;
+#endif
+
+    return 0;
+}
@@ -0,0 +1,246 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* 关键帧换出性能测试：模拟长时间运行，不断创建带有随机特征数据的关键帧，每个关键帧新建若干地图点，
+* 由当前和前两个关键帧观测，计算描述子和平均观测方向。
+* 每隔一段时间随机读取旧关键帧的特征数据(模拟重定位和闭环)，检查读入的数据与原来相同。
+* 最后不再新建关键帧，读取所有关键帧的特征数据(模拟全局BA和只定位模式)。
+* 统计常驻内存的特征数据、进程RSS和读入耗时。内存预算为0时不换出，用于对比。
+*/
+
+
+#include<iostream>
+#include<fstream>
+#include<random>
+#include<vector>
+#include<string>
+#include<cmath>
+#include<unistd.h>
+
+#include<opencv2/core/core.hpp>
+
+#include<Map.h>
+#include<MapPoint.h>
+#include<KeyFrame.h>
+#include<Frame.h>
+
+
+using namespace std;
+
+// 进程常驻内存(MB)
+double ResidentMB()
+{
+    ifstream f("/proc/self/statm");
+    size_t nPages = 0, nResident = 0;
+    f >> nPages >> nResident;
+    return nResident * (double) sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+}
+
+// 描述子的校验值
+unsigned long Checksum(const ORB_SLAM2::DescriptorBlock &descriptors)
+{
+    unsigned long sum = 0;
+    for (int i = 0; i < descriptors.Rows(); i++)
+        for (int j = 0; j < ORB_SLAM2::DescriptorBlock::DESC_SIZE; j++)
+            sum = sum * 31 + descriptors.Row(i)[j];
+    return sum;
+}
+
+// 随机的特征点、描述子、词袋向量、栅格和IMU测量
+void FillFrame(ORB_SLAM2::Frame &F, const int N, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> uniformX(0, 752), uniformY(0, 480);
+    F.mpFeatures = std::make_shared<ORB_SLAM2::FrameFeatures>();
+    ORB_SLAM2::FrameFeatures &features = *F.mpFeatures;
+    F.N = N;
+
+    features.mvKeys.resize(N);
+    for (int i = 0; i < N; i++)
+        features.mvKeys[i] = cv::KeyPoint(uniformX(rng), uniformY(rng), 31, 0, 1, i % 8);
+    features.mvKeysUn = features.mvKeys;
+    features.mvuRight.assign(N, -1);
+    features.mvDepth.assign(N, -1);
+
+    vector<uchar> vDescriptors((size_t) N * ORB_SLAM2::DescriptorBlock::DESC_SIZE);
+    for (size_t i = 0; i < vDescriptors.size(); i++)
+        vDescriptors[i] = (uchar) rng();
+    features.mDescriptorBlock = ORB_SLAM2::DescriptorBlock(vDescriptors.data(), N);
+    features.mDescriptors = features.mDescriptorBlock.Mat();
+
+    // 每个节点(单词)2个特征点
+    features.mBowVec.reserve(N / 2);
+    features.mFeatVec.reserve(N / 2, N);
+    for (int i = 0; i + 1 < N; i += 2)
+    {
+        const unsigned int vIndices[2] = {(unsigned int) i, (unsigned int) i + 1};
+        features.mBowVec.push_back(i * 7, 1.0 / N);
+        features.mFeatVec.push_back(i * 7, vIndices, 2);
+    }
+
+    const int nCells = FRAME_GRID_COLS * FRAME_GRID_ROWS;
+    features.mvGridOffsets.assign(nCells + 1, 0);
+    for (int i = 0; i < N; i++)
+        features.mvGridOffsets[i % nCells + 1]++;
+    for (int c = 0; c < nCells; c++)
+        features.mvGridOffsets[c + 1] += features.mvGridOffsets[c];
+    features.mvGridIndices.resize(N);
+    vector<unsigned int> vNext(features.mvGridOffsets.begin(), features.mvGridOffsets.end() - 1);
+    for (int i = 0; i < N; i++)
+        features.mvGridIndices[vNext[i % nCells]++] = i;
+
+    F.mvpMapPoints.assign(N, static_cast<ORB_SLAM2::MapPoint *>(NULL));
+    F.mvbOutlier.assign(N, false);
+}
+
+int main(int argc, char **argv)
+{
+    const int nKeyFrames = argc > 1 ? atoi(argv[1]) : 2000;
+    const int nBudgetMB = argc > 2 ? atoi(argv[2]) : 64;
+    const string strSpillFile = argc > 3 ? argv[3] : "bench_keyframe_store.bin";
+    const int nNewPoints = argc > 4 ? atoi(argv[4]) : 100;
+    const int N = 1000;
+    // 关键帧之间0.5s，200Hz的IMU
+    const int nIMU = 100;
+    // 每隔nPageInPeriod个关键帧读取一个随机的旧关键帧
+    const int nPageInPeriod = 5;
+    const int nReportPeriod = nKeyFrames / 10 > 0 ? nKeyFrames / 10 : 1;
+
+    ORB_SLAM2::Map map;
+    if (!map.mKeyFrameStore.Open(strSpillFile, (size_t) nBudgetMB))
+        return 1;
+
+    // 构造关键帧用的Frame
+    ORB_SLAM2::Frame F;
+    F.mpORBvocabulary = static_cast<ORB_SLAM2::ORBVocabulary *>(NULL);
+    F.mpReferenceKF = static_cast<ORB_SLAM2::KeyFrame *>(NULL);
+    F.mK = cv::Mat::eye(3, 3, CV_32F);
+    F.mbf = 0;
+    F.mb = 0;
+    F.mThDepth = 0;
+    F.mnScaleLevels = 8;
+    F.mfScaleFactor = 1.2f;
+    F.mfLogScaleFactor = log(1.2f);
+    for (int i = 0; i < F.mnScaleLevels; i++)
+    {
+        F.mvScaleFactors.push_back(pow(1.2f, i));
+        F.mvInvScaleFactors.push_back(1.0f / F.mvScaleFactors.back());
+        F.mvLevelSigma2.push_back(F.mvScaleFactors.back() * F.mvScaleFactors.back());
+        F.mvInvLevelSigma2.push_back(1.0f / F.mvLevelSigma2.back());
+    }
+    F.mTcw = cv::Mat::eye(4, 4, CV_32F);
+
+    std::mt19937 rng(0);
+    vector<ORB_SLAM2::KeyFrame *> vpKFs;
+    vector<unsigned long> vChecksums;
+    vpKFs.reserve(nKeyFrames);
+    vChecksums.reserve(nKeyFrames);
+
+    cout << "keyframes: " << nKeyFrames << ", features: " << N << ", new map points per keyframe: " << nNewPoints
+         << ", budget: " << nBudgetMB << " MB" << endl;
+    std::uniform_real_distribution<float> uniformPos(-10, 10);
+    double warmMB = ResidentMB();
+    size_t nMismatches = 0;
+
+    for (int i = 0; i < nKeyFrames; i++)
+    {
+        FillFrame(F, N, rng);
+        F.mnId = i;
+        F.mTimeStamp = 0.5 * i;
+
+        vector<ORB_SLAM2::IMUData> vIMUData;
+        vIMUData.reserve(nIMU);
+        for (int j = 0; j < nIMU; j++)
+            vIMUData.push_back(ORB_SLAM2::IMUData(0, 0, 0, 0, 0, 9.8, F.mTimeStamp - 0.5 + 0.005 * j));
+
+        ORB_SLAM2::KeyFrame *pKF = new ORB_SLAM2::KeyFrame(F, &map, static_cast<ORB_SLAM2::KeyFrameDatabase *>(NULL),
+                                                           vIMUData, vpKFs.empty() ? NULL : vpKFs.back());
+        map.AddKeyFrame(pKF);
+        vpKFs.push_back(pKF);
+        vChecksums.push_back(Checksum(F.mpFeatures->mDescriptorBlock));
+        F.mpFeatures.reset();
+
+        // 新的地图点，由当前和前两个关键帧的同一个特征点观测
+        for (int j = 0; j < nNewPoints && nNewPoints <= N; j++)
+        {
+            const size_t idx = (size_t) j * N / nNewPoints;
+            const cv::Mat Pos = (cv::Mat_<float>(3, 1) << uniformPos(rng), uniformPos(rng), 10 + uniformPos(rng));
+            ORB_SLAM2::MapPoint *pMP = new ORB_SLAM2::MapPoint(Pos, pKF, &map);
+            for (size_t k = vpKFs.size() >= 3 ? vpKFs.size() - 3 : 0; k < vpKFs.size(); k++)
+            {
+                pMP->AddObservation(vpKFs[k], idx);
+                vpKFs[k]->AddMapPoint(pMP, idx);
+            }
+            pMP->ComputeDistinctiveDescriptors();
+            pMP->UpdateNormalAndDepth();
+            map.AddMapPoint(pMP);
+        }
+
+        // 局部建图处理完关键帧后换出
+        if (map.mKeyFrameStore.IsEnabled())
+            map.mKeyFrameStore.Evict(pKF, map.GetAllKeyFrames());
+
+        // 重定位或闭环时读取旧关键帧
+        if (i % nPageInPeriod == 0)
+        {
+            const size_t idx = rng() % vpKFs.size();
+            const std::shared_ptr<const ORB_SLAM2::KeyFrameFeatures> pFeatures = vpKFs[idx]->GetFeatures();
+            if (!pFeatures || Checksum(pFeatures->mDescriptorBlock) != vChecksums[idx] ||
+                pFeatures->mvIMUData.size() != (size_t) nIMU || pFeatures->mvGridIndices.size() != (size_t) N ||
+                pFeatures->mvKeysUn.size() != (size_t) N || pFeatures->mvuRight.size() != (size_t) N ||
+                pFeatures->mvDepth.size() != (size_t) N || pFeatures->mBowVec.size() != (size_t) N / 2 ||
+                pFeatures->mFeatVec.size() != (size_t) N / 2)
+                nMismatches++;
+        }
+
+        if (i == nReportPeriod - 1)
+            warmMB = ResidentMB();
+        if ((i + 1) % nReportPeriod == 0)
+        {
+            size_t nResidentBytes, nFileBytes;
+            unsigned long nSpills, nPageIns;
+            double meanPageInMs, maxPageInMs;
+            map.mKeyFrameStore.GetStats(nResidentBytes, nFileBytes, nSpills, nPageIns, meanPageInMs, maxPageInMs);
+            cout << "keyframes " << i + 1 << ": map points " << map.MapPointsInMap() << ", RSS " << ResidentMB()
+                 << " MB, features in memory " << nResidentBytes / (1024.0 * 1024.0) << " MB, on disk "
+                 << nFileBytes / (1024.0 * 1024.0) << " MB" << endl;
+        }
+    }
+
+    const double endMB = ResidentMB();
+
+    // 全局BA或只定位模式：不再新建关键帧，依次读取所有关键帧的特征数据。
+    // LocalMapping线程检查到超过预算后换出，这里每次读取后检查一次。
+    size_t nResidentBytes, nFileBytes;
+    unsigned long nSpills, nPageIns;
+    double meanPageInMs, maxPageInMs;
+    size_t nPeakBytes = 0;
+    for (size_t i = 0; i < vpKFs.size(); i++)
+    {
+        if (!vpKFs[i]->GetFeatures())
+            nMismatches++;
+        if (map.mKeyFrameStore.EvictionRequested())
+            map.mKeyFrameStore.Evict(NULL, map.GetAllKeyFrames());
+        map.mKeyFrameStore.GetStats(nResidentBytes, nFileBytes, nSpills, nPageIns, meanPageInMs, maxPageInMs);
+        nPeakBytes = max(nPeakBytes, nResidentBytes);
+    }
+    cout << "reading all keyframes without new keyframes: features in memory at most "
+         << nPeakBytes / (1024.0 * 1024.0) << " MB, at the end " << nResidentBytes / (1024.0 * 1024.0)
+         << " MB, RSS " << ResidentMB() << " MB" << endl;
+
+    map.mKeyFrameStore.GetStats(nResidentBytes, nFileBytes, nSpills, nPageIns, meanPageInMs, maxPageInMs);
+    cout << "spilled: " << nSpills << ", paged in: " << nPageIns << ", page-in mean: " << meanPageInMs
+         << " ms, max: " << maxPageInMs << " ms" << endl;
+    cout << "RSS growth per keyframe after warm-up: "
+         << (endMB - warmMB) * 1024.0 / max(1, nKeyFrames - nReportPeriod) << " KB" << endl;
+
+    map.clear();
+
+    if (nMismatches > 0)
+    {
+        cerr << "ERROR: " << nMismatches << " paged-in keyframes differ from the original" << endl;
+        return 1;
+    }
+    cout << "paged-in data identical: yes" << endl;
+
+    return 0;
+}
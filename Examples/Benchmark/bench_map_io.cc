@@ -0,0 +1,94 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* 地图读写性能测试：加载System::SaveMap保存的地图文件，统计加载耗时，
+* 再保存到另一个文件，检查两个文件大小相同并统计不同的字节数(加载恢复了所有保存的数据)。
+*/
+
+
+#include<iostream>
+#include<fstream>
+#include<iterator>
+#include<chrono>
+#include<vector>
+#include<string>
+
+#include<ORBVocabulary.h>
+#include<Map.h>
+#include<KeyFrameDatabase.h>
+#include<MapSerializer.h>
+
+
+using namespace std;
+
+// 读取整个文件
+bool ReadFile(const string &strFile, vector<char> &vData)
+{
+    ifstream f(strFile.c_str(), ios::in | ios::binary);
+    if (!f.is_open())
+        return false;
+    vData.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        cerr << endl << "Usage: ./bench_map_io vocabulary map_file output_map_file" << endl;
+        return 1;
+    }
+
+    const string strVocFile = argv[1];
+    ORB_SLAM2::ORBVocabulary voc;
+    bool bVocLoad;
+    if (strVocFile.size() > 4 && strVocFile.compare(strVocFile.size() - 4, 4, ".bin") == 0)
+        bVocLoad = voc.loadFromBinaryFile(strVocFile);
+    else if (strVocFile.size() > 5 && strVocFile.compare(strVocFile.size() - 5, 5, ".mvoc") == 0)
+        bVocLoad = voc.loadFromMappedFile(strVocFile);
+    else
+        bVocLoad = voc.loadFromTextFile(strVocFile);
+    if (!bVocLoad)
+    {
+        cerr << "Failed to open vocabulary at: " << strVocFile << endl;
+        return 1;
+    }
+
+    ORB_SLAM2::Map map;
+    ORB_SLAM2::KeyFrameDatabase keyFrameDB(voc);
+    ORB_SLAM2::MapSerializer::VINSState vins;
+
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    if (!ORB_SLAM2::MapSerializer::Load(argv[2], &map, &keyFrameDB, &voc, vins))
+        return 1;
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    if (!ORB_SLAM2::MapSerializer::Save(argv[3], &map, &keyFrameDB, voc, vins))
+        return 1;
+    std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+
+    vector<char> vData1, vData2;
+    ReadFile(argv[2], vData1);
+    ReadFile(argv[3], vData2);
+
+    cout << "keyframes: " << map.KeyFramesInMap() << ", map points: " << map.MapPointsInMap()
+         << ", file size: " << vData1.size() / (1024.0 * 1024.0) << " MB" << endl;
+    cout << "load: " << std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t2 - t1).count()
+         << " ms" << endl;
+    cout << "save: " << std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t3 - t2).count()
+         << " ms" << endl;
+
+    // 结构不同时文件大小一定不同。NavState的旋转每次拷贝都会重新归一化，最后一位可能不同。
+    if (vData1.size() != vData2.size())
+    {
+        cerr << "ERROR: saved map size differs from the loaded file" << endl;
+        return 1;
+    }
+    size_t nDiffBytes = 0;
+    for (size_t i = 0; i < vData1.size(); i++)
+        if (vData1[i] != vData2[i])
+            nDiffBytes++;
+    cout << "round trip differing bytes: " << nDiffBytes << " (NavState rotation renormalization only)" << endl;
+
+    map.clear();
+    return 0;
+}
@@ -0,0 +1,184 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* 地图点集合性能测试：比较原来的std::set<MapPoint*>与Map的SlotMap存储，
+* 统计插入、删除和GetAllMapPoints/GetMapPointsSnapshot的耗时(包括每次获取前地图有新增、乱序新增或删除时)，
+* 并检查两者的内容一致。
+*/
+
+
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<random>
+#include<set>
+#include<vector>
+
+#include<opencv2/core/core.hpp>
+
+#include<Map.h>
+#include<MapPoint.h>
+
+
+using namespace std;
+
+typedef std::chrono::steady_clock Clock;
+
+double ElapsedUs(const Clock::time_point &t1, const Clock::time_point &t2)
+{
+    return std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(t2 - t1).count();
+}
+
+// 重复nIterations次，返回排序后的单次耗时(us)
+template<class TFunc>
+vector<double> Time(const int nIterations, TFunc func)
+{
+    vector<double> vTimes;
+    vTimes.reserve(nIterations);
+    for (int i = 0; i < nIterations; i++)
+    {
+        Clock::time_point t1 = Clock::now();
+        func();
+        Clock::time_point t2 = Clock::now();
+        vTimes.push_back(ElapsedUs(t1, t2));
+    }
+    sort(vTimes.begin(), vTimes.end());
+    return vTimes;
+}
+
+void Print(const char *name, const vector<double> &vTimes)
+{
+    cout << name << " median: " << vTimes[vTimes.size() / 2] << " us, p99: " << vTimes[vTimes.size() * 99 / 100]
+         << " us" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    const int nPoints = argc > 1 ? atoi(argv[1]) : 200000;
+    const int nIterations = argc > 2 ? atoi(argv[2]) : 100;
+    // 与局部建图剔除点云相近，删除一部分点
+    const double cullRatio = 0.3;
+
+    ORB_SLAM2::Map map;
+    vector<ORB_SLAM2::MapPoint *> vpMPs;
+    vpMPs.reserve(nPoints);
+    const cv::Mat pos = cv::Mat::zeros(3, 1, CV_32F);
+    for (int i = 0; i < nPoints; i++)
+        vpMPs.push_back(new ORB_SLAM2::MapPoint(pos, &map, 0, 0));
+
+    // 插入
+    std::set<ORB_SLAM2::MapPoint *> spMPs;
+    Clock::time_point t1 = Clock::now();
+    for (int i = 0; i < nPoints; i++)
+        spMPs.insert(vpMPs[i]);
+    Clock::time_point t2 = Clock::now();
+    for (int i = 0; i < nPoints; i++)
+        map.AddMapPoint(vpMPs[i]);
+    Clock::time_point t3 = Clock::now();
+    cout << "points: " << nPoints << ", iterations: " << nIterations << endl;
+    cout << "insert: set " << ElapsedUs(t1, t2) / 1000 << " ms, slot map " << ElapsedUs(t2, t3) / 1000 << " ms"
+         << endl;
+
+    // 随机删除
+    vector<ORB_SLAM2::MapPoint *> vpCulled(vpMPs);
+    std::mt19937 rng(0);
+    shuffle(vpCulled.begin(), vpCulled.end(), rng);
+    vpCulled.resize((size_t) (nPoints * cullRatio));
+    t1 = Clock::now();
+    for (size_t i = 0; i < vpCulled.size(); i++)
+        spMPs.erase(vpCulled[i]);
+    t2 = Clock::now();
+    for (size_t i = 0; i < vpCulled.size(); i++)
+        map.EraseMapPoint(vpCulled[i]);
+    t3 = Clock::now();
+    cout << "erase " << vpCulled.size() << ": set " << ElapsedUs(t1, t2) / 1000 << " ms, slot map "
+         << ElapsedUs(t2, t3) / 1000 << " ms" << endl;
+
+    // 获取所有点云
+    size_t nSink = 0;
+    vector<double> vTimesSet = Time(nIterations, [&]()
+    {
+        vector<ORB_SLAM2::MapPoint *> vp(spMPs.begin(), spMPs.end());
+        nSink += vp.size();
+    });
+    vector<double> vTimesCopy = Time(nIterations, [&]()
+    {
+        vector<ORB_SLAM2::MapPoint *> vp = map.GetAllMapPoints();
+        nSink += vp.size();
+    });
+    vector<double> vTimesSnapshot = Time(nIterations, [&]()
+    {
+        ORB_SLAM2::SlotMap<ORB_SLAM2::MapPoint>::Snapshot pvp = map.GetMapPointsSnapshot();
+        nSink += pvp->size();
+    });
+    // 每次获取前地图都有变化(新增一个点)，快照在上一次的基础上加入新的点
+    vector<ORB_SLAM2::MapPoint *> vpAdded;
+    vector<double> vTimesSnapshotChanged = Time(nIterations, [&]()
+    {
+        vpAdded.push_back(new ORB_SLAM2::MapPoint(pos, &map, 0, 0));
+        map.AddMapPoint(vpAdded.back());
+        ORB_SLAM2::SlotMap<ORB_SLAM2::MapPoint>::Snapshot pvp = map.GetMapPointsSnapshot();
+        nSink += pvp->size();
+    });
+    // 新增的两个点按id倒序加入(不同线程创建)，快照需要排序合并
+    vector<double> vTimesSnapshotUnordered = Time(nIterations, [&]()
+    {
+        ORB_SLAM2::MapPoint *pMP1 = new ORB_SLAM2::MapPoint(pos, &map, 0, 0);
+        ORB_SLAM2::MapPoint *pMP2 = new ORB_SLAM2::MapPoint(pos, &map, 0, 0);
+        vpAdded.push_back(pMP2);
+        vpAdded.push_back(pMP1);
+        map.AddMapPoint(pMP2);
+        map.AddMapPoint(pMP1);
+        ORB_SLAM2::SlotMap<ORB_SLAM2::MapPoint>::Snapshot pvp = map.GetMapPointsSnapshot();
+        nSink += pvp->size();
+    });
+    // 每次获取前删除一个点，快照从上一次的快照中去掉删除的点
+    vector<ORB_SLAM2::MapPoint *> vpErased(spMPs.begin(), spMPs.end());
+    shuffle(vpErased.begin(), vpErased.end(), rng);
+    vpErased.resize(nIterations);
+    size_t nErased = 0;
+    vector<double> vTimesSnapshotErased = Time(nIterations, [&]()
+    {
+        spMPs.erase(vpErased[nErased]);
+        map.EraseMapPoint(vpErased[nErased++]);
+        ORB_SLAM2::SlotMap<ORB_SLAM2::MapPoint>::Snapshot pvp = map.GetMapPointsSnapshot();
+        nSink += pvp->size();
+    });
+
+    Print("set copy", vTimesSet);
+    Print("GetAllMapPoints", vTimesCopy);
+    Print("GetMapPointsSnapshot (unchanged)", vTimesSnapshot);
+    Print("GetMapPointsSnapshot (1 added)", vTimesSnapshotChanged);
+    Print("GetMapPointsSnapshot (2 added out of order)", vTimesSnapshotUnordered);
+    Print("GetMapPointsSnapshot (1 erased)", vTimesSnapshotErased);
+    cout << "speedup GetAllMapPoints: " << vTimesSet[nIterations / 2] / vTimesCopy[nIterations / 2] << "x" << endl;
+
+    // 内容一致：按id排序后相同
+    for (size_t i = 0; i < vpAdded.size(); i++)
+        map.EraseMapPoint(vpAdded[i]);
+    vector<ORB_SLAM2::MapPoint *> vpExpected(spMPs.begin(), spMPs.end());
+    sort(vpExpected.begin(), vpExpected.end(), [](ORB_SLAM2::MapPoint *a, ORB_SLAM2::MapPoint *b)
+    {
+        return a->mnId < b->mnId;
+    });
+    const bool bSame = vpExpected == map.GetAllMapPoints() && vpExpected == *map.GetMapPointsSnapshot() &&
+                       map.GetMapPoint(vpExpected.back()->mnId) == vpExpected.back() &&
+                       map.GetMapPoint(vpCulled[0]->mnId) == NULL;
+
+    for (size_t i = 0; i < vpAdded.size(); i++)
+        delete vpAdded[i];
+    for (size_t i = 0; i < vpCulled.size(); i++)
+        delete vpCulled[i];
+    for (size_t i = 0; i < vpErased.size(); i++)
+        delete vpErased[i];
+    map.clear();
+
+    if (!bSame)
+    {
+        cerr << "ERROR: slot map content differs from the set" << endl;
+        return 1;
+    }
+    cout << "content identical: yes (" << nSink << ")" << endl;
+
+    return 0;
+}
@@ -0,0 +1,219 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* 地图点观测容器性能测试：对不同观测数量的地图点，比较原来的std::map<KeyFrame*, size_t, cmpKeyFrameId>
+* 与MapPoint中ObservationVector的内存占用(对象大小加堆上分配的字节数)，
+* 以及KeyFrame::UpdateConnections统计共视关键帧的耗时：原来每个点拷贝一次观测(GetObservations)，
+* 现在用ForEachObservation直接遍历。并检查两者统计的共视关系相同。
+*/
+
+
+#include<iostream>
+#include<algorithm>
+#include<atomic>
+#include<chrono>
+#include<cstdlib>
+#include<map>
+#include<mutex>
+#include<new>
+#include<random>
+#include<vector>
+
+#include<opencv2/core/core.hpp>
+
+#include<Map.h>
+#include<MapPoint.h>
+#include<KeyFrame.h>
+#include<Frame.h>
+
+
+using namespace std;
+
+// 统计堆上分配的字节数
+std::atomic<long> gnHeapBytes(0);
+
+void *operator new(size_t size)
+{
+    size_t *p = (size_t *) malloc(size + sizeof(size_t));
+    if (!p)
+        throw std::bad_alloc();
+    *p = size;
+    gnHeapBytes += (long) size;
+    return p + 1;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (!ptr)
+        return;
+    size_t *p = (size_t *) ptr - 1;
+    gnHeapBytes -= (long) *p;
+    free(p);
+}
+
+// 原来MapPoint的观测：std::map，GetObservations()在锁内拷贝
+class cmpKeyFrameId
+{
+public:
+    bool operator()(const ORB_SLAM2::KeyFrame *a, const ORB_SLAM2::KeyFrame *b) const
+    {
+        return a->mnId < b->mnId;
+    }
+};
+
+typedef std::map<ORB_SLAM2::KeyFrame *, size_t, cmpKeyFrameId> MapObservations;
+
+class MapObservationPoint
+{
+public:
+    void AddObservation(ORB_SLAM2::KeyFrame *pKF, size_t idx)
+    {
+        unique_lock<mutex> lock(mMutexFeatures);
+        if (mObservations.count(pKF))
+            return;
+        mObservations[pKF] = idx;
+    }
+
+    MapObservations GetObservations()
+    {
+        unique_lock<mutex> lock(mMutexFeatures);
+        return mObservations;
+    }
+
+protected:
+    MapObservations mObservations;
+    std::mutex mMutexFeatures;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double ElapsedUs(const Clock::time_point &t1, const Clock::time_point &t2)
+{
+    return std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(t2 - t1).count();
+}
+
+int main(int argc, char **argv)
+{
+    const int nPoints = argc > 1 ? atoi(argv[1]) : 20000;
+    const int nKFs = argc > 2 ? atoi(argv[2]) : 200;
+    const int nRepeats = argc > 3 ? atoi(argv[3]) : 20;
+    const int vnObservations[] = {2, 3, 4, 6, 8, 12, 16};
+
+    // 每个关键帧nPoints个特征点，单目(没有右目坐标)
+    ORB_SLAM2::Map slamMap;
+    ORB_SLAM2::Frame F;
+    F.N = nPoints;
+    F.mpFeatures->mvKeysUn.resize(nPoints);
+    F.mpFeatures->mvuRight.assign(nPoints, -1);
+    F.mpFeatures->mvDepth.assign(nPoints, -1);
+    F.mTcw = cv::Mat::eye(4, 4, CV_32F);
+    vector<ORB_SLAM2::KeyFrame *> vpKFs;
+    for (int i = 0; i < nKFs; i++)
+        vpKFs.push_back(new ORB_SLAM2::KeyFrame(F, &slamMap, NULL, vector<ORB_SLAM2::IMUData>()));
+
+    cout << "points: " << nPoints << ", keyframes: " << nKFs << ", repeats: " << nRepeats << endl;
+    cout << "observations\tmap bytes/point\tflat bytes/point\tmap us/pass\tflat us/pass\tspeedup\tidentical"
+         << endl;
+
+    bool bAllIdentical = true;
+    for (size_t t = 0; t < sizeof(vnObservations) / sizeof(vnObservations[0]); t++)
+    {
+        const int n = vnObservations[t];
+        std::mt19937 rng(n);
+
+        // 每个点的观测：n个不同的关键帧，按随机顺序加入
+        vector<vector<ORB_SLAM2::KeyFrame *> > vvpObsKFs(nPoints);
+        for (int p = 0; p < nPoints; p++)
+        {
+            vector<ORB_SLAM2::KeyFrame *> vpCandidates = vpKFs;
+            shuffle(vpCandidates.begin(), vpCandidates.end(), rng);
+            vvpObsKFs[p].assign(vpCandidates.begin(), vpCandidates.begin() + n);
+        }
+
+        vector<MapObservationPoint> vMapPoints(nPoints);
+        const long nHeap0 = gnHeapBytes;
+        for (int p = 0; p < nPoints; p++)
+            for (int i = 0; i < n; i++)
+                vMapPoints[p].AddObservation(vvpObsKFs[p][i], p);
+        const long nHeap1 = gnHeapBytes;
+
+        vector<ORB_SLAM2::MapPoint *> vpMPs;
+        vpMPs.reserve(nPoints);
+        for (int p = 0; p < nPoints; p++)
+            vpMPs.push_back(new ORB_SLAM2::MapPoint(cv::Mat::zeros(3, 1, CV_32F), &slamMap, 0, 0));
+        const long nHeap2 = gnHeapBytes;
+        for (int p = 0; p < nPoints; p++)
+            for (int i = 0; i < n; i++)
+                vpMPs[p]->AddObservation(vvpObsKFs[p][i], p);
+        const long nHeap3 = gnHeapBytes;
+
+        const double mapBytes = sizeof(MapObservations) + (double) (nHeap1 - nHeap0) / nPoints;
+        const double flatBytes = sizeof(ORB_SLAM2::ObservationVector) + (double) (nHeap3 - nHeap2) / nPoints;
+
+        // 与UpdateConnections相同：统计观测到这些点的关键帧
+        ORB_SLAM2::KeyFrame *pCurrentKF = vpKFs[0];
+        map<ORB_SLAM2::KeyFrame *, int> KFcounterMap, KFcounterFlat;
+
+        Clock::time_point t1 = Clock::now();
+        for (int r = 0; r < nRepeats; r++)
+        {
+            KFcounterMap.clear();
+            for (int p = 0; p < nPoints; p++)
+            {
+                const MapObservations observations = vMapPoints[p].GetObservations();
+                for (MapObservations::const_iterator mit = observations.begin(), mend = observations.end();
+                     mit != mend; mit++)
+                {
+                    if (mit->first->mnId == pCurrentKF->mnId)
+                        continue;
+                    KFcounterMap[mit->first]++;
+                }
+            }
+        }
+        Clock::time_point t2 = Clock::now();
+        for (int r = 0; r < nRepeats; r++)
+        {
+            KFcounterFlat.clear();
+            for (int p = 0; p < nPoints; p++)
+            {
+                vpMPs[p]->ForEachObservation([&](ORB_SLAM2::KeyFrame *pKFi, size_t)
+                                             {
+                                                 if (pKFi->mnId != pCurrentKF->mnId)
+                                                     KFcounterFlat[pKFi]++;
+                                             });
+            }
+        }
+        Clock::time_point t3 = Clock::now();
+
+        // 共视关系和遍历顺序(按关键帧Id)都应相同
+        bool bIdentical = KFcounterMap == KFcounterFlat;
+        for (int p = 0; p < nPoints && bIdentical; p++)
+        {
+            const MapObservations mapObs = vMapPoints[p].GetObservations();
+            const ORB_SLAM2::mapMapPointObs flatObs = vpMPs[p]->GetObservations();
+            bIdentical = mapObs.size() == flatObs.size();
+            ORB_SLAM2::mapMapPointObs::const_iterator fit = flatObs.begin();
+            for (MapObservations::const_iterator mit = mapObs.begin(); mit != mapObs.end() && bIdentical; mit++, fit++)
+                bIdentical = mit->first == fit->first && mit->second == fit->second;
+        }
+        bAllIdentical = bAllIdentical && bIdentical;
+
+        cout << n << "\t\t" << mapBytes << "\t\t" << flatBytes << "\t\t\t" << ElapsedUs(t1, t2) / nRepeats << "\t"
+             << ElapsedUs(t2, t3) / nRepeats << "\t" << ElapsedUs(t1, t2) / ElapsedUs(t2, t3) << "\t"
+             << (bIdentical ? "yes" : "NO") << endl;
+
+        for (int p = 0; p < nPoints; p++)
+            delete vpMPs[p];
+    }
+
+    for (int i = 0; i < nKFs; i++)
+        delete vpKFs[i];
+
+    if (!bAllIdentical)
+    {
+        cerr << "ERROR: flat observations differ from std::map" << endl;
+        return 1;
+    }
+
+    return 0;
+}
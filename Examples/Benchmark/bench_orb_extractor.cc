@@ -0,0 +1,209 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* ORB特征提取性能测试：比较单线程与线程池并行提取、标量与SIMD内核的耗时，并检查输出完全一致。
+* 同时统计稳态下每帧的内存分配次数。
+*/
+
+
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<thread>
+#include<vector>
+#include<cstring>
+#include<cerrno>
+#include<atomic>
+
+#include<opencv2/core/core.hpp>
+#include<opencv2/highgui/highgui.hpp>
+#include<opencv2/imgproc/imgproc.hpp>
+
+#include<ORBextractor.h>
+#include<ThreadPool.h>
+
+
+using namespace std;
+
+// 替换glibc的分配函数以统计分配次数(包括OpenCV的cv::fastMalloc)
+static std::atomic<long> nAllocations(0);
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    nAllocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    nAllocations++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    nAllocations++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    nAllocations++;
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+}
+#endif
+
+// 预热后运行一次提取，返回期间的内存分配次数
+long CountAllocations(ORB_SLAM2::ORBextractor &extractor, const cv::Mat &im,
+                      vector<cv::KeyPoint> &vKeys, cv::Mat &descriptors)
+{
+    extractor(im, cv::Mat(), vKeys, descriptors);
+
+    const long nBefore = nAllocations.load();
+    extractor(im, cv::Mat(), vKeys, descriptors);
+    return nAllocations.load() - nBefore;
+}
+
+// 对提取器重复运行nIterations次，返回每次的耗时(ms)
+vector<double> TimeExtractor(ORB_SLAM2::ORBextractor &extractor, const cv::Mat &im, const int nIterations,
+                             vector<cv::KeyPoint> &vKeys, cv::Mat &descriptors)
+{
+    vector<double> vTimes;
+    vTimes.reserve(nIterations);
+
+    for (int i = 0; i < nIterations; i++)
+    {
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        extractor(im, cv::Mat(), vKeys, descriptors);
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+        vTimes.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t2 - t1).count());
+    }
+
+    sort(vTimes.begin(), vTimes.end());
+    return vTimes;
+}
+
+bool SameOutput(const vector<cv::KeyPoint> &vKeys1, const cv::Mat &desc1,
+                const vector<cv::KeyPoint> &vKeys2, const cv::Mat &desc2)
+{
+    if (vKeys1.size() != vKeys2.size() || desc1.rows != desc2.rows)
+        return false;
+
+    for (size_t i = 0; i < vKeys1.size(); i++)
+    {
+        const cv::KeyPoint &kp1 = vKeys1[i];
+        const cv::KeyPoint &kp2 = vKeys2[i];
+        if (kp1.pt.x != kp2.pt.x || kp1.pt.y != kp2.pt.y || kp1.angle != kp2.angle ||
+            kp1.response != kp2.response || kp1.octave != kp2.octave)
+            return false;
+    }
+
+    for (int i = 0; i < desc1.rows; i++)
+        if (memcmp(desc1.ptr(i), desc2.ptr(i), 32) != 0)
+            return false;
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << endl << "Usage: ./bench_orb_extractor settings image [iterations] [threads]" << endl;
+        return 1;
+    }
+
+    cv::FileStorage fSettings(argv[1], cv::FileStorage::READ);
+    if (!fSettings.isOpened())
+    {
+        cerr << "Failed to open settings file at: " << argv[1] << endl;
+        return 1;
+    }
+
+    cv::Mat im = cv::imread(argv[2], CV_LOAD_IMAGE_UNCHANGED);
+    if (im.empty())
+    {
+        cerr << "Failed to load image at: " << argv[2] << endl;
+        return 1;
+    }
+    if (im.channels() == 3)
+        cv::cvtColor(im, im, CV_BGR2GRAY);
+    else if (im.channels() == 4)
+        cv::cvtColor(im, im, CV_BGRA2GRAY);
+
+    const int nIterations = argc > 3 ? atoi(argv[3]) : 200;
+    int nThreads = argc > 4 ? atoi(argv[4]) : (int) fSettings["ORBextractor.nThreads"];
+    if (nThreads <= 1)
+        nThreads = std::thread::hardware_concurrency();
+
+    int nFeatures = fSettings["ORBextractor.nFeatures"];
+    float fScaleFactor = fSettings["ORBextractor.scaleFactor"];
+    int nLevels = fSettings["ORBextractor.nLevels"];
+    int fIniThFAST = fSettings["ORBextractor.iniThFAST"];
+    int fMinThFAST = fSettings["ORBextractor.minThFAST"];
+
+    ORB_SLAM2::ORBextractor serialExtractor(nFeatures, fScaleFactor, nLevels, fIniThFAST, fMinThFAST);
+    ORB_SLAM2::ORBextractor parallelExtractor(nFeatures, fScaleFactor, nLevels, fIniThFAST, fMinThFAST);
+
+    ORB_SLAM2::ThreadPool threadPool(nThreads - 1);
+    parallelExtractor.SetThreadPool(&threadPool);
+
+    vector<cv::KeyPoint> vKeysSerial, vKeysParallel;
+    cv::Mat descSerial, descParallel;
+
+    vector<double> vTimesSerial = TimeExtractor(serialExtractor, im, nIterations, vKeysSerial, descSerial);
+    vector<double> vTimesParallel = TimeExtractor(parallelExtractor, im, nIterations, vKeysParallel, descParallel);
+
+    cout << "image: " << im.cols << "x" << im.rows << ", features: " << vKeysSerial.size()
+         << ", iterations: " << nIterations << ", threads: " << nThreads << endl;
+    cout << "serial   median: " << vTimesSerial[nIterations / 2] << " ms, p99: "
+         << vTimesSerial[nIterations * 99 / 100] << " ms" << endl;
+    cout << "parallel median: " << vTimesParallel[nIterations / 2] << " ms, p99: "
+         << vTimesParallel[nIterations * 99 / 100] << " ms" << endl;
+    cout << "speedup: " << vTimesSerial[nIterations / 2] / vTimesParallel[nIterations / 2] << "x" << endl;
+#ifdef __GLIBC__
+    cout << "steady-state allocations per frame, serial: "
+         << CountAllocations(serialExtractor, im, vKeysSerial, descSerial)
+         << ", parallel: " << CountAllocations(parallelExtractor, im, vKeysParallel, descParallel) << endl;
+#endif
+
+    if (!SameOutput(vKeysSerial, descSerial, vKeysParallel, descParallel))
+    {
+        cerr << "ERROR: parallel output differs from serial output" << endl;
+        return 1;
+    }
+    cout << "output identical: yes" << endl;
+
+    // 标量内核与运行时选择的SIMD内核对比(单线程)
+    const int nKernelLevel = ORB_SLAM2::ORBextractor::GetKernelLevel();
+    if (nKernelLevel != ORB_SLAM2::ORBextractor::KERNEL_SCALAR)
+    {
+        vector<cv::KeyPoint> vKeysScalar;
+        cv::Mat descScalar;
+        ORB_SLAM2::ORBextractor::SetKernelLevel(ORB_SLAM2::ORBextractor::KERNEL_SCALAR);
+        vector<double> vTimesScalar = TimeExtractor(serialExtractor, im, nIterations, vKeysScalar, descScalar);
+        ORB_SLAM2::ORBextractor::SetKernelLevel(nKernelLevel);
+
+        cout << "kernel level: " << nKernelLevel << " (1=SSE4.1, 2=AVX2)" << endl;
+        cout << "scalar kernel median: " << vTimesScalar[nIterations / 2] << " ms, p99: "
+             << vTimesScalar[nIterations * 99 / 100] << " ms" << endl;
+        cout << "simd kernel speedup: " << vTimesScalar[nIterations / 2] / vTimesSerial[nIterations / 2] << "x" << endl;
+
+        if (!SameOutput(vKeysScalar, descScalar, vKeysSerial, descSerial))
+        {
+            cerr << "ERROR: simd output differs from scalar output" << endl;
+            return 1;
+        }
+        cout << "simd output identical: yes" << endl;
+    }
+
+    return 0;
+}
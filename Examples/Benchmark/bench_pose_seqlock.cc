@@ -0,0 +1,252 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* 地图点坐标读写竞争测试：跟踪线程按Frame::isInFrustum的方式读取地图点的坐标、观测方向和尺度不变距离，
+* 同时一个线程模拟局部BA成批写回地图点坐标。统计每次读取的延迟分位数。
+* 对比原来用互斥量保护的读取(mutex)和MapPoint中的序列锁读取(seqlock)。
+*/
+
+
+#include<iostream>
+#include<algorithm>
+#include<atomic>
+#include<chrono>
+#include<mutex>
+#include<random>
+#include<thread>
+#include<vector>
+#include<cmath>
+
+#include<Eigen/Core>
+#include<opencv2/core/core.hpp>
+
+#include<Map.h>
+#include<MapPoint.h>
+
+
+using namespace std;
+
+// 原来MapPoint的做法：每个访问函数都加mMutexPos
+class LockedPoint
+{
+public:
+    LockedPoint() : mPos(Eigen::Vector3f::Zero()), mNormal(Eigen::Vector3f::Zero()), mfMinDistance(1),
+                    mfMaxDistance(10)
+    {}
+
+    void SetWorldPos(const Eigen::Vector3f &Pos)
+    {
+        unique_lock<mutex> lock(mMutexPos);
+        mPos = Pos;
+    }
+
+    Eigen::Vector3f GetWorldPos()
+    {
+        unique_lock<mutex> lock(mMutexPos);
+        return mPos;
+    }
+
+    Eigen::Vector3f GetNormal()
+    {
+        unique_lock<mutex> lock(mMutexPos);
+        return mNormal;
+    }
+
+    float GetMinDistanceInvariance()
+    {
+        unique_lock<mutex> lock(mMutexPos);
+        return 0.8f * mfMinDistance;
+    }
+
+    float GetMaxDistanceInvariance()
+    {
+        unique_lock<mutex> lock(mMutexPos);
+        return 1.2f * mfMaxDistance;
+    }
+
+    int PredictScale(const float &currentDist, const float &logScaleFactor)
+    {
+        float ratio;
+        {
+            unique_lock<mutex> lock(mMutexPos);
+            ratio = mfMaxDistance / currentDist;
+        }
+        return ceil(log(ratio) / logScaleFactor);
+    }
+
+protected:
+    Eigen::Vector3f mPos;
+    Eigen::Vector3f mNormal;
+    float mfMinDistance;
+    float mfMaxDistance;
+    std::mutex mMutexPos;
+};
+
+// 防止读取被优化掉
+std::atomic<float> gSink(0);
+
+// 与Frame::isInFrustum相同的读取序列
+template<class TPoint>
+float TrackingRead(TPoint *pMP)
+{
+    const Eigen::Vector3f P = pMP->GetWorldPos();
+    const float maxDistance = pMP->GetMaxDistanceInvariance();
+    const float minDistance = pMP->GetMinDistanceInvariance();
+    const float dist = P.norm() + 1.0f;
+    const Eigen::Vector3f Pn = pMP->GetNormal();
+    const int nLevel = pMP->PredictScale(dist, log(1.2f));
+    return P(0) + Pn(0) + maxDistance + minDistance + nLevel;
+}
+
+// 与LockedPoint相同的初始观测方向和尺度不变距离
+class BenchMapPoint : public ORB_SLAM2::MapPoint
+{
+public:
+    explicit BenchMapPoint(ORB_SLAM2::Map *pMap) : MapPoint(cv::Mat::zeros(3, 1, CV_32F), pMap, 0, 0)
+    {
+        SetGeometry(Eigen::Vector3f::Zero(), Eigen::Vector3f::Zero(), 1, 10);
+    }
+};
+
+// 被测的MapPoint：用Eigen访问函数
+class SeqLockPoint
+{
+public:
+    explicit SeqLockPoint(ORB_SLAM2::MapPoint *pMP) : mpMP(pMP)
+    {}
+
+    void SetWorldPos(const Eigen::Vector3f &Pos)
+    {
+        mpMP->SetWorldPos(Pos);
+    }
+
+    Eigen::Vector3f GetWorldPos()
+    {
+        return mpMP->GetWorldPosEigen();
+    }
+
+    Eigen::Vector3f GetNormal()
+    {
+        return mpMP->GetNormalEigen();
+    }
+
+    float GetMinDistanceInvariance()
+    {
+        return mpMP->GetMinDistanceInvariance();
+    }
+
+    float GetMaxDistanceInvariance()
+    {
+        return mpMP->GetMaxDistanceInvariance();
+    }
+
+    int PredictScale(const float &currentDist, const float &logScaleFactor)
+    {
+        return mpMP->PredictScale(currentDist, logScaleFactor);
+    }
+
+protected:
+    ORB_SLAM2::MapPoint *mpMP;
+};
+
+// 读者线程在写者运行期间不断读取随机的地图点，返回每次读取的延迟(ns)
+template<class TPoint>
+vector<double> Run(vector<TPoint *> &vpPoints, const int nReaders, const int nBursts, const int nIdleUs)
+{
+    std::atomic<bool> bStop(false);
+    std::atomic<int> nReady(0);
+    vector<vector<double> > vvLatencies(nReaders);
+
+    vector<thread> vReaders;
+    for (int r = 0; r < nReaders; r++)
+    {
+        vReaders.push_back(thread([&, r]()
+                                  {
+                                      std::mt19937 rng(r);
+                                      float sum = 0;
+                                      vvLatencies[r].reserve(1 << 22);
+                                      nReady++;
+                                      while (!bStop)
+                                      {
+                                          TPoint *pMP = vpPoints[rng() % vpPoints.size()];
+                                          std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+                                          sum += TrackingRead(pMP);
+                                          std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+                                          if (vvLatencies[r].size() < vvLatencies[r].capacity())
+                                              vvLatencies[r].push_back(
+                                                      std::chrono::duration_cast<std::chrono::duration<double, std::nano> >(
+                                                              t2 - t1).count());
+                                      }
+                                      gSink.store(sum, std::memory_order_relaxed);
+                                  }));
+    }
+    while (nReady < nReaders)
+        std::this_thread::yield();
+
+    // 局部BA：优化结束后在mMutexMapUpdate下写回所有局部地图点，然后等待下一个关键帧
+    std::mutex mutexMapUpdate;
+    for (int b = 0; b < nBursts; b++)
+    {
+        {
+            unique_lock<mutex> lock(mutexMapUpdate);
+            for (size_t i = 0; i < vpPoints.size(); i++)
+                vpPoints[i]->SetWorldPos(Eigen::Vector3f(b, i, 1.0f));
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(nIdleUs));
+    }
+
+    bStop = true;
+    for (int r = 0; r < nReaders; r++)
+        vReaders[r].join();
+
+    vector<double> vLatencies;
+    for (int r = 0; r < nReaders; r++)
+        vLatencies.insert(vLatencies.end(), vvLatencies[r].begin(), vvLatencies[r].end());
+    sort(vLatencies.begin(), vLatencies.end());
+    return vLatencies;
+}
+
+void Report(const string &name, const vector<double> &vLatencies)
+{
+    if (vLatencies.empty())
+        return;
+    const size_t n = vLatencies.size();
+    cout << name << "\treads: " << n << "\tp50: " << vLatencies[n / 2] << " ns\tp99: " << vLatencies[n * 99 / 100]
+         << " ns\tp99.9: " << vLatencies[n * 999 / 1000] << " ns\tmax: " << vLatencies.back() << " ns" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    const int nPoints = argc > 1 ? atoi(argv[1]) : 2000;
+    const int nReaders = argc > 2 ? atoi(argv[2]) : 2;
+    const int nBursts = argc > 3 ? atoi(argv[3]) : 200;
+    // 两次BA写回之间的间隔
+    const int nIdleUs = 500;
+
+    cout << "map points: " << nPoints << ", readers: " << nReaders << ", BA write bursts: " << nBursts << endl;
+
+    vector<LockedPoint *> vpLocked;
+    for (int i = 0; i < nPoints; i++)
+        vpLocked.push_back(new LockedPoint());
+
+    ORB_SLAM2::Map map;
+    vector<BenchMapPoint *> vpMPs;
+    vector<SeqLockPoint *> vpSeqLock;
+    for (int i = 0; i < nPoints; i++)
+    {
+        vpMPs.push_back(new BenchMapPoint(&map));
+        vpSeqLock.push_back(new SeqLockPoint(vpMPs.back()));
+    }
+
+    Report("mutex", Run(vpLocked, nReaders, nBursts, nIdleUs));
+    Report("seqlock", Run(vpSeqLock, nReaders, nBursts, nIdleUs));
+
+    for (int i = 0; i < nPoints; i++)
+    {
+        delete vpLocked[i];
+        delete vpSeqLock[i];
+        delete vpMPs[i];
+    }
+
+    return 0;
+}
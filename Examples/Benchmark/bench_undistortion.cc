@@ -0,0 +1,155 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* 特征点去畸变性能测试：比较每帧迭代求解的cv::undistortPoints与查找表双线性插值的耗时，
+* 并统计两者在真实特征点上的误差。
+*/
+
+
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<vector>
+#include<cmath>
+
+#include<opencv2/core/core.hpp>
+#include<opencv2/highgui/highgui.hpp>
+#include<opencv2/imgproc/imgproc.hpp>
+
+#include<ORBextractor.h>
+#include<UndistortionMap.h>
+
+
+using namespace std;
+
+// 与Frame::UndistortKeyPoints中原来的做法相同
+void UndistortIterative(const vector<cv::KeyPoint> &vKeys, const cv::Mat &K, const cv::Mat &DistCoef,
+                        vector<cv::KeyPoint> &vKeysUn)
+{
+    const int N = vKeys.size();
+    cv::Mat mat(N, 2, CV_32F);
+    for (int i = 0; i < N; i++)
+    {
+        mat.at<float>(i, 0) = vKeys[i].pt.x;
+        mat.at<float>(i, 1) = vKeys[i].pt.y;
+    }
+
+    mat = mat.reshape(2);
+    cv::undistortPoints(mat, mat, K, DistCoef, cv::Mat(), K);
+    mat = mat.reshape(1);
+
+    vKeysUn.resize(N);
+    for (int i = 0; i < N; i++)
+    {
+        cv::KeyPoint kp = vKeys[i];
+        kp.pt.x = mat.at<float>(i, 0);
+        kp.pt.y = mat.at<float>(i, 1);
+        vKeysUn[i] = kp;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << endl << "Usage: ./bench_undistortion settings image [iterations] [step]" << endl;
+        return 1;
+    }
+
+    cv::FileStorage fSettings(argv[1], cv::FileStorage::READ);
+    if (!fSettings.isOpened())
+    {
+        cerr << "Failed to open settings file at: " << argv[1] << endl;
+        return 1;
+    }
+
+    cv::Mat im = cv::imread(argv[2], CV_LOAD_IMAGE_UNCHANGED);
+    if (im.empty())
+    {
+        cerr << "Failed to load image at: " << argv[2] << endl;
+        return 1;
+    }
+    if (im.channels() == 3)
+        cv::cvtColor(im, im, CV_BGR2GRAY);
+    else if (im.channels() == 4)
+        cv::cvtColor(im, im, CV_BGRA2GRAY);
+
+    const int nIterations = argc > 3 ? atoi(argv[3]) : 1000;
+    float step = argc > 4 ? atof(argv[4]) : (float) fSettings["Camera.UndistortStep"];
+    if (step <= 0)
+        step = 1.0f;
+
+    cv::Mat K = cv::Mat::eye(3, 3, CV_32F);
+    K.at<float>(0, 0) = fSettings["Camera.fx"];
+    K.at<float>(1, 1) = fSettings["Camera.fy"];
+    K.at<float>(0, 2) = fSettings["Camera.cx"];
+    K.at<float>(1, 2) = fSettings["Camera.cy"];
+
+    cv::Mat DistCoef(4, 1, CV_32F);
+    DistCoef.at<float>(0) = fSettings["Camera.k1"];
+    DistCoef.at<float>(1) = fSettings["Camera.k2"];
+    DistCoef.at<float>(2) = fSettings["Camera.p1"];
+    DistCoef.at<float>(3) = fSettings["Camera.p2"];
+    const float k3 = fSettings["Camera.k3"];
+    if (k3 != 0)
+    {
+        DistCoef.resize(5);
+        DistCoef.at<float>(4) = k3;
+    }
+
+    int nFeatures = fSettings["ORBextractor.nFeatures"];
+    float fScaleFactor = fSettings["ORBextractor.scaleFactor"];
+    int nLevels = fSettings["ORBextractor.nLevels"];
+    int fIniThFAST = fSettings["ORBextractor.iniThFAST"];
+    int fMinThFAST = fSettings["ORBextractor.minThFAST"];
+
+    ORB_SLAM2::ORBextractor extractor(nFeatures, fScaleFactor, nLevels, fIniThFAST, fMinThFAST);
+    vector<cv::KeyPoint> vKeys;
+    cv::Mat descriptors;
+    extractor(im, cv::Mat(), vKeys, descriptors);
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    ORB_SLAM2::UndistortionMap undistortionMap(K, DistCoef, im.cols, im.rows, step);
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    const double buildTime = std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t1 - t0).count();
+
+    vector<cv::KeyPoint> vKeysIterative, vKeysMap;
+    vector<double> vTimesIterative, vTimesMap;
+    for (int i = 0; i < nIterations; i++)
+    {
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+        UndistortIterative(vKeys, K, DistCoef, vKeysIterative);
+        std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+        undistortionMap.Undistort(vKeys, vKeysMap);
+        std::chrono::steady_clock::time_point t4 = std::chrono::steady_clock::now();
+
+        vTimesIterative.push_back(
+                std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(t3 - t2).count());
+        vTimesMap.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::micro> >(t4 - t3).count());
+    }
+    sort(vTimesIterative.begin(), vTimesIterative.end());
+    sort(vTimesMap.begin(), vTimesMap.end());
+
+    double maxError = 0, sumError = 0;
+    for (size_t i = 0; i < vKeys.size(); i++)
+    {
+        const cv::Point2f d = vKeysMap[i].pt - vKeysIterative[i].pt;
+        const double error = sqrt(d.x * d.x + d.y * d.y);
+        maxError = max(maxError, error);
+        sumError += error;
+    }
+
+    cout << "image: " << im.cols << "x" << im.rows << ", features: " << vKeys.size()
+         << ", iterations: " << nIterations << ", step: " << step << " px" << endl;
+    cout << "map build: " << buildTime << " ms" << endl;
+    cout << "iterative median: " << vTimesIterative[nIterations / 2] << " us, p99: "
+         << vTimesIterative[nIterations * 99 / 100] << " us" << endl;
+    cout << "lookup    median: " << vTimesMap[nIterations / 2] << " us, p99: "
+         << vTimesMap[nIterations * 99 / 100] << " us" << endl;
+    cout << "speedup: " << vTimesIterative[nIterations / 2] / vTimesMap[nIterations / 2] << "x" << endl;
+    cout << "keypoint error, max: " << maxError << " px, mean: "
+         << (vKeys.empty() ? 0 : sumError / vKeys.size()) << " px" << endl;
+    cout << "grid cell center max error: " << undistortionMap.MaxError() << " px" << endl;
+
+    return 0;
+}
@@ -17,6 +17,11 @@
 
 #include "FORB.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FORB_SIMD_X86
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 namespace DBoW2 {
@@ -83,23 +88,135 @@ int FORB::distance(const FORB::TDescriptor &a,
 {
   // Bit set count operation from
   // http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
+  // on 64-bit words (4 words per 32-byte descriptor)
 
-  const int *pa = a.ptr<int32_t>();
-  const int *pb = b.ptr<int32_t>();
+  const uint64_t *pa = a.ptr<uint64_t>();
+  const uint64_t *pb = b.ptr<uint64_t>();
 
   int dist=0;
 
-  for(int i=0; i<8; i++, pa++, pb++)
+  for(int i=0; i<4; i++, pa++, pb++)
   {
-      unsigned  int v = *pa ^ *pb;
-      v = v - ((v >> 1) & 0x55555555);
-      v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
-      dist += (((v + (v >> 4)) & 0xF0F0F0F) * 0x1010101) >> 24;
+      uint64_t v = *pa ^ *pb;
+      v = v - ((v >> 1) & 0x5555555555555555ULL);
+      v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+      dist += (int)((((v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * 0x0101010101010101ULL) >> 56);
   }
 
   return dist;
 }
 
+// --------------------------------------------------------------------------
+
+static void distancesScalar(const unsigned char *a, const unsigned char *b,
+  int n, int *dist)
+{
+  const uint64_t *pa = reinterpret_cast<const uint64_t*>(a);
+
+  for(int i = 0; i < n; ++i, b += FORB::L)
+  {
+    const uint64_t *pb = reinterpret_cast<const uint64_t*>(b);
+
+    int d = 0;
+    for(int j = 0; j < 4; ++j)
+    {
+      uint64_t v = pa[j] ^ pb[j];
+      v = v - ((v >> 1) & 0x5555555555555555ULL);
+      v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+      d += (int)((((v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * 0x0101010101010101ULL) >> 56);
+    }
+    dist[i] = d;
+  }
+}
+
+#ifdef FORB_SIMD_X86
+
+static int detectKernel()
+{
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) return 2;
+  if(__builtin_cpu_supports("popcnt")) return 1;
+  return 0;
+}
+
+// 0: scalar, 1: popcnt, 2: avx2
+static const int kernel = detectKernel();
+
+__attribute__((target("popcnt")))
+static void distancesPopcnt(const unsigned char *a, const unsigned char *b,
+  int n, int *dist)
+{
+  const uint64_t *pa = reinterpret_cast<const uint64_t*>(a);
+  const uint64_t a0 = pa[0], a1 = pa[1], a2 = pa[2], a3 = pa[3];
+
+  for(int i = 0; i < n; ++i, b += FORB::L)
+  {
+    const uint64_t *pb = reinterpret_cast<const uint64_t*>(b);
+    dist[i] = __builtin_popcountll(a0 ^ pb[0]) + __builtin_popcountll(a1 ^ pb[1]) +
+      __builtin_popcountll(a2 ^ pb[2]) + __builtin_popcountll(a3 ^ pb[3]);
+  }
+}
+
+// per-byte bit count with vpshufb, summed into four 64-bit lanes by vpsadbw
+__attribute__((target("avx2")))
+static inline __m256i popcntBytes(const __m256i &x)
+{
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f);
+  const __m256i cnt = _mm256_add_epi8(
+    _mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)),
+    _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+  return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+static void distancesAVX2(const unsigned char *a, const unsigned char *b,
+  int n, int *dist)
+{
+  const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+  const __m256i *pb = reinterpret_cast<const __m256i*>(b);
+
+  int i = 0;
+  // 4 descriptors at a time; each 64-bit lane sum is at most 64, so two
+  // results fit in one lane and the four distances end up in one __m128i
+  for(; i + 4 <= n; i += 4, pb += 4)
+  {
+    const __m256i s0 = popcntBytes(_mm256_xor_si256(va, _mm256_load_si256(pb)));
+    const __m256i s1 = popcntBytes(_mm256_xor_si256(va, _mm256_load_si256(pb + 1)));
+    const __m256i s2 = popcntBytes(_mm256_xor_si256(va, _mm256_load_si256(pb + 2)));
+    const __m256i s3 = popcntBytes(_mm256_xor_si256(va, _mm256_load_si256(pb + 3)));
+
+    const __m256i t01 = _mm256_or_si256(s0, _mm256_slli_epi64(s1, 32));
+    const __m256i t23 = _mm256_or_si256(s2, _mm256_slli_epi64(s3, 32));
+    const __m256i u = _mm256_add_epi32(_mm256_unpacklo_epi64(t01, t23),
+      _mm256_unpackhi_epi64(t01, t23));
+    const __m128i d = _mm_add_epi32(_mm256_castsi256_si128(u),
+      _mm256_extracti128_si256(u, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dist + i), d);
+  }
+
+  for(; i < n; ++i, ++pb)
+  {
+    const __m256i s = popcntBytes(_mm256_xor_si256(va, _mm256_load_si256(pb)));
+    const __m128i h = _mm_add_epi64(_mm256_castsi256_si128(s),
+      _mm256_extracti128_si256(s, 1));
+    dist[i] = _mm_cvtsi128_si32(h) + _mm_extract_epi32(h, 2);
+  }
+}
+
+#endif
+
+void FORB::distances(const unsigned char *a, const unsigned char *b,
+  int n, int *dist)
+{
+#ifdef FORB_SIMD_X86
+  if(kernel == 2) return distancesAVX2(a, b, n, dist);
+  if(kernel == 1) return distancesPopcnt(a, b, n, dist);
+#endif
+  distancesScalar(a, b, n, dist);
+}
+
 // --------------------------------------------------------------------------
   
 std::string FORB::toString(const FORB::TDescriptor &a)
@@ -46,6 +46,18 @@ public:
    */
   static int distance(const TDescriptor &a, const TDescriptor &b);
 
+  /**
+   * Calculates the distances between a descriptor and n descriptors stored
+   * contiguously, L bytes each. Uses AVX2 or POPCNT when the cpu supports
+   * them; the results are the same as distance()
+   * @param a descriptor (L bytes)
+   * @param b first of the n descriptors, aligned to 32 bytes
+   * @param n number of descriptors in b
+   * @param dist (out) n distances
+   */
+  static void distances(const unsigned char *a, const unsigned char *b,
+    int n, int *dist);
+
   /**
    * Returns a string version of the descriptor
    * @param a descriptor
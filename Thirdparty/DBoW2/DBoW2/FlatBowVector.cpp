@@ -0,0 +1,114 @@
+/**
+ * File: FlatBowVector.cpp
+ * Description: bag of words vector stored in sorted arrays
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "FlatBowVector.h"
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+FlatBowVector::FlatBowVector(void)
+{
+}
+
+// --------------------------------------------------------------------------
+
+FlatBowVector::FlatBowVector(const BowVector &v)
+{
+  assign(v);
+}
+
+// --------------------------------------------------------------------------
+
+void FlatBowVector::assign(const BowVector &v)
+{
+  clear();
+  reserve(v.size());
+
+  // the map is already sorted by word id
+  for(BowVector::const_iterator vit = v.begin(); vit != v.end(); ++vit)
+    push_back(vit->first, vit->second);
+}
+
+// --------------------------------------------------------------------------
+
+void FlatBowVector::toBowVector(BowVector &v) const
+{
+  v.clear();
+  for(size_t i = 0; i < m_ids.size(); ++i)
+    v.insert(v.end(), BowVector::value_type(m_ids[i], m_values[i]));
+}
+
+// --------------------------------------------------------------------------
+
+void FlatBowVector::clear()
+{
+  m_ids.clear();
+  m_values.clear();
+}
+
+// --------------------------------------------------------------------------
+
+void FlatBowVector::reserve(size_t n)
+{
+  m_ids.reserve(n);
+  m_values.reserve(n);
+}
+
+// --------------------------------------------------------------------------
+
+void FlatBowVector::normalize(LNorm norm_type)
+{
+  // same order of operations as BowVector::normalize
+  double norm = 0.0;
+
+  if(norm_type == DBoW2::L1)
+  {
+    for(size_t i = 0; i < m_values.size(); ++i)
+      norm += fabs(m_values[i]);
+  }
+  else
+  {
+    for(size_t i = 0; i < m_values.size(); ++i)
+      norm += m_values[i] * m_values[i];
+    norm = sqrt(norm);
+  }
+
+  if(norm > 0.0)
+  {
+    for(size_t i = 0; i < m_values.size(); ++i)
+      m_values[i] /= norm;
+  }
+}
+
+// --------------------------------------------------------------------------
+
+bool FlatBowVector::operator==(const FlatBowVector &v) const
+{
+  return m_ids == v.m_ids && m_values == v.m_values;
+}
+
+// --------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream &out, const FlatBowVector &v)
+{
+  for(size_t i = 0; i < v.size(); ++i)
+  {
+    out << "<" << v.id(i) << ", " << v.value(i) << ">";
+
+    if(i + 1 < v.size()) out << ", ";
+  }
+  return out;
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
@@ -0,0 +1,143 @@
+/**
+ * File: FlatBowVector.h
+ * Description: bag of words vector stored in sorted arrays
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_FLAT_BOW_VECTOR__
+#define __D_T_FLAT_BOW_VECTOR__
+
+#include <iostream>
+#include <vector>
+
+#include "BowVector.h"
+
+namespace DBoW2 {
+
+/// Vector of words to represent images, stored as two arrays sorted by
+/// word id (ids and values). Holds the same entries as a BowVector, with
+/// one allocation per array instead of one tree node per word
+class FlatBowVector
+{
+public:
+
+  /**
+   * Constructor
+   */
+  FlatBowVector(void);
+
+  /**
+   * Creates the vector with the entries of a bow vector
+   * @param v
+   */
+  explicit FlatBowVector(const BowVector &v);
+
+  /**
+   * Replaces the content with the entries of a bow vector
+   * @param v
+   */
+  void assign(const BowVector &v);
+
+  /**
+   * Copies the entries into a bow vector
+   * @param v (out)
+   */
+  void toBowVector(BowVector &v) const;
+
+  /**
+   * Removes all the words
+   */
+  void clear();
+
+  /**
+   * Appends a word. Ids must be added in increasing order
+   * @param id word id, greater than the last one
+   * @param v word value
+   */
+  inline void push_back(WordId id, WordValue v)
+  {
+    m_ids.push_back(id);
+    m_values.push_back(v);
+  }
+
+  /**
+   * Reserves memory for n words
+   * @param n
+   */
+  void reserve(size_t n);
+
+  /**
+   * Normalizes the values in the vector, as BowVector::normalize
+   * @param norm_type norm used
+   */
+  void normalize(LNorm norm_type);
+
+  /**
+   * Returns the number of words
+   */
+  inline size_t size() const { return m_ids.size(); }
+
+  /**
+   * Returns whether there are no words
+   */
+  inline bool empty() const { return m_ids.empty(); }
+
+  /**
+   * Returns the id of the i-th word (ids are sorted)
+   * @param i
+   */
+  inline WordId id(size_t i) const { return m_ids[i]; }
+
+  /**
+   * Returns the value of the i-th word
+   * @param i
+   */
+  inline WordValue value(size_t i) const { return m_values[i]; }
+
+  /**
+   * Returns the sorted word ids, size() elements
+   */
+  inline const WordId* ids() const
+  {
+    return m_ids.empty() ? NULL : &m_ids[0];
+  }
+
+  /**
+   * Returns the word values, size() elements
+   */
+  inline const WordValue* values() const
+  {
+    return m_values.empty() ? NULL : &m_values[0];
+  }
+
+  /**
+   * Returns whether both vectors have the same words and values
+   * @param v
+   */
+  bool operator==(const FlatBowVector &v) const;
+
+  inline bool operator!=(const FlatBowVector &v) const
+  {
+    return !(*this == v);
+  }
+
+  /**
+   * Prints the content of the bow vector
+   * @param out stream
+   * @param v
+   */
+  friend std::ostream& operator<<(std::ostream &out, const FlatBowVector &v);
+
+protected:
+
+  /// Word ids, sorted
+  std::vector<WordId> m_ids;
+
+  /// Value of each word
+  std::vector<WordValue> m_values;
+};
+
+} // namespace DBoW2
+
+#endif
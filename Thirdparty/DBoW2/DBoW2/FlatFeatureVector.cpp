@@ -0,0 +1,128 @@
+/**
+ * File: FlatFeatureVector.cpp
+ * Description: feature vector stored in sorted arrays
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "FlatFeatureVector.h"
+
+namespace DBoW2 {
+
+// ---------------------------------------------------------------------------
+
+FlatFeatureVector::FlatFeatureVector(void): m_offsets(1, 0)
+{
+}
+
+// ---------------------------------------------------------------------------
+
+FlatFeatureVector::FlatFeatureVector(const FeatureVector &fv): m_offsets(1, 0)
+{
+  assign(fv);
+}
+
+// ---------------------------------------------------------------------------
+
+void FlatFeatureVector::assign(const FeatureVector &fv)
+{
+  clear();
+
+  size_t n = 0;
+  FeatureVector::const_iterator fit;
+  for(fit = fv.begin(); fit != fv.end(); ++fit) n += fit->second.size();
+  reserve(fv.size(), n);
+
+  // the map is already sorted by node id
+  for(fit = fv.begin(); fit != fv.end(); ++fit)
+  {
+    if(!fit->second.empty())
+      push_back(fit->first, &fit->second[0], fit->second.size());
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+void FlatFeatureVector::toFeatureVector(FeatureVector &fv) const
+{
+  fv.clear();
+  for(size_t i = 0; i < m_nodes.size(); ++i)
+  {
+    const unsigned int *f = features(i);
+    fv.insert(fv.end(), FeatureVector::value_type(m_nodes[i],
+      std::vector<unsigned int>(f, f + nFeatures(i))));
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+void FlatFeatureVector::clear()
+{
+  m_nodes.clear();
+  m_offsets.assign(1, 0);
+  m_features.clear();
+}
+
+// ---------------------------------------------------------------------------
+
+void FlatFeatureVector::push_back(NodeId id, const unsigned int *features,
+  size_t n)
+{
+  m_nodes.push_back(id);
+  m_features.insert(m_features.end(), features, features + n);
+  m_offsets.push_back(m_features.size());
+}
+
+// ---------------------------------------------------------------------------
+
+void FlatFeatureVector::reserve(size_t nodes, size_t features)
+{
+  m_nodes.reserve(nodes);
+  m_offsets.reserve(nodes + 1);
+  m_features.reserve(features);
+}
+
+// ---------------------------------------------------------------------------
+
+size_t FlatFeatureVector::lowerBound(NodeId id, size_t first) const
+{
+  return std::lower_bound(m_nodes.begin() + first, m_nodes.end(), id) -
+    m_nodes.begin();
+}
+
+// ---------------------------------------------------------------------------
+
+bool FlatFeatureVector::operator==(const FlatFeatureVector &fv) const
+{
+  return m_nodes == fv.m_nodes && m_offsets == fv.m_offsets &&
+    m_features == fv.m_features;
+}
+
+// ---------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream &out, const FlatFeatureVector &fv)
+{
+  for(size_t i = 0; i < fv.size(); ++i)
+  {
+    const unsigned int *f = fv.features(i);
+
+    if(i > 0) out << ", ";
+    out << "<" << fv.nodeId(i) << ": [";
+    for(unsigned int j = 0; j < fv.nFeatures(i); ++j)
+    {
+      if(j > 0) out << ", ";
+      out << f[j];
+    }
+    out << "]>";
+  }
+
+  return out;
+}
+
+// ---------------------------------------------------------------------------
+
+} // namespace DBoW2
@@ -0,0 +1,144 @@
+/**
+ * File: FlatFeatureVector.h
+ * Description: feature vector stored in sorted arrays
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_FLAT_FEATURE_VECTOR__
+#define __D_T_FLAT_FEATURE_VECTOR__
+
+#include <iostream>
+#include <vector>
+
+#include "BowVector.h"
+#include "FeatureVector.h"
+
+namespace DBoW2 {
+
+/// Vector of nodes with indexes of local features, in compressed rows:
+/// the nodes are sorted by id and the features of node i are
+/// features(i)[0..nFeatures(i)), all stored in one array
+class FlatFeatureVector
+{
+public:
+
+  /**
+   * Constructor
+   */
+  FlatFeatureVector(void);
+
+  /**
+   * Creates the vector with the entries of a feature vector
+   * @param fv
+   */
+  explicit FlatFeatureVector(const FeatureVector &fv);
+
+  /**
+   * Replaces the content with the entries of a feature vector
+   * @param fv
+   */
+  void assign(const FeatureVector &fv);
+
+  /**
+   * Copies the entries into a feature vector
+   * @param fv (out)
+   */
+  void toFeatureVector(FeatureVector &fv) const;
+
+  /**
+   * Removes all the nodes
+   */
+  void clear();
+
+  /**
+   * Appends a node with its features. Ids must be added in increasing order
+   * @param id node id, greater than the last one
+   * @param features indexes of the features
+   * @param n number of features
+   */
+  void push_back(NodeId id, const unsigned int *features, size_t n);
+
+  /**
+   * Reserves memory for the given number of nodes and features
+   * @param nodes
+   * @param features
+   */
+  void reserve(size_t nodes, size_t features);
+
+  /**
+   * Returns the number of nodes
+   */
+  inline size_t size() const { return m_nodes.size(); }
+
+  /**
+   * Returns whether there are no nodes
+   */
+  inline bool empty() const { return m_nodes.empty(); }
+
+  /**
+   * Returns the id of the i-th node (ids are sorted)
+   * @param i
+   */
+  inline NodeId nodeId(size_t i) const { return m_nodes[i]; }
+
+  /**
+   * Returns the indexes of the features of the i-th node
+   * @param i node index, less than size()
+   */
+  inline const unsigned int* features(size_t i) const
+  {
+    return &m_features[0] + m_offsets[i];
+  }
+
+  /**
+   * Returns the number of features of the i-th node
+   * @param i node index, less than size()
+   */
+  inline unsigned int nFeatures(size_t i) const
+  {
+    return m_offsets[i+1] - m_offsets[i];
+  }
+
+  /**
+   * Returns the index of the first node whose id is not less than id,
+   * searching from the node with index first on. size() if there is none
+   * @param id node id
+   * @param first index to start at
+   */
+  size_t lowerBound(NodeId id, size_t first = 0) const;
+
+  /**
+   * Returns whether both vectors have the same nodes and features
+   * @param fv
+   */
+  bool operator==(const FlatFeatureVector &fv) const;
+
+  inline bool operator!=(const FlatFeatureVector &fv) const
+  {
+    return !(*this == fv);
+  }
+
+  /**
+   * Sends a string versions of the feature vector through the stream
+   * @param out stream
+   * @param fv feature vector
+   */
+  friend std::ostream& operator<<(std::ostream &out,
+    const FlatFeatureVector &fv);
+
+protected:
+
+  /// Node ids, sorted
+  std::vector<NodeId> m_nodes;
+
+  /// Features of node i are m_features[m_offsets[i], m_offsets[i+1])
+  std::vector<unsigned int> m_offsets;
+
+  /// Feature indexes of all the nodes
+  std::vector<unsigned int> m_features;
+};
+
+} // namespace DBoW2
+
+#endif
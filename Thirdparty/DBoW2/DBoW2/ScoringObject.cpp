@@ -313,3 +313,188 @@ double DotProductScoring::score(const BowVector &v1,
 // ---------------------------------------------------------------------------
 // ---------------------------------------------------------------------------
 
+// Scores of flat vectors. The common words are found by merging the sorted
+// id arrays, advancing both indexes without branches, and their terms are
+// added up in increasing word id order, as with the maps, so the scores
+// are exactly the same.
+
+namespace
+{
+
+/// Sum of term(v_i, w_i) over the words present in both vectors
+template<class Term>
+inline double sumCommonWords(const FlatBowVector &v1, const FlatBowVector &v2,
+  const Term &term)
+{
+  const WordId *id1 = v1.ids();
+  const WordId *id2 = v2.ids();
+  const WordValue *w1 = v1.values();
+  const WordValue *w2 = v2.values();
+  const size_t n1 = v1.size();
+  const size_t n2 = v2.size();
+
+  double score = 0;
+
+  size_t i1 = 0, i2 = 0;
+  while(i1 < n1 && i2 < n2)
+  {
+    const WordId a = id1[i1];
+    const WordId b = id2[i2];
+
+    if(a == b) score += term(w1[i1], w2[i2]);
+
+    i1 += (a <= b);
+    i2 += (b <= a);
+  }
+
+  return score;
+}
+
+struct L1Term
+{
+  inline double operator()(WordValue vi, WordValue wi) const
+  {
+    return fabs(vi - wi) - fabs(vi) - fabs(wi);
+  }
+};
+
+struct ProductTerm
+{
+  inline double operator()(WordValue vi, WordValue wi) const
+  {
+    return vi * wi;
+  }
+};
+
+struct ChiSquareTerm
+{
+  inline double operator()(WordValue vi, WordValue wi) const
+  {
+    return vi + wi != 0.0 ? vi * wi / (vi + wi) : 0.0;
+  }
+};
+
+struct BhattacharyyaTerm
+{
+  inline double operator()(WordValue vi, WordValue wi) const
+  {
+    return sqrt(vi * wi);
+  }
+};
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+
+double L1Scoring::score(const FlatBowVector &v1, const FlatBowVector &v2)
+  const
+{
+  double score = sumCommonWords(v1, v2, L1Term());
+
+  // see L1Scoring::score(BowVector, BowVector)
+  score = -score/2.0;
+
+  return score; // [0..1]
+}
+
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+
+double L2Scoring::score(const FlatBowVector &v1, const FlatBowVector &v2)
+  const
+{
+  double score = sumCommonWords(v1, v2, ProductTerm());
+
+  if(score >= 1) // rounding errors
+    score = 1.0;
+  else
+    score = 1.0 - sqrt(1.0 - score); // [0..1]
+
+  return score;
+}
+
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+
+double ChiSquareScoring::score(const FlatBowVector &v1,
+  const FlatBowVector &v2) const
+{
+  double score = sumCommonWords(v1, v2, ChiSquareTerm());
+
+  // this takes the -4 into account
+  score = 2. * score; // [0..1]
+
+  return score;
+}
+
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+
+double KLScoring::score(const FlatBowVector &v1, const FlatBowVector &v2)
+  const
+{
+  const WordId *id1 = v1.ids();
+  const WordId *id2 = v2.ids();
+  const WordValue *w1 = v1.values();
+  const WordValue *w2 = v2.values();
+  const size_t n1 = v1.size();
+  const size_t n2 = v2.size();
+
+  double score = 0;
+
+  // all the items or v are taken into account
+
+  size_t i1 = 0, i2 = 0;
+  while(i1 < n1 && i2 < n2)
+  {
+    const WordValue vi = w1[i1];
+    const WordValue wi = w2[i2];
+
+    if(id1[i1] == id2[i2])
+    {
+      if(vi != 0 && wi != 0) score += vi * log(vi/wi);
+      ++i1;
+      ++i2;
+    }
+    else if(id1[i1] < id2[i2])
+    {
+      score += vi * (log(vi) - LOG_EPS);
+      ++i1;
+    }
+    else
+    {
+      // do not add any score
+      ++i2;
+    }
+  }
+
+  // sum rest of items of v
+  for(; i1 < n1; ++i1)
+    if(w1[i1] != 0)
+      score += w1[i1] * (log(w1[i1]) - LOG_EPS);
+
+  return score; // cannot be scaled
+}
+
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+
+double BhattacharyyaScoring::score(const FlatBowVector &v1,
+  const FlatBowVector &v2) const
+{
+  return sumCommonWords(v1, v2, BhattacharyyaTerm()); // already scaled
+}
+
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+
+double DotProductScoring::score(const FlatBowVector &v1,
+  const FlatBowVector &v2) const
+{
+  return sumCommonWords(v1, v2, ProductTerm()); // cannot scale
+}
+
+// ---------------------------------------------------------------------------
+// ---------------------------------------------------------------------------
+
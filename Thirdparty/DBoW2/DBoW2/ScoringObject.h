@@ -11,6 +11,7 @@
 #define __D_T_SCORING_OBJECT__
 
 #include "BowVector.h"
+#include "FlatBowVector.h"
 
 namespace DBoW2 {
 
@@ -27,6 +28,16 @@ public:
    */
   virtual double score(const BowVector &v, const BowVector &w) const = 0;
 
+  /**
+   * Same as score(BowVector, BowVector) with flat vectors. Gives exactly the
+   * same result, the common words are added up in the same order
+   * @param v
+   * @param w
+   * @return score
+   */
+  virtual double score(const FlatBowVector &v, const FlatBowVector &w) const
+    = 0;
+
   /**
    * Returns whether a vector must be normalized before scoring according
    * to the scoring scheme
@@ -61,6 +72,15 @@ public:
      */ \
     virtual double score(const BowVector &v, const BowVector &w) const; \
     \
+    /** \
+     * Computes score between two flat vectors \
+     * @param v \
+     * @param w \
+     * @return score between v and w \
+     */ \
+    virtual double score(const FlatBowVector &v, const FlatBowVector &w) \
+      const; \
+    \
     /** \
      * Says if a vector must be normalized according to the scoring function \
      * @param norm (out) if true, norm to use
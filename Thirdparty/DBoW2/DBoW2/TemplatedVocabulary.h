@@ -18,6 +18,7 @@
 #define __D_T_TEMPLATED_VOCABULARY__
 
 #include <cassert>
+#include <cstring>
 
 #include <vector>
 #include <numeric>
@@ -27,8 +28,15 @@
 #include <opencv2/core/core.hpp>
 #include <limits>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "FeatureVector.h"
 #include "BowVector.h"
+#include "FlatFeatureVector.h"
+#include "FlatBowVector.h"
 #include "ScoringObject.h"
 
 #include "../DUtils/Random.h"
@@ -145,6 +153,62 @@ public:
   virtual void transform(const std::vector<TDescriptor>& features,
     BowVector &v, FeatureVector &fv, int levelsup) const;
 
+  /**
+   * Same as transform(features, v, fv, levelsup), with the descriptors
+   * stored contiguously (F::L bytes each, e.g. the rows of a continuous
+   * cv::Mat) instead of one TDescriptor each
+   * @param descriptors first descriptor
+   * @param n number of descriptors
+   * @param v (out) bow vector
+   * @param fv (out) feature vector of nodes and feature indexes
+   * @param levelsup levels to go up the vocabulary tree to get the node index
+   */
+  void transform(const unsigned char *descriptors, int n,
+    BowVector &v, FeatureVector &fv, int levelsup) const;
+
+  /**
+   * Finds the word of each of n contiguous descriptors (F::L bytes each).
+   * It only reads the vocabulary, so disjoint ranges of descriptors can be
+   * transformed by different threads and then joined with buildVectors
+   * @param descriptors first descriptor
+   * @param n number of descriptors
+   * @param word_ids (out) word id of each descriptor
+   * @param weights (out) word weight of each descriptor
+   * @param nids (out) id of the node "levelsup" levels up of each descriptor
+   * @param levelsup
+   */
+  void transform(const unsigned char *descriptors, int n, WordId *word_ids,
+    WordValue *weights, NodeId *nids, int levelsup) const;
+
+  /**
+   * Builds the bow vector and the feature vector of n features from the
+   * words found by transform(descriptors, n, word_ids, weights, nids,
+   * levelsup). Feature i is the i-th entry of the arrays
+   * @param word_ids word id of each feature
+   * @param weights word weight of each feature
+   * @param nids node id of each feature
+   * @param n number of features
+   * @param v (out) bow vector
+   * @param fv (out) feature vector
+   */
+  void buildVectors(const WordId *word_ids, const WordValue *weights,
+    const NodeId *nids, int n, BowVector &v, FeatureVector &fv) const;
+
+  /**
+   * Same as transform(descriptors, n, v, fv, levelsup), producing flat
+   * vectors with exactly the same entries
+   */
+  void transform(const unsigned char *descriptors, int n,
+    FlatBowVector &v, FlatFeatureVector &fv, int levelsup) const;
+
+  /**
+   * Same as buildVectors(word_ids, weights, nids, n, v, fv) producing flat
+   * vectors with exactly the same entries. The features are sorted instead
+   * of inserted in maps
+   */
+  void buildVectors(const WordId *word_ids, const WordValue *weights,
+    const NodeId *nids, int n, FlatBowVector &v, FlatFeatureVector &fv) const;
+
   /**
    * Transforms a single feature into a word (without weight)
    * @param feature
@@ -160,6 +224,14 @@ public:
    * @note the vectors must be already sorted and normalized if necessary
    */
   inline double score(const BowVector &a, const BowVector &b) const;
+
+  /**
+   * Returns the score of two flat vectors, the same as with BowVectors
+   * @param a vector
+   * @param b vector
+   * @return score between vectors
+   */
+  inline double score(const FlatBowVector &a, const FlatBowVector &b) const;
   
   /**
    * Returns the id of the node that is "levelsup" levels from the word given
@@ -258,6 +330,27 @@ public:
    */
   void saveToBinaryFile(const std::string &filename) const;  
 
+  /**
+   * Loads the vocabulary from a file written by saveToMappedFile.
+   * The file is mapped read-only and its flat tree is used in place, so
+   * loading takes no time and the pages are shared by all the processes
+   * that map the same file. Only the flat tree is available: the vocabulary
+   * supports transform, score, size and empty, but not the functions that
+   * walk the tree (getWord, getParentNode, stopWords, save...)
+   * @param filename
+   * @return false if the file could not be mapped or is not valid
+   */
+  bool loadFromMappedFile(const std::string &filename);
+
+  /**
+   * Saves the flat tree into a file that can be loaded with
+   * loadFromMappedFile. Sections are page aligned and addressed by offsets
+   * from the start of the file, in the byte order of this machine
+   * @param filename
+   * @return false if the file could not be written
+   */
+  bool saveToMappedFile(const std::string &filename) const;
+
 
   /**
    * Saves the vocabulary into a file
@@ -301,6 +394,29 @@ public:
    */
   virtual int stopWords(double minWeight);
 
+  /**
+   * Builds a flat copy of the tree, used by transform from now on.
+   * The children of each node are stored contiguously and their descriptors
+   * are packed as raw F::L byte rows, so all the children of a node are
+   * scored with a single F::distances call. Words, weights and node ids are
+   * the same as with the tree, so transform produces the same vectors.
+   * Only for descriptors stored as F::L contiguous bytes (e.g. FORB).
+   * Loading or creating a vocabulary discards the flat copy.
+   */
+  void flatten();
+
+  /**
+   * Returns whether transform uses the flat copy of the tree
+   * @return true iff flatten has been called after the last load
+   */
+  inline bool isFlat() const { return m_flat_nodes != NULL; }
+
+  /**
+   * Returns whether the vocabulary is mapped from a file
+   * @return true iff loaded with loadFromMappedFile
+   */
+  inline bool isMapped() const { return m_map_address != NULL; }
+
 protected:
 
   /// Pointer to descriptor
@@ -341,6 +457,42 @@ protected:
     inline bool isLeaf() const { return children.empty(); }
   };
 
+  /// Node of the flat tree, also the record of the mapped file
+  struct FlatNode
+  {
+    /// Flat index of the first child; its descriptor row has the same index
+    unsigned int first_child;
+    /// Number of children, 0 for words
+    unsigned int n_children;
+    /// Id of the node in m_nodes
+    NodeId id;
+    /// Word id if the node is a word
+    WordId word_id;
+    /// Weight if the node is a word
+    WordValue weight;
+  };
+
+  /// Header at the start of a mapped file
+  struct MappedHeader
+  {
+    /// "DBoW2MAP"
+    char magic[8];
+    unsigned int version;
+    /// sizeof(FlatNode) and F::L, checked when mapping
+    unsigned int node_size;
+    unsigned int descriptor_size;
+    int k;
+    int L;
+    int scoring;
+    int weighting;
+    unsigned int n_nodes;
+    unsigned int n_words;
+    /// Offsets from the start of the file, page aligned
+    unsigned long long nodes_offset;
+    unsigned long long descriptors_offset;
+    unsigned long long file_size;
+  };
+
 protected:
 
   /**
@@ -348,6 +500,11 @@ protected:
    */
   void createScoringObject();
 
+  /**
+   * Discards the flat tree and unmaps the mapped file, if any
+   */
+  void clearFlat();
+
   /** 
    * Returns a set of pointers to descriptores
    * @param training_features all the features
@@ -374,6 +531,25 @@ protected:
    * @param id (out) word id
    */
   virtual void transform(const TDescriptor &feature, WordId &id) const;
+
+  /**
+   * Checks the node table of a mapped file in one sequential pass: the
+   * children of every node lie after it and inside the table, and every
+   * word id is smaller than the number of words. transformFlat relies on
+   * this to stay inside the mapping and to terminate.
+   * @param nodes node table
+   * @param n_nodes number of nodes
+   * @param n_words number of words
+   * @return true iff the table is consistent
+   */
+  static bool checkFlatNodes(const FlatNode *nodes, unsigned int n_nodes,
+    unsigned int n_words);
+
+  /**
+   * Same as transform(feature, id, weight, nid, levelsup), using the flat tree
+   */
+  void transformFlat(const unsigned char *feature, WordId &id,
+    WordValue &weight, NodeId* nid, int levelsup) const;
       
   /**
    * Creates a level in the tree, under the parent, by running kmeans with
@@ -438,6 +614,32 @@ protected:
   /// Words of the vocabulary (tree leaves)
   /// this condition holds: m_words[wid]->word_id == wid
   std::vector<Node*> m_words;
+
+  /// Flat tree in breadth-first order, NULL if not built. Root is at 0.
+  /// Points into m_flat_storage or into the mapped file
+  const FlatNode *m_flat_nodes;
+
+  /// Storage of the flat nodes built by flatten
+  std::vector<FlatNode> m_flat_storage;
+
+  /// Storage of the flat descriptors built by flatten
+  std::vector<unsigned char> m_flat_buffer;
+
+  /// Descriptor of each flat node (F::L bytes each, 32-byte aligned),
+  /// points into m_flat_buffer or into the mapped file
+  const unsigned char *m_flat_descriptors;
+
+  /// Mapped file, NULL if not mapped
+  void *m_map_address;
+
+  /// Length of the mapping
+  size_t m_map_length;
+
+  /// Name of the mapped file, mapped again by copies
+  std::string m_map_filename;
+
+  /// Number of words of a mapped vocabulary (m_words is empty then)
+  unsigned int m_map_words;
   
 };
 
@@ -447,7 +649,8 @@ template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
   (int k, int L, WeightingType weighting, ScoringType scoring)
   : m_k(k), m_L(L), m_weighting(weighting), m_scoring(scoring),
-  m_scoring_object(NULL)
+  m_scoring_object(NULL), m_flat_nodes(NULL), m_flat_descriptors(NULL),
+  m_map_address(NULL), m_map_length(0), m_map_words(0)
 {
   createScoringObject();
 }
@@ -456,7 +659,9 @@ TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
 
 template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
-  (const std::string &filename): m_scoring_object(NULL)
+  (const std::string &filename): m_scoring_object(NULL),
+  m_flat_nodes(NULL), m_flat_descriptors(NULL),
+  m_map_address(NULL), m_map_length(0), m_map_words(0)
 {
   load(filename);
 }
@@ -465,7 +670,9 @@ TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
 
 template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
-  (const char *filename): m_scoring_object(NULL)
+  (const char *filename): m_scoring_object(NULL),
+  m_flat_nodes(NULL), m_flat_descriptors(NULL),
+  m_map_address(NULL), m_map_length(0), m_map_words(0)
 {
   load(filename);
 }
@@ -509,6 +716,23 @@ void TemplatedVocabulary<TDescriptor,F>::createScoringObject()
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::clearFlat()
+{
+  if(m_map_address != NULL) munmap(m_map_address, m_map_length);
+  m_map_address = NULL;
+  m_map_length = 0;
+  m_map_filename.clear();
+  m_map_words = 0;
+
+  m_flat_nodes = NULL;
+  m_flat_descriptors = NULL;
+  m_flat_storage.clear();
+  m_flat_buffer.clear();
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 void TemplatedVocabulary<TDescriptor,F>::setScoringType(ScoringType type)
 {
@@ -529,7 +753,8 @@ void TemplatedVocabulary<TDescriptor,F>::setWeightingType(WeightingType type)
 template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary(
   const TemplatedVocabulary<TDescriptor, F> &voc)
-  : m_scoring_object(NULL)
+  : m_scoring_object(NULL), m_flat_nodes(NULL), m_flat_descriptors(NULL),
+  m_map_address(NULL), m_map_length(0), m_map_words(0)
 {
   *this = voc;
 }
@@ -540,6 +765,7 @@ template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::~TemplatedVocabulary()
 {
   delete m_scoring_object;
+  clearFlat();
 }
 
 // --------------------------------------------------------------------------
@@ -549,6 +775,8 @@ TemplatedVocabulary<TDescriptor, F>&
 TemplatedVocabulary<TDescriptor,F>::operator=
   (const TemplatedVocabulary<TDescriptor, F> &voc)
 {  
+  if(this == &voc) return *this;
+
   this->m_k = voc.m_k;
   this->m_L = voc.m_L;
   this->m_scoring = voc.m_scoring;
@@ -561,6 +789,12 @@ TemplatedVocabulary<TDescriptor,F>::operator=
   
   this->m_nodes = voc.m_nodes;
   this->createWords();
+
+  // the flat tree points into the buffers or the mapping of voc,
+  // build or map it again
+  this->clearFlat();
+  if(voc.isMapped()) this->loadFromMappedFile(voc.m_map_filename);
+  else if(voc.isFlat()) this->flatten();
   
   return *this;
 }
@@ -572,6 +806,7 @@ void TemplatedVocabulary<TDescriptor,F>::create(
   const std::vector<std::vector<TDescriptor> > &training_features)
 {
   m_nodes.clear();
+  clearFlat();
   m_words.clear();
   
   // expected_nodes = Sum_{i=0..L} ( k^i )
@@ -1013,7 +1248,7 @@ void TemplatedVocabulary<TDescriptor,F>::setNodeWeights
 template<class TDescriptor, class F>
 inline unsigned int TemplatedVocabulary<TDescriptor,F>::size() const
 {
-  return m_words.size();
+  return isMapped() ? m_map_words : m_words.size();
 }
 
 // --------------------------------------------------------------------------
@@ -1021,7 +1256,7 @@ inline unsigned int TemplatedVocabulary<TDescriptor,F>::size() const
 template<class TDescriptor, class F>
 inline bool TemplatedVocabulary<TDescriptor,F>::empty() const
 {
-  return m_words.empty();
+  return isMapped() ? m_map_words == 0 : m_words.empty();
 }
 
 // --------------------------------------------------------------------------
@@ -1149,28 +1384,87 @@ void TemplatedVocabulary<TDescriptor,F>::transform(
     return;
   }
   
+  const int n = features.size();
+  vector<WordId> word_ids(n);
+  vector<WordValue> weights(n);
+  vector<NodeId> nids(n);
+
+  // w is the idf value if TF_IDF or IDF, 1 if TF or BINARY
+  for(int i = 0; i < n; ++i)
+    transform(features[i], word_ids[i], weights[i], &nids[i], levelsup);
+
+  if(n > 0)
+    buildVectors(&word_ids[0], &weights[0], &nids[0], n, v, fv);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F> 
+void TemplatedVocabulary<TDescriptor,F>::transform(
+  const unsigned char *descriptors, int n,
+  BowVector &v, FeatureVector &fv, int levelsup) const
+{
+  v.clear();
+  fv.clear();
+  
+  if(empty() || n <= 0) return;
+
+  vector<WordId> word_ids(n);
+  vector<WordValue> weights(n);
+  vector<NodeId> nids(n);
+
+  transform(descriptors, n, &word_ids[0], &weights[0], &nids[0], levelsup);
+  buildVectors(&word_ids[0], &weights[0], &nids[0], n, v, fv);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F> 
+void TemplatedVocabulary<TDescriptor,F>::transform(
+  const unsigned char *descriptors, int n, WordId *word_ids,
+  WordValue *weights, NodeId *nids, int levelsup) const
+{
+  for(int i = 0; i < n; ++i)
+  {
+    const unsigned char *row = descriptors + (size_t)i * F::L;
+
+    if(m_flat_nodes != NULL)
+    {
+      transformFlat(row, word_ids[i], weights[i], &nids[i], levelsup);
+    }
+    else
+    {
+      // header only, the row is not copied
+      const TDescriptor feature(1, F::L, CV_8U,
+        const_cast<unsigned char*>(row));
+      transform(feature, word_ids[i], weights[i], &nids[i], levelsup);
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F> 
+void TemplatedVocabulary<TDescriptor,F>::buildVectors(
+  const WordId *word_ids, const WordValue *weights, const NodeId *nids,
+  int n, BowVector &v, FeatureVector &fv) const
+{
+  v.clear();
+  fv.clear();
+
   // normalize 
   LNorm norm;
   bool must = m_scoring_object->mustNormalize(norm);
   
-  typename vector<TDescriptor>::const_iterator fit;
-  
   if(m_weighting == TF || m_weighting == TF_IDF)
   {
-    unsigned int i_feature = 0;
-    for(fit = features.begin(); fit < features.end(); ++fit, ++i_feature)
+    for(int i = 0; i < n; ++i)
     {
-      WordId id;
-      NodeId nid;
-      WordValue w; 
       // w is the idf value if TF_IDF, 1 if TF
-      
-      transform(*fit, id, w, &nid, levelsup);
-      
-      if(w > 0) // not stopped
+      if(weights[i] > 0) // not stopped
       { 
-        v.addWeight(id, w);
-        fv.addFeature(nid, i_feature);
+        v.addWeight(word_ids[i], weights[i]);
+        fv.addFeature(nids[i], i);
       }
     }
     
@@ -1185,20 +1479,13 @@ void TemplatedVocabulary<TDescriptor,F>::transform(
   }
   else // IDF || BINARY
   {
-    unsigned int i_feature = 0;
-    for(fit = features.begin(); fit < features.end(); ++fit, ++i_feature)
+    for(int i = 0; i < n; ++i)
     {
-      WordId id;
-      NodeId nid;
-      WordValue w;
       // w is idf if IDF, or 1 if BINARY
-      
-      transform(*fit, id, w, &nid, levelsup);
-      
-      if(w > 0) // not stopped
+      if(weights[i] > 0) // not stopped
       {
-        v.addIfNotExist(id, w);
-        fv.addFeature(nid, i_feature);
+        v.addIfNotExist(word_ids[i], weights[i]);
+        fv.addFeature(nids[i], i);
       }
     }
   } // if m_weighting == ...
@@ -1208,6 +1495,100 @@ void TemplatedVocabulary<TDescriptor,F>::transform(
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F> 
+void TemplatedVocabulary<TDescriptor,F>::transform(
+  const unsigned char *descriptors, int n,
+  FlatBowVector &v, FlatFeatureVector &fv, int levelsup) const
+{
+  v.clear();
+  fv.clear();
+  
+  if(empty() || n <= 0) return;
+
+  vector<WordId> word_ids(n);
+  vector<WordValue> weights(n);
+  vector<NodeId> nids(n);
+
+  transform(descriptors, n, &word_ids[0], &weights[0], &nids[0], levelsup);
+  buildVectors(&word_ids[0], &weights[0], &nids[0], n, v, fv);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F> 
+void TemplatedVocabulary<TDescriptor,F>::buildVectors(
+  const WordId *word_ids, const WordValue *weights, const NodeId *nids,
+  int n, FlatBowVector &v, FlatFeatureVector &fv) const
+{
+  v.clear();
+  fv.clear();
+
+  // features that are not stopped, sorted by word id and then by index,
+  // so that the weights of a word are added up in the same order as
+  // BowVector::addWeight does
+  vector<unsigned long long> keys;
+  keys.reserve(n);
+  for(int i = 0; i < n; ++i)
+  {
+    if(weights[i] > 0) // not stopped
+      keys.push_back(((unsigned long long)word_ids[i] << 32) | (unsigned)i);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  size_t n_words = 0;
+  for(size_t k = 0; k < keys.size(); ++k)
+    if(k == 0 || (keys[k] >> 32) != (keys[k-1] >> 32)) ++n_words;
+
+  // normalize 
+  LNorm norm;
+  bool must = m_scoring_object->mustNormalize(norm);
+  const bool tf = m_weighting == TF || m_weighting == TF_IDF;
+  const double nd = n_words;
+
+  v.reserve(n_words);
+  for(size_t k = 0; k < keys.size(); )
+  {
+    const unsigned long long id = keys[k] >> 32;
+
+    // w is the idf value if TF_IDF or IDF, 1 if TF or BINARY.
+    // IDF and BINARY keep the weight of the first feature
+    WordValue value = weights[(unsigned)keys[k]];
+    for(++k; k < keys.size() && (keys[k] >> 32) == id; ++k)
+      if(tf) value += weights[(unsigned)keys[k]];
+
+    // unnecessary when normalizing
+    if(tf && !must) value /= nd;
+
+    v.push_back((WordId)id, value);
+  }
+
+  if(must) v.normalize(norm);
+
+  // the same features, sorted by node id and then by index
+  keys.clear();
+  for(int i = 0; i < n; ++i)
+  {
+    if(weights[i] > 0) // not stopped
+      keys.push_back(((unsigned long long)nids[i] << 32) | (unsigned)i);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  vector<unsigned int> features(keys.size());
+  for(size_t k = 0; k < keys.size(); ++k) features[k] = (unsigned)keys[k];
+
+  fv.reserve(n_words, keys.size());
+  for(size_t k = 0; k < keys.size(); )
+  {
+    const size_t first = k;
+    const unsigned long long nid = keys[k] >> 32;
+    for(++k; k < keys.size() && (keys[k] >> 32) == nid; ++k);
+
+    fv.push_back((NodeId)nid, &features[first], k - first);
+  }
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F> 
 inline double TemplatedVocabulary<TDescriptor,F>::score
   (const BowVector &v1, const BowVector &v2) const
@@ -1217,6 +1598,15 @@ inline double TemplatedVocabulary<TDescriptor,F>::score
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F> 
+inline double TemplatedVocabulary<TDescriptor,F>::score
+  (const FlatBowVector &v1, const FlatBowVector &v2) const
+{
+  return m_scoring_object->score(v1, v2);
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 void TemplatedVocabulary<TDescriptor,F>::transform
   (const TDescriptor &feature, WordId &id) const
@@ -1231,6 +1621,12 @@ template<class TDescriptor, class F>
 void TemplatedVocabulary<TDescriptor,F>::transform(const TDescriptor &feature, 
   WordId &word_id, WordValue &weight, NodeId *nid, int levelsup) const
 { 
+  if(m_flat_nodes != NULL)
+  {
+    transformFlat(feature.data, word_id, weight, nid, levelsup);
+    return;
+  }
+
   // propagate the feature down the tree
   vector<NodeId> nodes;
   typename vector<NodeId>::const_iterator nit;
@@ -1273,6 +1669,105 @@ void TemplatedVocabulary<TDescriptor,F>::transform(const TDescriptor &feature,
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::transformFlat(
+  const unsigned char *f, WordId &word_id, WordValue &weight,
+  NodeId *nid, int levelsup) const
+{
+  // level at which the node must be stored in nid, if given
+  const int nid_level = m_L - levelsup;
+  if(nid_level <= 0 && nid != NULL) *nid = 0; // root
+
+  // children are scored in chunks to keep the distances on the stack
+  const unsigned int CHUNK = 64;
+  int dist[CHUNK];
+
+  unsigned int final_idx = 0; // root
+  int current_level = 0;
+
+  do
+  {
+    ++current_level;
+    const FlatNode &node = m_flat_nodes[final_idx];
+
+    // the first child with the minimum distance wins, as in the tree
+    int best_d = std::numeric_limits<int>::max();
+    for(unsigned int c = 0; c < node.n_children; c += CHUNK)
+    {
+      const unsigned int first = node.first_child + c;
+      const int n = (int)std::min(CHUNK, node.n_children - c);
+      F::distances(f, m_flat_descriptors + (size_t)first * F::L, n, dist);
+
+      for(int i = 0; i < n; ++i)
+      {
+        if(dist[i] < best_d)
+        {
+          best_d = dist[i];
+          final_idx = first + i;
+        }
+      }
+    }
+
+    if(nid != NULL && current_level == nid_level)
+      *nid = m_flat_nodes[final_idx].id;
+
+  } while(m_flat_nodes[final_idx].n_children > 0);
+
+  const FlatNode &word = m_flat_nodes[final_idx];
+  word_id = word.word_id;
+  weight = word.weight;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::flatten()
+{
+  if(isMapped()) return; // already flat
+
+  clearFlat();
+
+  if(m_nodes.empty()) return;
+
+  // 31 extra bytes to align the first row to 32 bytes
+  m_flat_buffer.assign(m_nodes.size() * F::L + 31, 0);
+  unsigned char *descriptors = &m_flat_buffer[0];
+  descriptors += (32 - reinterpret_cast<size_t>(descriptors) % 32) % 32;
+
+  // breadth-first order, so the children of each node are consecutive
+  vector<NodeId> order;
+  order.reserve(m_nodes.size());
+  order.push_back(0);
+
+  vector<FlatNode> flat_nodes(m_nodes.size());
+  for(size_t i = 0; i < order.size(); ++i)
+  {
+    const Node &node = m_nodes[order[i]];
+
+    FlatNode &flat = flat_nodes[i];
+    flat.id = order[i];
+    flat.first_child = order.size();
+    flat.n_children = node.children.size();
+    flat.word_id = node.word_id;
+    flat.weight = node.weight;
+
+    vector<NodeId>::const_iterator cit;
+    for(cit = node.children.begin(); cit != node.children.end(); ++cit)
+    {
+      memcpy(descriptors + order.size() * F::L, m_nodes[*cit].descriptor.data,
+        F::L);
+      order.push_back(*cit);
+    }
+  }
+  flat_nodes.resize(order.size());
+
+  m_flat_storage.swap(flat_nodes);
+  m_flat_nodes = &m_flat_storage[0];
+  m_flat_descriptors = descriptors;
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 NodeId TemplatedVocabulary<TDescriptor,F>::getParentNode
   (WordId wid, int levelsup) const
@@ -1342,6 +1837,11 @@ int TemplatedVocabulary<TDescriptor,F>::stopWords(double minWeight)
       (*wit)->weight = 0;
     }
   }
+
+  // the flat tree keeps a copy of the weights
+  for(size_t i = 0; i < m_flat_storage.size(); ++i)
+    m_flat_storage[i].weight = m_nodes[m_flat_storage[i].id].weight;
+
   return c;
 }
 
@@ -1358,6 +1858,7 @@ bool TemplatedVocabulary<TDescriptor,F>::loadFromTextFile(const std::string &fil
 
     m_words.clear();
     m_nodes.clear();
+    clearFlat();
 
     string s;
     getline(f,s);
@@ -1479,6 +1980,7 @@ bool TemplatedVocabulary<TDescriptor,F>::loadFromBinaryFile(const std::string &f
   m_words.clear();
   m_words.reserve(pow((double)m_k, (double)m_L + 1));
   m_nodes.clear();
+  clearFlat();
   m_nodes.resize(nb_nodes+1);
   m_nodes[0].id = 0;
   char buf[size_node]; int nid = 1;
@@ -1535,6 +2037,150 @@ void TemplatedVocabulary<TDescriptor,F>::saveToBinaryFile(const std::string &fil
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::saveToMappedFile(
+  const std::string &filename) const
+{
+  if(!isFlat())
+  {
+    TemplatedVocabulary<TDescriptor, F> voc(*this);
+    voc.flatten();
+    return voc.isFlat() && voc.saveToMappedFile(filename);
+  }
+
+  // sections start at page boundaries, so they stay aligned when mapped
+  const unsigned long long page = 4096;
+
+  MappedHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "DBoW2MAP", sizeof(header.magic));
+  header.version = 1;
+  header.node_size = sizeof(FlatNode);
+  header.descriptor_size = F::L;
+  header.k = m_k;
+  header.L = m_L;
+  header.scoring = m_scoring;
+  header.weighting = m_weighting;
+  header.n_nodes = isMapped() ?
+    static_cast<const MappedHeader*>(m_map_address)->n_nodes :
+    m_flat_storage.size();
+  header.n_words = size();
+  header.nodes_offset = (sizeof(header) + page - 1) / page * page;
+  header.descriptors_offset = (header.nodes_offset +
+    (unsigned long long)header.n_nodes * sizeof(FlatNode) + page - 1)
+    / page * page;
+  header.file_size = header.descriptors_offset +
+    (unsigned long long)header.n_nodes * F::L;
+
+  ofstream f(filename.c_str(), ios::out | ios::binary);
+  if(!f.is_open()) return false;
+
+  const vector<char> padding(page, 0);
+
+  f.write((const char*)&header, sizeof(header));
+  f.write(&padding[0], header.nodes_offset - sizeof(header));
+  f.write((const char*)m_flat_nodes,
+    (std::streamsize)header.n_nodes * sizeof(FlatNode));
+  f.write(&padding[0], header.descriptors_offset - header.nodes_offset -
+    (unsigned long long)header.n_nodes * sizeof(FlatNode));
+  f.write((const char*)m_flat_descriptors,
+    (std::streamsize)header.n_nodes * F::L);
+  f.close();
+
+  return !f.fail();
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::checkFlatNodes(
+  const FlatNode *nodes, unsigned int n_nodes, unsigned int n_words)
+{
+  for(unsigned int i = 0; i < n_nodes; ++i)
+  {
+    const FlatNode &node = nodes[i];
+    if(node.n_children == 0)
+    {
+      if(node.word_id >= n_words) return false;
+    }
+    else if(node.first_child <= i ||
+      (unsigned long long)node.first_child + node.n_children > n_nodes)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::loadFromMappedFile(
+  const std::string &filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if(fd < 0) return false;
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MappedHeader))
+  {
+    close(fd);
+    return false;
+  }
+
+  const size_t length = st.st_size;
+  void *address = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // the mapping keeps a reference to the file
+  if(address == MAP_FAILED) return false;
+
+  // the header and the node table are checked, the descriptors are not
+  // read here so that their pages are loaded on demand
+  const MappedHeader &header = *static_cast<const MappedHeader*>(address);
+  if(memcmp(header.magic, "DBoW2MAP", sizeof(header.magic)) != 0 ||
+    header.version != 1 || header.node_size != sizeof(FlatNode) ||
+    header.descriptor_size != (unsigned int)F::L || header.n_nodes == 0 ||
+    header.k <= 0 || header.L <= 0 ||
+    header.scoring < L1_NORM || header.scoring > DOT_PRODUCT ||
+    header.weighting < TF_IDF || header.weighting > BINARY ||
+    header.file_size != length ||
+    header.nodes_offset % 32 != 0 || header.descriptors_offset % 32 != 0 ||
+    header.nodes_offset + (unsigned long long)header.n_nodes *
+      sizeof(FlatNode) > header.descriptors_offset ||
+    header.descriptors_offset + (unsigned long long)header.n_nodes * F::L
+      > length ||
+    !checkFlatNodes(reinterpret_cast<const FlatNode*>(
+      static_cast<const unsigned char*>(address) + header.nodes_offset),
+      header.n_nodes, header.n_words))
+  {
+    munmap(address, length);
+    return false;
+  }
+
+  m_words.clear();
+  m_nodes.clear();
+  clearFlat();
+
+  m_k = header.k;
+  m_L = header.L;
+  m_scoring = (ScoringType)header.scoring;
+  m_weighting = (WeightingType)header.weighting;
+  createScoringObject();
+
+  m_map_address = address;
+  m_map_length = length;
+  m_map_filename = filename;
+  m_map_words = header.n_words;
+
+  m_flat_nodes = reinterpret_cast<const FlatNode*>(
+    static_cast<const unsigned char*>(address) + header.nodes_offset);
+  m_flat_descriptors =
+    static_cast<const unsigned char*>(address) + header.descriptors_offset;
+
+  return true;
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 void TemplatedVocabulary<TDescriptor,F>::save(const std::string &filename) const
 {
@@ -1660,6 +2306,7 @@ void TemplatedVocabulary<TDescriptor,F>::load(const cv::FileStorage &fs,
 {
   m_words.clear();
   m_nodes.clear();
+  clearFlat();
   
   cv::FileNode fvoc = fs[name];
   
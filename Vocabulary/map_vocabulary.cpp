@@ -0,0 +1,72 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* 词典格式转换：把文本(.txt)或二进制(.bin)词典转换为可以直接映射到内存的扁平格式(.mvoc)，
+* System加载.mvoc词典时不需要解析，多个进程共享同一份物理内存。
+*/
+
+
+#include<iostream>
+#include<chrono>
+#include<string>
+
+#include"ORBVocabulary.h"
+
+
+using namespace std;
+
+bool HasSuffix(const string &str, const string &suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        cerr << endl << "Usage: ./map_vocabulary input.(txt|bin) output.mvoc" << endl;
+        return 1;
+    }
+
+    const string strInput = argv[1];
+    const string strOutput = argv[2];
+
+    ORB_SLAM2::ORBVocabulary voc;
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    bool bVocLoad;
+    if (HasSuffix(strInput, ".bin"))
+        bVocLoad = voc.loadFromBinaryFile(strInput);
+    else
+        bVocLoad = voc.loadFromTextFile(strInput);
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    if (!bVocLoad || voc.empty())
+    {
+        cerr << "Failed to open vocabulary at: " << strInput << endl;
+        return 1;
+    }
+
+    if (!voc.saveToMappedFile(strOutput))
+    {
+        cerr << "Failed to write vocabulary to: " << strOutput << endl;
+        return 1;
+    }
+
+    // 映射回来检查，加载时间即System启动时加载词典的时间
+    ORB_SLAM2::ORBVocabulary mapped;
+    std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+    const bool bMapped = mapped.loadFromMappedFile(strOutput);
+    std::chrono::steady_clock::time_point t4 = std::chrono::steady_clock::now();
+    if (!bMapped || mapped.size() != voc.size())
+    {
+        cerr << "Failed to map the written vocabulary: " << strOutput << endl;
+        return 1;
+    }
+
+    cout << "words: " << voc.size() << endl;
+    cout << "load " << strInput << ": "
+         << std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t2 - t1).count() << " ms" << endl;
+    cout << "map " << strOutput << ": "
+         << std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t4 - t3).count() << " ms" << endl;
+
+    return 0;
+}
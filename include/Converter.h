@@ -49,6 +49,8 @@ namespace ORB_SLAM2
 
         static cv::Mat toCvMat(const Eigen::Matrix<double, 3, 1> &m);
 
+        static cv::Mat toCvMat(const Eigen::Matrix<float, 3, 1> &m);
+
         static cv::Mat toCvSE3(const Eigen::Matrix<double, 3, 3> &R, const Eigen::Matrix<double, 3, 1> &t);
 
 
@@ -59,6 +61,11 @@ namespace ORB_SLAM2
 
         static Eigen::Matrix<double, 3, 3> toMatrix3d(const cv::Mat &cvMat3);
 
+        // 单精度，用于地图点坐标等不需要转换为double的计算。
+        static Eigen::Matrix<float, 3, 1> toVector3f(const cv::Mat &cvVector);
+
+        static Eigen::Matrix<float, 3, 3> toMatrix3f(const cv::Mat &cvMat3);
+
         static std::vector<float> toQuaternion(const cv::Mat &M);
 
 
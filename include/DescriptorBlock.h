@@ -0,0 +1,65 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef DESCRIPTORBLOCK_H
+#define DESCRIPTORBLOCK_H
+
+#include <vector>
+#include <memory>
+
+#include <opencv2/core/core.hpp>
+
+
+namespace ORB_SLAM2
+{
+
+    // 连续存放的ORB描述子，每行32字节，首地址32字节对齐，可以直接用对齐的SIMD指令读取每一行。
+    // 构造后内容不再修改，拷贝只增加引用计数，多个Frame、KeyFrame可以共享同一块数据。
+    class DescriptorBlock
+    {
+    public:
+
+        // 每个描述子的字节数
+        static const int DESC_SIZE = 32;
+
+        DescriptorBlock();
+
+        // 拷贝CV_8U类型、每行32字节的描述子矩阵。
+        explicit DescriptorBlock(const cv::Mat &descriptors);
+
+        // 拷贝从pData开始连续存放的nRows个描述子。
+        DescriptorBlock(const uchar *pData, int nRows);
+
+        // 把分散的描述子拷贝到一块连续内存中。
+        explicit DescriptorBlock(const std::vector<const uchar *> &vpRows);
+
+        int Rows() const
+        {
+            return mnRows;
+        }
+
+        bool Empty() const
+        {
+            return mnRows == 0;
+        }
+
+        // 第i个描述子，32字节对齐。
+        const uchar *Row(int i) const
+        {
+            return mpData + i * DESC_SIZE;
+        }
+
+        // 不拷贝数据的cv::Mat视图(CV_8U，Rows()x32)，只在该DescriptorBlock或其拷贝存在期间有效。
+        cv::Mat Mat() const;
+
+    protected:
+
+        // 分配nRows行对齐的内存。
+        void Allocate(int nRows);
+
+        std::shared_ptr<uchar> mpBuffer;
+        uchar *mpData;
+        int mnRows;
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // DESCRIPTORBLOCK_H
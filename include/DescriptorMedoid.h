@@ -0,0 +1,85 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef DESCRIPTORMEDOID_H
+#define DESCRIPTORMEDOID_H
+
+#include <vector>
+#include <stdint.h>
+
+#include <opencv2/core/core.hpp>
+
+
+namespace ORB_SLAM2
+{
+
+    // 地图点各个观测的描述子及其两两之间的距离，用于增量地选择最具代表性的描述子。
+    // 每个描述子到所有描述子的距离按从小到大的顺序缓存，加入或删除一个观测只计算O(n)个描述子距离，
+    // 并在每行有序插入或删除一个距离；选择时直接读取每行的中值。
+    // 选择规则与原来的批量计算相同：与其他描述子距离中值最小，中值相同时取nKey(关键帧Id)最小的。
+    // 不加锁，由调用者(MapPoint)保护。
+    class DescriptorMedoid
+    {
+    public:
+
+        DescriptorMedoid();
+
+        int Size() const
+        {
+            return mnSize;
+        }
+
+        // 加入一个描述子，nKey为观测的关键帧Id，nIndex为特征点在关键帧中的序号。
+        void Add(const uchar *pDescriptor, const unsigned long nKey, const size_t nIndex);
+
+        // 删除第i个描述子，最后一个描述子移到位置i。
+        void Remove(const int i);
+
+        // 删除所有描述子并释放内存。
+        void Clear();
+
+        unsigned long Key(const int i) const
+        {
+            return mvKeys[i];
+        }
+
+        size_t Index(const int i) const
+        {
+            return mvIndices[i];
+        }
+
+        const uchar *Descriptor(const int i) const
+        {
+            return &mvDescriptors[i * DESC_SIZE];
+        }
+
+        // 最具代表性的描述子的位置，没有描述子时返回-1。
+        int Best();
+
+        // 占用的内存(字节)。
+        size_t Bytes() const;
+
+    protected:
+
+        static const int DESC_SIZE = 32;
+
+        // 扩大距离矩阵，保留已有的距离。
+        void Reserve(const int nCapacity);
+
+        uint16_t *Row(const int i)
+        {
+            return &mvDistances[(size_t) i * mnCapacity];
+        }
+
+        int mnSize;
+        int mnCapacity;
+
+        std::vector<uchar> mvDescriptors;
+        std::vector<unsigned long> mvKeys;
+        std::vector<size_t> mvIndices;
+
+        // mnCapacity行，第i行的前mnSize个元素是第i个描述子到所有描述子(包括自身)的距离，从小到大排列。
+        std::vector<uint16_t> mvDistances;
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // DESCRIPTORMEDOID_H
@@ -0,0 +1,102 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef EPOCHMANAGER_H
+#define EPOCHMANAGER_H
+
+#include <vector>
+#include <deque>
+#include <utility>
+#include <mutex>
+
+
+namespace ORB_SLAM2
+{
+
+    class MapPoint;
+
+    class KeyFrame;
+
+    // 坏关键帧和坏地图点的延迟释放(基于epoch的回收)。
+    // SetBadFlag之后对象从地图中删除，但其他线程可能还持有它的指针，不能立即释放，先退休(Retire)。
+    // 访问地图的线程注册后，在主循环中先去掉自己保存的坏对象，再调用Quiesce，表示此时不再持有任何坏对象的指针。
+    // 所有注册的线程都调用过Quiesce后全局epoch加一。在第e个epoch退休的对象，
+    // 全局epoch到e+4时每个线程都在退休之后去掉过自己保存的坏对象，并结束了当时的循环，可以释放。
+    // 默认关闭，关闭时不记录退休对象，坏对象和原来一样不释放。
+    class EpochManager
+    {
+    public:
+
+        // 线程在作用域内注册，析构时注销。
+        class Registration
+        {
+        public:
+            Registration(EpochManager *pManager);
+
+            ~Registration();
+
+            void Quiesce();
+
+        private:
+            EpochManager *mpManager;
+            int mnThreadId;
+        };
+
+        EpochManager();
+
+        // 在各线程启动前设置。
+        void SetEnabled(const bool bEnabled);
+
+        bool IsEnabled();
+
+        // 注册当前线程，返回线程编号。
+        int RegisterThread();
+
+        void UnregisterThread(const int nThreadId);
+
+        // 线程不再持有坏对象的指针。
+        void Quiesce(const int nThreadId);
+
+        // SetBadFlag之后调用，每个对象只退休一次。
+        void Retire(MapPoint *pMP);
+
+        void Retire(KeyFrame *pKF);
+
+        // 累计退休的对象数，没有变化时线程不需要检查自己保存的对象。
+        unsigned long RetiredCount();
+
+        // 按退休顺序取出已经可以释放的对象，由调用者释放。
+        void Collect(std::vector<MapPoint *> &vpMPs, std::vector<KeyFrame *> &vpKFs);
+
+        // 取出所有退休的对象，用于清空地图(各线程已经重置)。
+        void CollectAll(std::vector<MapPoint *> &vpMPs, std::vector<KeyFrame *> &vpKFs);
+
+        // 等待释放和已经取出释放的对象数。
+        void GetStats(size_t &nPendingMPs, size_t &nPendingKFs, unsigned long &nReclaimedMPs,
+                      unsigned long &nReclaimedKFs);
+
+    protected:
+
+        // 所有注册的线程都经过当前epoch后加一。
+        void TryAdvance();
+
+        bool mbEnabled;
+
+        unsigned long mnEpoch;
+
+        // 每个线程最后一次Quiesce时的epoch，mvbRegistered为false的位置可以重新分配。
+        std::vector<unsigned long> mvnThreadEpochs;
+        std::vector<bool> mvbRegistered;
+
+        // 退休的对象和退休时的epoch，按退休顺序。
+        std::deque<std::pair<MapPoint *, unsigned long> > mdRetiredMapPoints;
+        std::deque<std::pair<KeyFrame *, unsigned long> > mdRetiredKeyFrames;
+
+        unsigned long mnRetired;
+        unsigned long mnReclaimedMapPoints;
+        unsigned long mnReclaimedKeyFrames;
+
+        std::mutex mMutex;
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // EPOCHMANAGER_H
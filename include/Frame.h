@@ -3,20 +3,24 @@
 #define FRAME_H
 
 #include<vector>
+#include<memory>
 
 
 #include "MapPoint.h"
-#include "Thirdparty/DBoW2/DBoW2/BowVector.h"
-#include "Thirdparty/DBoW2/DBoW2/FeatureVector.h"
+#include "Thirdparty/DBoW2/DBoW2/FlatBowVector.h"
+#include "Thirdparty/DBoW2/DBoW2/FlatFeatureVector.h"
 #include "ORBVocabulary.h"
 #include "KeyFrame.h"
 #include "ORBextractor.h"
+#include "DescriptorBlock.h"
+#include "UndistortionMap.h"
 
 #include <IMU/imudata.h>
 #include <IMU/NavState.h>
 #include <IMU/IMUPreintegrator.h>
 
 #include <opencv2/opencv.hpp>
+#include <Eigen/Core>
 
 
 namespace ORB_SLAM2
@@ -30,6 +34,53 @@ namespace ORB_SLAM2
 
     class KeyFrame;
 
+    class ThreadPool;
+
+    // Frame的特征数据：特征点、描述子、词袋向量和网格等。
+    // 在Frame的构造函数中生成，之后只读，Frame拷贝时只增加引用计数。
+    // 唯一的例外是词袋向量，由跟踪线程在需要时通过Frame::ComputeBoW计算一次，它只取决于描述子。
+    struct FrameFeatures
+    {
+        // 特征点描述系向量(视图中的原始情况)和修正后的特征点描述向量(系统实际使用)。
+        // 在双目下，mvKeysUn是冗余的，因为一般得到的图像已经经过校正。
+        // 在RGBD下，RGB图像可能失真。
+        // mvKeys, mvKeysRight是左右两幅图像提取的特征点(未校正)。
+        // mvKeysUn 时经过校正后的特征点。
+        std::vector<cv::KeyPoint> mvKeys, mvKeysRight;
+        std::vector<cv::KeyPoint> mvKeysUn;
+
+
+        // 对于立体相机，mvuRight是特征点的右图坐标，mvDepth是特征点的深度。
+        // 对于单目相机，这两个容器的值是-1。
+        std::vector<float> mvuRight;
+        std::vector<float> mvDepth;
+
+
+        // 词袋向量的结构
+        DBoW2::FlatBowVector mBowVec;
+        DBoW2::FlatFeatureVector mFeatVec;
+
+
+        // ORB特征点的描述子，每一行表示表示一个特征点的描述子，存放在32字节对齐的连续内存中。
+        DescriptorBlock mDescriptorBlock, mDescriptorBlockRight;
+        // 上面描述子的cv::Mat视图，不拷贝数据。
+        cv::Mat mDescriptors, mDescriptorsRight;
+
+
+        // 每个各自分配的特征点数，把图像分成格子，保证均匀提取特征。
+        // FRAME_GRID_ROWS 48
+        // FRAME_GRID_COLS 64
+        // 所有格子的特征点编号连续存放(CSR)。
+        // 格子(ix,iy)的编号c = ix*FRAME_GRID_ROWS+iy，其特征点为mvGridIndices[mvGridOffsets[c], mvGridOffsets[c+1])，
+        // 同一列中相邻格子的特征点也是连续的。
+        std::vector<unsigned int> mvGridOffsets;
+        std::vector<unsigned int> mvGridIndices;
+
+
+        // 与上一帧之间的IMU测量
+        std::vector<IMUData> mvIMUDataSinceLastFrame;
+    };
+
     class Frame
     {
 
@@ -59,9 +110,6 @@ namespace ORB_SLAM2
 
         void SetNavStateBiasAcc(const Vector3d &ba);
 
-        // IMU预积分的结果
-        std::vector<IMUData> mvIMUDataSinceLastFrame;
-
         // 位姿先验信息，用于优化
         Matrix<double, 15, 15> mMargCovInv;
         NavState mNavStatePrior;
@@ -78,6 +126,14 @@ namespace ORB_SLAM2
         // 拷贝构造函数，第一个参数必须是自身类类型，实际是把参数对象的值赋给定义对象，使用=表达式完成。
         Frame(const Frame &frame);
 
+        // 拷贝和赋值都共享mpFeatures，只复制位姿、导航状态和地图点关联等跟踪状态；
+        // 移动时连跟踪状态也不复制。
+        Frame(Frame &&frame) = default;
+
+        Frame &operator=(const Frame &frame) = default;
+
+        Frame &operator=(Frame &&frame) = default;
+
 
         // 双目构造函数
         Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeStamp, ORBextractor *extractorLeft,
@@ -97,8 +153,8 @@ namespace ORB_SLAM2
         // 直接用ORBextractor中的函数调用符提取特征呢。
         void ExtractORB(int flag, const cv::Mat &im);
 
-        // 计算词袋表示，放在mBowVec中。
-        void ComputeBoW();
+        // 计算词袋表示，放在mBowVec中。pThreadPool非空时并行计算，结果相同。
+        void ComputeBoW(ThreadPool *pThreadPool = NULL);
 
         // 获取相机位姿，用Tcw更新mTcw。
         void SetPose(cv::Mat Tcw);
@@ -182,30 +238,10 @@ namespace ORB_SLAM2
         // 特征点的数量。
         int N;
 
-
-        // 特征点描述系向量(视图中的原始情况)和修正后的特征点描述向量(系统实际使用)。
-        // 在双目下，mvKeysUn是冗余的，因为一般得到的图像已经经过校正。
-        // 在RGBD下，RGB图像可能失真。
-        // mvKeys, mvKeysRight是左右两幅图像提取的特征点(未校正)。
-        // mvKeysUn 时经过校正后的特征点。
-        std::vector<cv::KeyPoint> mvKeys, mvKeysRight;
-        std::vector<cv::KeyPoint> mvKeysUn;
+        // 构造后不再改变的特征数据，Frame的拷贝共享同一份。
+        std::shared_ptr<FrameFeatures> mpFeatures;
 
 
-        // 对于立体相机，mvuRight是特征点的右图坐标，mvDepth是特征点的深度。
-        // 对于单目相机，这两个容器的值是-1。
-        std::vector<float> mvuRight;
-        std::vector<float> mvDepth;
-
-
-        // 词袋向量的结构
-        DBoW2::BowVector mBowVec;
-        DBoW2::FeatureVector mFeatVec;
-
-
-        // ORB特征点的描述子，每一行表示表示一个特征点的描述子。
-        cv::Mat mDescriptors, mDescriptorsRight;
-
         // 每个特征点对应的地图点云，NULL表示没有对应的点云。
         std::vector<MapPoint *> mvpMapPoints;
 
@@ -220,15 +256,14 @@ namespace ORB_SLAM2
         static float mfGridElementHeightInv;
 
 
-        // 每个各自分配的特征点数，把图像分成格子，保证均匀提取特征。
-        // FRAME_GRID_ROWS 48
-        // FRAME_GRID_COLS 64
-        std::vector<std::size_t> mGrid[FRAME_GRID_COLS][FRAME_GRID_ROWS];
-
-
         // 相机位姿 更新时的位姿变换矩阵是从世界坐标系到相机坐标系的变换矩阵。
         cv::Mat mTcw;
 
+        // mRcw, mtcw, mOw的单精度Eigen拷贝，由UpdatePoseMatrices()更新，用于投影地图点时不分配内存。
+        Eigen::Matrix3f mRcwEig;
+        Eigen::Vector3f mtcwEig;
+        Eigen::Vector3f mOwEig;
+
         // 当前帧和下一帧的Id。
         static long unsigned int nNextId;
         long unsigned int mnId;
@@ -255,6 +290,9 @@ namespace ORB_SLAM2
         // 初始化？
         static bool mbInitialComputations;
 
+        // 特征点去畸变查找表，由Tracking根据标定参数生成，为空时用cv::undistortPoints迭代求解。
+        static std::shared_ptr<const UndistortionMap> mpUndistortionMap;
+
 
     private:
 
@@ -0,0 +1,122 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+#include <opencv2/core/core.hpp>
+
+#include "Frame.h"
+#include "IMU/imudata.h"
+
+
+namespace ORB_SLAM2
+{
+
+    // 前端流水线：构造线程为后续图像构造Frame(灰度转换、ORB特征提取、去畸变、网格划分)，
+    // 同时跟踪线程处理当前帧。队列中最多有nDepth+1帧，跟踪结果与顺序执行完全一致。
+    class FramePipeline
+    {
+    public:
+
+        // 一帧图像及其构造结果。
+        struct Job
+        {
+            EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+            // 输入图像，构造后为灰度图
+            cv::Mat mIm;
+            std::vector<IMUData> mvIMU;
+            double mTimestamp;
+
+            Frame mFrame;
+            // 构造时是否使用了单目初始化提取器
+            bool mbIniExtractor;
+
+            std::chrono::steady_clock::time_point mtSubmit;
+            // 构造耗时(ms)
+            double mBuildTime;
+        };
+
+        // 延迟和吞吐量统计，时间单位为ms。
+        struct Stats
+        {
+            int nFrames;
+            // 因跟踪状态变化或重置而重新构造的帧数
+            int nRebuilt;
+            // 从提交图像到跟踪完成的延迟
+            double mLatencyMean;
+            double mLatencyMax;
+            double mBuildMean;
+            double mTrackMean;
+            // 从第一帧提交到最后一帧跟踪完成的平均帧率(Hz)
+            double mThroughput;
+        };
+
+        // build在构造线程中执行，根据Job::mbIniExtractor选择提取器构造Frame。
+        FramePipeline(const std::function<void(Job &)> &build, int nDepth);
+
+        ~FramePipeline();
+
+        // 提交一帧图像，图像会被拷贝，调用者可以复用缓冲区。
+        void Submit(const cv::Mat &im, const std::vector<IMUData> &vimu, const double &timestamp);
+
+        // 取出最早提交的一帧，必要时等待其构造完成，由调用者delete。
+        // 队列中不超过nDepth帧且bFlush为false时返回NULL，队列为空时也返回NULL。
+        Job *Pop(bool bFlush);
+
+        // 暂停构造线程，并把已构造但未取出的帧放回输入队列等待重新构造。
+        // 暂停期间跟踪线程可以修改Frame::nNextId、提取器和标定参数。
+        void Pause();
+
+        // 恢复构造，bIniExtractor为之后构造使用的提取器。
+        void Resume(bool bIniExtractor);
+
+        // 设置之后构造使用的提取器，已构造的帧在取出时由跟踪线程检查。
+        void SetIniExtractor(bool bIniExtractor);
+
+        // 记录一帧重新构造。
+        void CountRebuilt();
+
+        // 一帧跟踪完成，trackTime为跟踪耗时(ms)。
+        void FinishFrame(const Job &job, double trackTime);
+
+        Stats GetStats();
+
+    protected:
+
+        void Run();
+
+        std::function<void(Job &)> mBuild;
+        const int mnDepth;
+
+        std::thread mThread;
+
+        std::mutex mMutexQueue;
+        std::condition_variable mCondQueue;
+        // 等待构造的帧和已构造的帧，按提交顺序
+        std::deque<Job *> mqInputs;
+        std::deque<Job *> mqBuilt;
+        bool mbBuilding;
+        bool mbPaused;
+        bool mbIniExtractor;
+        bool mbFinishRequested;
+
+        std::mutex mMutexStats;
+        Stats mStats;
+        bool mbStarted;
+        std::chrono::steady_clock::time_point mtFirstSubmit;
+        double mLatencySum;
+        double mBuildSum;
+        double mTrackSum;
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // FRAMEPIPELINE_H
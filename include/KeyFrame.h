@@ -3,12 +3,15 @@
 #define KEYFRAME_H
 
 #include "MapPoint.h"
-#include "Thirdparty/DBoW2/DBoW2/BowVector.h"
-#include "Thirdparty/DBoW2/DBoW2/FeatureVector.h"
+#include "Thirdparty/DBoW2/DBoW2/FlatBowVector.h"
+#include "Thirdparty/DBoW2/DBoW2/FlatFeatureVector.h"
 #include "ORBVocabulary.h"
 #include "ORBextractor.h"
+#include "DescriptorBlock.h"
 #include "Frame.h"
 #include "KeyFrameDatabase.h"
+#include "KeyFrameStore.h"
+#include "SeqLock.h"
 
 #include "IMU/imudata.h"
 #include "IMU/NavState.h"
@@ -29,11 +32,27 @@ namespace ORB_SLAM2
 
     class KeyFrameDatabase;
 
+    class ThreadPool;
+
+    class MapSerializer;
+
+
+    // 关键帧的位姿(按行存放的4x4矩阵)和相机中心，由序列锁保护，读取时不加锁。
+    struct KeyFramePose
+    {
+        float mTcw[16];
+        float mTwc[16];
+        float mOw[3];
+        float mCw[4];           // 齐次坐标。
+    };
+
 
     // 关键帧，可以由Frame构造，许多数据会被3个线程同时访问，用锁的地方很普遍。
 
     class KeyFrame
     {
+        // 保存和加载地图时直接读写连接关系等内部数据。
+        friend class MapSerializer;
 
     public:
 
@@ -43,6 +62,9 @@ namespace ORB_SLAM2
         // VI 构造函数
         KeyFrame(Frame &F, Map *pMap, KeyFrameDatabase *pKFDB, std::vector<IMUData> vIMUData, KeyFrame *pLastKF = NULL);
 
+        // 释放特征数据和它在KeyFrameStore中的记录。
+        ~KeyFrame();
+
         KeyFrame *GetPrevKeyFrame(void);
 
         KeyFrame *GetNextKeyFrame(void);
@@ -102,9 +124,8 @@ namespace ORB_SLAM2
         std::mutex mMutexNavState;
         NavState mNavState;
 
-        // IMU预积分数据
+        // IMU预积分数据，IMU测量在mpFeatures中。
         std::mutex mMutexIMUData;
-        std::vector<IMUData> mvIMUData;
         IMUPreintegrator mIMUPreInt;
 
     public:
@@ -113,7 +134,7 @@ namespace ORB_SLAM2
         KeyFrame(Frame &F, Map *pMap, KeyFrameDatabase *pKFDB);
 
         // 位姿函数。
-        // 在这里的get set需要用到锁。
+        // 读取不加锁(序列锁)，设置时用mMutexPose串行化。
         void SetPose(const cv::Mat &Tcw);
 
         cv::Mat GetPose();
@@ -122,6 +143,8 @@ namespace ORB_SLAM2
 
         cv::Mat GetCameraCenter();
 
+        Eigen::Vector3f GetCameraCenterEigen();
+
         cv::Mat GetStereoCenter();
 
         cv::Mat GetRotation();
@@ -129,8 +152,8 @@ namespace ORB_SLAM2
         cv::Mat GetTranslation();
 
 
-        // 词袋表示。
-        void ComputeBoW();
+        // 词袋表示。pThreadPool非空时并行计算，结果相同。
+        void ComputeBoW(ThreadPool *pThreadPool = NULL);
 
         //  Covisibility图函数。
         void AddConnection(KeyFrame *pKF, const int &weight);
@@ -176,6 +199,8 @@ namespace ORB_SLAM2
 
         void EraseMapPointMatch(MapPoint *pMP);
 
+        void EraseBadMapPointMatches();
+
         void ReplaceMapPointMatch(const size_t &idx, MapPoint *pMP);
 
         std::set<MapPoint *> GetMapPoints();
@@ -187,7 +212,26 @@ namespace ORB_SLAM2
         MapPoint *GetMapPoint(const size_t &idx);
 
         // 特征点函数
-        std::vector<size_t> GetFeaturesInArea(const float &x, const float &y, const float &r) const;
+        std::vector<size_t> GetFeaturesInArea(const float &x, const float &y, const float &r);
+
+        // 使用已经取得的特征数据，避免每次调用都读取。
+        std::vector<size_t> GetFeaturesInArea(const KeyFrameFeatures &features, const float &x, const float &y,
+                                              const float &r) const;
+
+        // 特征数据(特征点、右目坐标和深度、描述子、BoW、栅格和IMU测量)，换出到磁盘时先读入。
+        // 返回值持有期间数据有效，之后换出或替换都不影响。读取失败时返回NULL，换出的记录不释放。
+        std::shared_ptr<const KeyFrameFeatures> GetFeatures();
+
+        // 第idx个特征点的描述子，换出时只从磁盘读取这一个，不读入整个关键帧。
+        bool GetDescriptor(const size_t idx, uchar *pDescriptor);
+
+        // 把特征数据写入KeyFrameStore并释放，同时释放观测到的地图点的描述子缓存，返回释放的字节数。
+        size_t SpillFeatures();
+
+        bool IsFeaturesResident();
+
+        // 最后一次读取特征数据时KeyFrameStore的使用计数(KeyFrameStore::NextUse)，用于选择换出的关键帧。
+        unsigned long GetLastFeatureUse();
 
         cv::Mat UnprojectStereo(int i);
 
@@ -251,14 +295,6 @@ namespace ORB_SLAM2
         long unsigned int mnBALocalForKF;
         long unsigned int mnBAFixedForKF;
 
-        // 用于关键帧数据库的变量。
-        long unsigned int mnLoopQuery;
-        int mnLoopWords;
-        float mLoopScore;
-        long unsigned int mnRelocQuery;
-        int mnRelocWords;
-        float mRelocScore;
-
         // 用于闭环检测的变量
         cv::Mat mTcwGBA;
         cv::Mat mTcwBefGBA;
@@ -270,17 +306,11 @@ namespace ORB_SLAM2
         // 特征点数量
         const int N;
 
-        // 特征点，立体坐标系和描述子。通过一个索引关联。
-        // 和Frame关联。
-        const std::vector<cv::KeyPoint> mvKeys;
-        const std::vector<cv::KeyPoint> mvKeysUn;
-        const std::vector<float> mvuRight;      // 如果是单目，为负数。
-        const std::vector<float> mvDepth;       // 如果是单目，为负数。
-        const cv::Mat mDescriptors;
+        // 每个特征点是否有右目坐标(mvuRight>=0)，每个特征点一位，常驻内存。
+        // 地图点加入和删除观测时按此统计观测数，不需要读取换出的特征数据。
+        const std::vector<bool> mvbStereo;
 
-        // BoW。
-        DBoW2::BowVector mBowVec;       // 图像的词袋表示。
-        DBoW2::FeatureVector mFeatVec;  // 局部特征向量节点的索引。
+        // 特征点、右目坐标、深度、描述子和BoW都在GetFeatures()中，通过特征点的索引关联。
 
         // 相对于父类的姿态（当坏点标志被激活后）。
         cv::Mat mTcp;
@@ -304,12 +334,8 @@ namespace ORB_SLAM2
 
     protected:
 
-        // SE3位姿和相机质心。
-        cv::Mat Tcw;
-        cv::Mat Twc;
-        cv::Mat Ow;
-
-        cv::Mat Cw;             // 双目基线的中点，仅用于可视化。
+        // SE3位姿和相机质心，Cw为双目基线的中点，仅用于可视化。
+        SeqLock<KeyFramePose> mPose;
 
         // 关联特征点的地图点云。
         std::vector<MapPoint *> mvpMapPoints;
@@ -318,8 +344,17 @@ namespace ORB_SLAM2
         KeyFrameDatabase *mpKeyFrameDB;
         ORBVocabulary *mpORBvocabulary;
 
-        // 覆盖在图像上的栅格。
-        std::vector<std::vector<std::vector<size_t> > > mGrid;
+        // 替换特征数据(写时拷贝)，原来的磁盘记录失效。
+        // 读取-拷贝-修改-替换需要持有mMutexFeaturesUpdate，否则同时进行的两个修改会丢失其中一个。
+        void SetFeatures(const std::shared_ptr<const KeyFrameFeatures> &pFeatures);
+        std::mutex mMutexFeaturesUpdate;
+
+        // 特征数据，换出到磁盘时为空。
+        std::shared_ptr<const KeyFrameFeatures> mpFeatures;
+        // 特征数据在KeyFrameStore中的记录，换出之后特征数据没有修改时再次换出不需要重写。
+        KeyFrameStore::Record mSpillRecord;
+        size_t mnFeatureBytes;
+        unsigned long mnLastFeatureUse;
 
         // Covisibility图。
         std::map<KeyFrame *, int> mConnectedKeyFrameWeights;        // 与该关键帧连接的关键和权重。
@@ -343,9 +378,11 @@ namespace ORB_SLAM2
 
         Map *mpMap;
 
+        // 串行化mPose的写者，读者不使用。
         std::mutex mMutexPose;
         std::mutex mMutexConnections;
         std::mutex mMutexFeatures;
+        std::mutex mMutexSpill;
 
 
     };
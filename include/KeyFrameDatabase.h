@@ -3,7 +3,6 @@
 #define KEYFRAMEDATABASE_H
 
 #include <vector>
-#include <list>
 #include <set>
 
 #include "KeyFrame.h"
@@ -19,8 +18,17 @@ namespace ORB_SLAM2
 
     class Frame;
 
+    class ThreadPool;
+
+    class MapSerializer;
+
+    // 查询只读倒排索引，候选计数和得分保存在查询自己的数组中，不写入关键帧，
+    // 因此闭环检测和重定位可以同时查询。
     class KeyFrameDatabase
     {
+        // 保存和加载地图时直接读写倒排索引，不重新计算。
+        friend class MapSerializer;
+
     public:
         // 构造函数。
         KeyFrameDatabase(const ORBVocabulary &voc);
@@ -33,6 +41,12 @@ namespace ORB_SLAM2
 
         void clear();
 
+        // 设置共享线程池，非空时并行计算候选关键帧的相似度，结果与串行相同。
+        void SetThreadPool(ThreadPool *pThreadPool)
+        {
+            mpThreadPool = pThreadPool;
+        }
+
         // 闭环检测。
         std::vector<KeyFrame *> DetectLoopCandidates(KeyFrame *pKF, float minScore);
 
@@ -41,13 +55,27 @@ namespace ORB_SLAM2
 
     protected:
 
+        // 找出与bowVec有公共word的关键帧(不含spExcluded)，只对共有word较多的计算相似度。
+        // vnCandidateIdx[id]为关键帧id在vpCandidates中的下标，-1表示不是候选；
+        // vnWords为共有word数，vScores为相似度(未计算的为0)，返回计算相似度的共有word数阈值。
+        int QueryCandidates(const DBoW2::FlatBowVector &bowVec, const std::set<KeyFrame *> &spExcluded,
+                            std::vector<int> &vnCandidateIdx, std::vector<KeyFrame *> &vpCandidates,
+                            std::vector<int> &vnWords, std::vector<float> &vScores);
+
         // 关联词典。
         // 预先训练好的词典。
         const ORBVocabulary *mpVoc;
 
         // 倒排文件。
-        // 倒排索引，mvInvertedFile[i]表示包含第i个word id的所有关键帧。
-        std::vector<list<KeyFrame *> > mvInvertedFile;
+        // 倒排索引，mvInvertedFile[i]表示包含第i个word id的所有关键帧，连续存放。
+        // 剔除的关键帧先置为NULL，超过一半时再压缩。
+        std::vector<std::vector<KeyFrame *> > mvInvertedFile;
+        std::vector<int> mvnErased;
+
+        // 已添加关键帧的最大id，查询时按id开辟计数数组。
+        long unsigned int mnMaxKFId;
+
+        ThreadPool *mpThreadPool;
 
         // mutex
         std::mutex mMutex;
@@ -0,0 +1,148 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef KEYFRAMESTORE_H
+#define KEYFRAMESTORE_H
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <fstream>
+#include <stdint.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "Thirdparty/DBoW2/DBoW2/FlatBowVector.h"
+#include "Thirdparty/DBoW2/DBoW2/FlatFeatureVector.h"
+#include "DescriptorBlock.h"
+#include "IMU/imudata.h"
+
+
+namespace ORB_SLAM2
+{
+
+    class KeyFrame;
+
+    // 关键帧中按特征点存放的数据，可以换出到磁盘。
+    // 读取时只增加引用计数，换出或替换后持有者仍然可以继续使用原来的数据。
+    // 修改时整体替换(写时拷贝)，不修改已经发布的对象。
+    struct KeyFrameFeatures
+    {
+        // 未校正和校正后的特征点。
+        std::vector<cv::KeyPoint> mvKeys;
+        std::vector<cv::KeyPoint> mvKeysUn;
+        // 右目坐标和深度，单目时为负数。
+        std::vector<float> mvuRight;
+        std::vector<float> mvDepth;
+        // 与构造关键帧的Frame共享，不拷贝。
+        DescriptorBlock mDescriptorBlock;
+        // 图像的词袋表示和局部特征向量节点的索引。
+        DBoW2::FlatBowVector mBowVec;
+        DBoW2::FlatFeatureVector mFeatVec;
+        // 覆盖在图像上的栅格，与Frame::mvGridOffsets/mvGridIndices相同的CSR存储。
+        std::vector<unsigned int> mvGridOffsets;
+        std::vector<unsigned int> mvGridIndices;
+        // 与上一个关键帧之间的IMU测量。
+        std::vector<IMUData> mvIMUData;
+
+        // 占用的内存(字节)。
+        size_t Bytes() const;
+    };
+
+
+    // 关键帧特征数据的磁盘存储，用于长时间运行时限制地图占用的内存。
+    // 常驻内存的特征数据超过预算时，换出最久没有用于匹配的、不在当前局部地图中的关键帧，
+    // 同时释放这些关键帧中地图点的描述子缓存；地图点本身各线程直接访问，仍然常驻内存。
+    // 换出的数据在重定位、闭环、局部建图或BA需要时再读入(KeyFrame::GetFeatures)，
+    // 读入后超过预算时由LocalMapping线程换出，没有新的关键帧时(只定位模式、全局BA)也一样。
+    // 预算只限制特征数据和描述子缓存。KeyFrame对象、地图点及其关联(N=1000时每个关键帧约12KB，每个地图点约0.8KB)
+    // 仍然常驻，进程内存随地图大小增长，只是增长得慢；长时间运行时还需要限制地图的大小(例如只定位模式)。
+    // 记录只在本次运行中有效，按本机内存格式存放；删除的记录空间按大小重新使用。
+    class KeyFrameStore
+    {
+    public:
+
+        // 文件中的一条记录，nSize为0表示没有记录。
+        struct Record
+        {
+            uint64_t nOffset;
+            uint64_t nSize;
+
+            Record() : nOffset(0), nSize(0)
+            {}
+        };
+
+        KeyFrameStore();
+
+        ~KeyFrameStore();
+
+        // 创建存储文件并设置预算(MB)，在各线程启动前调用。nBudgetMB为0时不换出。
+        bool Open(const std::string &filename, const size_t nBudgetMB);
+
+        bool IsEnabled();
+
+        // 写入一条记录。
+        bool Write(const KeyFrameFeatures &features, Record &record);
+
+        // 读入一条记录，失败时返回空指针。记录读入耗时。
+        std::shared_ptr<KeyFrameFeatures> Read(const Record &record);
+
+        // 只读取记录中第idx个描述子(32字节)，不读入整条记录。idx由调用者保证小于特征点数。
+        bool ReadDescriptor(const Record &record, const size_t idx, uchar *pDescriptor);
+
+        // 删除记录，空间可以重新使用。
+        void Release(Record &record);
+
+        // 常驻内存的特征数据变化(字节)，包括地图点缓存的各个观测的描述子(MapPoint::mDescriptorMedoid)。
+        void AddResident(const long nBytes);
+
+        // 新增或读入的数据使常驻数据超过预算后为真，调用Evict后清除。只加一次锁，可以在线程循环中检查。
+        bool EvictionRequested();
+
+        // 换出离当前局部地图较远、最久没有使用的关键帧，直到常驻数据低于预算的90%。
+        // pCurrentKF及其共视关键帧和前面的若干个关键帧不换出；pCurrentKF为NULL时以vpKFs中最新的关键帧为准。
+        // 只在一个线程中调用(LocalMapping)。
+        void Evict(KeyFrame *pCurrentKF, const std::vector<KeyFrame *> &vpKFs);
+
+        // 特征数据的使用计数，每次调用加1，各线程都可以调用。记录在关键帧中，用于选择最久没有使用的关键帧。
+        unsigned long NextUse()
+        {
+            return ++mnUseClock;
+        }
+
+        // 常驻数据、换出和读入的统计。
+        void GetStats(size_t &nResidentBytes, size_t &nFileBytes, unsigned long &nSpills, unsigned long &nPageIns,
+                      double &meanPageInMs, double &maxPageInMs);
+
+    protected:
+
+        // 常驻数据超过预算
+        bool OverBudget();
+
+        bool mbEnabled;
+        size_t mnBudgetBytes;
+
+        std::string mFilename;
+        std::fstream mFile;
+        uint64_t mnFileBytes;
+
+        // 删除的记录，按大小排序(大小->位置)。
+        std::multimap<uint64_t, uint64_t> mmFreeExtents;
+
+        std::atomic<unsigned long> mnUseClock;
+
+        long mnResidentBytes;
+        bool mbEvictionRequested;
+        unsigned long mnSpills;
+        unsigned long mnPageIns;
+        double mTotalPageInMs;
+        double mMaxPageInMs;
+
+        std::mutex mMutex;
+        std::mutex mMutexFile;
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // KEYFRAMESTORE_H
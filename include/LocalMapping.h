@@ -30,6 +30,9 @@ namespace ORB_SLAM2
 
         void DeleteBadInLocalWindow(void);
 
+        // 去掉保存的坏点云和坏关键帧，之后调用EpochManager的Quiesce。
+        void EraseBadObjects();
+
         // VINS线程
         void VINSInitThread(void);
 
@@ -47,6 +50,9 @@ namespace ORB_SLAM2
 
         cv::Mat GetRwiInit(void);
 
+        // 加载地图后恢复VI初始化结果，地图已经是绝对尺度。
+        void SetVINSInitState(const cv::Mat &gw, const cv::Mat &Rwi);
+
         bool GetMapUpdateFlagForTracking();
 
         void SetMapUpdateFlagInTracking(bool bflag);
@@ -223,6 +229,9 @@ namespace ORB_SLAM2
 
         std::list<MapPoint *> mlpRecentAddedMapPoints;
 
+        // 上次检查坏对象时的退休计数。
+        unsigned long mnLastRetiredCount;
+
         std::mutex mMutexNewKFs;
 
         // 不进行全局BA。
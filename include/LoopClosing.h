@@ -101,6 +101,12 @@ namespace ORB_SLAM2
 
         void ResetIfRequested();
 
+        // 去掉保存的坏关键帧，之后调用EpochManager的Quiesce。
+        void EraseBadObjects();
+
+        // 上次检查坏对象时的退休计数。
+        unsigned long mnLastRetiredCount;
+
         bool mbResetRequested;
         std::mutex mMutexReset;
 
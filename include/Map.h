@@ -4,6 +4,9 @@
 
 #include "MapPoint.h"
 #include "KeyFrame.h"
+#include "SlotMap.h"
+#include "EpochManager.h"
+#include "KeyFrameStore.h"
 #include <set>
 
 #include <mutex>
@@ -15,12 +18,6 @@ namespace ORB_SLAM2
 
     class KeyFrame;
 
-    class KFIdComapre
-    {
-    public:
-        bool operator()(const KeyFrame *kfleft, const KeyFrame *kfright) const;
-    };
-
     class Map
     {
 
@@ -48,12 +45,23 @@ namespace ORB_SLAM2
         // 设置参考MP，用于DrawMapPoints。
         void SetReferenceMapPoints(const std::vector<MapPoint *> &vpMPs);
 
-        // 获得所有关键帧。
+        // 获得所有关键帧，按id排序。
         std::vector<KeyFrame *> GetAllKeyFrames();
 
-        // 获得所有点云。
+        // 获得所有点云，按id排序。
         std::vector<MapPoint *> GetAllMapPoints();
 
+        // 所有关键帧和点云的只读快照，地图没有变化时不拷贝，遍历时不加锁。
+        // 只需要读取时代替GetAllKeyFrames/GetAllMapPoints。
+        SlotMap<KeyFrame>::Snapshot GetKeyFramesSnapshot();
+
+        SlotMap<MapPoint>::Snapshot GetMapPointsSnapshot();
+
+        // 按id查找地图中的关键帧和点云，不在地图中时返回NULL。
+        KeyFrame *GetKeyFrame(const long unsigned int id);
+
+        MapPoint *GetMapPoint(const long unsigned int id);
+
         // 获得参考点晕。
         std::vector<MapPoint *> GetReferenceMapPoints();
 
@@ -74,12 +82,16 @@ namespace ORB_SLAM2
         // 避免在不同线程中同时创建点云，造成Id冲突。
         std::mutex mMutexPointCreation;
 
-    protected:
+        // 坏关键帧和坏点云的延迟释放，Map.ReclaimMemory为0时不释放。
+        EpochManager mEpochManager;
 
-        std::set<MapPoint *> mspMapPoints;                  // 地图点云集。
-        // std::set<KeyFrame *> mspKeyFrames;                  // 关键帧集。
+        // 关键帧特征数据的磁盘存储，Map.MemoryBudget为0时不换出。
+        KeyFrameStore mKeyFrameStore;
+
+    protected:
 
-        std::set<KeyFrame *, KFIdComapre> mspKeyFrames;        // 关键帧集。
+        SlotMap<MapPoint> mMapPoints;                       // 地图点云集。
+        SlotMap<KeyFrame> mKeyFrames;                       // 关键帧集。
 
 
         std::vector<MapPoint *> mvpReferenceMapPoints;      // 参考点云集。
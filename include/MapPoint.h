@@ -6,8 +6,13 @@
 #include "KeyFrame.h"
 #include "Frame.h"
 #include "Map.h"
+#include "DescriptorBlock.h"
+#include "DescriptorMedoid.h"
+#include "SeqLock.h"
+#include "ObservationVector.h"
 
 #include <opencv2/core/core.hpp>
+#include <Eigen/Core>
 #include <mutex>
 
 namespace ORB_SLAM2
@@ -19,41 +24,74 @@ namespace ORB_SLAM2
 
     class Frame;
 
-    class cmpKeyFrameId
+    class MapSerializer;
+
+    // 观测按关键帧Id排序，少量观测存放在对象内部。
+    typedef ObservationVector mapMapPointObs;
+
+    // 地图点的坐标、平均观测方向和尺度不变距离，由序列锁保护，跟踪线程读取时不加锁。
+    struct MapPointGeometry
     {
-    public:
-        bool operator()(const KeyFrame *a, const KeyFrame *b) const;
+        float mWorldPos[3];
+        float mNormalVector[3];
+        float mfMinDistance;
+        float mfMaxDistance;
     };
 
-    typedef std::map<KeyFrame *, size_t, cmpKeyFrameId> mapMapPointObs;
-
 
     // 地图点云。
 
     class MapPoint
     {
+        // 保存和加载地图时直接读写观测等内部数据。
+        friend class MapSerializer;
+
     public:
         // 构造函数
         MapPoint(const cv::Mat &Pos, KeyFrame *pRefKF, Map *pMap);
 
         MapPoint(const cv::Mat &Pos, Map *pMap, Frame *pFrame, const int &idxF);
 
+        // 加载地图时使用，参考关键帧、观测和描述子等由MapSerializer恢复。
+        MapPoint(const cv::Mat &Pos, Map *pMap, const long int &nFirstKFid, const long int &nFirstFrame);
+
+        ~MapPoint();
+
         //
         void SetWorldPos(const cv::Mat &Pos);
 
+        void SetWorldPos(const Eigen::Vector3f &Pos);
+
         void UpdateScale(float scale);
 
+        // 返回坐标的拷贝(cv::Mat)，会分配内存，逐步改用GetWorldPosEigen()。
         cv::Mat GetWorldPos();
 
+        // 按值返回坐标，不分配内存。
+        Eigen::Vector3f GetWorldPosEigen();
+
         //
         cv::Mat GetNormal();
 
+        Eigen::Vector3f GetNormalEigen();
+
         KeyFrame *GetReferenceKeyFrame();
 
         //
         // std::map<KeyFrame *,size_t> GetObservations();
         mapMapPointObs GetObservations();
 
+        // 持有mMutexFeatures遍历观测，不拷贝。对每个观测调用f(KeyFrame*, size_t)。
+        // f中不能再加锁(包括该地图点和关键帧的函数)，只能读取关键帧中不变的成员。
+        template<class F>
+        void ForEachObservation(F f)
+        {
+            std::unique_lock<std::mutex> lock(mMutexFeatures);
+            for (mapMapPointObs::const_iterator mit = mObservations.begin(), mend = mObservations.end();
+                 mit != mend; mit++)
+                f(mit->first, mit->second);
+        }
+
         int Observations();
 
         // 添加/删除观测，记录KF中可以观测到该地图点云的特征点。
@@ -96,9 +134,15 @@ namespace ORB_SLAM2
         // 计算具有代表性的描述子。
         void ComputeDistinctiveDescriptors();
 
-        // 获取描述子。
+        // 释放各个观测的描述子缓存，返回释放的字节数。观测的关键帧换出时调用，之后用到时再从KeyFrameStore读取。
+        size_t ReleaseDescriptorCache();
+
+        // 获取描述子的拷贝。
         cv::Mat GetDescriptor();
 
+        // 获取描述子，不拷贝数据。描述子更新时整体替换，返回的DescriptorBlock内容不会改变。
+        DescriptorBlock GetDescriptorBlock();
+
         // 更新平均观测方向和观测距离。
         void UpdateNormalAndDepth();
 
@@ -161,17 +205,27 @@ namespace ORB_SLAM2
 
     protected:
 
-        cv::Mat mWorldPos;                              // MapPoint在世界坐标系下的绝对坐标。
+        // 构造时设置坐标、平均观测方向和尺度不变距离。
+        void SetGeometry(const Eigen::Vector3f &Pos, const Eigen::Vector3f &Normal, const float fMinDistance,
+                         const float fMaxDistance);
+
+        // MapPoint在世界坐标系下的绝对坐标、平均观测方向和尺度不变距离。
+        // 读取不加锁；写入时持有mMutexPos，保证同一时刻只有一个写者。
+        SeqLock<MapPointGeometry> mGeometry;
 
         // std::map<KeyFrame *, size_t> mObservations;       // 观测到该MapPoint的KF和该MapPoint在KF中的索引。
         mapMapPointObs mObservations;       // 观测到该MapPoint的KF和该MapPoint在KF中的索引。
-        cv::Mat mNormalVector;                          // MapPoint的平均观测方向。
 
         // 快速匹配最好的描述子。
         // 每个3D也有一个描述子。
         // 如果MapPoint与多帧图像特征点对应（由KF来构造时），那么距离其他描述子的平均距离最小的描述子是最佳描述子。
         // MapPoint只与一帧图像特征点对应（由Frame构造时），这个特征点的描述子就是该3D点的描述子。
-        cv::Mat mDescriptor;                           // 通过 ComputeDistinctiveDescriptors()获得最佳描述子。
+        DescriptorBlock mDescriptor;                   // 通过 ComputeDistinctiveDescriptors()获得最佳描述子。
+
+        // 各个观测的描述子和两两距离，ComputeDistinctiveDescriptors()只处理变化的观测。
+        DescriptorMedoid mDescriptorMedoid;
+        // mDescriptorMedoid计入KeyFrameStore常驻内存的字节数。
+        size_t mnMedoidBytes;
 
         KeyFrame *mpRefKF;                              // 参考关键帧。
 
@@ -183,14 +237,16 @@ namespace ORB_SLAM2
         bool mbBad;
         MapPoint *mpReplaced;
 
-        // 尺度不变性距离。
-        float mfMinDistance;
-        float mfMaxDistance;
-
         Map *mpMap;
 
+        // 串行化mGeometry的写者，读者不使用。
         std::mutex mMutexPos;
         std::mutex mMutexFeatures;
+        // 保护mDescriptorMedoid和mnMedoidBytes，在mMutexFeatures之前加锁。
+        std::mutex mMutexMedoid;
+
+        // mDescriptorMedoid变化后更新计入的内存，调用时持有mMutexMedoid。
+        void UpdateMedoidBytes();
 
 
     };
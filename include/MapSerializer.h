@@ -0,0 +1,49 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef MAPSERIALIZER_H
+#define MAPSERIALIZER_H
+
+#include <string>
+#include <opencv2/core/core.hpp>
+
+#include "ORBVocabulary.h"
+
+
+namespace ORB_SLAM2
+{
+
+    class Map;
+
+    class KeyFrameDatabase;
+
+    // 地图的二进制存储。
+    // 保存关键帧(位姿、导航状态、特征点、描述子、词袋向量、IMU数据和预积分)、地图点、共视图、生成树和闭环边，
+    // 以及关键帧库的倒排索引。加载时顺序读取，不重新计算词袋向量和倒排索引，加载后可以直接重定位。
+    // 文件头记录版本号，数据按本机字节序存放。
+    class MapSerializer
+    {
+    public:
+
+        // 文件格式版本，格式改变时增加。
+        static const unsigned int VERSION = 1;
+
+        // VI初始化的结果，与地图一起保存。
+        struct VINSState
+        {
+            bool bInited;
+            cv::Mat GravityVec;     // 世界坐标系下的重力
+            cv::Mat RwiInit;
+        };
+
+        // 保存地图和关键帧库，调用前需要停止各线程(System::Shutdown)。
+        static bool Save(const std::string &filename, Map *pMap, KeyFrameDatabase *pKFDB, const ORBVocabulary &voc,
+                         const VINSState &vins);
+
+        // 加载到空的地图和关键帧库中，失败时不修改它们。
+        // 同时恢复Frame的相机参数和KeyFrame、MapPoint、Frame的下一个Id。
+        static bool Load(const std::string &filename, Map *pMap, KeyFrameDatabase *pKFDB, ORBVocabulary *pVoc,
+                         VINSState &vins);
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // MAPSERIALIZER_H
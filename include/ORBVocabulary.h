@@ -6,13 +6,21 @@
 #include"Thirdparty/DBoW2/DBoW2/FORB.h"
 #include"Thirdparty/DBoW2/DBoW2/TemplatedVocabulary.h"
 
+#include"DescriptorBlock.h"
+
 namespace ORB_SLAM2
 {
     // 对DBoW2中的类重命名
     typedef DBoW2::TemplatedVocabulary<DBoW2::FORB::TDescriptor, DBoW2::FORB> ORBVocabulary;
 
+    class ThreadPool;
+
+    // 直接从连续存放的描述子计算词袋向量，不为每个描述子构造cv::Mat。
+    // pThreadPool非空时分块并行查找单词，再按特征点顺序合并，结果与ORBVocabulary::transform完全一致。
+    void ComputeBowVectors(const ORBVocabulary &voc, const DescriptorBlock &descriptors, const int levelsup,
+                           DBoW2::FlatBowVector &bowVec, DBoW2::FlatFeatureVector &featVec, ThreadPool *pThreadPool);
+
 }   //namespace ORB_SLAM2
 
 
 #endif  //ORBVOCABULARY_H
-
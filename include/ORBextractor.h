@@ -11,21 +11,29 @@
 namespace ORB_SLAM2
 {
 
-    class ExtractorNode
-    {
-    public:
-
-        // 定义构造函数，列表初始化成员变量。
-        ExtractorNode() : bNoMore(false)
-        {}
-
-        void DivideNode(ExtractorNode &n1, ExtractorNode &n2, ExtractorNode &n3, ExtractorNode &n4);
+    class ThreadPool;
 
-        std::vector<cv::KeyPoint> vKeys;
-        cv::Point2i UL, UR, BL, BR;
-        std::list<ExtractorNode>::iterator lit;
+    // DistributeOctTree的四叉树节点，存放在连续数组中，用下标代替指针。
+    // 节点不保存特征点副本，只记录自己在特征点下标数组中的区间，子节点划分父节点的区间。
+    struct ExtractorNode
+    {
+        // 节点区域[x0,x1)x[y0,y1)
+        int x0, x1, y0, y1;
+        // 节点内特征点下标在ExtractorNodeArena::vKeyIdx中的区间[begin,end)
+        int begin, end;
+        // 节点链表中的前后节点，-1表示没有
+        int prev, next;
         bool bNoMore;
+    };
 
+    // 四叉树使用的内存池，每层一个，跨帧复用。
+    struct ExtractorNodeArena
+    {
+        std::vector<ExtractorNode> vNodes;
+        std::vector<int> vKeyIdx;
+        std::vector<int> vKeyIdxTmp;
+        std::vector<std::pair<int, int> > vSizeAndNode;
+        std::vector<std::pair<int, int> > vPrevSizeAndNode;
     };
 
     class ORBextractor
@@ -38,6 +46,19 @@ namespace ORB_SLAM2
             FAST_SCORE = 1
         };
 
+        // 方向和描述子计算使用的SIMD内核，启动时根据CPU特性选择，各内核结果完全一致。
+        enum
+        {
+            KERNEL_SCALAR = 0,
+            KERNEL_SSE41 = 1,
+            KERNEL_AVX2 = 2
+        };
+
+        static int GetKernelLevel();
+
+        // 只能设置为不高于CPU支持的级别，用于对比测试。
+        static void SetKernelLevel(int level);
+
         ORBextractor(int nfeatures, float scaleFactor, int nlevels, int iniThFAST, int minThFAST);
 
         ~ORBextractor()
@@ -82,6 +103,12 @@ namespace ORB_SLAM2
             return mvInvLevelSigma2;
         }
 
+        // 设置共享线程池，非空时金字塔各层(以及每层内的FAST网格)并行提取，输出与单线程完全一致。
+        void SetThreadPool(ThreadPool *pThreadPool)
+        {
+            mpThreadPool = pThreadPool;
+        }
+
 
         std::vector<cv::Mat> mvImagePyramid;
 
@@ -92,9 +119,16 @@ namespace ORB_SLAM2
 
         void ComputeKeyPointsOctTree(std::vector<std::vector<cv::KeyPoint> > &allKeypoints);
 
-        std::vector<cv::KeyPoint> DistributeOctTree(const std::vector<cv::KeyPoint> &vToDistributeKeys, const int &minX,
-                                                    const int &maxX, const int &minY, const int &maxY,
-                                                    const int &nFeatures, const int &level);
+        // 提取单层图像的FAST角点并用八叉树均匀化，计算方向。
+        void ComputeKeyPointsLevel(const int level, std::vector<cv::KeyPoint> &keypoints);
+
+        // 计算单层特征点的描述子，并把坐标缩放到第0层。
+        void ComputeDescriptorsLevel(const int level, std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors);
+
+        // 用四叉树把特征点均匀化到nFeatures个左右的区域，每个区域保留响应值最大的一个，结果写入vResultKeys。
+        void DistributeOctTree(const std::vector<cv::KeyPoint> &vToDistributeKeys, const int &minX,
+                               const int &maxX, const int &minY, const int &maxY,
+                               const int &nFeatures, const int &level, std::vector<cv::KeyPoint> &vResultKeys);
 
 
         void ComputeKeyPointsOld(std::vector<std::vector<cv::KeyPoint> > &allKeypoints);
@@ -117,6 +151,24 @@ namespace ORB_SLAM2
         std::vector<float> mvLevelSigma2;
         std::vector<float> mvInvLevelSigma2;
 
+        // 共享线程池，为NULL时单线程提取。
+        ThreadPool *mpThreadPool;
+
+        // 跨帧复用的缓存，图像分辨率不变时稳态提取不再分配内存。
+        // 带边界的金字塔图像，mvImagePyramid是其中去掉边界的部分。
+        std::vector<cv::Mat> mvPyramidBuffer;
+        // 高斯模糊后用于计算描述子的各层图像，比图像多分配一行作为SIMD读取的余量。
+        std::vector<cv::Mat> mvBlurPyramid;
+        // 每层的特征点、待分配的FAST角点和各网格的FAST角点。
+        std::vector<std::vector<cv::KeyPoint> > mvvLevelKeys;
+        std::vector<std::vector<cv::KeyPoint> > mvvToDistributeKeys;
+        std::vector<std::vector<std::vector<cv::KeyPoint> > > mvvCellKeys;
+        // 每层描述子的起始行。
+        std::vector<int> mvnLevelOffset;
+        // 每层四叉树的内存池。
+        std::vector<ExtractorNodeArena> mvNodeArena;
+        // 每层的FAST角点强度图，0表示在较低的阈值下也不是角点。
+        std::vector<cv::Mat> mvFastStrength;
 
     };
 
@@ -9,11 +9,14 @@
 #include "MapPoint.h"
 #include "KeyFrame.h"
 #include "Frame.h"
+#include "DescriptorBlock.h"
 
 
 namespace ORB_SLAM2
 {
 
+    class ThreadPool;
+
     class ORBmatcher
     {
     public:
@@ -24,6 +27,20 @@ namespace ORB_SLAM2
         // 计算两个ORB描述子之间的汉明距
         static int DescriptorDistance(const cv::Mat &a, const cv::Mat &b);
 
+        static int DescriptorDistance(const uchar *a, const uchar *b);
+
+        // 一对多计算汉明距：描述子a与descriptors中pIndices指定的n行，结果写入pDist。
+        // 与ORBextractor使用同一SIMD内核级别(AVX2 vpshufb或硬件POPCNT)，结果与DescriptorDistance完全一致。
+        static void DescriptorDistances(const uchar *a, const DescriptorBlock &descriptors, const size_t *pIndices,
+                                        const int n, int *pDist);
+
+        // 在descriptors的vIndices行中按顺序搜索与a距离最小和次小的描述子。
+        // bestDist/bestIdx/bestDist2/bestIdx2由调用者初始化，更新规则与逐个比较的匹配循环相同：
+        // 距离小于最小值时原最小值变为次小值，否则小于次小值时更新次小值。
+        static void SearchBestDescriptor(const uchar *a, const DescriptorBlock &descriptors,
+                                         const std::vector<size_t> &vIndices, int &bestDist, int &bestIdx,
+                                         int &bestDist2, int &bestIdx2);
+
         /**
          *  @brief 通过投影局部地图点云到当前帧，跟踪局部地图的点云,匹配点添加到当前帧。用于跟踪局部地图
          *  把局部地图中点云投影到当前帧，则将当前帧中的地图点云.
@@ -33,9 +50,11 @@ namespace ORB_SLAM2
          *  @param      F                当前帧
          *  @param      vpMapPoints      局部地图点云
          *  @param      th               阈值
+         *  @param      pThreadPool      非空时并行搜索，结果与单线程完全一致
          *  @return                      成功匹配的点云数目
          **/
-        int SearchByProjection(Frame &F, const std::vector<MapPoint *> &vpMapPoints, const float th = 3);
+        int SearchByProjection(Frame &F, const std::vector<MapPoint *> &vpMapPoints, const float th = 3,
+                               ThreadPool *pThreadPool = NULL);
 
         /**
         *  @brief 通过投影上一帧地图点云到当前帧，跟踪上一帧的点云。用于跟踪前一帧
@@ -110,6 +129,14 @@ namespace ORB_SLAM2
 
         float RadiusByViewingCos(const float &viewCos);
 
+        // 局部地图点pMP在F中的投影搜索：返回false表示该点不参与匹配，否则返回描述子和未匹配的候选特征点。
+        bool ProjectionCandidates(Frame &F, MapPoint *pMP, const float th, DescriptorBlock &MPdescriptor,
+                                  std::vector<size_t> &vCandidates);
+
+        // SearchByProjection(Frame&, vpMapPoints)的并行版本。
+        int SearchByProjectionParallel(Frame &F, const std::vector<MapPoint *> &vpMapPoints, const float th,
+                                       ThreadPool *pThreadPool);
+
         void ComputeThreeMaxima(std::vector<int> *histo, const int L, int &ind1, int &ind2, int &ind3);
 
         float mfNNratio;
@@ -0,0 +1,122 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef OBSERVATIONVECTOR_H
+#define OBSERVATIONVECTOR_H
+
+#include <cstddef>
+#include <utility>
+
+
+namespace ORB_SLAM2
+{
+
+    class KeyFrame;
+
+    // 地图点的观测：(关键帧, 地图点在关键帧中的索引)，按关键帧Id从小到大排列，与原来的
+    // std::map<KeyFrame*, size_t, cmpKeyFrameId>遍历顺序相同。
+    // 一般的地图点只有几个观测，不超过INLINE_CAPACITY个时存放在对象内部，不分配内存，拷贝也只是复制一小块数组；
+    // 超过后改用堆上的数组。
+    // 保留std::map中用到的接口(begin/end/count/find/operator[]/erase)，迭代器为指针，元素有first/second。
+    // 不加锁，由调用者(MapPoint)保护。
+    class ObservationVector
+    {
+    public:
+
+        typedef std::pair<KeyFrame *, size_t> value_type;
+        typedef value_type *iterator;
+        typedef const value_type *const_iterator;
+
+        static const size_t INLINE_CAPACITY = 8;
+
+        ObservationVector() : mpData(mInline), mnSize(0), mnCapacity(INLINE_CAPACITY)
+        {}
+
+        ObservationVector(const ObservationVector &other);
+
+        ObservationVector &operator=(const ObservationVector &other);
+
+        ~ObservationVector()
+        {
+            if (mpData != mInline)
+                delete[] mpData;
+        }
+
+        size_t size() const
+        {
+            return mnSize;
+        }
+
+        bool empty() const
+        {
+            return mnSize == 0;
+        }
+
+        iterator begin()
+        {
+            return mpData;
+        }
+
+        iterator end()
+        {
+            return mpData + mnSize;
+        }
+
+        const_iterator begin() const
+        {
+            return mpData;
+        }
+
+        const_iterator end() const
+        {
+            return mpData + mnSize;
+        }
+
+        // 观测数很少，按指针顺序查找，不需要读取关键帧的Id。
+        iterator find(const KeyFrame *pKF)
+        {
+            iterator it = begin();
+            for (iterator itEnd = end(); it != itEnd; it++)
+                if (it->first == pKF)
+                    break;
+            return it;
+        }
+
+        const_iterator find(const KeyFrame *pKF) const
+        {
+            const_iterator it = begin();
+            for (const_iterator itEnd = end(); it != itEnd; it++)
+                if (it->first == pKF)
+                    break;
+            return it;
+        }
+
+        size_t count(const KeyFrame *pKF) const
+        {
+            return find(pKF) != end() ? 1 : 0;
+        }
+
+        // 加入观测，已经存在时不修改。返回是否加入。
+        bool insert(KeyFrame *pKF, const size_t idx);
+
+        // 与std::map相同：不存在时按关键帧Id插入索引为0的观测。
+        size_t &operator[](KeyFrame *pKF);
+
+        // 删除pKF的观测，返回删除的个数。
+        size_t erase(const KeyFrame *pKF);
+
+        // 删除所有观测并释放堆上的内存。
+        void clear();
+
+    protected:
+
+        // 按关键帧Id找到插入位置，需要时扩大容量。
+        iterator InsertPosition(KeyFrame *pKF);
+
+        value_type *mpData;
+        unsigned int mnSize;
+        unsigned int mnCapacity;
+        value_type mInline[INLINE_CAPACITY];
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // OBSERVATIONVECTOR_H
@@ -0,0 +1,88 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <stdint.h>
+
+
+namespace ORB_SLAM2
+{
+
+    // 序列锁：读者不加锁、不阻塞写者，读到写者写了一半的数据时重新读取。
+    // 用于跟踪线程频繁读取、局部建图BA成批写入的小块数据(地图点坐标、关键帧位姿)。
+    // T必须是只包含float/int等成员的POD，大小为4字节的整数倍。数据按32位原子字存放，读写不构成数据竞争。
+    // 写者之间不互斥，由调用者用原来的互斥量串行化。
+    template<class T>
+    class SeqLock
+    {
+    public:
+
+        SeqLock() : mnSequence(0)
+        {
+            for (int i = 0; i < WORDS; i++)
+                mWords[i].store(0, std::memory_order_relaxed);
+        }
+
+        // 读取一份完整的拷贝，不加锁。
+        T Read() const
+        {
+            uint32_t words[WORDS];
+            while (true)
+            {
+                const unsigned int nSequence = mnSequence.load(std::memory_order_acquire);
+                // 写者正在写入
+                if (nSequence & 1)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                for (int i = 0; i < WORDS; i++)
+                    words[i] = mWords[i].load(std::memory_order_relaxed);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (mnSequence.load(std::memory_order_relaxed) == nSequence)
+                    break;
+            }
+
+            T value;
+            std::memcpy(&value, words, sizeof(T));
+            return value;
+        }
+
+        // 写入，调用者保证同一时刻只有一个写者。
+        void Write(const T &value)
+        {
+            uint32_t words[WORDS];
+            std::memcpy(words, &value, sizeof(T));
+
+            const unsigned int nSequence = mnSequence.load(std::memory_order_relaxed);
+            mnSequence.store(nSequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for (int i = 0; i < WORDS; i++)
+                mWords[i].store(words[i], std::memory_order_relaxed);
+
+            mnSequence.store(nSequence + 2, std::memory_order_release);
+        }
+
+    protected:
+
+        enum
+        {
+            WORDS = sizeof(T) / sizeof(uint32_t)
+        };
+
+        static_assert(sizeof(T) % sizeof(uint32_t) == 0, "SeqLock data must be a multiple of 4 bytes");
+
+        // 奇数表示正在写入。
+        std::atomic<unsigned int> mnSequence;
+        std::atomic<uint32_t> mWords[WORDS];
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // SEQLOCK_H
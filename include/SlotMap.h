@@ -0,0 +1,318 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <utility>
+
+
+namespace ORB_SLAM2
+{
+
+    // 按mnId索引的对象集合，用于Map中的关键帧和地图点。
+    // mvpDense按插入顺序连续存放对象指针，只在末尾加入；mvSlots[id]是对象在mvpDense中的位置(-1表示不在集合中)，
+    // 插入、删除和按id查找都是O(1)。删除时只置为NULL，超过一半时再压缩(同时按id排序)。
+    // 不同线程创建的对象插入顺序可能与id不同，只记录下来，生成快照时再排序。
+    // 每次修改增加mnGeneration，GetSnapshot在没有修改时直接返回上一次的快照，不拷贝；
+    // 否则在上一次快照的基础上去掉之后删除的对象、加入之后新加入的对象，锁内只拷贝这两部分。
+    // 删除的对象可能已经被EpochManager回收释放，生成快照时只比较删除时记录的id，不访问对象。
+    // 本身不加锁，由Map的mMutexMap保护。
+    template<class T>
+    class SlotMap
+    {
+    public:
+
+        // 只读快照，持有者遍历时不需要加锁。
+        typedef std::shared_ptr<const std::vector<T *> > Snapshot;
+
+        SlotMap() : mnErased(0), mnGeneration(0), mnLayout(0), mbSorted(true), mnSnapshotGeneration(0),
+                    mnSnapshotLayout(0), mnSnapshotDense(0), mnSnapshotErased(0)
+        {}
+
+        // 插入对象，已存在时返回false。
+        bool Insert(T *p)
+        {
+            const size_t id = p->mnId;
+            if (id >= mvSlots.size())
+                mvSlots.resize(std::max(id + 1, 2 * mvSlots.size()), -1);
+            if (mvSlots[id] >= 0)
+                return false;
+
+            if (!mvnDenseIds.empty() && id < mvnDenseIds.back())
+                mbSorted = false;
+            mvSlots[id] = (int) mvpDense.size();
+            mvpDense.push_back(p);
+            mvnDenseIds.push_back(id);
+
+            mnGeneration++;
+            return true;
+        }
+
+        // 删除对象，不存在时返回false。
+        bool Erase(T *p)
+        {
+            const size_t id = p->mnId;
+            if (id >= mvSlots.size() || mvSlots[id] < 0 || mvpDense[mvSlots[id]] != p)
+                return false;
+
+            mvpDense[mvSlots[id]] = static_cast<T *>(NULL);
+            mvSlots[id] = -1;
+            mvErased.push_back(std::make_pair(id, p));
+            mnGeneration++;
+
+            if (2 * (++mnErased) > mvpDense.size())
+                Compact();
+            return true;
+        }
+
+        // 按id查找，不存在时返回NULL。
+        T *Get(const size_t id) const
+        {
+            if (id >= mvSlots.size() || mvSlots[id] < 0)
+                return static_cast<T *>(NULL);
+            return mvpDense[mvSlots[id]];
+        }
+
+        size_t Size() const
+        {
+            return mvpDense.size() - mnErased;
+        }
+
+        bool Empty() const
+        {
+            return Size() == 0;
+        }
+
+        // 修改计数，内容改变后一定不同。
+        unsigned long Generation() const
+        {
+            return mnGeneration;
+        }
+
+        // 按id顺序拷贝所有对象。
+        std::vector<T *> GetAll() const
+        {
+            std::vector<T *> vp;
+            vp.reserve(Size());
+            for (size_t i = 0; i < mvpDense.size(); i++)
+                if (mvpDense[i])
+                    vp.push_back(mvpDense[i]);
+            if (!mbSorted)
+                std::sort(vp.begin(), vp.end(), LessId);
+            return vp;
+        }
+
+        // 按id顺序的只读快照，调用时不能持有mutex(保护本集合的锁)。
+        // 锁内只拷贝上一次快照之后删除和加入的(id, 指针)(压缩后拷贝整个数组)，生成新的快照在锁外进行，
+        // 只按拷贝的id排序和查找，不访问对象(上一次快照中的对象可能已经删除并释放)。
+        Snapshot GetSnapshot(std::mutex &mutex)
+        {
+            Snapshot pPrevious;
+            std::shared_ptr<const std::vector<size_t> > pPreviousIds;
+            std::vector<std::pair<size_t, T *> > vAdded, vErased;
+            unsigned long nGeneration, nLayout;
+            size_t nDense, nErased;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (mpSnapshot && mnSnapshotGeneration == mnGeneration)
+                    return mpSnapshot;
+
+                size_t nFirst = 0;
+                if (mpSnapshot && mnSnapshotLayout == mnLayout)
+                {
+                    pPrevious = mpSnapshot;
+                    pPreviousIds = mpSnapshotIds;
+                    nFirst = mnSnapshotDense;
+                    vErased.assign(mvErased.begin() + mnSnapshotErased, mvErased.end());
+                }
+                vAdded.reserve(mvpDense.size() - nFirst);
+                for (size_t i = nFirst; i < mvpDense.size(); i++)
+                    if (mvpDense[i])
+                        vAdded.push_back(std::make_pair(mvnDenseIds[i], mvpDense[i]));
+                nGeneration = mnGeneration;
+                nLayout = mnLayout;
+                nDense = mvpDense.size();
+                nErased = mvErased.size();
+            }
+
+            std::shared_ptr<std::vector<T *> > pvp = std::make_shared<std::vector<T *> >();
+            std::shared_ptr<std::vector<size_t> > pvnIds = std::make_shared<std::vector<size_t> >();
+            const size_t nReserve = (pPrevious ? pPrevious->size() : 0) + vAdded.size();
+            pvp->reserve(nReserve);
+            pvnIds->reserve(nReserve);
+            if (pPrevious)
+            {
+                // 上一次快照按id排序，二分查找删除的对象(之后加入又删除的不在其中)
+                const std::vector<size_t> &vnPreviousIds = *pPreviousIds;
+                std::vector<size_t> vnRemoved;
+                vnRemoved.reserve(vErased.size());
+                for (size_t i = 0; i < vErased.size(); i++)
+                {
+                    const size_t k = std::lower_bound(vnPreviousIds.begin(), vnPreviousIds.end(), vErased[i].first) -
+                                     vnPreviousIds.begin();
+                    if (k < vnPreviousIds.size() && vnPreviousIds[k] == vErased[i].first &&
+                        (*pPrevious)[k] == vErased[i].second)
+                        vnRemoved.push_back(k);
+                }
+                std::sort(vnRemoved.begin(), vnRemoved.end());
+                vnRemoved.erase(std::unique(vnRemoved.begin(), vnRemoved.end()), vnRemoved.end());
+                vnRemoved.push_back(pPrevious->size());
+
+                size_t nBegin = 0;
+                for (size_t i = 0; i < vnRemoved.size(); i++)
+                {
+                    pvp->insert(pvp->end(), pPrevious->begin() + nBegin, pPrevious->begin() + vnRemoved[i]);
+                    pvnIds->insert(pvnIds->end(), vnPreviousIds.begin() + nBegin, vnPreviousIds.begin() + vnRemoved[i]);
+                    nBegin = vnRemoved[i] + 1;
+                }
+            }
+
+            // 新加入的部分按id排序，一般都在上一次快照之后，直接追加；否则与上一次的快照合并
+            if (!std::is_sorted(vAdded.begin(), vAdded.end()))
+                std::sort(vAdded.begin(), vAdded.end());
+            if (pvnIds->empty() || vAdded.empty() || pvnIds->back() < vAdded.front().first)
+            {
+                for (size_t i = 0; i < vAdded.size(); i++)
+                {
+                    pvnIds->push_back(vAdded[i].first);
+                    pvp->push_back(vAdded[i].second);
+                }
+            }
+            else
+            {
+                std::shared_ptr<std::vector<T *> > pvpMerged = std::make_shared<std::vector<T *> >();
+                std::shared_ptr<std::vector<size_t> > pvnMergedIds = std::make_shared<std::vector<size_t> >();
+                pvpMerged->reserve(pvp->size() + vAdded.size());
+                pvnMergedIds->reserve(pvp->size() + vAdded.size());
+                size_t i = 0, j = 0;
+                while (i < pvp->size() || j < vAdded.size())
+                {
+                    if (j == vAdded.size() || (i < pvp->size() && (*pvnIds)[i] < vAdded[j].first))
+                    {
+                        pvnMergedIds->push_back((*pvnIds)[i]);
+                        pvpMerged->push_back((*pvp)[i]);
+                        i++;
+                    }
+                    else
+                    {
+                        pvnMergedIds->push_back(vAdded[j].first);
+                        pvpMerged->push_back(vAdded[j].second);
+                        j++;
+                    }
+                }
+                pvp.swap(pvpMerged);
+                pvnIds.swap(pvnMergedIds);
+            }
+
+            Snapshot pSnapshot = pvp;
+            {
+                // 其它线程可能已经缓存了更新的快照
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!mpSnapshot || mnSnapshotGeneration < nGeneration)
+                {
+                    mpSnapshot = pSnapshot;
+                    mpSnapshotIds = pvnIds;
+                    mnSnapshotGeneration = nGeneration;
+                    mnSnapshotLayout = nLayout;
+                    mnSnapshotDense = nDense;
+                    mnSnapshotErased = nErased;
+                }
+            }
+            return pSnapshot;
+        }
+
+        // 遍历所有对象(按插入顺序)，调用期间不能修改集合。
+        template<class TFunc>
+        void ForEach(TFunc func) const
+        {
+            for (size_t i = 0; i < mvpDense.size(); i++)
+                if (mvpDense[i])
+                    func(mvpDense[i]);
+        }
+
+        // 清空集合，不释放对象。
+        void Clear()
+        {
+            mvpDense.clear();
+            mvnDenseIds.clear();
+            mvSlots.clear();
+            mvErased.clear();
+            mnErased = 0;
+            mnGeneration++;
+            mnLayout++;
+            mbSorted = true;
+            mpSnapshot.reset();
+            mpSnapshotIds.reset();
+        }
+
+    protected:
+
+        static bool LessId(const T *a, const T *b)
+        {
+            return a->mnId < b->mnId;
+        }
+
+        // 去掉删除的位置，需要时按id排序。
+        void Compact()
+        {
+            size_t j = 0;
+            for (size_t i = 0; i < mvpDense.size(); i++)
+            {
+                if (!mvpDense[i])
+                    continue;
+                mvpDense[j] = mvpDense[i];
+                mvnDenseIds[j] = mvnDenseIds[i];
+                j++;
+            }
+            mvpDense.resize(j);
+            mvnDenseIds.resize(j);
+            if (!mbSorted)
+            {
+                std::sort(mvpDense.begin(), mvpDense.end(), LessId);
+                for (size_t i = 0; i < mvpDense.size(); i++)
+                    mvnDenseIds[i] = mvpDense[i]->mnId;
+                mbSorted = true;
+            }
+            for (size_t i = 0; i < mvpDense.size(); i++)
+                mvSlots[mvnDenseIds[i]] = (int) i;
+            mvErased.clear();
+            mnErased = 0;
+            mnLayout++;
+        }
+
+        // 按插入顺序存放的对象，删除的为NULL。
+        std::vector<T *> mvpDense;
+        // mvpDense中每个位置的id。
+        std::vector<size_t> mvnDenseIds;
+        // id到mvpDense位置的索引。
+        std::vector<int> mvSlots;
+
+        size_t mnErased;
+
+        unsigned long mnGeneration;
+
+        // 压缩或清空时增加，之后mvpDense中已有的位置改变，快照需要重新拷贝整个数组。
+        unsigned long mnLayout;
+
+        // 上一次压缩之后删除的对象(删除时的id, 指针)，用于从上一次的快照中去掉。
+        std::vector<std::pair<size_t, T *> > mvErased;
+
+        // mvpDense是否按id递增。
+        bool mbSorted;
+
+        Snapshot mpSnapshot;
+        // mpSnapshot中每个对象的id，同样按id排序。
+        std::shared_ptr<const std::vector<size_t> > mpSnapshotIds;
+        unsigned long mnSnapshotGeneration;
+        unsigned long mnSnapshotLayout;
+        // 生成快照时mvpDense和mvErased的大小，之后加入和删除的从这里开始。
+        size_t mnSnapshotDense;
+        size_t mnSnapshotErased;
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // SLOTMAP_H
@@ -67,6 +67,8 @@ namespace ORB_SLAM2
         // 输入：RGB图像或灰度图像；时间戳。                       输出：返回相机位姿。
         cv::Mat TrackMonocular(const cv::Mat &im, const double &timestamp);
 
+        // 处理单目图像和两帧之间的IMU数据
+        // 开启Tracking.PipelineDepth时返回的是之前提交的帧的位姿，剩余的帧在Shutdown()中跟踪。
         cv::Mat TrackMonoVI(const cv::Mat &im, const std::vector<IMUData> &vimu, const double &timestamp);
 
         // 停止局部地图线程，只进行相机跟踪。
@@ -99,9 +101,12 @@ namespace ORB_SLAM2
         // 数据格式见 http://www.cvlibs.net/datasets/kitti/eval_odometry.php
         void SaveTrajectoryKITTI(const string &filename);
 
-        // 未来的工作
-        //SaveMap( const string &filename );
-        //LoadMap( const string &filename )
+        // 保存地图和关键帧库的倒排索引(二进制)。
+        // 首先需要调用ShutDown函数
+        bool SaveMap(const string &filename);
+
+        // 加载地图到空的系统中，成功后进入定位模式，通过重定位开始跟踪。
+        bool LoadMap(const string &filename);
 
 
     private:
@@ -153,6 +158,9 @@ namespace ORB_SLAM2
         bool mbActivateLocalizationMode;
         bool mbDeactivateLocalizationMode;
 
+        // Shutdown时保存地图的文件，为空时不保存。
+        string mstrMapSaveFile;
+
 
     };
 
@@ -0,0 +1,49 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+
+namespace ORB_SLAM2
+{
+
+    // 共享的工作线程池，供特征提取等前端模块并行使用。
+    // ParallelFor会阻塞到所有任务完成，调用线程本身也参与计算，因此可以嵌套调用而不会死锁。
+    class ThreadPool
+    {
+    public:
+
+        // nThreads为工作线程数(不含调用线程)。
+        explicit ThreadPool(int nThreads);
+
+        ~ThreadPool();
+
+        // 对[0,n)中的每个下标调用func，func之间不能有写冲突。
+        void ParallelFor(int n, const std::function<void(int)> &func);
+
+        int GetNumThreads() const
+        {
+            return (int) mvThreads.size();
+        }
+
+    protected:
+
+        void Run();
+
+        std::vector<std::thread> mvThreads;
+
+        std::deque<std::function<void()> > mqTasks;
+        std::mutex mMutexTasks;
+        std::condition_variable mCondTasks;
+        bool mbFinishRequested;
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // THREADPOOL_H
@@ -20,6 +20,7 @@
 
 #include "IMU/imudata.h"
 #include "IMU/configparam.h"
+#include "FramePipeline.h"
 
 
 #include <mutex>
@@ -39,6 +40,8 @@ namespace ORB_SLAM2
 
     class System;
 
+    class ThreadPool;
+
 
     class Tracking
     {
@@ -67,8 +70,12 @@ namespace ORB_SLAM2
 
         ConfigParam *mpParams;
 
+        // 开启流水线时返回的是较早提交的一帧的位姿，队列未满时返回空矩阵。
         cv::Mat GrabImageMonoVI(const cv::Mat &im, const std::vector<IMUData> &vimu, const double &timestamp);
 
+        // 跟踪流水线中剩余的帧并输出统计信息，未开启流水线时什么也不做。
+        void FlushMonoVI();
+
         // 保存上一帧关键帧到当前帧的IMU数据，用于创建关键帧后进行预积分
         // 在初始化和新关键帧创建时被清空
         std::vector<IMUData> mvIMUSinceLastKF;
@@ -99,6 +106,12 @@ namespace ORB_SLAM2
 
         void SetViewer(Viewer *pViewer);
 
+        // 共享线程池，局部建图线程计算关键帧词袋向量时也使用，可能为NULL。
+        ThreadPool *GetThreadPool()
+        {
+            return mpThreadPool;
+        }
+
         // 加载设置文件。
         void ChangeCalibration(const string &strSettingPath);
 
@@ -190,6 +203,20 @@ namespace ORB_SLAM2
 
         void CreateNewKeyFrame();
 
+        // 回收坏关键帧和坏点云，每一帧跟踪完成后调用。
+        void ReclaimBadObjects();
+
+        void EraseBadObjects();
+
+        void FreeBadKeyFrames();
+
+        // 在EpochManager中注册的线程编号。
+        int mnEpochThreadId;
+        // 上次检查坏对象时的退休计数。
+        unsigned long mnLastRetiredCount;
+        // 已经可以释放、等待修改轨迹的坏关键帧，按退休顺序。
+        std::vector<KeyFrame *> mvpBadKeyFramesToFree;
+
         // 在执行定位模式时，当与地图中的点云没有匹配时，这个标志为1。如果有暂时的匹配点跟踪可以继续。
         // 在这种情况下按照视觉里程计运行。系统会尝试进行重定位得到0偏移的局部地图
         bool mbVO;
@@ -207,6 +234,21 @@ namespace ORB_SLAM2
         ORBextractor *mpORBextractorLeft, *mpORBextractorRight;
         ORBextractor *mpIniORBextractor;
 
+        // 特征提取、局部地图匹配和词袋向量计算共享的线程池，ORBextractor.nThreads不大于1时为NULL。
+        ThreadPool *mpThreadPool;
+
+        // 单目VI前端流水线，Tracking.PipelineDepth为0时为NULL。
+        FramePipeline *mpFramePipeline;
+
+        // 在流水线构造线程中把图像转为灰度并构造Frame。
+        void BuildFrameMonoVI(FramePipeline::Job &job);
+
+        // 跟踪流水线取出的一帧，返回其位姿。
+        cv::Mat TrackPipelinedFrame(FramePipeline::Job *pJob);
+
+        // 用当前的mK和mDistCoef重新生成Frame::mpUndistortionMap，Camera.UndistortStep为0时不使用查找表。
+        void SetUndistortionMap(const cv::FileStorage &fSettings);
+
         // BoW
         ORBVocabulary *mpORBVocabulary;
         KeyFrameDatabase *mpKeyFrameDB;
@@ -0,0 +1,56 @@
+//定义预处理变量，#ifndef variance_name 表示变量未定义时为真，并执行之后的代码直到遇到 #endif。
+#ifndef UNDISTORTIONMAP_H
+#define UNDISTORTIONMAP_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+
+namespace ORB_SLAM2
+{
+
+    // 特征点去畸变查找表。
+    // 构造时用cv::undistortPoints求出图像上间距为step像素的格点的无畸变坐标，
+    // 之后每个特征点由所在格子四个顶点的双线性插值得到，不再迭代求解。
+    // 构造后只读，可以被多个线程同时使用。
+    class UndistortionMap
+    {
+    public:
+
+        // K和distCoef与Frame中的相同，表覆盖[0,width]x[0,height]。
+        UndistortionMap(const cv::Mat &K, const cv::Mat &distCoef, const int width, const int height,
+                        const float step);
+
+        // 校正vKeys中的特征点，结果写入vKeysUn，表外的点仍用cv::undistortPoints。
+        void Undistort(const std::vector<cv::KeyPoint> &vKeys, std::vector<cv::KeyPoint> &vKeysUn) const;
+
+        // 在格子中心(插值误差最大处)与cv::undistortPoints比较，返回最大误差(像素)。
+        float MaxError() const;
+
+        float GetStep() const
+        {
+            return mfStep;
+        }
+
+    protected:
+
+        // 双线性插值，点在表外时返回false。
+        bool Lookup(const float x, const float y, cv::Point2f &pt) const;
+
+        cv::Mat mK;
+        cv::Mat mDistCoef;
+
+        float mfStep;
+        float mfInvStep;
+
+        // 格点数，格点(ix,iy)的坐标为(ix*step,iy*step)，无畸变坐标存放在mvTable[iy*mnCols+ix]。
+        int mnCols;
+        int mnRows;
+        std::vector<cv::Point2f> mvTable;
+    };
+
+} //namespace ORB_SLAM2
+
+#endif // UNDISTORTIONMAP_H
@@ -129,6 +129,16 @@ namespace ORB_SLAM2
     }
 
 
+    cv::Mat Converter::toCvMat(const Eigen::Matrix<float, 3, 1> &m)
+    {
+        cv::Mat cvMat(3, 1, CV_32F);
+        for (int i = 0; i < 3; i++)
+            cvMat.at<float>(i) = m(i);
+
+        return cvMat;
+    }
+
+
     cv::Mat Converter::toCvSE3(const Eigen::Matrix<double, 3, 3> &R, const Eigen::Matrix<double, 3, 1> &t)
     {
         cv::Mat cvMat = cv::Mat::eye(4, 4, CV_32F);
@@ -182,6 +192,27 @@ namespace ORB_SLAM2
     }
 
 
+    Eigen::Matrix<float, 3, 1> Converter::toVector3f(const cv::Mat &cvVector)
+    {
+        Eigen::Matrix<float, 3, 1> v;
+        v << cvVector.at<float>(0), cvVector.at<float>(1), cvVector.at<float>(2);
+
+        return v;
+    }
+
+
+    Eigen::Matrix<float, 3, 3> Converter::toMatrix3f(const cv::Mat &cvMat3)
+    {
+        Eigen::Matrix<float, 3, 3> M;
+
+        M << cvMat3.at<float>(0, 0), cvMat3.at<float>(0, 1), cvMat3.at<float>(0, 2),
+                cvMat3.at<float>(1, 0), cvMat3.at<float>(1, 1), cvMat3.at<float>(1, 2),
+                cvMat3.at<float>(2, 0), cvMat3.at<float>(2, 1), cvMat3.at<float>(2, 2);
+
+        return M;
+    }
+
+
     std::vector<float> Converter::toQuaternion(const cv::Mat &M)
     {
         Eigen::Matrix<double, 3, 3> eigMat = toMatrix3d(M);
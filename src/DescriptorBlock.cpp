@@ -0,0 +1,67 @@
+#include "DescriptorBlock.h"
+
+#include <cstring>
+#include <stdint.h>
+
+namespace ORB_SLAM2
+{
+
+    const int DescriptorBlock::DESC_SIZE;
+
+    DescriptorBlock::DescriptorBlock() : mpData(static_cast<uchar *>(NULL)), mnRows(0)
+    {}
+
+    DescriptorBlock::DescriptorBlock(const cv::Mat &descriptors) : mpData(static_cast<uchar *>(NULL)), mnRows(0)
+    {
+        if (descriptors.empty())
+            return;
+
+        CV_Assert(descriptors.type() == CV_8U && descriptors.cols == DESC_SIZE);
+
+        Allocate(descriptors.rows);
+        if (descriptors.isContinuous())
+            memcpy(mpData, descriptors.data, (size_t) mnRows * DESC_SIZE);
+        else
+            for (int i = 0; i < mnRows; i++)
+                memcpy(mpData + i * DESC_SIZE, descriptors.ptr<uchar>(i), DESC_SIZE);
+    }
+
+    DescriptorBlock::DescriptorBlock(const uchar *pData, int nRows) : mpData(static_cast<uchar *>(NULL)), mnRows(0)
+    {
+        if (nRows <= 0)
+            return;
+
+        Allocate(nRows);
+        memcpy(mpData, pData, (size_t) mnRows * DESC_SIZE);
+    }
+
+    DescriptorBlock::DescriptorBlock(const std::vector<const uchar *> &vpRows) :
+            mpData(static_cast<uchar *>(NULL)), mnRows(0)
+    {
+        if (vpRows.empty())
+            return;
+
+        Allocate((int) vpRows.size());
+        for (int i = 0; i < mnRows; i++)
+            memcpy(mpData + i * DESC_SIZE, vpRows[i], DESC_SIZE);
+    }
+
+    cv::Mat DescriptorBlock::Mat() const
+    {
+        if (mnRows == 0)
+            return cv::Mat();
+        return cv::Mat(mnRows, DESC_SIZE, CV_8U, mpData);
+    }
+
+    void DescriptorBlock::Allocate(int nRows)
+    {
+        // 多分配DESC_SIZE-1字节，用于把首地址对齐到32字节
+        uchar *pBuffer = new uchar[(size_t) nRows * DESC_SIZE + DESC_SIZE - 1];
+        mpBuffer.reset(pBuffer, std::default_delete<uchar[]>());
+
+        const uintptr_t address = reinterpret_cast<uintptr_t>(pBuffer);
+        mpData = pBuffer + ((DESC_SIZE - address % DESC_SIZE) % DESC_SIZE);
+        mnRows = nRows;
+    }
+
+} //namespace ORB_SLAM2
@@ -0,0 +1,124 @@
+#include "DescriptorMedoid.h"
+#include "ORBmatcher.h"
+
+#include <algorithm>
+#include <climits>
+
+
+namespace ORB_SLAM2
+{
+
+    DescriptorMedoid::DescriptorMedoid() : mnSize(0), mnCapacity(0)
+    {
+
+    }
+
+    void DescriptorMedoid::Reserve(const int nCapacity)
+    {
+        std::vector<uint16_t> vDistances((size_t) nCapacity * nCapacity, 0);
+        for (int i = 0; i < mnSize; i++)
+            std::copy(mvDistances.begin() + (size_t) i * mnCapacity,
+                      mvDistances.begin() + (size_t) i * mnCapacity + mnSize,
+                      vDistances.begin() + (size_t) i * nCapacity);
+        mvDistances.swap(vDistances);
+        mnCapacity = nCapacity;
+    }
+
+    // 计算新描述子与已有描述子的O(n)个距离，插入到各行中。
+    void DescriptorMedoid::Add(const uchar *pDescriptor, const unsigned long nKey, const size_t nIndex)
+    {
+        if (mnSize == mnCapacity)
+            Reserve(mnCapacity == 0 ? 4 : 2 * mnCapacity);
+
+        const int n = mnSize;
+        mvDescriptors.insert(mvDescriptors.end(), pDescriptor, pDescriptor + DESC_SIZE);
+        mvKeys.push_back(nKey);
+        mvIndices.push_back(nIndex);
+
+        uint16_t *pNewRow = Row(n);
+        for (int i = 0; i < n; i++)
+        {
+            const uint16_t dist = (uint16_t) ORBmatcher::DescriptorDistance(Descriptor(i), Descriptor(n));
+            uint16_t *pRow = Row(i);
+            uint16_t *pPos = std::upper_bound(pRow, pRow + n, dist);
+            std::copy_backward(pPos, pRow + n, pRow + n + 1);
+            *pPos = dist;
+            pNewRow[i] = dist;
+        }
+        pNewRow[n] = 0;
+        std::sort(pNewRow, pNewRow + n + 1);
+
+        mnSize++;
+    }
+
+    // 从各行中删除到第i个描述子的距离(重新计算O(n)个距离)，再把最后一个描述子移到位置i。
+    void DescriptorMedoid::Remove(const int i)
+    {
+        const int n = mnSize;
+        const int last = n - 1;
+        for (int j = 0; j < n; j++)
+        {
+            if (j == i)
+                continue;
+            const uint16_t dist = (uint16_t) ORBmatcher::DescriptorDistance(Descriptor(i), Descriptor(j));
+            uint16_t *pRow = Row(j);
+            uint16_t *pPos = std::lower_bound(pRow, pRow + n, dist);
+            std::copy(pPos + 1, pRow + n, pPos);
+        }
+
+        if (i != last)
+        {
+            std::copy(mvDescriptors.begin() + (size_t) last * DESC_SIZE, mvDescriptors.end(),
+                      mvDescriptors.begin() + (size_t) i * DESC_SIZE);
+            mvKeys[i] = mvKeys[last];
+            mvIndices[i] = mvIndices[last];
+            std::copy(Row(last), Row(last) + last, Row(i));
+        }
+
+        mvDescriptors.resize((size_t) last * DESC_SIZE);
+        mvKeys.pop_back();
+        mvIndices.pop_back();
+        mnSize--;
+    }
+
+    void DescriptorMedoid::Clear()
+    {
+        std::vector<uchar>().swap(mvDescriptors);
+        std::vector<unsigned long>().swap(mvKeys);
+        std::vector<size_t>().swap(mvIndices);
+        std::vector<uint16_t>().swap(mvDistances);
+        mnSize = 0;
+        mnCapacity = 0;
+    }
+
+    size_t DescriptorMedoid::Bytes() const
+    {
+        return mvDescriptors.capacity() + mvKeys.capacity() * sizeof(unsigned long) +
+               mvIndices.capacity() * sizeof(size_t) + mvDistances.capacity() * sizeof(uint16_t);
+    }
+
+    // 每行(包括自身的距离0)的中值与原来的Distances[i][0.5*(N-1)]相同，各行有序，直接读取，O(n)。
+    int DescriptorMedoid::Best()
+    {
+        const int n = mnSize;
+        if (n == 0)
+            return -1;
+
+        const int nMedian = (n - 1) / 2;
+
+        int bestMedian = INT_MAX;
+        int bestIdx = -1;
+        for (int i = 0; i < n; i++)
+        {
+            const int median = Row(i)[nMedian];
+            if (median < bestMedian || (median == bestMedian && mvKeys[i] < mvKeys[bestIdx]))
+            {
+                bestMedian = median;
+                bestIdx = i;
+            }
+        }
+
+        return bestIdx;
+    }
+
+} //namespace ORB_SLAM2
@@ -0,0 +1,157 @@
+#include "EpochManager.h"
+
+
+namespace ORB_SLAM2
+{
+
+    // 对象在退休后需要经过的epoch数。
+    static const unsigned long RECLAIM_EPOCHS = 4;
+
+
+    EpochManager::Registration::Registration(EpochManager *pManager) : mpManager(pManager)
+    {
+        mnThreadId = mpManager->RegisterThread();
+    }
+
+    EpochManager::Registration::~Registration()
+    {
+        mpManager->UnregisterThread(mnThreadId);
+    }
+
+    void EpochManager::Registration::Quiesce()
+    {
+        mpManager->Quiesce(mnThreadId);
+    }
+
+
+    EpochManager::EpochManager() : mbEnabled(false), mnEpoch(0), mnRetired(0), mnReclaimedMapPoints(0),
+                                   mnReclaimedKeyFrames(0)
+    {
+
+    }
+
+    void EpochManager::SetEnabled(const bool bEnabled)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mbEnabled = bEnabled;
+    }
+
+    bool EpochManager::IsEnabled()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mbEnabled;
+    }
+
+    // 注册线程，从当前epoch开始。
+    int EpochManager::RegisterThread()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        for (size_t i = 0; i < mvbRegistered.size(); i++)
+        {
+            if (!mvbRegistered[i])
+            {
+                mvbRegistered[i] = true;
+                mvnThreadEpochs[i] = mnEpoch;
+                return (int) i;
+            }
+        }
+        mvbRegistered.push_back(true);
+        mvnThreadEpochs.push_back(mnEpoch);
+        return (int) mvbRegistered.size() - 1;
+    }
+
+    // 注销线程，不再等待它。
+    void EpochManager::UnregisterThread(const int nThreadId)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mvbRegistered[nThreadId] = false;
+        TryAdvance();
+    }
+
+    // 线程经过当前epoch。
+    void EpochManager::Quiesce(const int nThreadId)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!mbEnabled)
+            return;
+        mvnThreadEpochs[nThreadId] = mnEpoch;
+        TryAdvance();
+    }
+
+    void EpochManager::TryAdvance()
+    {
+        for (size_t i = 0; i < mvbRegistered.size(); i++)
+            if (mvbRegistered[i] && mvnThreadEpochs[i] != mnEpoch)
+                return;
+        mnEpoch++;
+    }
+
+    // 地图点退休。
+    void EpochManager::Retire(MapPoint *pMP)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!mbEnabled)
+            return;
+        mdRetiredMapPoints.push_back(std::make_pair(pMP, mnEpoch));
+        mnRetired++;
+    }
+
+    // 关键帧退休。
+    void EpochManager::Retire(KeyFrame *pKF)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!mbEnabled)
+            return;
+        mdRetiredKeyFrames.push_back(std::make_pair(pKF, mnEpoch));
+        mnRetired++;
+    }
+
+    unsigned long EpochManager::RetiredCount()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mnRetired;
+    }
+
+    // 取出经过了RECLAIM_EPOCHS个epoch的对象。
+    void EpochManager::Collect(std::vector<MapPoint *> &vpMPs, std::vector<KeyFrame *> &vpKFs)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mdRetiredMapPoints.empty() && mdRetiredMapPoints.front().second + RECLAIM_EPOCHS <= mnEpoch)
+        {
+            vpMPs.push_back(mdRetiredMapPoints.front().first);
+            mdRetiredMapPoints.pop_front();
+            mnReclaimedMapPoints++;
+        }
+        while (!mdRetiredKeyFrames.empty() && mdRetiredKeyFrames.front().second + RECLAIM_EPOCHS <= mnEpoch)
+        {
+            vpKFs.push_back(mdRetiredKeyFrames.front().first);
+            mdRetiredKeyFrames.pop_front();
+            mnReclaimedKeyFrames++;
+        }
+    }
+
+    // 取出所有退休的对象。
+    void EpochManager::CollectAll(std::vector<MapPoint *> &vpMPs, std::vector<KeyFrame *> &vpKFs)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        for (size_t i = 0; i < mdRetiredMapPoints.size(); i++)
+            vpMPs.push_back(mdRetiredMapPoints[i].first);
+        for (size_t i = 0; i < mdRetiredKeyFrames.size(); i++)
+            vpKFs.push_back(mdRetiredKeyFrames[i].first);
+        mnReclaimedMapPoints += mdRetiredMapPoints.size();
+        mnReclaimedKeyFrames += mdRetiredKeyFrames.size();
+        mdRetiredMapPoints.clear();
+        mdRetiredKeyFrames.clear();
+    }
+
+    void EpochManager::GetStats(size_t &nPendingMPs, size_t &nPendingKFs, unsigned long &nReclaimedMPs,
+                                unsigned long &nReclaimedKFs)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        nPendingMPs = mdRetiredMapPoints.size();
+        nPendingKFs = mdRetiredKeyFrames.size();
+        nReclaimedMPs = mnReclaimedMapPoints;
+        nReclaimedKFs = mnReclaimedKeyFrames;
+    }
+
+} //namespace ORB_SLAM2
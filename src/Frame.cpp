@@ -13,6 +13,7 @@ namespace ORB_SLAM2
     // 定义并初始化静态成员，声明静态成员在.h中。
     long unsigned int Frame::nNextId = 0;
     bool Frame::mbInitialComputations = true;
+    std::shared_ptr<const UndistortionMap> Frame::mpUndistortionMap;
     float Frame::cx, Frame::cy, Frame::fx, Frame::fy, Frame::invfx, Frame::invfy;
     float Frame::mnMinX, Frame::mnMinY, Frame::mnMaxX, Frame::mnMaxY;
     float Frame::mfGridElementWidthInv, Frame::mfGridElementHeightInv;
@@ -26,7 +27,7 @@ namespace ORB_SLAM2
         // 重置预积分数据
         IMUPreInt.reset();
 
-        const std::vector<IMUData> &vIMUSInceLastFrame = mvIMUDataSinceLastFrame;
+        const std::vector<IMUData> &vIMUSInceLastFrame = mpFeatures->mvIMUDataSinceLastFrame;
 
         Vector3d bg = pLastF->GetNavState().Get_BiasGyr();
         Vector3d ba = pLastF->GetNavState().Get_BiasAcc();
@@ -140,11 +141,12 @@ namespace ORB_SLAM2
                  ORBextractor *extractor, ORBVocabulary *voc,
                  cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth, KeyFrame *pLastKF) :
             mpORBvocabulary(voc), mpORBextractorLeft(extractor), mpORBextractorRight(static_cast<ORBextractor *>(NULL)),
-            mTimeStamp(timeStamp), mK(K.clone()), mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth)
+            mTimeStamp(timeStamp), mK(K.clone()), mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth),
+            mpFeatures(std::make_shared<FrameFeatures>())
     {
 
         // 保存imu数据
-        mvIMUDataSinceLastFrame = vimu;
+        mpFeatures->mvIMUDataSinceLastFrame = vimu;
 
         mnId = nNextId++;
 
@@ -159,16 +161,16 @@ namespace ORB_SLAM2
 
         ExtractORB(0, imGray);
 
-        N = mvKeys.size();
+        N = mpFeatures->mvKeys.size();
 
-        if (mvKeys.empty())
+        if (mpFeatures->mvKeys.empty())
             return;
 
         UndistortKeyPoints();
 
         // 设定标志位，表示无立体匹配信息
-        mvuRight = vector<float>(N, -1);
-        mvDepth = vector<float>(N, -1);
+        mpFeatures->mvuRight = vector<float>(N, -1);
+        mpFeatures->mvDepth = vector<float>(N, -1);
 
         mvpMapPoints = vector<MapPoint *>(N, static_cast<MapPoint *>(NULL));
         mvbOutlier = vector<bool>(N, false);
@@ -199,7 +201,7 @@ namespace ORB_SLAM2
     /**********************************************************/
 
     // 默认构造函数。 
-    Frame::Frame()
+    Frame::Frame() : mpFeatures(std::make_shared<FrameFeatures>())
     {
 
     }
@@ -210,24 +212,17 @@ namespace ORB_SLAM2
             mpORBvocabulary(frame.mpORBvocabulary), mpORBextractorLeft(frame.mpORBextractorLeft),
             mpORBextractorRight(frame.mpORBextractorRight), mTimeStamp(frame.mTimeStamp), mK(frame.mK.clone()),
             mDistCoef(frame.mDistCoef.clone()), mbf(frame.mbf), mb(frame.mb), mThDepth(frame.mThDepth), N(frame.N),
-            mvKeys(frame.mvKeys), mvKeysRight(frame.mvKeysRight), mvKeysUn(frame.mvKeysUn), mvuRight(frame.mvuRight),
-            mvDepth(frame.mvDepth), mBowVec(frame.mBowVec), mFeatVec(frame.mFeatVec),
-            mDescriptors(frame.mDescriptors.clone()), mDescriptorsRight(frame.mDescriptorsRight.clone()),
-            mvpMapPoints(frame.mvpMapPoints), mvbOutlier(frame.mvbOutlier), mnId(frame.mnId),
+            mpFeatures(frame.mpFeatures), mvpMapPoints(frame.mvpMapPoints), mvbOutlier(frame.mvbOutlier),
+            mnId(frame.mnId),
             mpReferenceKF(frame.mpReferenceKF), mnScaleLevels(frame.mnScaleLevels),
             mfScaleFactor(frame.mfScaleFactor), mfLogScaleFactor(frame.mfLogScaleFactor),
             mvScaleFactors(frame.mvScaleFactors), mvInvScaleFactors(frame.mvInvScaleFactors),
             mvLevelSigma2(frame.mvLevelSigma2), mvInvLevelSigma2(frame.mvInvLevelSigma2)
     {
 
-        for (int i = 0; i < FRAME_GRID_COLS; i++)
-            for (int j = 0; j < FRAME_GRID_ROWS; j++)
-                mGrid[i][j] = frame.mGrid[i][j];
-
         if (!frame.mTcw.empty())
             SetPose(frame.mTcw);
 
-        mvIMUDataSinceLastFrame = frame.mvIMUDataSinceLastFrame;
         mNavState = frame.GetNavState();
         mMargCovInv = frame.mMargCovInv;
         mNavStatePrior = frame.mNavStatePrior;
@@ -240,7 +235,7 @@ namespace ORB_SLAM2
                  const float &thDepth)
             : mpORBvocabulary(voc), mpORBextractorLeft(extractorLeft), mpORBextractorRight(extractorRight),
               mTimeStamp(timeStamp), mK(K.clone()), mDistCoef(distCoef.clone()), mbf(bf), mb(0), mThDepth(thDepth),
-              mpReferenceKF(static_cast<KeyFrame *>(NULL))
+              mpFeatures(std::make_shared<FrameFeatures>()), mpReferenceKF(static_cast<KeyFrame *>(NULL))
     {
         // Frame ID
         mnId = nNextId++;
@@ -261,10 +256,10 @@ namespace ORB_SLAM2
         threadLeft.join();
         threadRight.join();
 
-        if (mvKeys.empty())
+        if (mpFeatures->mvKeys.empty())
             return;
 
-        N = mvKeys.size();
+        N = mpFeatures->mvKeys.size();
 
         // Undistort特征点，这里没有对双目进行校正，因为要求输入的图像已经进行极线校正
         UndistortKeyPoints();
@@ -306,7 +301,8 @@ namespace ORB_SLAM2
                  ORBVocabulary *voc, cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth)
             : mpORBvocabulary(voc), mpORBextractorLeft(extractor),
               mpORBextractorRight(static_cast<ORBextractor *>(NULL)),
-              mTimeStamp(timeStamp), mK(K.clone()), mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth)
+              mTimeStamp(timeStamp), mK(K.clone()), mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth),
+              mpFeatures(std::make_shared<FrameFeatures>())
     {
         // Frame ID
         mnId = nNextId++;
@@ -323,9 +319,9 @@ namespace ORB_SLAM2
         // ORB extraction
         ExtractORB(0, imGray);
 
-        N = mvKeys.size();
+        N = mpFeatures->mvKeys.size();
 
-        if (mvKeys.empty())
+        if (mpFeatures->mvKeys.empty())
             return;
 
         UndistortKeyPoints();
@@ -363,7 +359,8 @@ namespace ORB_SLAM2
     Frame::Frame(const cv::Mat &imGray, const double &timeStamp, ORBextractor *extractor, ORBVocabulary *voc,
                  cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth) :
             mpORBvocabulary(voc), mpORBextractorLeft(extractor), mpORBextractorRight(static_cast<ORBextractor *>(NULL)),
-            mTimeStamp(timeStamp), mK(K.clone()), mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth)
+            mTimeStamp(timeStamp), mK(K.clone()), mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth),
+            mpFeatures(std::make_shared<FrameFeatures>())
     {
 
         // 帧ID。
@@ -381,9 +378,9 @@ namespace ORB_SLAM2
         // ORB特增提取。
         ExtractORB(0, imGray);
 
-        N = mvKeys.size();
+        N = mpFeatures->mvKeys.size();
 
-        if (mvKeys.empty())
+        if (mpFeatures->mvKeys.empty())
             return;
 
 
@@ -391,8 +388,8 @@ namespace ORB_SLAM2
         UndistortKeyPoints();
 
         // 设定标志位，表示无立体匹配信息。
-        mvuRight = vector<float>(N, -1);
-        mvDepth = vector<float>(N, -1);
+        mpFeatures->mvuRight = vector<float>(N, -1);
+        mpFeatures->mvDepth = vector<float>(N, -1);
 
         mvpMapPoints = vector<MapPoint *>(N, static_cast<MapPoint *>(NULL));
         mvbOutlier = vector<bool>(N, false);
@@ -425,35 +422,55 @@ namespace ORB_SLAM2
     // 分配特征点到栅格。
     void Frame::AssignFeaturesToGrid()
     {
-        int nReserve = 0.5f * N / (FRAME_GRID_COLS * FRAME_GRID_ROWS);
-
-        // 分配存储空间。
-        for (unsigned int i = 0; i < FRAME_GRID_COLS; i++)
-            for (unsigned int j = 0; j < FRAME_GRID_ROWS; j++)
-                mGrid[i][j].reserve(nReserve);
+        const int nCells = FRAME_GRID_COLS * FRAME_GRID_ROWS;
 
-        // 在mGrid中记录特征点编号。
+        // 计数排序，第一遍统计每个格子的特征点数。
+        vector<int> vCell(N, -1);
+        mpFeatures->mvGridOffsets.assign(nCells + 1, 0);
         for (int i = 0; i < N; i++)
         {
-            const cv::KeyPoint &kp = mvKeysUn[i];
+            const cv::KeyPoint &kp = mpFeatures->mvKeysUn[i];
 
             int nGridPosX, nGridPosY;
             if (PosInGrid(kp, nGridPosX, nGridPosY))
-                mGrid[nGridPosX][nGridPosY].push_back(i);
+            {
+                vCell[i] = nGridPosX * FRAME_GRID_ROWS + nGridPosY;
+                mpFeatures->mvGridOffsets[vCell[i] + 1]++;
+            }
         }
 
+        for (int c = 0; c < nCells; c++)
+            mpFeatures->mvGridOffsets[c + 1] += mpFeatures->mvGridOffsets[c];
+
+        // 第二遍按编号顺序写入特征点编号，格子内的顺序与编号顺序相同。
+        mpFeatures->mvGridIndices.resize(mpFeatures->mvGridOffsets[nCells]);
+        vector<unsigned int> vNext(mpFeatures->mvGridOffsets.begin(), mpFeatures->mvGridOffsets.end() - 1);
+        for (int i = 0; i < N; i++)
+            if (vCell[i] >= 0)
+                mpFeatures->mvGridIndices[vNext[vCell[i]]++] = i;
+
     }
 
 
     // 提取ORB特征。
     void Frame::ExtractORB(int flag, const cv::Mat &im)
     {
+        cv::Mat descriptors;
+
         // 单目和RGBD。
         if (flag == 0)
-            (*mpORBextractorLeft)(im, cv::Mat(), mvKeys, mDescriptors);
+        {
+            (*mpORBextractorLeft)(im, cv::Mat(), mpFeatures->mvKeys, descriptors);
+            mpFeatures->mDescriptorBlock = DescriptorBlock(descriptors);
+            mpFeatures->mDescriptors = mpFeatures->mDescriptorBlock.Mat();
+        }
             // 双目。
         else
-            (*mpORBextractorRight)(im, cv::Mat(), mvKeysRight, mDescriptorsRight);
+        {
+            (*mpORBextractorRight)(im, cv::Mat(), mpFeatures->mvKeysRight, descriptors);
+            mpFeatures->mDescriptorBlockRight = DescriptorBlock(descriptors);
+            mpFeatures->mDescriptorsRight = mpFeatures->mDescriptorBlockRight.Mat();
+        }
 
     }
 
@@ -479,6 +496,10 @@ namespace ORB_SLAM2
         // mOw，世界坐标系下相机坐标系原点的坐标，世界坐标系指向相机坐标系。
         mOw = -mRcw.t() * mtcw;
 
+        mRcwEig = Converter::toMatrix3f(mRcw);
+        mtcwEig = Converter::toVector3f(mtcw);
+        mOwEig = Converter::toVector3f(mOw);
+
     }
 
 
@@ -494,13 +515,13 @@ namespace ORB_SLAM2
         pMP->mbTrackInView = false;
 
         // 地图点的世界坐标。
-        cv::Mat P = pMP->GetWorldPos();
+        const Eigen::Vector3f P = pMP->GetWorldPosEigen();
 
         // 地图点在相机坐标系下的坐标。 
-        const cv::Mat Pc = mRcw * P + mtcw;
-        const float &PcX = Pc.at<float>(0);
-        const float &PcY = Pc.at<float>(1);
-        const float &PcZ = Pc.at<float>(2);
+        const Eigen::Vector3f Pc = mRcwEig * P + mtcwEig;
+        const float PcX = Pc(0);
+        const float PcY = Pc(1);
+        const float PcZ = Pc(2);
 
         // 检查地图点深度>0 
         if (PcZ < 0.0f)
@@ -520,14 +541,14 @@ namespace ORB_SLAM2
         const float maxDistance = pMP->GetMaxDistanceInvariance();
         const float minDistance = pMP->GetMinDistanceInvariance();
         // 世界坐标系下，地图点到相机的向量，相机指向地图点。
-        const cv::Mat PO = P - mOw;
-        const float dist = cv::norm(PO);
+        const Eigen::Vector3f PO = P - mOwEig;
+        const float dist = PO.norm();
         if (dist < minDistance || dist > maxDistance)
             return false;
 
 
         // 判据2 计算当前视角和平均视角的余弦值，若视角>60度(余弦值<cos60)，返回false。 
-        cv::Mat Pn = pMP->GetNormal();
+        const Eigen::Vector3f Pn = pMP->GetNormalEigen();
         const float viewCos = PO.dot(Pn) / dist;
         if (viewCos < viewingCosLimit)
             return false;
@@ -583,35 +604,37 @@ namespace ORB_SLAM2
         if (nMaxCellY < 0)
             return vIndices;
 
+        // 没有分配网格(默认构造的Frame)。
+        if (mpFeatures->mvGridOffsets.empty())
+            return vIndices;
+
         const bool bCheckLevels = (minLevel > 0) || (maxLevel >= 0);
 
         for (int ix = nMinCellX; ix <= nMaxCellX; ix++)
         {
-            for (int iy = nMinCellY; iy <= nMaxCellY; iy++)
-            {
-                const vector<size_t> vCell = mGrid[ix][iy];
-                if (vCell.empty())
-                    continue;
+            // 同一列中nMinCellY到nMaxCellY的格子连续存放，一次遍历。
+            const unsigned int jBegin = mpFeatures->mvGridOffsets[ix * FRAME_GRID_ROWS + nMinCellY];
+            const unsigned int jEnd = mpFeatures->mvGridOffsets[ix * FRAME_GRID_ROWS + nMaxCellY + 1];
 
-                // 遍历格子中的MP。
-                for (size_t j = 0, jend = vCell.size(); j < jend; j++)
+            // 遍历格子中的MP。
+            for (unsigned int j = jBegin; j < jEnd; j++)
+            {
+                const size_t idx = mpFeatures->mvGridIndices[j];
+                const cv::KeyPoint &kpUn = mpFeatures->mvKeysUn[idx];
+                if (bCheckLevels)
                 {
-                    const cv::KeyPoint &kpUn = mvKeysUn[vCell[j]];
-                    if (bCheckLevels)
-                    {
-                        if (kpUn.octave < minLevel)
+                    if (kpUn.octave < minLevel)
+                        continue;
+                    if (maxLevel >= 0)
+                        if (kpUn.octave > maxLevel)
                             continue;
-                        if (maxLevel >= 0)
-                            if (kpUn.octave > maxLevel)
-                                continue;
-                    }
+                }
 
-                    const float distx = kpUn.pt.x - x;
-                    const float disty = kpUn.pt.y - y;
+                const float distx = kpUn.pt.x - x;
+                const float disty = kpUn.pt.y - y;
 
-                    if (fabs(distx) < r && fabs(disty) < r)
-                        vIndices.push_back(vCell[j]);
-                }
+                if (fabs(distx) < r && fabs(disty) < r)
+                    vIndices.push_back(idx);
             }
         }
 
@@ -636,13 +659,11 @@ namespace ORB_SLAM2
 
 
     // 计算词典mBowVec和mFeatVec，其中mFeatVec记录了属于第i个node（在第4层）的ni个描述子。
-    void Frame::ComputeBoW()
+    void Frame::ComputeBoW(ThreadPool *pThreadPool)
     {
-        if (mBowVec.empty())
-        {
-            vector<cv::Mat> vCurrentDesc = Converter::toDescriptorVector(mDescriptors);
-            mpORBvocabulary->transform(vCurrentDesc, mBowVec, mFeatVec, 4);
-        }
+        if (mpFeatures->mBowVec.empty())
+            ComputeBowVectors(*mpORBvocabulary, mpFeatures->mDescriptorBlock, 4, mpFeatures->mBowVec,
+                              mpFeatures->mFeatVec, pThreadPool);
 
     }
 
@@ -653,7 +674,14 @@ namespace ORB_SLAM2
         // 如果图像没有失真。
         if (mDistCoef.at<float>(0) == 0.0)
         {
-            mvKeysUn = mvKeys;
+            mpFeatures->mvKeysUn = mpFeatures->mvKeys;
+            return;
+        }
+
+        // 有查找表时双线性插值。
+        if (mpUndistortionMap)
+        {
+            mpUndistortionMap->Undistort(mpFeatures->mvKeys, mpFeatures->mvKeysUn);
             return;
         }
 
@@ -661,8 +689,8 @@ namespace ORB_SLAM2
         cv::Mat mat(N, 2, CV_32F);
         for (int i = 0; i < N; i++)
         {
-            mat.at<float>(i, 0) = mvKeys[i].pt.x;
-            mat.at<float>(i, 1) = mvKeys[i].pt.y;
+            mat.at<float>(i, 0) = mpFeatures->mvKeys[i].pt.x;
+            mat.at<float>(i, 1) = mpFeatures->mvKeys[i].pt.y;
         }
 
         // 调整mat的通道为2，矩阵的形状不变。
@@ -671,13 +699,13 @@ namespace ORB_SLAM2
         mat = mat.reshape(1);
 
         // 储存校正后的特征点。
-        mvKeysUn.resize(N);
+        mpFeatures->mvKeysUn.resize(N);
         for (int i = 0; i < N; i++)
         {
-            cv::KeyPoint kp = mvKeys[i];
+            cv::KeyPoint kp = mpFeatures->mvKeys[i];
             kp.pt.x = mat.at<float>(i, 0);
             kp.pt.y = mat.at<float>(i, 1);
-            mvKeysUn[i] = kp;
+            mpFeatures->mvKeysUn[i] = kp;
         }
 
     }
@@ -746,8 +774,8 @@ namespace ORB_SLAM2
     */
     void Frame::ComputeStereoMatches()
     {
-        mvuRight = vector<float>(N, -1.0f);
-        mvDepth = vector<float>(N, -1.0f);
+        mpFeatures->mvuRight = vector<float>(N, -1.0f);
+        mpFeatures->mvDepth = vector<float>(N, -1.0f);
 
         const int nRows = mpORBextractorLeft->mvImagePyramid[0].rows;
 
@@ -762,17 +790,17 @@ namespace ORB_SLAM2
         for (int i = 0; i < nRows; i++)
             vRowIndices[i].reserve(200);
 
-        const int Nr = mvKeysRight.size();
+        const int Nr = mpFeatures->mvKeysRight.size();
 
         for (int iR = 0; iR < Nr; iR++)
         {
             // !!在这个函数中没有对双目进行校正，双目校正是在外层程序中实现的
-            const cv::KeyPoint &kp = mvKeysRight[iR];
+            const cv::KeyPoint &kp = mpFeatures->mvKeysRight[iR];
             const float &kpY = kp.pt.y;
             // 计算匹配搜索的纵向宽度，尺度越大（层数越高，距离越近），搜索范围越大
             // 如果特征点在金字塔第一层，则搜索范围为:正负2
             // 尺度越大其位置不确定性越高，所以其搜索半径越大
-            const float r = 2.0f * mvScaleFactors[mvKeysRight[iR].octave];
+            const float r = 2.0f * mvScaleFactors[mpFeatures->mvKeysRight[iR].octave];
             const int maxr = ceil(kpY + r);
             const int minr = floor(kpY - r);
 
@@ -795,7 +823,7 @@ namespace ORB_SLAM2
         // 这里是不是应该对校正后特征点求深度呢？(wubo???)
         for (int iL = 0; iL < N; iL++)
         {
-            const cv::KeyPoint &kpL = mvKeys[iL];
+            const cv::KeyPoint &kpL = mpFeatures->mvKeys[iL];
             const int &levelL = kpL.octave;
             const float &vL = kpL.pt.y;
             const float &uL = kpL.pt.x;
@@ -816,14 +844,14 @@ namespace ORB_SLAM2
             size_t bestIdxR = 0;
 
             // 每个特征点描述子占一行，建立一个指针指向iL特征点对应的描述子
-            const cv::Mat &dL = mDescriptors.row(iL);
+            const uchar *dL = mpFeatures->mDescriptorBlock.Row(iL);
 
             // Compare descriptor to right keypoints
             // 步骤2.1：遍历右目所有可能的匹配点，找出最佳匹配点（描述子距离最小）
             for (size_t iC = 0; iC < vCandidates.size(); iC++)
             {
                 const size_t iR = vCandidates[iC];
-                const cv::KeyPoint &kpR = mvKeysRight[iR];
+                const cv::KeyPoint &kpR = mpFeatures->mvKeysRight[iR];
 
                 // 仅对近邻尺度的特征点进行匹配
                 if (kpR.octave < levelL - 1 || kpR.octave > levelL + 1)
@@ -833,8 +861,7 @@ namespace ORB_SLAM2
 
                 if (uR >= minU && uR <= maxU)
                 {
-                    const cv::Mat &dR = mDescriptorsRight.row(iR);
-                    const int dist = ORBmatcher::DescriptorDistance(dL, dR);
+                    const int dist = ORBmatcher::DescriptorDistance(dL, mpFeatures->mDescriptorBlockRight.Row(iR));
 
                     if (dist < bestDist)
                     {
@@ -851,7 +878,7 @@ namespace ORB_SLAM2
             {
                 // coordinates in image pyramid at keypoint scale
                 // kpL.pt.x对应金字塔最底层坐标，将最佳匹配的特征点对尺度变换到尺度对应层 (scaleduL, scaledvL) (scaleduR0, )
-                const float uR0 = mvKeysRight[bestIdxR].pt.x;
+                const float uR0 = mpFeatures->mvKeysRight[bestIdxR].pt.x;
                 const float scaleFactor = mvInvScaleFactors[kpL.octave];
                 const float scaleduL = round(kpL.pt.x * scaleFactor);
                 const float scaledvL = round(kpL.pt.y * scaleFactor);
@@ -933,8 +960,8 @@ namespace ORB_SLAM2
                     }
                     // depth 是在这里计算的
                     // depth=baseline*fx/disparity
-                    mvDepth[iL] = mbf / disparity;   // 深度
-                    mvuRight[iL] = bestuR;       // 匹配对在右图的横坐标
+                    mpFeatures->mvDepth[iL] = mbf / disparity;   // 深度
+                    mpFeatures->mvuRight[iL] = bestuR;       // 匹配对在右图的横坐标
                     vDistIdx.push_back(pair<int, int>(bestDist, iL)); // 该特征点SAD匹配最小匹配偏差
                 }
             }
@@ -952,8 +979,8 @@ namespace ORB_SLAM2
                 break;
             else
             {
-                mvuRight[vDistIdx[i].second] = -1;
-                mvDepth[vDistIdx[i].second] = -1;
+                mpFeatures->mvuRight[vDistIdx[i].second] = -1;
+                mpFeatures->mvDepth[vDistIdx[i].second] = -1;
             }
         }
     }
@@ -962,13 +989,13 @@ namespace ORB_SLAM2
     void Frame::ComputeStereoFromRGBD(const cv::Mat &imDepth)
     {
         // mvDepth直接由depth图像读取
-        mvuRight = vector<float>(N, -1);
-        mvDepth = vector<float>(N, -1);
+        mpFeatures->mvuRight = vector<float>(N, -1);
+        mpFeatures->mvDepth = vector<float>(N, -1);
 
         for (int i = 0; i < N; i++)
         {
-            const cv::KeyPoint &kp = mvKeys[i];
-            const cv::KeyPoint &kpU = mvKeysUn[i];
+            const cv::KeyPoint &kp = mpFeatures->mvKeys[i];
+            const cv::KeyPoint &kpU = mpFeatures->mvKeysUn[i];
 
             const float &v = kp.pt.y;
             const float &u = kp.pt.x;
@@ -977,8 +1004,8 @@ namespace ORB_SLAM2
 
             if (d > 0)
             {
-                mvDepth[i] = d;
-                mvuRight[i] = kpU.pt.x - mbf / d;
+                mpFeatures->mvDepth[i] = d;
+                mpFeatures->mvuRight[i] = kpU.pt.x - mbf / d;
             }
         }
     }
@@ -996,11 +1023,11 @@ namespace ORB_SLAM2
         // mvDepth对应的校正前的特征点，可这里却是对校正后特征点反投影
         // KeyFrame::UnprojectStereo中是对校正前的特征点mvKeys反投影
         // 在ComputeStereoMatches函数中应该对校正后的特征点求深度？？ (wubo???)
-        const float z = mvDepth[i];
+        const float z = mpFeatures->mvDepth[i];
         if (z > 0)
         {
-            const float u = mvKeysUn[i].pt.x;
-            const float v = mvKeysUn[i].pt.y;
+            const float u = mpFeatures->mvKeysUn[i].pt.x;
+            const float v = mpFeatures->mvKeysUn[i].pt.y;
             const float x = (u - cx) * z * invfx;
             const float y = (v - cy) * z * invfy;
             cv::Mat x3Dc = (cv::Mat_<float>(3, 1) << x, y, z);
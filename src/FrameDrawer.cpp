@@ -174,7 +174,7 @@ namespace ORB_SLAM2
     {
         unique_lock<mutex> lock(mMutex);
         pTracker->mImGray.copyTo(mIm);
-        mvCurrentKeys = pTracker->mCurrentFrame.mvKeys;
+        mvCurrentKeys = pTracker->mCurrentFrame.mpFeatures->mvKeys;
         N = mvCurrentKeys.size();
         mvbVO = vector<bool>(N, false);
         mvbMap = vector<bool>(N, false);
@@ -182,7 +182,7 @@ namespace ORB_SLAM2
 
         if (pTracker->mLastProcessedState == Tracking::NOT_INITIALIZED)
         {
-            mvIniKeys = pTracker->mInitialFrame.mvKeys;
+            mvIniKeys = pTracker->mInitialFrame.mpFeatures->mvKeys;
             mvIniMatches = pTracker->mvIniMatches;
         }
         else if (pTracker->mLastProcessedState == Tracking::OK)
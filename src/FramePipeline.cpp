@@ -0,0 +1,184 @@
+#include "FramePipeline.h"
+
+#include <algorithm>
+
+namespace ORB_SLAM2
+{
+
+    FramePipeline::FramePipeline(const std::function<void(Job &)> &build, int nDepth) :
+            mBuild(build), mnDepth(std::max(nDepth, 1)), mbBuilding(false), mbPaused(false), mbIniExtractor(true),
+            mbFinishRequested(false), mbStarted(false), mLatencySum(0), mBuildSum(0), mTrackSum(0)
+    {
+        mStats.nFrames = 0;
+        mStats.nRebuilt = 0;
+        mStats.mLatencyMean = 0;
+        mStats.mLatencyMax = 0;
+        mStats.mBuildMean = 0;
+        mStats.mTrackMean = 0;
+        mStats.mThroughput = 0;
+
+        mThread = std::thread(&FramePipeline::Run, this);
+    }
+
+    FramePipeline::~FramePipeline()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutexQueue);
+            mbFinishRequested = true;
+        }
+        mCondQueue.notify_all();
+        mThread.join();
+
+        for (size_t i = 0; i < mqInputs.size(); i++)
+            delete mqInputs[i];
+        for (size_t i = 0; i < mqBuilt.size(); i++)
+            delete mqBuilt[i];
+    }
+
+    void FramePipeline::Run()
+    {
+        while (true)
+        {
+            Job *pJob;
+            {
+                std::unique_lock<std::mutex> lock(mMutexQueue);
+                while (!mbFinishRequested && (mbPaused || mqInputs.empty()))
+                    mCondQueue.wait(lock);
+
+                if (mbFinishRequested)
+                    return;
+
+                pJob = mqInputs.front();
+                mqInputs.pop_front();
+                pJob->mbIniExtractor = mbIniExtractor;
+                mbBuilding = true;
+            }
+
+            std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+            mBuild(*pJob);
+            std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+            pJob->mBuildTime = std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t2 - t1).count();
+
+            {
+                std::unique_lock<std::mutex> lock(mMutexQueue);
+                mqBuilt.push_back(pJob);
+                mbBuilding = false;
+            }
+            mCondQueue.notify_all();
+        }
+    }
+
+    void FramePipeline::Submit(const cv::Mat &im, const std::vector<IMUData> &vimu, const double &timestamp)
+    {
+        Job *pJob = new Job();
+        pJob->mIm = im.clone();
+        pJob->mvIMU = vimu;
+        pJob->mTimestamp = timestamp;
+        pJob->mbIniExtractor = true;
+        pJob->mtSubmit = std::chrono::steady_clock::now();
+        pJob->mBuildTime = 0;
+
+        {
+            std::unique_lock<std::mutex> lock(mMutexStats);
+            if (!mbStarted)
+            {
+                mtFirstSubmit = pJob->mtSubmit;
+                mbStarted = true;
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mMutexQueue);
+            mqInputs.push_back(pJob);
+        }
+        mCondQueue.notify_all();
+    }
+
+    FramePipeline::Job *FramePipeline::Pop(bool bFlush)
+    {
+        std::unique_lock<std::mutex> lock(mMutexQueue);
+
+        const int nPending = (int) (mqInputs.size() + mqBuilt.size()) + (mbBuilding ? 1 : 0);
+        if (nPending == 0 || (!bFlush && nPending <= mnDepth))
+            return static_cast<Job *>(NULL);
+
+        while (mqBuilt.empty())
+            mCondQueue.wait(lock);
+
+        Job *pJob = mqBuilt.front();
+        mqBuilt.pop_front();
+        return pJob;
+    }
+
+    void FramePipeline::Pause()
+    {
+        int nRequeued;
+        {
+            std::unique_lock<std::mutex> lock(mMutexQueue);
+            mbPaused = true;
+            while (mbBuilding)
+                mCondQueue.wait(lock);
+
+            // 已构造的帧按原顺序放回输入队列头部
+            nRequeued = (int) mqBuilt.size();
+            while (!mqBuilt.empty())
+            {
+                mqInputs.push_front(mqBuilt.back());
+                mqBuilt.pop_back();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mMutexStats);
+        mStats.nRebuilt += nRequeued;
+    }
+
+    void FramePipeline::Resume(bool bIniExtractor)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutexQueue);
+            mbIniExtractor = bIniExtractor;
+            mbPaused = false;
+        }
+        mCondQueue.notify_all();
+    }
+
+    void FramePipeline::SetIniExtractor(bool bIniExtractor)
+    {
+        std::unique_lock<std::mutex> lock(mMutexQueue);
+        mbIniExtractor = bIniExtractor;
+    }
+
+    void FramePipeline::CountRebuilt()
+    {
+        std::unique_lock<std::mutex> lock(mMutexStats);
+        mStats.nRebuilt++;
+    }
+
+    void FramePipeline::FinishFrame(const Job &job, double trackTime)
+    {
+        std::chrono::steady_clock::time_point tNow = std::chrono::steady_clock::now();
+        const double latency =
+                std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(tNow - job.mtSubmit).count();
+
+        std::unique_lock<std::mutex> lock(mMutexStats);
+        const double elapsed =
+                std::chrono::duration_cast<std::chrono::duration<double> >(tNow - mtFirstSubmit).count();
+        mStats.nFrames++;
+        mLatencySum += latency;
+        mBuildSum += job.mBuildTime;
+        mTrackSum += trackTime;
+
+        mStats.mLatencyMean = mLatencySum / mStats.nFrames;
+        mStats.mLatencyMax = std::max(mStats.mLatencyMax, latency);
+        mStats.mBuildMean = mBuildSum / mStats.nFrames;
+        mStats.mTrackMean = mTrackSum / mStats.nFrames;
+        mStats.mThroughput = elapsed > 0 ? mStats.nFrames / elapsed : 0;
+    }
+
+    FramePipeline::Stats FramePipeline::GetStats()
+    {
+        std::unique_lock<std::mutex> lock(mMutexStats);
+        return mStats;
+    }
+
+} //namespace ORB_SLAM2
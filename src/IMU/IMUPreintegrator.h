@@ -13,8 +13,12 @@ namespace ORB_SLAM2
 
     typedef Eigen::Matrix<double, 9, 9> Matrix9d;
 
+    class MapSerializer;
+
     class IMUPreintegrator
     {
+        // 保存和加载地图时直接读写预积分结果。
+        friend class MapSerializer;
 
     public:
         EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -25,7 +25,7 @@ namespace ORB_SLAM2
     {
         mK = ReferenceFrame.mK.clone();
 
-        mvKeys1 = ReferenceFrame.mvKeysUn;
+        mvKeys1 = ReferenceFrame.mpFeatures->mvKeysUn;
 
         mSigma = sigma;
         mSigma2 = sigma * sigma;
@@ -39,7 +39,7 @@ namespace ORB_SLAM2
     {
         // ReferenceFrame: 1, CurrentFrame: 2。
         // Frame2的特征点。 
-        mvKeys2 = CurrentFrame.mvKeysUn;
+        mvKeys2 = CurrentFrame.mpFeatures->mvKeysUn;
 
         // 1 2帧间匹配的特征点。
         mvMatches12.clear();
@@ -6,6 +6,7 @@
 #include "ORBmatcher.h"
 
 #include <mutex>
+#include <string.h>
 
 
 namespace ORB_SLAM2
@@ -14,6 +15,34 @@ namespace ORB_SLAM2
     long unsigned int KeyFrame::nNextId = 0;
 
 
+    // 从Frame拷贝关键帧的特征数据，描述子共享。
+    static std::shared_ptr<KeyFrameFeatures> MakeKeyFrameFeatures(const Frame &F, const std::vector<IMUData> &vIMUData)
+    {
+        std::shared_ptr<KeyFrameFeatures> pFeatures = std::make_shared<KeyFrameFeatures>();
+        pFeatures->mvKeys = F.mpFeatures->mvKeys;
+        pFeatures->mvKeysUn = F.mpFeatures->mvKeysUn;
+        pFeatures->mvuRight = F.mpFeatures->mvuRight;
+        pFeatures->mvDepth = F.mpFeatures->mvDepth;
+        pFeatures->mDescriptorBlock = F.mpFeatures->mDescriptorBlock;
+        pFeatures->mBowVec = F.mpFeatures->mBowVec;
+        pFeatures->mFeatVec = F.mpFeatures->mFeatVec;
+        pFeatures->mvGridOffsets = F.mpFeatures->mvGridOffsets;
+        pFeatures->mvGridIndices = F.mpFeatures->mvGridIndices;
+        pFeatures->mvIMUData = vIMUData;
+        return pFeatures;
+    }
+
+
+    // 有右目坐标的特征点。
+    static std::vector<bool> StereoFlags(const std::vector<float> &vuRight)
+    {
+        std::vector<bool> vbStereo(vuRight.size());
+        for (size_t i = 0; i < vuRight.size(); i++)
+            vbStereo[i] = vuRight[i] >= 0;
+        return vbStereo;
+    }
+
+
     /************************VI SLAM*************************/
 
     void KeyFrame::UpdateNavStatePVRFromTcw(const cv::Mat &Tcw, const cv::Mat &Tbc)
@@ -77,17 +106,31 @@ namespace ORB_SLAM2
 
     std::vector<IMUData> KeyFrame::GetVectorIMUData(void)
     {
-        unique_lock<mutex> lock(mMutexIMUData);
-        return mvIMUData;
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures = GetFeatures();
+        return pFeatures ? pFeatures->mvIMUData : std::vector<IMUData>();
     }
 
     void KeyFrame::AppendIMUDataToFront(KeyFrame *pPrevKF)
     {
-        std::vector<IMUData> vimunew = pPrevKF->GetVectorIMUData();
+        const std::shared_ptr<const KeyFrameFeatures> pPrevFeatures = pPrevKF->GetFeatures();
         {
             unique_lock<mutex> lock(mMutexIMUData);
-            vimunew.insert(vimunew.end(), mvIMUData.begin(), mvIMUData.end());
-            mvIMUData = vimunew;
+            // 与ComputeBoW的修改互斥，读取和替换之间特征数据不会被替换
+            unique_lock<mutex> lockUpdate(mMutexFeaturesUpdate);
+            // 读取失败时不修改，换出的数据仍然保留在KeyFrameStore中
+            const std::shared_ptr<const KeyFrameFeatures> pCurrentFeatures = GetFeatures();
+            if (!pPrevFeatures || !pCurrentFeatures)
+            {
+                cerr << "KeyFrame " << mnId << ": IMU data of KeyFrame " << pPrevKF->mnId << " not merged" << endl;
+                return;
+            }
+
+            // 特征数据只读，拷贝后替换
+            std::shared_ptr<KeyFrameFeatures> pFeatures = std::make_shared<KeyFrameFeatures>(*pCurrentFeatures);
+            std::vector<IMUData> vimunew = pPrevFeatures->mvIMUData;
+            vimunew.insert(vimunew.end(), pFeatures->mvIMUData.begin(), pFeatures->mvIMUData.end());
+            pFeatures->mvIMUData.swap(vimunew);
+            SetFeatures(pFeatures);
         }
     }
 
@@ -207,13 +250,22 @@ namespace ORB_SLAM2
 
         else
         {
+            // 读取失败或没有IMU数据时保留原来的预积分
+            const std::shared_ptr<const KeyFrameFeatures> pFeatures = GetFeatures();
+            if (!pFeatures || pFeatures->mvIMUData.empty())
+            {
+                cerr << "KeyFrame " << mnId << ": no IMU data, pre-integrator not changed" << endl;
+                return;
+            }
+            const std::vector<IMUData> &vIMUData = pFeatures->mvIMUData;
+
             mIMUPreInt.reset();
             Vector3d bg = mpPrevKeyFrame->GetNavState().Get_BiasGyr();
             Vector3d ba = mpPrevKeyFrame->GetNavState().Get_BiasAcc();
 
             // 上一帧关键帧到第一个IMU数据的预积分值
             {
-                const IMUData &imu = mvIMUData.front();
+                const IMUData &imu = vIMUData.front();
                 double dt = imu._t - mpPrevKeyFrame->mTimeStamp;
                 mIMUPreInt.update(imu._g - bg, imu._a - ba, dt);
 
@@ -226,15 +278,15 @@ namespace ORB_SLAM2
 
             }
 
-            for (size_t i = 0; i < mvIMUData.size(); i++)
+            for (size_t i = 0; i < vIMUData.size(); i++)
             {
-                const IMUData &imu = mvIMUData[i];
+                const IMUData &imu = vIMUData[i];
                 double nextt;
 
-                if (i == mvIMUData.size() - 1)
+                if (i == vIMUData.size() - 1)
                     nextt = mTimeStamp;
                 else
-                    nextt = mvIMUData[i + 1]._t;
+                    nextt = vIMUData[i + 1]._t;
 
                 double dt = nextt - imu._t;
 
@@ -257,19 +309,17 @@ namespace ORB_SLAM2
             mnFrameId(F.mnId), mTimeStamp(F.mTimeStamp), mnGridCols(FRAME_GRID_COLS), mnGridRows(FRAME_GRID_ROWS),
             mfGridElementWidthInv(F.mfGridElementWidthInv), mfGridElementHeightInv(F.mfGridElementHeightInv),
             mnTrackReferenceForFrame(0), mnFuseTargetForKF(0), mnBALocalForKF(0), mnBAFixedForKF(0),
-            mnLoopQuery(0), mnLoopWords(0), mnRelocQuery(0), mnRelocWords(0), mnBAGlobalForKF(0),
+            mnBAGlobalForKF(0),
             fx(F.fx), fy(F.fy), cx(F.cx), cy(F.cy), invfx(F.invfx), invfy(F.invfy),
-            mbf(F.mbf), mb(F.mb), mThDepth(F.mThDepth), N(F.N), mvKeys(F.mvKeys), mvKeysUn(F.mvKeysUn),
-            mvuRight(F.mvuRight), mvDepth(F.mvDepth), mDescriptors(F.mDescriptors.clone()),
-            mBowVec(F.mBowVec), mFeatVec(F.mFeatVec), mnScaleLevels(F.mnScaleLevels), mfScaleFactor(F.mfScaleFactor),
+            mbf(F.mbf), mb(F.mb), mThDepth(F.mThDepth), N(F.N), mvbStereo(StereoFlags(F.mpFeatures->mvuRight)),
+            mnScaleLevels(F.mnScaleLevels),
+            mfScaleFactor(F.mfScaleFactor),
             mfLogScaleFactor(F.mfLogScaleFactor), mvScaleFactors(F.mvScaleFactors), mvLevelSigma2(F.mvLevelSigma2),
             mvInvLevelSigma2(F.mvInvLevelSigma2), mnMinX(F.mnMinX), mnMinY(F.mnMinY), mnMaxX(F.mnMaxX),
             mnMaxY(F.mnMaxY), mK(F.mK), mvpMapPoints(F.mvpMapPoints), mpKeyFrameDB(pKFDB),
-            mpORBvocabulary(F.mpORBvocabulary), mbFirstConnection(true), mpParent(NULL), mbNotErase(false),
+            mpORBvocabulary(F.mpORBvocabulary), mnFeatureBytes(0), mbFirstConnection(true), mpParent(NULL), mbNotErase(false),
             mbToBeErased(false), mbBad(false), mHalfBaseline(F.mb / 2), mpMap(pMap)
     {
-        mvIMUData = vIMUData;
-
         if (pPrevKF)
         {
             pPrevKF->SetNextKeyFrame(this);
@@ -280,13 +330,8 @@ namespace ORB_SLAM2
 
         mnId = nNextId++;
 
-        mGrid.resize(mnGridCols);
-        for (int i = 0; i < mnGridCols; i++)
-        {
-            mGrid[i].resize(mnGridRows);
-            for (int j = 0; j < mnGridRows; j++)
-                mGrid[i][j] = F.mGrid[i][j];
-        }
+        SetFeatures(MakeKeyFrameFeatures(F, vIMUData));
+        mnLastFeatureUse = mpMap->mKeyFrameStore.NextUse();
 
         SetPose(F.mTcw);
 
@@ -298,6 +343,14 @@ namespace ORB_SLAM2
 
 
 
+    KeyFrame::~KeyFrame()
+    {
+        if (mpFeatures)
+            mpMap->mKeyFrameStore.AddResident(-(long) mnFeatureBytes);
+        mpMap->mKeyFrameStore.Release(mSpillRecord);
+    }
+
+
     /*********************************************************/
 
 
@@ -306,15 +359,15 @@ namespace ORB_SLAM2
             mnFrameId(F.mnId), mTimeStamp(F.mTimeStamp), mnGridCols(FRAME_GRID_COLS), mnGridRows(FRAME_GRID_ROWS),
             mfGridElementWidthInv(F.mfGridElementWidthInv), mfGridElementHeightInv(F.mfGridElementHeightInv),
             mnTrackReferenceForFrame(0), mnFuseTargetForKF(0), mnBALocalForKF(0), mnBAFixedForKF(0),
-            mnLoopQuery(0), mnLoopWords(0), mnRelocQuery(0), mnRelocWords(0), mnBAGlobalForKF(0),
+            mnBAGlobalForKF(0),
             fx(F.fx), fy(F.fy), cx(F.cx), cy(F.cy), invfx(F.invfx), invfy(F.invfy),
-            mbf(F.mbf), mb(F.mb), mThDepth(F.mThDepth), N(F.N), mvKeys(F.mvKeys), mvKeysUn(F.mvKeysUn),
-            mvuRight(F.mvuRight), mvDepth(F.mvDepth), mDescriptors(F.mDescriptors.clone()),
-            mBowVec(F.mBowVec), mFeatVec(F.mFeatVec), mnScaleLevels(F.mnScaleLevels), mfScaleFactor(F.mfScaleFactor),
+            mbf(F.mbf), mb(F.mb), mThDepth(F.mThDepth), N(F.N), mvbStereo(StereoFlags(F.mpFeatures->mvuRight)),
+            mnScaleLevels(F.mnScaleLevels),
+            mfScaleFactor(F.mfScaleFactor),
             mfLogScaleFactor(F.mfLogScaleFactor), mvScaleFactors(F.mvScaleFactors), mvLevelSigma2(F.mvLevelSigma2),
             mvInvLevelSigma2(F.mvInvLevelSigma2), mnMinX(F.mnMinX), mnMinY(F.mnMinY), mnMaxX(F.mnMaxX),
             mnMaxY(F.mnMaxY), mK(F.mK), mvpMapPoints(F.mvpMapPoints), mpKeyFrameDB(pKFDB),
-            mpORBvocabulary(F.mpORBvocabulary), mbFirstConnection(true), mpParent(NULL), mbNotErase(false),
+            mpORBvocabulary(F.mpORBvocabulary), mnFeatureBytes(0), mbFirstConnection(true), mpParent(NULL), mbNotErase(false),
             mbToBeErased(false), mbBad(false), mHalfBaseline(F.mb / 2), mpMap(pMap)
     {
         // Test log
@@ -324,14 +377,9 @@ namespace ORB_SLAM2
         mpNextKeyFrame = NULL;
         mnId = nNextId++;
 
-        // 传递每个栅格的特征点数。
-        mGrid.resize(mnGridCols);
-        for (int i = 0; i < mnGridCols; i++)
-        {
-            mGrid[i].resize(mnGridRows);
-            for (int j = 0; j < mnGridRows; j++)
-                mGrid[i][j] = F.mGrid[i][j];
-        }
+        // 传递特征点、描述子和每个栅格的特征点。
+        SetFeatures(MakeKeyFrameFeatures(F, std::vector<IMUData>()));
+        mnLastFeatureUse = mpMap->mKeyFrameStore.NextUse();
 
         SetPose(F.mTcw);
 
@@ -339,14 +387,109 @@ namespace ORB_SLAM2
 
 
     // 计算mBowVec，并且将描述子分散在第4层，即mFeatVec记录了属于第i个node的ni个描述子。
-    void KeyFrame::ComputeBoW()
+    void KeyFrame::ComputeBoW(ThreadPool *pThreadPool)
+    {
+        // 与AppendIMUDataToFront的修改互斥
+        unique_lock<mutex> lock(mMutexFeaturesUpdate);
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures = GetFeatures();
+        if (!pFeatures)
+            return;
+        if (pFeatures->mBowVec.empty() || pFeatures->mFeatVec.empty())
+        {
+            // 特征数据只读，计算后替换
+            std::shared_ptr<KeyFrameFeatures> pNewFeatures = std::make_shared<KeyFrameFeatures>(*pFeatures);
+            ComputeBowVectors(*mpORBvocabulary, pNewFeatures->mDescriptorBlock, 4, pNewFeatures->mBowVec,
+                              pNewFeatures->mFeatVec, pThreadPool);
+            SetFeatures(pNewFeatures);
+        }
+
+    }
+
+
+    // 读取特征数据，换出时从KeyFrameStore读入。
+    std::shared_ptr<const KeyFrameFeatures> KeyFrame::GetFeatures()
     {
-        if (mBowVec.empty() || mFeatVec.empty())
+        unique_lock<mutex> lock(mMutexSpill);
+        mnLastFeatureUse = mpMap->mKeyFrameStore.NextUse();
+        if (!mpFeatures)
+        {
+            std::shared_ptr<const KeyFrameFeatures> pFeatures = mpMap->mKeyFrameStore.Read(mSpillRecord);
+            if (!pFeatures)
+            {
+                // 读取失败时返回NULL，记录保留，下次再读
+                cerr << "KeyFrame " << mnId << ": failed to read features from the keyframe store" << endl;
+                return pFeatures;
+            }
+            mpFeatures = pFeatures;
+            mpMap->mKeyFrameStore.AddResident((long) mnFeatureBytes);
+        }
+        return mpFeatures;
+    }
+
+    bool KeyFrame::GetDescriptor(const size_t idx, uchar *pDescriptor)
+    {
+        unique_lock<mutex> lock(mMutexSpill);
+        if (idx >= (size_t) N)
+            return false;
+        if (mpFeatures)
+        {
+            if (idx >= (size_t) mpFeatures->mDescriptorBlock.Rows())
+                return false;
+            memcpy(pDescriptor, mpFeatures->mDescriptorBlock.Row(idx), DescriptorBlock::DESC_SIZE);
+            return true;
+        }
+        return mpMap->mKeyFrameStore.ReadDescriptor(mSpillRecord, idx, pDescriptor);
+    }
+
+    size_t KeyFrame::SpillFeatures()
+    {
+        size_t nBytes;
+        {
+            unique_lock<mutex> lock(mMutexSpill);
+            if (!mpFeatures)
+                return 0;
+
+            // 上次换出后没有修改时记录仍然有效
+            if (mSpillRecord.nSize == 0 && !mpMap->mKeyFrameStore.Write(*mpFeatures, mSpillRecord))
+                return 0;
+
+            mpFeatures.reset();
+            mpMap->mKeyFrameStore.AddResident(-(long) mnFeatureBytes);
+            nBytes = mnFeatureBytes;
+        }
+
+        // 地图点缓存的该关键帧的描述子也不再常驻，之后需要时从KeyFrameStore读取。
+        // ComputeDistinctiveDescriptors先锁地图点再读取描述子，这里不能持有mMutexSpill。
+        const vector<MapPoint *> vpMPs = GetMapPointMatches();
+        for (size_t i = 0; i < vpMPs.size(); i++)
         {
-            vector<cv::Mat> vCurrentDesc = Converter::toDescriptorVector(mDescriptors);
-            mpORBvocabulary->transform(vCurrentDesc, mBowVec, mFeatVec, 4);
+            MapPoint *pMP = vpMPs[i];
+            if (pMP && !pMP->isBad())
+                nBytes += pMP->ReleaseDescriptorCache();
         }
+        return nBytes;
+    }
+
+    bool KeyFrame::IsFeaturesResident()
+    {
+        unique_lock<mutex> lock(mMutexSpill);
+        return (bool) mpFeatures;
+    }
+
+    unsigned long KeyFrame::GetLastFeatureUse()
+    {
+        unique_lock<mutex> lock(mMutexSpill);
+        return mnLastFeatureUse;
+    }
 
+    void KeyFrame::SetFeatures(const std::shared_ptr<const KeyFrameFeatures> &pFeatures)
+    {
+        unique_lock<mutex> lock(mMutexSpill);
+        const size_t nBytes = pFeatures->Bytes();
+        mpMap->mKeyFrameStore.AddResident((long) nBytes - (mpFeatures ? (long) mnFeatureBytes : 0));
+        mpMap->mKeyFrameStore.Release(mSpillRecord);
+        mpFeatures = pFeatures;
+        mnFeatureBytes = nBytes;
     }
 
 
@@ -354,20 +497,34 @@ namespace ORB_SLAM2
     void KeyFrame::SetPose(const cv::Mat &Tcw_)
     {
         unique_lock<mutex> lock(mMutexPose);
-        Tcw_.copyTo(Tcw);
+        cv::Mat Tcw = Tcw_.clone();
         cv::Mat Rcw = Tcw.rowRange(0, 3).colRange(0, 3);
         cv::Mat tcw = Tcw.rowRange(0, 3).col(3);
         cv::Mat Rwc = Rcw.t();
-        Ow = -Rwc * tcw;
+        cv::Mat Ow = -Rwc * tcw;
 
-        Twc = cv::Mat::eye(4, 4, Tcw.type());
+        cv::Mat Twc = cv::Mat::eye(4, 4, Tcw.type());
         Rwc.copyTo(Twc.rowRange(0, 3).colRange(0, 3));
         Ow.copyTo(Twc.rowRange(0, 3).col(3));
 
         // 相机坐标系下(左目)，立体相机中心的齐次坐标。
         cv::Mat center = (cv::Mat_<float>(4, 1) << mHalfBaseline, 0, 0, 1);
         // 世界坐标系下，立体相机中心的齐次坐标。
-        Cw = Twc * center;
+        cv::Mat Cw = Twc * center;
+
+        KeyFramePose pose;
+        for (int i = 0; i < 4; i++)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                pose.mTcw[i * 4 + j] = Tcw.at<float>(i, j);
+                pose.mTwc[i * 4 + j] = Twc.at<float>(i, j);
+            }
+            pose.mCw[i] = Cw.at<float>(i);
+        }
+        for (int i = 0; i < 3; i++)
+            pose.mOw[i] = Ow.at<float>(i);
+        mPose.Write(pose);
 
     }
 
@@ -375,8 +532,8 @@ namespace ORB_SLAM2
     // 获取位姿。
     cv::Mat KeyFrame::GetPose()
     {
-        unique_lock<mutex> lock(mMutexPose);
-        return Tcw.clone();
+        KeyFramePose pose = mPose.Read();
+        return cv::Mat(4, 4, CV_32F, pose.mTcw).clone();
 
     }
 
@@ -384,8 +541,8 @@ namespace ORB_SLAM2
     // 获取位姿的逆。
     cv::Mat KeyFrame::GetPoseInverse()
     {
-        unique_lock<mutex> lock(mMutexPose);
-        return Twc.clone();
+        KeyFramePose pose = mPose.Read();
+        return cv::Mat(4, 4, CV_32F, pose.mTwc).clone();
 
     }
 
@@ -393,17 +550,23 @@ namespace ORB_SLAM2
     // 获取世界坐标系下相机坐标系原点坐标。
     cv::Mat KeyFrame::GetCameraCenter()
     {
-        unique_lock<mutex> lock(mMutexPose);
-        return Ow.clone();
+        KeyFramePose pose = mPose.Read();
+        return cv::Mat(3, 1, CV_32F, pose.mOw).clone();
+
+    }
 
+    Eigen::Vector3f KeyFrame::GetCameraCenterEigen()
+    {
+        const KeyFramePose pose = mPose.Read();
+        return Eigen::Vector3f(pose.mOw[0], pose.mOw[1], pose.mOw[2]);
     }
 
 
     // 获取双目相机中点坐标(世界坐标系下)。
     cv::Mat KeyFrame::GetStereoCenter()
     {
-        unique_lock<mutex> lock(mMutexPose);
-        return Cw.clone();
+        KeyFramePose pose = mPose.Read();
+        return cv::Mat(4, 1, CV_32F, pose.mCw).clone();
 
     }
 
@@ -411,8 +574,8 @@ namespace ORB_SLAM2
     // 获取当前关键帧的旋转矩阵。
     cv::Mat KeyFrame::GetRotation()
     {
-        unique_lock<mutex> lock(mMutexPose);
-        return Tcw.rowRange(0, 3).colRange(0, 3).clone();
+        KeyFramePose pose = mPose.Read();
+        return cv::Mat(4, 4, CV_32F, pose.mTcw).rowRange(0, 3).colRange(0, 3).clone();
 
     }
 
@@ -420,8 +583,8 @@ namespace ORB_SLAM2
     // 获取当前关键帧帧的位移矩阵。
     cv::Mat KeyFrame::GetTranslation()
     {
-        unique_lock<mutex> lock(mMutexPose);
-        return Tcw.rowRange(0, 3).col(3).clone();
+        KeyFramePose pose = mPose.Read();
+        return cv::Mat(4, 4, CV_32F, pose.mTcw).rowRange(0, 3).col(3).clone();
 
     }
 
@@ -578,6 +741,21 @@ namespace ORB_SLAM2
 
     }
 
+    // 剔除关键帧中已经变坏、但没有从该关键帧中删除的地图点(创建关键帧时或该关键帧被剔除后变坏的)。
+    void KeyFrame::EraseBadMapPointMatches()
+    {
+        const vector<MapPoint *> vpMPs = GetMapPointMatches();
+        for (size_t i = 0; i < vpMPs.size(); i++)
+        {
+            if (vpMPs[i] && vpMPs[i]->isBad())
+            {
+                unique_lock<mutex> lock(mMutexFeatures);
+                if (mvpMapPoints[i] == vpMPs[i])
+                    mvpMapPoints[i] = static_cast<MapPoint *>(NULL);
+            }
+        }
+    }
+
 
     // 替换该关键帧地图点。
     void KeyFrame::ReplaceMapPointMatch(const size_t &idx, MapPoint *pMP)
@@ -695,18 +873,13 @@ namespace ORB_SLAM2
             if (pMP->isBad())
                 continue;
 
-            // 对于每一个MapPoint，observations记录了可以观测到该MapPoint的所有关键帧和KF中Mappoint的索引。
-            mapMapPointObs/*map<KeyFrame*, size_t>*/ observations = pMP->GetObservations();
-
-            // 建立当前关键帧的公视关系。
-            for (mapMapPointObs/*map<KeyFrame*, size_t>*/::iterator mit = observations.begin(), mend = observations.end();
-                 mit != mend; mit++)
-            {
-                // 剔除自身，自身不算共视。
-                if (mit->first->mnId == mnId)
-                    continue;
-                KFcounter[mit->first]++;
-            }
+            // 对于每一个MapPoint，遍历可以观测到该MapPoint的所有关键帧(不拷贝观测)，建立当前关键帧的公视关系。
+            pMP->ForEachObservation([&](KeyFrame *pKFi, size_t)
+                                    {
+                                        // 剔除自身，自身不算共视。
+                                        if (pKFi->mnId != mnId)
+                                            KFcounter[pKFi]++;
+                                    });
         }
 
         // 没有共视关系，正常不应该出现。
@@ -994,7 +1167,7 @@ namespace ORB_SLAM2
                 }
 
             mpParent->EraseChild(this);
-            mTcp = Tcw * mpParent->GetPoseInverse();
+            mTcp = GetPose() * mpParent->GetPoseInverse();
             mbBad = true;
         }
 
@@ -1035,6 +1208,12 @@ namespace ORB_SLAM2
         mpMap->EraseKeyFrame(this);
         mpKeyFrameDB->erase(this);
 
+        // 轨迹和其他线程可能还持有该关键帧，都不再使用后再释放。
+        mpMap->mEpochManager.Retire(this);
+
+        // 不释放坏关键帧时，限制内存的情况下换出它的特征数据。
+        if (mpMap->mKeyFrameStore.IsEnabled() && !mpMap->mEpochManager.IsEnabled())
+            SpillFeatures();
 
     }
 
@@ -1068,8 +1247,21 @@ namespace ORB_SLAM2
 
 
     // 获取该关键帧中制定区域的特征。
-    vector<size_t> KeyFrame::GetFeaturesInArea(const float &x, const float &y, const float &r) const
+    vector<size_t> KeyFrame::GetFeaturesInArea(const float &x, const float &y, const float &r)
+    {
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures = GetFeatures();
+        if (!pFeatures)
+            return vector<size_t>();
+        return GetFeaturesInArea(*pFeatures, x, y, r);
+    }
+
+    vector<size_t> KeyFrame::GetFeaturesInArea(const KeyFrameFeatures &features, const float &x, const float &y,
+                                               const float &r) const
     {
+        const std::vector<unsigned int> &vGridOffsets = features.mvGridOffsets;
+        const std::vector<unsigned int> &vGridIndices = features.mvGridIndices;
+        const std::vector<cv::KeyPoint> &vKeysUn = features.mvKeysUn;
+
         vector<size_t> vIndices;
         vIndices.reserve(N);
 
@@ -1092,21 +1284,23 @@ namespace ORB_SLAM2
         if (nMaxCellY < 0)
             return vIndices;
 
+        if (vGridOffsets.empty())
+            return vIndices;
+
         for (int ix = nMinCellX; ix <= nMaxCellX; ix++)
         {
-            for (int iy = nMinCellY; iy <= nMaxCellY; iy++)
+            // 同一列中nMinCellY到nMaxCellY的格子的特征点连续存放。
+            const unsigned int jBegin = vGridOffsets[ix * mnGridRows + nMinCellY];
+            const unsigned int jEnd = vGridOffsets[ix * mnGridRows + nMaxCellY + 1];
+            for (unsigned int j = jBegin; j < jEnd; j++)
             {
-                // mGrid[ix][iy]存储着每个格子的特征点数。
-                const vector<size_t> vCell = mGrid[ix][iy];
-                for (size_t j = 0, jend = vCell.size(); j < jend; j++)
-                {
-                    const cv::KeyPoint &kpUn = mvKeysUn[vCell[j]];
-                    const float distx = kpUn.pt.x - x;
-                    const float disty = kpUn.pt.y - y;
+                const size_t idx = vGridIndices[j];
+                const cv::KeyPoint &kpUn = vKeysUn[idx];
+                const float distx = kpUn.pt.x - x;
+                const float disty = kpUn.pt.y - y;
 
-                    if (fabs(distx) < r && fabs(disty) < r)
-                        vIndices.push_back(vCell[j]);
-                }
+                if (fabs(distx) < r && fabs(disty) < r)
+                    vIndices.push_back(idx);
             }
         }
 
@@ -1130,7 +1324,11 @@ namespace ORB_SLAM2
      */
     cv::Mat KeyFrame::UnprojectStereo(int i)
     {
-        const float z = mvDepth[i];
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures = GetFeatures();
+        if (!pFeatures || i < 0 || (size_t) i >= pFeatures->mvKeys.size())
+            return cv::Mat();
+
+        const float z = pFeatures->mvDepth[i];
         if (z > 0)
         {
             // 由2维图像反投影到相机坐标系
@@ -1138,13 +1336,13 @@ namespace ORB_SLAM2
             // mvDepth对应的校正前的特征点，因此这里对校正前特征点反投影
             // 可在Frame::UnprojectStereo中却是对校正后的特征点mvKeysUn反投影
             // 在ComputeStereoMatches函数中应该对校正后的特征点求深度？？ (wubo???)
-            const float u = mvKeys[i].pt.x;
-            const float v = mvKeys[i].pt.y;
+            const float u = pFeatures->mvKeys[i].pt.x;
+            const float v = pFeatures->mvKeys[i].pt.y;
             const float x = (u - cx) * z * invfx;
             const float y = (v - cy) * z * invfy;
             cv::Mat x3Dc = (cv::Mat_<float>(3, 1) << x, y, z);
 
-            unique_lock<mutex> lock(mMutexPose);
+            const cv::Mat Twc = GetPoseInverse();
             // 由相机坐标系转换到世界坐标系
             // Twc为相机坐标系到世界坐标系的变换矩阵
             // Twc.rosRange(0,3).colRange(0,3)取Twc矩阵的前3行与前3列
@@ -1166,10 +1364,9 @@ namespace ORB_SLAM2
         cv::Mat Tcw_;
         {
             unique_lock<mutex> lock(mMutexFeatures);
-            unique_lock<mutex> lock2(mMutexPose);
             vpMapPoints = mvpMapPoints;
-            Tcw_ = Tcw.clone();
         }
+        Tcw_ = GetPose();
 
         vector<float> vDepths;
         vDepths.reserve(N);
@@ -3,8 +3,11 @@
 
 #include "KeyFrameDatabase.h"
 #include "KeyFrame.h"
-#include "Thirdparty/DBoW2/DBoW2/BowVector.h"
+#include "ThreadPool.h"
+#include "Thirdparty/DBoW2/DBoW2/FlatBowVector.h"
 
+#include <algorithm>
+#include <list>
 #include <mutex>
 
 
@@ -14,10 +17,12 @@ namespace ORB_SLAM2
 {
 
     // 构造函数。
-    KeyFrameDatabase::KeyFrameDatabase(const ORBVocabulary &voc) : mpVoc(&voc)
+    KeyFrameDatabase::KeyFrameDatabase(const ORBVocabulary &voc) : mpVoc(&voc), mnMaxKFId(0),
+                                                                   mpThreadPool(static_cast<ThreadPool *>(NULL))
     {
         // 词的数量。
         mvInvertedFile.resize(voc.size());
+        mvnErased.resize(voc.size(), 0);
     }
 
 
@@ -25,32 +30,50 @@ namespace ORB_SLAM2
     // 将pKF与它包含的word关联起来。
     void KeyFrameDatabase::add(KeyFrame *pKF)
     {
+        // 词袋向量在关键帧的特征数据中，在加锁之前读取。
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures = pKF->GetFeatures();
+        if (!pFeatures)
+            return;
+        const DBoW2::FlatBowVector &bowVec = pFeatures->mBowVec;
+
         unique_lock<mutex> lock(mMutex);
 
-        // 为该KeyFrame包含的词添加关联， vit->first是关键帧pFK包含的词。
-        for (DBoW2::BowVector::const_iterator vit = pKF->mBowVec.begin(), vend = pKF->mBowVec.end(); vit != vend; vit++)
-            mvInvertedFile[vit->first].push_back(pKF);
+        // 为该KeyFrame包含的词添加关联， bowVec.id(iw)是关键帧pFK包含的词。
+        for (size_t iw = 0, iend = bowVec.size(); iw < iend; iw++)
+            mvInvertedFile[bowVec.id(iw)].push_back(pKF);
+
+        if (pKF->mnId > mnMaxKFId)
+            mnMaxKFId = pKF->mnId;
     }
 
 
     // 关键帧被删除后，更新数据库的倒排索引。
     void KeyFrameDatabase::erase(KeyFrame *pKF)
     {
+        // 词袋向量读取失败时遍历所有的词，不能在倒排索引中留下删除的关键帧。
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures = pKF->GetFeatures();
+
         unique_lock<mutex> lock(mMutex);
 
         // 每一个pKF包含多个word，遍历mvInvertedFile中的words，根据word删除对应的pKF。
-        for (DBoW2::BowVector::const_iterator vit = pKF->mBowVec.begin(), vend = pKF->mBowVec.end(); vit != vend; vit++)
+        const size_t nWords = pFeatures ? pFeatures->mBowVec.size() : mvInvertedFile.size();
+        for (size_t iw = 0; iw < nWords; iw++)
         {
+            const DBoW2::WordId wordId = pFeatures ? pFeatures->mBowVec.id(iw) : (DBoW2::WordId) iw;
+
             // 列出包含又共同word的关键帧。 
-            list<KeyFrame *> &lKFs = mvInvertedFile[vit->first];
+            vector<KeyFrame *> &vKFs = mvInvertedFile[wordId];
+
+            vector<KeyFrame *>::iterator vit = find(vKFs.begin(), vKFs.end(), pKF);
+            if (vit == vKFs.end())
+                continue;
 
-            for (list<KeyFrame *>::iterator lit = lKFs.begin(), lend = lKFs.end(); lit != lend; lit++)
+            // 先置为NULL，剔除的超过一半时压缩，保持其余关键帧的顺序。
+            *vit = static_cast<KeyFrame *>(NULL);
+            if (2 * (++mvnErased[wordId]) > (int) vKFs.size())
             {
-                if (pKF == *lit)
-                {
-                    lKFs.erase(lit);
-                    break;
-                }
+                vKFs.erase(remove(vKFs.begin(), vKFs.end(), static_cast<KeyFrame *>(NULL)), vKFs.end());
+                mvnErased[wordId] = 0;
             }
         }
 
@@ -60,103 +83,148 @@ namespace ORB_SLAM2
     // 清除KeyFrameDB。
     void KeyFrameDatabase::clear()
     {
+        unique_lock<mutex> lock(mMutex);
+
         // mvInvertedFile[i] 表示包含第i个word id的所有关键帧。
         mvInvertedFile.clear();
         // 预先训练好的词典，就那个半天也加载不完的玩意。
         mvInvertedFile.resize(mpVoc->size());
+        mvnErased.assign(mpVoc->size(), 0);
+        mnMaxKFId = 0;
     }
 
 
-    /*
-    * 在闭环检测中找到与该关键帧可能闭环的关键帧。
-    *   1. 找出和当前关键帧具有公共word最多的关键帧。
-    *   2. 只和具有共同单词较多的关键帧进行相似度计算。
-    *   3. 将与共视较多关键帧相连(权值最高)的前十个关键帧归为一组，计算累计得分。
-    *   4. 返回累计得分的最高分0.75倍以上的组中word相似度最高的关键帧作为一组候选关键帧。
-    * @param
-    *   pKF 当前关键真，需要闭环的关键帧。
-    *   minScore 相似分数最低要求。
-    * @return    可能闭环的关键帧，一般不是一个。
-    */
-    vector<KeyFrame *> KeyFrameDatabase::DetectLoopCandidates(KeyFrame *pKF, float minScore)
+    // 闭环检测和重定位共同的步骤1-3，计数和得分只保存在调用者的数组中。
+    int KeyFrameDatabase::QueryCandidates(const DBoW2::FlatBowVector &bowVec, const set<KeyFrame *> &spExcluded,
+                                          vector<int> &vnCandidateIdx, vector<KeyFrame *> &vpCandidates,
+                                          vector<int> &vnWords, vector<float> &vScores)
     {
-        // 获得与pKF相连的KF，这些KeyFram都是局部相连，闭环检测时需要剔除。
-        set<KeyFrame *> spConnectedKeyFrames = pKF->GetConnectedKeyFrames();
-        // 保存可能与pKF形成回环的关键帧(有相同的word，不是局部连接)。
-        list<KeyFrame *> lKFsSharingWords;
+        vpCandidates.clear();
+        vnWords.clear();
 
-        // 步骤1 找到和pKF具有公共word的所有关键帧，不包含spConnectedKeyFrames。
+        // 步骤1 找到和bowVec具有公共word的所有关键帧，不包含spExcluded。
         {
             unique_lock<mutex> lock(mMutex);
 
-            // words是检测图像是否匹配的关键，遍历pKF的每一word。
-            for (DBoW2::BowVector::const_iterator vit = pKF->mBowVec.begin(), vend = pKF->mBowVec.end();
-                 vit != vend; vit++)
+            // 排除的关键帧标记为-2，不计数也不成为候选。
+            vnCandidateIdx.assign(mnMaxKFId + 1, -1);
+            for (set<KeyFrame *>::const_iterator sit = spExcluded.begin(); sit != spExcluded.end(); sit++)
+            {
+                if ((*sit)->mnId <= mnMaxKFId)
+                    vnCandidateIdx[(*sit)->mnId] = -2;
+            }
+
+            // words是检测图像是否匹配的关键，遍历bowVec的每一word。
+            for (size_t iw = 0, iend = bowVec.size(); iw < iend; iw++)
             {
                 // 提取包含该word的所有KeyFrame。
-                list<KeyFrame *> &lKFs = mvInvertedFile[vit->first];
+                const vector<KeyFrame *> &vKFs = mvInvertedFile[bowVec.id(iw)];
 
                 // 遍历有相同word的KF。
-                for (list<KeyFrame *>::iterator lit = lKFs.begin(), lend = lKFs.end(); lit != lend; lit++)
+                for (size_t i = 0, nKFs = vKFs.size(); i < nKFs; i++)
                 {
-                    KeyFrame *pKFi = *lit;
-                    // pKFi没有被标记为pKF的闭环候选帧。
-                    if (pKFi->mnLoopQuery != pKF->mnId)
+                    KeyFrame *pKFi = vKFs[i];
+                    if (!pKFi)
+                        continue;
+
+                    int &idx = vnCandidateIdx[pKFi->mnId];
+                    if (idx == -2)
+                        continue;
+
+                    // 第一次遇到，标记为候选。
+                    if (idx == -1)
                     {
-                        pKFi->mnLoopWords = 0;
-                        // pKFi不在局部相连中。
-                        if (!spConnectedKeyFrames.count(pKFi))
-                        {
-                            // 标记为pKF的候选。
-                            pKFi->mnLoopQuery = pKF->mnId;
-                            lKFsSharingWords.push_back(pKFi);
-                        }
+                        idx = (int) vpCandidates.size();
+                        vpCandidates.push_back(pKFi);
+                        vnWords.push_back(0);
                     }
 
-                    pKFi->mnLoopWords++;
+                    vnWords[idx]++;
                 }
             }
         }
 
-        if (lKFsSharingWords.empty())
-            return vector<KeyFrame *>();
+        vScores.assign(vpCandidates.size(), 0.0f);
+        if (vpCandidates.empty())
+            return 0;
 
-        // 存储于当前帧相似度大于minScore的分数和关键帧。
-        list<pair<float, KeyFrame *>> lScoreAndMatch;
+        // 步骤2 统计所有候选帧中与bowVec具有最多word的关键帧对应的word数目。
+        const int maxCommonWords = *max_element(vnWords.begin(), vnWords.end());
 
+        // 计算相似度的word数目阈值。
+        const int minCommonWords = maxCommonWords * 0.8f;
 
-        // 步骤2 统计所有闭环候选帧中与pKF具有最多word的关键帧对应的word数目。
-        int maxCommonWords = 0;
-        for (list<KeyFrame *>::iterator lit = lKFsSharingWords.begin(), lend = lKFsSharingWords.end();
-             lit != lend; lit++)
+        // 步骤3 只和共有words数目大于minCommonWords的关键帧计算相似度，各候选互不相关，可以并行。
+        vector<int> vToScore;
+        vToScore.reserve(vpCandidates.size());
+        for (size_t i = 0; i < vpCandidates.size(); i++)
         {
-            if ((*lit)->mnLoopWords > maxCommonWords)
-                maxCommonWords = (*lit)->mnLoopWords;
+            if (vnWords[i] > minCommonWords)
+                vToScore.push_back((int) i);
         }
 
-        // 计算相似度的word数目阈值。
-        int minCommonWords = maxCommonWords * 0.8f;
+        const int BLOCK_SIZE = 16;
+        const int nToScore = (int) vToScore.size();
+        const int nBlocks = (nToScore + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        auto scoreBlock = [&](int iBlock)
+        {
+            const int iEnd = min(nToScore, (iBlock + 1) * BLOCK_SIZE);
+            for (int i = iBlock * BLOCK_SIZE; i < iEnd; i++)
+            {
+                // 换出的候选关键帧先读入，读取失败时得分为0。
+                const std::shared_ptr<const KeyFrameFeatures> pFeatures = vpCandidates[vToScore[i]]->GetFeatures();
+                vScores[vToScore[i]] = pFeatures ? mpVoc->score(bowVec, pFeatures->mBowVec) : 0;
+            }
+        };
 
-        int nscores = 0;
+        if (mpThreadPool && nBlocks > 1)
+            mpThreadPool->ParallelFor(nBlocks, scoreBlock);
+        else
+            for (int iBlock = 0; iBlock < nBlocks; iBlock++)
+                scoreBlock(iBlock);
 
-        // 步骤3 遍历所有候选关键帧，找出共有word数目大于minCommonwords且单词匹配度大于minScore的关键帧，存入lScoreAndMatch。
-        for (list<KeyFrame *>::iterator lit = lKFsSharingWords.begin(), lend = lKFsSharingWords.end();
-             lit != lend; lit++)
-        {
-            KeyFrame *pKFi = *lit;
+        return minCommonWords;
+    }
 
-            // pKF只和共有words数目大于minCommonWords的关键帧进行比较。
-            if (pKFi->mnLoopWords > minCommonWords)
-            {
-                nscores++;
 
-                float si = mpVoc->score(pKF->mBowVec, pKFi->mBowVec);
-                pKFi->mLoopScore = si;
+    /*
+    * 在闭环检测中找到与该关键帧可能闭环的关键帧。
+    *   1. 找出和当前关键帧具有公共word最多的关键帧。
+    *   2. 只和具有共同单词较多的关键帧进行相似度计算。
+    *   3. 将与共视较多关键帧相连(权值最高)的前十个关键帧归为一组，计算累计得分。
+    *   4. 返回累计得分的最高分0.75倍以上的组中word相似度最高的关键帧作为一组候选关键帧。
+    * @param
+    *   pKF 当前关键真，需要闭环的关键帧。
+    *   minScore 相似分数最低要求。
+    * @return    可能闭环的关键帧，一般不是一个。
+    */
+    vector<KeyFrame *> KeyFrameDatabase::DetectLoopCandidates(KeyFrame *pKF, float minScore)
+    {
+        // 获得与pKF相连的KF，这些KeyFram都是局部相连，闭环检测时需要剔除。
+        set<KeyFrame *> spConnectedKeyFrames = pKF->GetConnectedKeyFrames();
 
-                // 大于最小匹配度minScore。
-                if (si >= minScore)
-                    lScoreAndMatch.push_back(make_pair(si, pKFi));
-            }
+        // 步骤1-3 找到和pKF具有公共word的所有关键帧(不包含spConnectedKeyFrames)，对共有word较多的计算相似度。
+        vector<int> vnCandidateIdx;
+        vector<KeyFrame *> vpCandidates;
+        vector<int> vnWords;
+        vector<float> vScores;
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures = pKF->GetFeatures();
+        if (!pFeatures)
+            return vector<KeyFrame *>();
+        const int minCommonWords = QueryCandidates(pFeatures->mBowVec, spConnectedKeyFrames, vnCandidateIdx,
+                                                   vpCandidates, vnWords, vScores);
+
+        if (vpCandidates.empty())
+            return vector<KeyFrame *>();
+
+        // 存储于当前帧相似度大于minScore的分数和关键帧。
+        list<pair<float, KeyFrame *>> lScoreAndMatch;
+
+        for (size_t i = 0; i < vpCandidates.size(); i++)
+        {
+            // 大于最小匹配度minScore。
+            if (vnWords[i] > minCommonWords && vScores[i] >= minScore)
+                lScoreAndMatch.push_back(make_pair(vScores[i], vpCandidates[i]));
         }
 
         if (lScoreAndMatch.empty())
@@ -181,15 +249,18 @@ namespace ORB_SLAM2
             {
                 // 候选帧的相邻帧。
                 KeyFrame *pKF2 = *vit;
-                // 只有pKF2在闭环候选帧lScoreAndMatch中，才能贡献分数。
-                if (pKF2->mnLoopQuery == pKF->mnId && pKF2->mnLoopWords > minCommonWords)
+                // 只有pKF2是计算过相似度的候选帧，才能贡献分数。查询之后添加的关键帧不在数组中。
+                if (pKF2->mnId >= vnCandidateIdx.size())
+                    continue;
+                const int idx2 = vnCandidateIdx[pKF2->mnId];
+                if (idx2 >= 0 && vnWords[idx2] > minCommonWords)
                 {
-                    accScore += pKF2->mLoopScore;
+                    accScore += vScores[idx2];
                     // 组内最高得分和对应关键帧。
-                    if (pKF2->mLoopScore > bestScore)
+                    if (vScores[idx2] > bestScore)
                     {
                         pBestKF = pKF2;
-                        bestScore = pKF2->mLoopScore;
+                        bestScore = vScores[idx2];
                     }
                 }
             }
@@ -240,70 +311,24 @@ namespace ORB_SLAM2
     */
     vector<KeyFrame *> KeyFrameDatabase::DetectRelocalizationCandidates(Frame *F)
     {
-        // 相比于关键帧闭环监测 DetectLoopCandidates()，帧F不存在共视图。
-        // 可能和帧F形成重定位的候选关键帧。
-        list<KeyFrame *> lKFsSharingWords;
-
-        // 步骤1 找出和当前帧具有公共words的所有关键帧。
-        {
-            unique_lock<mutex> lock(mMutex);
-
-            for (DBoW2::BowVector::const_iterator vit = F->mBowVec.begin(), vend = F->mBowVec.end(); vit != vend; vit++)
-            {
-                // 提取包含该word的所有KeyFrame。
-                list<KeyFrame *> &lKFs = mvInvertedFile[vit->first];
-
-                // 遍历有相同word的KF。
-                for (list<KeyFrame *>::iterator lit = lKFs.begin(), lend = lKFs.end(); lit != lend; lit++)
-                {
-                    KeyFrame *pKFi = *lit;
-                    // pKFi没有被标记为F的重定位候选帧。
-                    if (pKFi->mnRelocQuery != F->mnId)
-                    {
-                        pKFi->mnRelocWords = 0;
-                        pKFi->mnRelocQuery = F->mnId;
-                        lKFsSharingWords.push_back(pKFi);
-                    }
-
-                    pKFi->mnRelocWords++;
-                }
-            }
-        }
-
-        if (lKFsSharingWords.empty())
+        // 相比于关键帧闭环监测 DetectLoopCandidates()，帧F不存在共视图，不排除任何关键帧。
+        // 步骤1-3 找出和当前帧具有公共words的所有关键帧，对共有word较多的计算相似度。
+        vector<int> vnCandidateIdx;
+        vector<KeyFrame *> vpCandidates;
+        vector<int> vnWords;
+        vector<float> vScores;
+        const int minCommonWords = QueryCandidates(F->mpFeatures->mBowVec, set<KeyFrame *>(), vnCandidateIdx,
+                                                   vpCandidates, vnWords, vScores);
+
+        if (vpCandidates.empty())
             return vector<KeyFrame *>();
 
-        // 步骤2 统计所有重定位候选帧中与当前帧F具有最多word的关键帧对应的word数目。
-        int maxCommonWords = 0;
-        for (list<KeyFrame *>::iterator lit = lKFsSharingWords.begin(), lend = lKFsSharingWords.end();
-             lit != lend; lit++)
-        {
-            if ((*lit)->mnRelocWords > maxCommonWords)
-                maxCommonWords = (*lit)->mnRelocWords;
-        }
-
-        // 计算相似度的word数目阈值。
-        int minCommonWords = maxCommonWords * 0.8f;
-
         list<pair<float, KeyFrame *> > lScoreAndMatch;
 
-        int nscores = 0;
-
-        // 步骤3 遍历所有候选关键帧，找出共有word数目大于minCommonwords的关键帧，存入lScoreAndMatch。
-        for (list<KeyFrame *>::iterator lit = lKFsSharingWords.begin(), lend = lKFsSharingWords.end();
-             lit != lend; lit++)
+        for (size_t i = 0; i < vpCandidates.size(); i++)
         {
-            KeyFrame *pKFi = *lit;
-
-            // pKF只和共有words数目大于minCommonWords的关键帧进行比较。
-            if (pKFi->mnRelocWords > minCommonWords)
-            {
-                nscores++;
-
-                float si = mpVoc->score(F->mBowVec, pKFi->mBowVec);
-                pKFi->mRelocScore = si;
-                lScoreAndMatch.push_back(make_pair(si, pKFi));
-            }
+            if (vnWords[i] > minCommonWords)
+                lScoreAndMatch.push_back(make_pair(vScores[i], vpCandidates[i]));
         }
 
         if (lScoreAndMatch.empty())
@@ -327,16 +352,19 @@ namespace ORB_SLAM2
             {
                 // 候选帧的相邻帧。
                 KeyFrame *pKF2 = *vit;
-                // 只有pKF2在闭环候选帧lScoreAndMatch中，才能贡献分数。
-                if (pKF2->mnRelocQuery != F->mnId)
+                // 只有pKF2是候选帧，才能贡献分数，未计算相似度的得分为0。
+                if (pKF2->mnId >= vnCandidateIdx.size())
+                    continue;
+                const int idx2 = vnCandidateIdx[pKF2->mnId];
+                if (idx2 < 0)
                     continue;
 
-                accScore += pKF2->mRelocScore;
+                accScore += vScores[idx2];
                 // 组内最高得分和对应关键帧。
-                if (pKF2->mRelocScore > bestScore)
+                if (vScores[idx2] > bestScore)
                 {
                     pBestKF = pKF2;
-                    bestScore = pKF2->mRelocScore;
+                    bestScore = vScores[idx2];
                 }
             }
 
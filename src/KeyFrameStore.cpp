@@ -0,0 +1,450 @@
+#include "KeyFrameStore.h"
+#include "KeyFrame.h"
+
+#include <iostream>
+#include <algorithm>
+#include <set>
+#include <chrono>
+#include <string.h>
+
+
+using namespace std;
+
+namespace ORB_SLAM2
+{
+
+    namespace
+    {
+
+        // 当前关键帧之前不换出的关键帧数，与局部建图的滑动窗口相近。
+        const int PROTECTED_PREV_KEYFRAMES = 20;
+
+        // 记录开头是特征点数，之后是描述子，可以直接读取某一个描述子。
+        const uint64_t DESCRIPTOR_OFFSET = sizeof(uint64_t);
+
+
+        template<typename T>
+        inline void Append(string &s, const T &v)
+        {
+            s.append(reinterpret_cast<const char *>(&v), sizeof(T));
+        }
+
+        template<typename T>
+        inline void AppendArray(string &s, const T *p, size_t n)
+        {
+            if (n > 0)
+                s.append(reinterpret_cast<const char *>(p), n * sizeof(T));
+        }
+
+        template<typename T>
+        inline void AppendVector(string &s, const vector<T> &v)
+        {
+            Append(s, (uint64_t) v.size());
+            AppendArray(s, v.data(), v.size());
+        }
+
+        // 从pData读取，越过pEnd时失败。
+        template<typename T>
+        inline bool TakeArray(const char *&pData, const char *pEnd, T *p, size_t n)
+        {
+            if ((size_t) (pEnd - pData) < n * sizeof(T))
+                return false;
+            if (n > 0)
+                memcpy(p, pData, n * sizeof(T));
+            pData += n * sizeof(T);
+            return true;
+        }
+
+        template<typename T>
+        inline bool Take(const char *&pData, const char *pEnd, T &v)
+        {
+            return TakeArray(pData, pEnd, &v, 1);
+        }
+
+        template<typename T>
+        bool TakeVector(const char *&pData, const char *pEnd, vector<T> &v)
+        {
+            uint64_t n;
+            if (!Take(pData, pEnd, n) || n > (uint64_t) (pEnd - pData) / sizeof(T))
+                return false;
+            v.resize(n);
+            return TakeArray(pData, pEnd, v.data(), n);
+        }
+
+        // 记录格式：特征点数 -> 描述子 -> 未校正和校正后的特征点 -> 右目坐标和深度 -> 词袋向量 -> 特征向量 -> 栅格 -> IMU测量
+        void Serialize(const KeyFrameFeatures &features, string &s)
+        {
+            const uint64_t N = features.mDescriptorBlock.Rows();
+            Append(s, N);
+            if (N > 0)
+                AppendArray(s, features.mDescriptorBlock.Row(0), N * DescriptorBlock::DESC_SIZE);
+            AppendVector(s, features.mvKeys);
+            AppendVector(s, features.mvKeysUn);
+            AppendVector(s, features.mvuRight);
+            AppendVector(s, features.mvDepth);
+
+            const DBoW2::FlatBowVector &bowVec = features.mBowVec;
+            Append(s, (uint64_t) bowVec.size());
+            AppendArray(s, bowVec.ids(), bowVec.size());
+            AppendArray(s, bowVec.values(), bowVec.size());
+
+            const DBoW2::FlatFeatureVector &featVec = features.mFeatVec;
+            Append(s, (uint64_t) featVec.size());
+            for (size_t i = 0; i < featVec.size(); i++)
+            {
+                Append(s, featVec.nodeId(i));
+                Append(s, featVec.nFeatures(i));
+                AppendArray(s, featVec.features(i), featVec.nFeatures(i));
+            }
+
+            AppendVector(s, features.mvGridOffsets);
+            AppendVector(s, features.mvGridIndices);
+
+            Append(s, (uint64_t) features.mvIMUData.size());
+            for (size_t i = 0; i < features.mvIMUData.size(); i++)
+            {
+                const IMUData &imu = features.mvIMUData[i];
+                AppendArray(s, imu._g.data(), 3);
+                AppendArray(s, imu._a.data(), 3);
+                Append(s, imu._t);
+            }
+        }
+
+        bool Deserialize(const char *pData, const char *pEnd, KeyFrameFeatures &features)
+        {
+            uint64_t N;
+            if (!Take(pData, pEnd, N) || N > (uint64_t) (pEnd - pData) / DescriptorBlock::DESC_SIZE)
+                return false;
+            features.mDescriptorBlock = DescriptorBlock(reinterpret_cast<const uchar *>(pData), (int) N);
+            pData += N * DescriptorBlock::DESC_SIZE;
+
+            if (!TakeVector(pData, pEnd, features.mvKeys) || !TakeVector(pData, pEnd, features.mvKeysUn) ||
+                !TakeVector(pData, pEnd, features.mvuRight) || !TakeVector(pData, pEnd, features.mvDepth))
+                return false;
+
+            uint64_t nWords;
+            if (!Take(pData, pEnd, nWords) ||
+                nWords > (uint64_t) (pEnd - pData) / (sizeof(DBoW2::WordId) + sizeof(DBoW2::WordValue)))
+                return false;
+            vector<DBoW2::WordId> vWordIds(nWords);
+            vector<DBoW2::WordValue> vWordValues(nWords);
+            TakeArray(pData, pEnd, vWordIds.data(), nWords);
+            TakeArray(pData, pEnd, vWordValues.data(), nWords);
+            features.mBowVec.reserve(nWords);
+            for (uint64_t i = 0; i < nWords; i++)
+                features.mBowVec.push_back(vWordIds[i], vWordValues[i]);
+
+            uint64_t nNodes;
+            if (!Take(pData, pEnd, nNodes) || nNodes > N)
+                return false;
+            features.mFeatVec.reserve(nNodes, N);
+            vector<unsigned int> vNodeFeatures;
+            for (uint64_t i = 0; i < nNodes; i++)
+            {
+                DBoW2::NodeId nodeId;
+                unsigned int nNodeFeatures;
+                if (!Take(pData, pEnd, nodeId) || !Take(pData, pEnd, nNodeFeatures) || nNodeFeatures > N)
+                    return false;
+                vNodeFeatures.resize(nNodeFeatures);
+                if (!TakeArray(pData, pEnd, vNodeFeatures.data(), nNodeFeatures))
+                    return false;
+                features.mFeatVec.push_back(nodeId, vNodeFeatures.data(), nNodeFeatures);
+            }
+
+            if (!TakeVector(pData, pEnd, features.mvGridOffsets) || !TakeVector(pData, pEnd, features.mvGridIndices))
+                return false;
+
+            uint64_t nIMUData;
+            if (!Take(pData, pEnd, nIMUData) || nIMUData > (uint64_t) (pEnd - pData) / (7 * sizeof(double)))
+                return false;
+            features.mvIMUData.reserve(nIMUData);
+            for (uint64_t i = 0; i < nIMUData; i++)
+            {
+                double g[3], a[3], t;
+                TakeArray(pData, pEnd, g, 3);
+                TakeArray(pData, pEnd, a, 3);
+                Take(pData, pEnd, t);
+                features.mvIMUData.push_back(IMUData(g[0], g[1], g[2], a[0], a[1], a[2], t));
+            }
+
+            return pData == pEnd;
+        }
+
+    } // namespace
+
+
+    size_t KeyFrameFeatures::Bytes() const
+    {
+        size_t nFeatVec = mFeatVec.size() * (sizeof(DBoW2::NodeId) + sizeof(unsigned int));
+        for (size_t i = 0; i < mFeatVec.size(); i++)
+            nFeatVec += mFeatVec.nFeatures(i) * sizeof(unsigned int);
+
+        return (mvKeys.size() + mvKeysUn.size()) * sizeof(cv::KeyPoint) +
+               (mvuRight.size() + mvDepth.size()) * sizeof(float) +
+               (size_t) mDescriptorBlock.Rows() * DescriptorBlock::DESC_SIZE +
+               mBowVec.size() * (sizeof(DBoW2::WordId) + sizeof(DBoW2::WordValue)) + nFeatVec + (mvGridOffsets.size() + mvGridIndices.size()) * sizeof(unsigned int) +
+               mvIMUData.size() * sizeof(IMUData);
+    }
+
+
+    KeyFrameStore::KeyFrameStore() : mbEnabled(false), mnBudgetBytes(0), mnFileBytes(0), mnUseClock(0),
+                                     mnResidentBytes(0), mbEvictionRequested(false), mnSpills(0), mnPageIns(0),
+                                     mTotalPageInMs(0), mMaxPageInMs(0)
+    {
+
+    }
+
+    KeyFrameStore::~KeyFrameStore()
+    {
+        if (mFile.is_open())
+        {
+            mFile.close();
+            remove(mFilename.c_str());
+        }
+    }
+
+    bool KeyFrameStore::Open(const std::string &filename, const size_t nBudgetMB)
+    {
+        unique_lock<mutex> lock(mMutex);
+        mbEnabled = false;
+        if (nBudgetMB == 0)
+            return true;
+
+        mFile.open(filename.c_str(), ios::in | ios::out | ios::binary | ios::trunc);
+        if (!mFile.is_open())
+        {
+            cerr << "Failed to create keyframe store " << filename << endl;
+            return false;
+        }
+
+        mFilename = filename;
+        mnBudgetBytes = nBudgetMB << 20;
+        mnFileBytes = 0;
+        mmFreeExtents.clear();
+        mbEnabled = true;
+        return true;
+    }
+
+    bool KeyFrameStore::IsEnabled()
+    {
+        unique_lock<mutex> lock(mMutex);
+        return mbEnabled;
+    }
+
+    bool KeyFrameStore::Write(const KeyFrameFeatures &features, Record &record)
+    {
+        string s;
+        Serialize(features, s);
+        const uint64_t nSize = s.size();
+
+        // 优先使用删除的记录中大小最接近的，剩余的部分仍然可以使用。
+        uint64_t nOffset;
+        {
+            unique_lock<mutex> lock(mMutex);
+            if (!mbEnabled)
+                return false;
+
+            multimap<uint64_t, uint64_t>::iterator it = mmFreeExtents.lower_bound(nSize);
+            if (it != mmFreeExtents.end())
+            {
+                nOffset = it->second;
+                if (it->first > nSize)
+                    mmFreeExtents.insert(make_pair(it->first - nSize, nOffset + nSize));
+                mmFreeExtents.erase(it);
+            }
+            else
+            {
+                nOffset = mnFileBytes;
+                mnFileBytes += nSize;
+            }
+        }
+
+        {
+            unique_lock<mutex> lock(mMutexFile);
+            mFile.seekp((streamoff) nOffset);
+            mFile.write(s.data(), (streamsize) nSize);
+            mFile.flush();
+            if (!mFile)
+            {
+                cerr << "Failed to write keyframe store " << mFilename << endl;
+                mFile.clear();
+                lock.unlock();
+
+                Record failed;
+                failed.nOffset = nOffset;
+                failed.nSize = nSize;
+                Release(failed);
+                return false;
+            }
+        }
+
+        record.nOffset = nOffset;
+        record.nSize = nSize;
+
+        unique_lock<mutex> lock(mMutex);
+        mnSpills++;
+        return true;
+    }
+
+    std::shared_ptr<KeyFrameFeatures> KeyFrameStore::Read(const Record &record)
+    {
+        if (record.nSize == 0)
+            return std::shared_ptr<KeyFrameFeatures>();
+
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+        vector<char> vBuffer(record.nSize);
+        {
+            unique_lock<mutex> lock(mMutexFile);
+            mFile.seekg((streamoff) record.nOffset);
+            mFile.read(vBuffer.data(), (streamsize) record.nSize);
+            if (!mFile)
+            {
+                mFile.clear();
+                return std::shared_ptr<KeyFrameFeatures>();
+            }
+        }
+
+        std::shared_ptr<KeyFrameFeatures> pFeatures = std::make_shared<KeyFrameFeatures>();
+        if (!Deserialize(vBuffer.data(), vBuffer.data() + vBuffer.size(), *pFeatures))
+            return std::shared_ptr<KeyFrameFeatures>();
+
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+        const double ms = std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t2 - t1).count();
+
+        unique_lock<mutex> lock(mMutex);
+        mnPageIns++;
+        mTotalPageInMs += ms;
+        mMaxPageInMs = max(mMaxPageInMs, ms);
+        return pFeatures;
+    }
+
+    bool KeyFrameStore::ReadDescriptor(const Record &record, const size_t idx, uchar *pDescriptor)
+    {
+        const uint64_t nOffset = DESCRIPTOR_OFFSET + (uint64_t) idx * DescriptorBlock::DESC_SIZE;
+        if (nOffset + DescriptorBlock::DESC_SIZE > record.nSize)
+            return false;
+
+        unique_lock<mutex> lock(mMutexFile);
+        mFile.seekg((streamoff) (record.nOffset + nOffset));
+        mFile.read(reinterpret_cast<char *>(pDescriptor), DescriptorBlock::DESC_SIZE);
+        if (!mFile)
+        {
+            mFile.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void KeyFrameStore::Release(Record &record)
+    {
+        if (record.nSize == 0)
+            return;
+
+        {
+            unique_lock<mutex> lock(mMutex);
+            if (record.nOffset + record.nSize == mnFileBytes)
+                mnFileBytes = record.nOffset;
+            else
+                mmFreeExtents.insert(make_pair(record.nSize, record.nOffset));
+        }
+        record = Record();
+    }
+
+    void KeyFrameStore::AddResident(const long nBytes)
+    {
+        unique_lock<mutex> lock(mMutex);
+        mnResidentBytes += nBytes;
+        if (nBytes > 0 && mbEnabled && mnResidentBytes > (long) mnBudgetBytes)
+            mbEvictionRequested = true;
+    }
+
+    bool KeyFrameStore::EvictionRequested()
+    {
+        unique_lock<mutex> lock(mMutex);
+        return mbEvictionRequested;
+    }
+
+    bool KeyFrameStore::OverBudget()
+    {
+        unique_lock<mutex> lock(mMutex);
+        return mbEnabled && mnResidentBytes > (long) mnBudgetBytes;
+    }
+
+    void KeyFrameStore::Evict(KeyFrame *pCurrentKF, const std::vector<KeyFrame *> &vpKFs)
+    {
+        {
+            unique_lock<mutex> lock(mMutex);
+            mbEvictionRequested = false;
+        }
+        if (!OverBudget())
+            return;
+
+        // 没有当前关键帧时(只定位模式、全局BA后)保护最新的关键帧。
+        if (!pCurrentKF)
+        {
+            for (size_t i = 0; i < vpKFs.size(); i++)
+            {
+                if (!vpKFs[i]->isBad() && (!pCurrentKF || vpKFs[i]->mnId > pCurrentKF->mnId))
+                    pCurrentKF = vpKFs[i];
+            }
+        }
+
+        // 当前局部地图中的关键帧：当前关键帧、共视关键帧和前面的若干个关键帧(IMU预积分)。
+        set<KeyFrame *> spLocalKFs;
+        if (pCurrentKF)
+        {
+            spLocalKFs.insert(pCurrentKF);
+            const vector<KeyFrame *> vpCovisibleKFs = pCurrentKF->GetVectorCovisibleKeyFrames();
+            spLocalKFs.insert(vpCovisibleKFs.begin(), vpCovisibleKFs.end());
+
+            KeyFrame *pPrevKF = pCurrentKF->GetPrevKeyFrame();
+            for (int i = 0; i < PROTECTED_PREV_KEYFRAMES && pPrevKF; i++)
+            {
+                spLocalKFs.insert(pPrevKF);
+                pPrevKF = pPrevKF->GetPrevKeyFrame();
+            }
+        }
+
+        // 其他关键帧按最后一次使用的先后排序。
+        vector<pair<unsigned long, KeyFrame *> > vCandidates;
+        vCandidates.reserve(vpKFs.size());
+        for (size_t i = 0; i < vpKFs.size(); i++)
+        {
+            KeyFrame *pKF = vpKFs[i];
+            if (pKF->isBad() || spLocalKFs.count(pKF) || !pKF->IsFeaturesResident())
+                continue;
+            vCandidates.push_back(make_pair(pKF->GetLastFeatureUse(), pKF));
+        }
+        sort(vCandidates.begin(), vCandidates.end(),
+             [](const pair<unsigned long, KeyFrame *> &a, const pair<unsigned long, KeyFrame *> &b)
+             {
+                 return a.first < b.first || (a.first == b.first && a.second->mnId < b.second->mnId);
+             });
+
+        // 换出到预算的90%，不需要每个关键帧都换出。
+        const long nTarget = (long) (mnBudgetBytes / 10 * 9);
+        for (size_t i = 0; i < vCandidates.size(); i++)
+        {
+            {
+                unique_lock<mutex> lock(mMutex);
+                if (mnResidentBytes <= nTarget)
+                    break;
+            }
+            vCandidates[i].second->SpillFeatures();
+        }
+    }
+
+    void KeyFrameStore::GetStats(size_t &nResidentBytes, size_t &nFileBytes, unsigned long &nSpills,
+                                 unsigned long &nPageIns, double &meanPageInMs, double &maxPageInMs)
+    {
+        unique_lock<mutex> lock(mMutex);
+        nResidentBytes = mnResidentBytes > 0 ? (size_t) mnResidentBytes : 0;
+        nFileBytes = mnFileBytes;
+        nSpills = mnSpills;
+        nPageIns = mnPageIns;
+        meanPageInMs = mnPageIns > 0 ? mTotalPageInMs / mnPageIns : 0;
+        maxPageInMs = mMaxPageInMs;
+    }
+
+} //namespace ORB_SLAM2
@@ -53,12 +53,13 @@ namespace ORB_SLAM2
             }
             else
             {
-                // 清空IMU预积分数据
-                mIMUPreInt.reset();
-
+                // 没有IMU数据(或关键帧的特征数据读取失败)时保留关键帧的预积分
                 if (mvIMUData.empty())
                     return;
 
+                // 清空IMU预积分数据
+                mIMUPreInt.reset();
+
                 // 考虑上一帧关键帧和第一个IMU数据的预积分
                 {
                     const IMUData &imu = mvIMUData.front();
@@ -164,6 +165,14 @@ namespace ORB_SLAM2
         return mRwiInit.clone();
     }
 
+    void LocalMapping::SetVINSInitState(const cv::Mat &gw, const cv::Mat &Rwi)
+    {
+        mGravityVec = gw.clone();
+        mRwiInit = Rwi.clone();
+        mnVINSInitScale = 1.0;
+        SetVINSInited(true);
+    }
+
 
     // 初始化VINS线程，在System中开启
     void LocalMapping::VINSInitThread()
@@ -171,6 +180,9 @@ namespace ORB_SLAM2
         unsigned long initedid = 0;
         cerr << "start VINSInitThread" << endl;
 
+        // 每次循环之后不再持有地图对象。
+        EpochManager::Registration epoch(&mpMap->mEpochManager);
+
         // 创建关键帧之后开始初始化
         while (1)
         {
@@ -187,6 +199,8 @@ namespace ORB_SLAM2
                     }
                 }
 
+            epoch.Quiesce();
+
             usleep(3000);
 
             if (isFinished())
@@ -913,6 +927,34 @@ namespace ORB_SLAM2
     }
 
 
+    // 去掉局部建图线程保存的坏点云和坏关键帧，之后它们可以被释放(Map.ReclaimMemory为0时不执行)。
+    void LocalMapping::EraseBadObjects()
+    {
+        EpochManager &epoch = mpMap->mEpochManager;
+        if (!epoch.IsEnabled())
+            return;
+
+        // 等待处理的关键帧包含Tracking创建时已经变坏的点云，处理之前可能经过很多epoch。
+        list<KeyFrame *> lNewKeyFrames;
+        {
+            unique_lock<mutex> lock(mMutexNewKFs);
+            lNewKeyFrames = mlNewKeyFrames;
+        }
+        for (list<KeyFrame *>::iterator lit = lNewKeyFrames.begin(), lend = lNewKeyFrames.end(); lit != lend; lit++)
+            (*lit)->EraseBadMapPointMatches();
+
+        // 上次检查之后没有新的坏对象。
+        const unsigned long nRetired = epoch.RetiredCount();
+        if (nRetired == mnLastRetiredCount)
+            return;
+
+        mlpRecentAddedMapPoints.remove_if([](MapPoint *pMP) { return pMP->isBad(); });
+        DeleteBadInLocalWindow();
+
+        mnLastRetiredCount = nRetired;
+    }
+
+
     // 删除LocalWindow中的坏KF
     void LocalMapping::DeleteBadInLocalWindow(void)
     {
@@ -958,6 +1000,8 @@ namespace ORB_SLAM2
         mbCopyInitKFs = false;
         mbInitGBAFinish = false;
 
+        mnLastRetiredCount = 0;
+
     }
 
     // 设置进程间的对象指针，用于数据交互。
@@ -987,6 +1031,9 @@ namespace ORB_SLAM2
 
         mbFinished = false;
 
+        // 在循环中去掉保存的坏对象后告知EpochManager。
+        EpochManager::Registration epoch(&mpMap->mEpochManager);
+
         while (1)
         {
 
@@ -1060,6 +1107,10 @@ namespace ORB_SLAM2
                 if (GetFlagInitGBAFinish())
                     mpLoopCloser->InsertKeyFrame(mpCurrentKeyFrame);
 
+                // 步骤6 关键帧的特征数据超过内存预算时，换出不在当前局部地图中、最久没有使用的关键帧。
+                if (mpMap->mKeyFrameStore.IsEnabled())
+                    mpMap->mKeyFrameStore.Evict(mpCurrentKeyFrame, mpMap->GetAllKeyFrames());
+
             }   // 当前关键帧队列不为空。
 
                 // 停止Local Mapping
@@ -1068,6 +1119,13 @@ namespace ORB_SLAM2
                 // 收到停止请求，但是进程没有完成。
                 while (isStopped() && !CheckFinish())
                 {
+                    // 只定位模式和全局BA时读入的特征数据超过预算后换出。
+                    if (mpMap->mKeyFrameStore.EvictionRequested())
+                        mpMap->mKeyFrameStore.Evict(NULL, mpMap->GetAllKeyFrames());
+
+                    EraseBadObjects();
+                    epoch.Quiesce();
+
                     // 延时3000us
                     std::this_thread::sleep_for(std::chrono::milliseconds(3));
                 }
@@ -1079,9 +1137,17 @@ namespace ORB_SLAM2
             // 是否进行重置。
             ResetIfRequested();
 
+            // 没有新的关键帧时，重定位、闭环和全局BA读入的特征数据超过预算后换出。
+            if (mpMap->mKeyFrameStore.EvictionRequested())
+                mpMap->mKeyFrameStore.Evict(NULL, mpMap->GetAllKeyFrames());
+
             // 设置线程空闲，用于Tracking查看。
             SetAcceptKeyFrames(true);
 
+            // 不再持有坏对象，它们可以被释放。
+            EraseBadObjects();
+            epoch.Quiesce();
+
             // 进程完成。
             if (CheckFinish())
                 break;
@@ -1134,11 +1200,12 @@ namespace ORB_SLAM2
         }
 
         // 步骤2 计算当前关键帧的BoW向量。
-        mpCurrentKeyFrame->ComputeBoW();
+        mpCurrentKeyFrame->ComputeBoW(mpTracker->GetThreadPool());
 
         // 步骤3 跟踪局部地图过程中新的MapPoints和当前关键帧关联起来。
         // TrackLocalMap()只对局部地图中的MapPoints与当前关键帧进行了匹配，保存了匹配点云，但没有更新MP的属性。
         const vector<MapPoint *> vpMapPointMatches = mpCurrentKeyFrame->GetMapPointMatches();
+        const bool bReclaim = mpMap->mEpochManager.IsEnabled();
 
         for (size_t i = 0; i < vpMapPointMatches.size(); i++)
         {
@@ -1164,6 +1231,11 @@ namespace ORB_SLAM2
                         mlpRecentAddedMapPoints.push_back(pMP);
                     }
                 }
+                    // Tracking创建关键帧时已经变坏的点云，没有观测关系，之后不会从关键帧中删除。回收时在这里删除。
+                else if (bReclaim)
+                {
+                    mpCurrentKeyFrame->EraseMapPointMatch(i);
+                }
             }
         }
 
@@ -1268,6 +1340,11 @@ namespace ORB_SLAM2
 
         const float ratioFactor = 1.5f * mpCurrentKeyFrame->mfScaleFactor;
 
+        // 当前关键帧的特征点、右目坐标和深度
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures1 = mpCurrentKeyFrame->GetFeatures();
+        if (!pFeatures1)
+            return;
+
         int nnew = 0;
 
         // 极线搜索，匹配约束，三角化。
@@ -1314,6 +1391,10 @@ namespace ORB_SLAM2
             vector<pair<size_t, size_t> > vMatchedIndices;    // 存储两关键帧新的特征匹配点的索引。
             matcher.SearchForTriangulation(mpCurrentKeyFrame, pKF2, F12, vMatchedIndices, false);
 
+            const std::shared_ptr<const KeyFrameFeatures> pFeatures2 = pKF2->GetFeatures();
+            if (!pFeatures2)
+                continue;
+
             cv::Mat Rcw2 = pKF2->GetRotation();
             cv::Mat Rwc2 = Rcw2.t();
             cv::Mat tcw2 = pKF2->GetTranslation();
@@ -1341,15 +1422,15 @@ namespace ORB_SLAM2
                 const int &idx2 = vMatchedIndices[ikp].second;
 
                 // 当前匹配特征点在当前关键帧中的特征点。
-                const cv::KeyPoint &kp1 = mpCurrentKeyFrame->mvKeysUn[idx1];
+                const cv::KeyPoint &kp1 = pFeatures1->mvKeysUn[idx1];
                 // mvuRight存放着双目的深度值，如果不是双目，为-1。
-                const float kp1_ur = mpCurrentKeyFrame->mvuRight[idx1];
+                const float kp1_ur = pFeatures1->mvuRight[idx1];
                 bool bStereo1 = kp1_ur >= 0;
 
                 // 当前匹配对在邻接关键帧中的特征点。
-                const cv::KeyPoint &kp2 = pKF2->mvKeysUn[idx2];
+                const cv::KeyPoint &kp2 = pFeatures2->mvKeysUn[idx2];
                 // mvuRight存放双目深度，不是双目时，为-1。
-                const float kp2_ur = pKF2->mvuRight[idx2];
+                const float kp2_ur = pFeatures2->mvuRight[idx2];
                 bool bStereo2 = kp2_ur >= 0;
 
                 // 步骤6.2 利用匹配点反投影得到视角差。
@@ -1369,9 +1450,9 @@ namespace ORB_SLAM2
 
                 // 步骤6.3 对于双目，利用双目得到视差角。
                 if (bStereo1)  // 双目，有深度。
-                    cosParallaxStereo1 = cos(2 * atan2(mpCurrentKeyFrame->mb / 2, mpCurrentKeyFrame->mvDepth[idx1]));
+                    cosParallaxStereo1 = cos(2 * atan2(mpCurrentKeyFrame->mb / 2, pFeatures1->mvDepth[idx1]));
                 else if (bStereo2) // 双目，有深度。
-                    cosParallaxStereo2 = cos(2 * atan2(pKF2->mb / 2, pKF2->mvDepth[idx2]));
+                    cosParallaxStereo2 = cos(2 * atan2(pKF2->mb / 2, pFeatures2->mvDepth[idx2]));
 
                 // 得到双目观测的视差角。
                 cosParallaxStereo = min(cosParallaxStereo1, cosParallaxStereo2);
@@ -1839,6 +1920,9 @@ namespace ORB_SLAM2
 
             // 步骤2 提取每个共视关键帧的MapPoints。
             const vector<MapPoint *> vpMapPoints = pKF->GetMapPointMatches();
+            const std::shared_ptr<const KeyFrameFeatures> pFeatures = pKF->GetFeatures();
+            if (!pFeatures)
+                continue;
 
             // 设置阈值。
             int nObs = 2;
@@ -1859,7 +1943,7 @@ namespace ORB_SLAM2
                         // 双目，只考虑近处的MapPoints，
                         if (!mbMonocular)
                         {
-                            if (pKF->mvDepth[i] > pKF->mThDepth || pKF->mvDepth[i] < 0)
+                            if (pFeatures->mvDepth[i] > pKF->mThDepth || pFeatures->mvDepth[i] < 0)
                                 continue;
                         }
 
@@ -1868,28 +1952,27 @@ namespace ORB_SLAM2
                         // MapPoints至少被3个关键帧观测到。
                         if (pMP->Observations() > thObs)
                         {
-                            const int &scaleLevel = pKF->mvKeysUn[i].octave;
-                            const mapMapPointObs/*map<KeyFrame *, size_t>*/ observations = pMP->GetObservations();
+                            const int &scaleLevel = pFeatures->mvKeysUn[i].octave;
                             // 判断该MapPoint是否同时被三个尺度更好关键帧观测到。
                             int nObs = 0;
 
-                            // 遍历所有观测到MP的关键帧。
-                            for (mapMapPointObs/*map<KeyFrame *, size_t>*/::const_iterator mit = observations.begin(), mend = observations.end();
+                            // 遍历所有观测到MP的关键帧。其他关键帧的特征点可能需要从磁盘读入，
+                            // 拷贝观测后在地图点的锁外读取。
+                            const mapMapPointObs observations = pMP->GetObservations();
+                            for (mapMapPointObs::const_iterator mit = observations.begin(), mend = observations.end();
                                  mit != mend; mit++)
                             {
                                 KeyFrame *pKFi = mit->first;
                                 if (pKFi == pKF)
                                     continue;
-                                const int &scaleLeveli = pKFi->mvKeysUn[mit->second].octave;
+                                const std::shared_ptr<const KeyFrameFeatures> pFeaturesi = pKFi->GetFeatures();
+                                if (!pFeaturesi)
+                                    continue;
+                                const int &scaleLeveli = pFeaturesi->mvKeysUn[mit->second].octave;
 
                                 // 尺度约束，要求MapPoints在关键帧pKFi的特征尺度近似于关键帧pKF的特征尺度。
                                 if (scaleLeveli <= scaleLevel + 1)
-                                {
                                     nObs++;
-                                    // 已经找到三个相同尺度的关键帧可以观测到MapPoint，不需要再找。
-                                    if (nObs >= thObs)
-                                        break;
-                                }
                             }   // 遍历可观测到该MP的关键帧。
 
                             // 被三个更好尺度的关键帧观测到的点云数量+1。
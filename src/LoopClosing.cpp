@@ -46,6 +46,7 @@ namespace ORB_SLAM2
         mpParams = pParams;
         mnCovisibilityConsistencyTh = 3;
         // mpMatchedKF = NULL;
+        mnLastRetiredCount = 0;
     }
 
     // 设置线程间对象的指针变量。
@@ -64,6 +65,9 @@ namespace ORB_SLAM2
     {
         mbFinished = false;
 
+        // 在循环中去掉保存的坏关键帧后告知EpochManager。
+        EpochManager::Registration epoch(&mpMap->mEpochManager);
+
         while (1)
         {
             // 检测LocalMapping发来的关键帧队列mlpLoopKeyFrameQueue是否为空。
@@ -87,6 +91,10 @@ namespace ORB_SLAM2
             // 如果收到重置申请，进行重置。
             ResetIfRequested();
 
+            // 不再持有坏对象，它们可以被释放。
+            EraseBadObjects();
+            epoch.Quiesce();
+
             if (CheckFinish())
                 break;
             // 延时5000us。
@@ -142,14 +150,24 @@ namespace ORB_SLAM2
 
         // 步骤2 遍历所有共视关键帧，计算当前关键帧与每个共视关键帧的BoW相似得分，得到最低分minScore。
         const vector<KeyFrame *> vpConnectedKeyFrames = mpCurrentKF->GetVectorCovisibleKeyFrames();
-        const DBoW2::BowVector &CurrentBowVec = mpCurrentKF->mBowVec;
+        const std::shared_ptr<const KeyFrameFeatures> pCurrentFeatures = mpCurrentKF->GetFeatures();
+        if (!pCurrentFeatures)
+        {
+            mpKeyFrameDB->add(mpCurrentKF);
+            mpCurrentKF->SetErase();
+            return false;
+        }
+        const DBoW2::FlatBowVector &CurrentBowVec = pCurrentFeatures->mBowVec;
         float minScore = 1;
         for (size_t i = 0; i < vpConnectedKeyFrames.size(); i++)
         {
             KeyFrame *pKF = vpConnectedKeyFrames[i];
             if (pKF->isBad())
                 continue;
-            const DBoW2::BowVector &BowVec = pKF->mBowVec;
+            const std::shared_ptr<const KeyFrameFeatures> pFeatures = pKF->GetFeatures();
+            if (!pFeatures)
+                continue;
+            const DBoW2::FlatBowVector &BowVec = pFeatures->mBowVec;
 
             float score = mpORBVocabulary->score(CurrentBowVec, BowVec);
 
@@ -794,17 +812,55 @@ namespace ORB_SLAM2
         if (mbResetRequested)
         {
             mlpLoopKeyFrameQueue.clear();
+            mvConsistentGroups.clear();
             mLastLoopKFid = 0;
             mbResetRequested = false;
         }
 
     }
 
+
+    // 去掉闭环检测线程保存的坏关键帧，之后它们可以被释放(Map.ReclaimMemory为0时不执行)。
+    // 一致组只比较指针，释放后新关键帧可能使用相同的地址，也要去掉。
+    void LoopClosing::EraseBadObjects()
+    {
+        EpochManager &epoch = mpMap->mEpochManager;
+        if (!epoch.IsEnabled())
+            return;
+
+        // 上次检查之后没有新的坏对象。
+        const unsigned long nRetired = epoch.RetiredCount();
+        if (nRetired == mnLastRetiredCount)
+            return;
+
+        {
+            unique_lock<mutex> lock(mMutexLoopQueue);
+            mlpLoopKeyFrameQueue.remove_if([](KeyFrame *pKF) { return pKF->isBad(); });
+        }
+
+        for (size_t iG = 0; iG < mvConsistentGroups.size(); iG++)
+        {
+            set<KeyFrame *> &sGroup = mvConsistentGroups[iG].first;
+            for (set<KeyFrame *>::iterator sit = sGroup.begin(); sit != sGroup.end();)
+            {
+                if ((*sit)->isBad())
+                    sit = sGroup.erase(sit);
+                else
+                    sit++;
+            }
+        }
+
+        mnLastRetiredCount = nRetired;
+    }
+
     // 运行全局BA，在单独的线程中。
     void LoopClosing::RunGlobalBundleAdjustment(unsigned long nLoopKF)
     {
         std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
+        // 全局BA期间持有所有关键帧和点云，结束前坏对象都不能释放。
+        EpochManager::Registration epoch(&mpMap->mEpochManager);
+
         cout << "Starting Global Bundle Adjustment " << endl;
 
         int idx = mnFullBAIdx;
@@ -898,7 +954,8 @@ namespace ORB_SLAM2
                 }
 
                 // 校正地图点云。
-                const vector<MapPoint *> vpMPs = mpMap->GetAllMapPoints();
+                const SlotMap<MapPoint>::Snapshot pvpMPs = mpMap->GetMapPointsSnapshot();
+                const vector<MapPoint *> &vpMPs = *pvpMPs;
 
                 for (size_t i = 0; i < vpMPs.size(); i++)
                 {
@@ -9,30 +9,24 @@ namespace ORB_SLAM2
 
     /***************VI SLAM*******************/
 
-    // 谓词
-    bool KFIdComapre::operator()(const KeyFrame *kfleft, const KeyFrame *kfright) const
-    {
-        return kfleft->mnId < kfright->mnId;
-    }
-
-
     void Map::UpdateScale(const double &scale)
     {
         unique_lock<mutex> lock(mMutexMapUpdate);
 
-        for (std::set<KeyFrame *, KFIdComapre>::iterator sit = mspKeyFrames.begin(), send = mspKeyFrames.end();
-             sit != send; sit++)
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = GetKeyFramesSnapshot();
+        for (std::vector<KeyFrame *>::const_iterator vit = pvpKFs->begin(), vend = pvpKFs->end(); vit != vend; vit++)
         {
-            KeyFrame *pKF = *sit;
+            KeyFrame *pKF = *vit;
             cv::Mat Tcw = pKF->GetPose();
             cv::Mat tcw = Tcw.rowRange(0, 3).col(3) * scale;
             tcw.copyTo(Tcw.rowRange(0, 3).col(3));
             pKF->SetPose(Tcw);
         }
 
-        for (std::set<MapPoint *>::iterator sit = mspMapPoints.begin(), send = mspMapPoints.end(); sit != send; sit++)
+        const SlotMap<MapPoint>::Snapshot pvpMPs = GetMapPointsSnapshot();
+        for (std::vector<MapPoint *>::const_iterator vit = pvpMPs->begin(), vend = pvpMPs->end(); vit != vend; vit++)
         {
-            MapPoint *pMP = *sit;
+            MapPoint *pMP = *vit;
             pMP->UpdateScale(scale);
         }
 
@@ -56,7 +50,7 @@ namespace ORB_SLAM2
     void Map::AddKeyFrame(KeyFrame *pKF)
     {
         unique_lock<mutex> lock(mMutexMap);
-        mspKeyFrames.insert(pKF);
+        mKeyFrames.Insert(pKF);
         if (pKF->mnId > mnMaxKFid)
             mnMaxKFid = pKF->mnId;
     }
@@ -65,7 +59,7 @@ namespace ORB_SLAM2
     void Map::AddMapPoint(MapPoint *pMP)
     {
         unique_lock<mutex> lock(mMutexMap);
-        mspMapPoints.insert(pMP);
+        mMapPoints.Insert(pMP);
     }
 
     // 从地图中剔除地图点云 pMP。
@@ -73,14 +67,14 @@ namespace ORB_SLAM2
     {
         unique_lock<mutex> lock(mMutexMap);
         // 剔除指针。
-        mspMapPoints.erase(pMP);
+        mMapPoints.Erase(pMP);
     }
 
     // 从地图中剔除关键帧 pKF。
     void Map::EraseKeyFrame(KeyFrame *pKF)
     {
         unique_lock<mutex> lock(mMutexMap);
-        mspKeyFrames.erase(pKF);
+        mKeyFrames.Erase(pKF);
     }
 
     // 设置参考MapPoint，用于DrawMapPoint()画图。
@@ -94,28 +88,55 @@ namespace ORB_SLAM2
     vector<KeyFrame *> Map::GetAllKeyFrames()
     {
         unique_lock<mutex> lock(mMutexMap);
-        return vector<KeyFrame *>(mspKeyFrames.begin(), mspKeyFrames.end());
+        return mKeyFrames.GetAll();
     }
 
     // 获取地图的所有MapPoints。
     vector<MapPoint *> Map::GetAllMapPoints()
     {
         unique_lock<mutex> lock(mMutexMap);
-        return vector<MapPoint *>(mspMapPoints.begin(), mspMapPoints.end());
+        return mMapPoints.GetAll();
+    }
+
+    // 获取关键帧的快照。
+    SlotMap<KeyFrame>::Snapshot Map::GetKeyFramesSnapshot()
+    {
+        // 在GetSnapshot内部加锁，排序和合并不占用mMutexMap
+        return mKeyFrames.GetSnapshot(mMutexMap);
+    }
+
+    // 获取MapPoints的快照。
+    SlotMap<MapPoint>::Snapshot Map::GetMapPointsSnapshot()
+    {
+        return mMapPoints.GetSnapshot(mMutexMap);
+    }
+
+    // 按id获取关键帧。
+    KeyFrame *Map::GetKeyFrame(const long unsigned int id)
+    {
+        unique_lock<mutex> lock(mMutexMap);
+        return mKeyFrames.Get(id);
+    }
+
+    // 按id获取MapPoint。
+    MapPoint *Map::GetMapPoint(const long unsigned int id)
+    {
+        unique_lock<mutex> lock(mMutexMap);
+        return mMapPoints.Get(id);
     }
 
     // 获取地图中的点云数量。
     long unsigned int Map::MapPointsInMap()
     {
         unique_lock<mutex> lock(mMutexMap);
-        return mspMapPoints.size();
+        return mMapPoints.Size();
     }
 
     // 获取地图中关键帧数量。
     long unsigned int Map::KeyFramesInMap()
     {
         unique_lock<mutex> lock(mMutexMap);
-        return mspKeyFrames.size();
+        return mKeyFrames.Size();
     }
 
     // 获取地图中所有参考MapPoints。
@@ -136,15 +157,22 @@ namespace ORB_SLAM2
     void Map::clear()
     {
         // 释放MapPoints的内存。
-        for (set<MapPoint *>::iterator sit = mspMapPoints.begin(), send = mspMapPoints.end(); sit != send; sit++)
-            delete *sit;
+        mMapPoints.ForEach([](MapPoint *pMP) { delete pMP; });
 
         // 释放KeyFrame的内存。
-        for (set<KeyFrame *>::iterator sit = mspKeyFrames.begin(), send = mspKeyFrames.end(); sit != send; sit++)
-            delete *sit;
-
-        mspMapPoints.clear();
-        mspKeyFrames.clear();
+        mKeyFrames.ForEach([](KeyFrame *pKF) { delete pKF; });
+
+        // 释放已经剔除、等待回收的MapPoints和KeyFrame，各线程已经重置。
+        vector<MapPoint *> vpRetiredMPs;
+        vector<KeyFrame *> vpRetiredKFs;
+        mEpochManager.CollectAll(vpRetiredMPs, vpRetiredKFs);
+        for (size_t i = 0; i < vpRetiredMPs.size(); i++)
+            delete vpRetiredMPs[i];
+        for (size_t i = 0; i < vpRetiredKFs.size(); i++)
+            delete vpRetiredKFs[i];
+
+        mMapPoints.Clear();
+        mKeyFrames.Clear();
         mnMaxKFid = 0;
         mvpReferenceMapPoints.clear();
         mvpKeyFrameOrigins.clear();
@@ -29,7 +29,9 @@ namespace ORB_SLAM2
     // 绘制地图中的点云。
     void MapDrawer::DrawMapPoints()
     {
-        const vector<MapPoint *> &vpMPs = mpMap->GetAllMapPoints();
+        // 地图没有变化时快照不拷贝。
+        const SlotMap<MapPoint>::Snapshot pvpMPs = mpMap->GetMapPointsSnapshot();
+        const vector<MapPoint *> &vpMPs = *pvpMPs;
         const vector<MapPoint *> &vpRefMPs = mpMap->GetReferenceMapPoints();
 
         set<MapPoint *> spRefMPs(vpRefMPs.begin(), vpRefMPs.end());
@@ -77,7 +79,8 @@ namespace ORB_SLAM2
         const float h = w * 0.75;
         const float z = w * 0.6;
 
-        const vector<KeyFrame *> vpKFs = mpMap->GetAllKeyFrames();
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = mpMap->GetKeyFramesSnapshot();
+        const vector<KeyFrame *> &vpKFs = *pvpKFs;
 
         if (bDrawKF)
         {
@@ -3,6 +3,7 @@
 
 #include "MapPoint.h"
 #include "ORBmatcher.h"
+#include "Converter.h"
 
 #include <mutex>
 
@@ -15,13 +16,6 @@ namespace ORB_SLAM2
     mutex MapPoint::mGlobalMutex;
 
 
-    // VI SLAM
-    bool cmpKeyFrameId::operator()(const KeyFrame *a, const KeyFrame *b) const
-    {
-        return a->mnId < b->mnId;
-    }
-
-
     /*
     * 给定坐标与KeyFrame构造MapPoint。
     *   双目： StereoInitialization()，CreateNewKeyFrame()，LocalMapping::CreateNewMapPoints()。
@@ -30,11 +24,10 @@ namespace ORB_SLAM2
     MapPoint::MapPoint(const cv::Mat &Pos, KeyFrame *pRefKF, Map *pMap) :
             mnFirstKFid(pRefKF->mnId), mnFirstFrame(pRefKF->mnFrameId), nObs(0), mnTrackReferenceForFrame(0),
             mnLastFrameSeen(0), mnBALocalForKF(0), mnFuseCandidateForKF(0), mnLoopPointForKF(0), mnCorrectedByKF(0),
-            mnCorrectedReference(0), mnBAGlobalForKF(0), mpRefKF(pRefKF), mnVisible(1), mnFound(1), mbBad(false),
-            mpReplaced(static_cast<MapPoint *>(NULL)), mfMinDistance(0), mfMaxDistance(0), mpMap(pMap)
+            mnCorrectedReference(0), mnBAGlobalForKF(0), mnMedoidBytes(0), mpRefKF(pRefKF), mnVisible(1), mnFound(1),
+            mbBad(false), mpReplaced(static_cast<MapPoint *>(NULL)), mpMap(pMap)
     {
-        Pos.copyTo(mWorldPos);
-        mNormalVector = cv::Mat::zeros(3, 1, CV_32F);
+        SetGeometry(Converter::toVector3f(Pos), Eigen::Vector3f::Zero(), 0, 0);
 
         // MapPoint在Tracking或Local Mapping线程创建，此处mutex防止id冲突。
         unique_lock<mutex> lock(mpMap->mMutexPointCreation);
@@ -42,6 +35,20 @@ namespace ORB_SLAM2
     }
 
 
+    // 加载地图时使用。
+    MapPoint::MapPoint(const cv::Mat &Pos, Map *pMap, const long int &nFirstKFid, const long int &nFirstFrame) :
+            mnFirstKFid(nFirstKFid), mnFirstFrame(nFirstFrame), nObs(0), mnTrackReferenceForFrame(0),
+            mnLastFrameSeen(0), mnBALocalForKF(0), mnFuseCandidateForKF(0), mnLoopPointForKF(0), mnCorrectedByKF(0),
+            mnCorrectedReference(0), mnBAGlobalForKF(0), mnMedoidBytes(0), mpRefKF(static_cast<KeyFrame *>(NULL)),
+            mnVisible(1), mnFound(1), mbBad(false), mpReplaced(static_cast<MapPoint *>(NULL)), mpMap(pMap)
+    {
+        SetGeometry(Converter::toVector3f(Pos), Eigen::Vector3f::Zero(), 0, 0);
+
+        unique_lock<mutex> lock(mpMap->mMutexPointCreation);
+        mnId = nNextId++;
+    }
+
+
     /*
     * 给定坐标与Frame创建MapPing。
     *   双目： UpdateLastFrame()*
@@ -49,26 +56,26 @@ namespace ORB_SLAM2
     MapPoint::MapPoint(const cv::Mat &Pos, Map *pMap, Frame *pFrame, const int &idxF) :
             mnFirstKFid(-1), mnFirstFrame(pFrame->mnId), nObs(0), mnTrackReferenceForFrame(0), mnLastFrameSeen(0),
             mnBALocalForKF(0), mnFuseCandidateForKF(0), mnLoopPointForKF(0), mnCorrectedByKF(0),
-            mnCorrectedReference(0), mnBAGlobalForKF(0), mpRefKF(static_cast<KeyFrame *>(NULL)), mnVisible(1),
-            mnFound(1), mbBad(false), mpReplaced(NULL), mpMap(pMap)
+            mnCorrectedReference(0), mnBAGlobalForKF(0), mnMedoidBytes(0), mpRefKF(static_cast<KeyFrame *>(NULL)),
+            mnVisible(1), mnFound(1), mbBad(false), mpReplaced(NULL), mpMap(pMap)
     {
-        Pos.copyTo(mWorldPos);
-        cv::Mat Ow = pFrame->GetCameraCenter();
+        const Eigen::Vector3f WorldPos = Converter::toVector3f(Pos);
         // 世界坐标系下，相机指向3D点的向量。
-        mNormalVector = mWorldPos - Ow;
-        mNormalVector = mNormalVector / cv::norm(mNormalVector);  // 归一化，单位向量。
+        const Eigen::Vector3f PC = WorldPos - pFrame->mOwEig;
+        const float dist = PC.norm();
 
-        cv::Mat PC = Pos - Ow;
-        const float dist = cv::norm(PC);
-        const int level = pFrame->mvKeysUn[idxF].octave;
+        const int level = pFrame->mpFeatures->mvKeysUn[idxF].octave;
         const float levelScaleFactor = pFrame->mvScaleFactors[level];
         const int nLevels = pFrame->mnScaleLevels;
 
-        mfMaxDistance = dist * levelScaleFactor;
-        mfMinDistance = mfMaxDistance / pFrame->mvScaleFactors[nLevels - 1];
+        const float fMaxDistance = dist * levelScaleFactor;
+        const float fMinDistance = fMaxDistance / pFrame->mvScaleFactors[nLevels - 1];
+
+        // 平均观测方向为归一化的单位向量。
+        SetGeometry(WorldPos, PC / dist, fMinDistance, fMaxDistance);
 
         // 左目特征点对应的描述子。
-        pFrame->mDescriptors.row(idxF).copyTo(mDescriptor);
+        mDescriptor = DescriptorBlock(pFrame->mpFeatures->mDescriptorBlock.Row(idxF), 1);
 
         // 防止Id冲突。
         unique_lock<mutex> lock(mpMap->mMutexPointCreation);
@@ -77,36 +84,83 @@ namespace ORB_SLAM2
     }
 
 
+    MapPoint::~MapPoint()
+    {
+        // 描述子缓存计入了KeyFrameStore的常驻内存
+        if (mnMedoidBytes > 0)
+            mpMap->mKeyFrameStore.AddResident(-(long) mnMedoidBytes);
+    }
+
+
     // VI SLAM 更新点云尺度
     void MapPoint::UpdateScale(float scale)
     {
-        SetWorldPos(GetWorldPos() * scale);
-        mfMaxDistance *= scale;
-        mfMinDistance *= scale;
+        unique_lock<mutex> lock2(mGlobalMutex);
+        unique_lock<mutex> lock(mMutexPos);
+        MapPointGeometry geometry = mGeometry.Read();
+        for (int i = 0; i < 3; i++)
+            geometry.mWorldPos[i] *= scale;
+        geometry.mfMaxDistance *= scale;
+        geometry.mfMinDistance *= scale;
+        mGeometry.Write(geometry);
     }
 
 
     // 设置MapPoint世界坐标系下的坐标。
     void MapPoint::SetWorldPos(const cv::Mat &Pos)
+    {
+        SetWorldPos(Converter::toVector3f(Pos));
+
+    }
+
+    void MapPoint::SetWorldPos(const Eigen::Vector3f &Pos)
     {
         unique_lock<mutex> lock2(mGlobalMutex);
         unique_lock<mutex> lock(mMutexPos);
-        Pos.copyTo(mWorldPos);
+        MapPointGeometry geometry = mGeometry.Read();
+        for (int i = 0; i < 3; i++)
+            geometry.mWorldPos[i] = Pos(i);
+        mGeometry.Write(geometry);
+    }
 
+    // 构造时设置全部几何信息，此时没有其他线程访问。
+    void MapPoint::SetGeometry(const Eigen::Vector3f &Pos, const Eigen::Vector3f &Normal, const float fMinDistance,
+                               const float fMaxDistance)
+    {
+        MapPointGeometry geometry;
+        for (int i = 0; i < 3; i++)
+        {
+            geometry.mWorldPos[i] = Pos(i);
+            geometry.mNormalVector[i] = Normal(i);
+        }
+        geometry.mfMinDistance = fMinDistance;
+        geometry.mfMaxDistance = fMaxDistance;
+        mGeometry.Write(geometry);
     }
 
     // 获取地图点云世界坐标系下的坐标。
     cv::Mat MapPoint::GetWorldPos()
     {
-        unique_lock<mutex> lock(mMutexPos);
-        return mWorldPos.clone();
+        return Converter::toCvMat(GetWorldPosEigen());
+    }
+
+    // 不加锁，BA写入时也不阻塞。
+    Eigen::Vector3f MapPoint::GetWorldPosEigen()
+    {
+        const MapPointGeometry geometry = mGeometry.Read();
+        return Eigen::Vector3f(geometry.mWorldPos[0], geometry.mWorldPos[1], geometry.mWorldPos[2]);
     }
 
     // 获取地图点的平均观测方向。
     cv::Mat MapPoint::GetNormal()
     {
-        unique_lock<mutex> lock(mMutexPos);
-        return mNormalVector.clone();
+        return Converter::toCvMat(GetNormalEigen());
+    }
+
+    Eigen::Vector3f MapPoint::GetNormalEigen()
+    {
+        const MapPointGeometry geometry = mGeometry.Read();
+        return Eigen::Vector3f(geometry.mNormalVector[0], geometry.mNormalVector[1], geometry.mNormalVector[2]);
     }
 
     // 获取该地图点的参考关键帧。
@@ -126,15 +180,12 @@ namespace ORB_SLAM2
     void MapPoint::AddObservation(KeyFrame *pKF, size_t idx)
     {
         unique_lock<mutex> lock(mMutexFeatures);
-        // 已经建立过观测关系。
-        if (mObservations.count(pKF))
+        // 记录下能观测到该Mappoint的KF和MapPoint在KF中的索引，已经建立过观测关系时返回。
+        if (!mObservations.insert(pKF, idx))
             return;
 
-        // 记录下能观测到该Mappoint的KF和MapPoint在KF中的索引。
-        mObservations[pKF] = idx;
-
         // 双目或RGBD
-        if (pKF->mvuRight[idx] >= 0)
+        if (pKF->mvbStereo[idx])
             nObs += 2;
             // 单目。
         else
@@ -151,7 +202,7 @@ namespace ORB_SLAM2
             if (mObservations.count(pKF))
             {
                 int idx = mObservations[pKF];
-                if (pKF->mvuRight[idx] >= 0)
+                if (pKF->mvbStereo[idx])
                     nObs -= 2;
                 else
                     nObs--;
@@ -211,9 +262,11 @@ namespace ORB_SLAM2
     void MapPoint::SetBadFlag()
     {
         mapMapPointObs/*map<KeyFrame *, size_t>*/ obs;
+        bool bWasBad;
         {
             unique_lock<mutex> lock1(mMutexFeatures);
             unique_lock<mutex> lock2(mMutexPos);
+            bWasBad = mbBad;
             mbBad = true;
             obs = mObservations;
             // 释放该MapPoint mObservations的内存空间。
@@ -227,9 +280,15 @@ namespace ORB_SLAM2
             pKF->EraseMapPointMatch(mit->second);
         }
 
+        ReleaseDescriptorCache();
+
         // 释放该MapPoint在Map中的内存。
         mpMap->EraseMapPoint(this);
 
+        // 其他线程可能还持有该MapPoint，都不再使用后再释放。
+        if (!bWasBad)
+            mpMap->mEpochManager.Retire(this);
+
     }
 
 
@@ -249,12 +308,14 @@ namespace ORB_SLAM2
 
         int nvisible, nfound;
         mapMapPointObs/*map<KeyFrame*, size_t>*/ obs;
+        bool bWasBad;
         {
             unique_lock<mutex> lock1(mMutexFeatures);
             unique_lock<mutex> lock2(mMutexPos);
             // 临时保存该地图点云与关键帧关联信息。
             obs = mObservations;
             mObservations.clear();
+            bWasBad = mbBad;
             mbBad = true;
             nvisible = mnVisible;
             nfound = mnFound;
@@ -286,9 +347,15 @@ namespace ORB_SLAM2
         pMP->IncreaseVisible(nvisible);
         pMP->ComputeDistinctiveDescriptors();
 
+        ReleaseDescriptorCache();
+
         // 在地图中剔除该MapPoint。
         mpMap->EraseMapPoint(this);
 
+        // 上一帧等可能还持有该MapPoint，通过mpReplaced找到替换点，都不再使用后再释放。
+        if (!bWasBad)
+            mpMap->mEpochManager.Retire(this);
+
     }
 
 
@@ -331,12 +398,14 @@ namespace ORB_SLAM2
     /*
     * 计算具有代表性的描述子。
     *   由于一个MapPoint可以被许多Frame观测到，在插入关键帧后，需要判断是否更新该地图点的最佳描述子。
-    *   先获得所有描述子，然后计算描述子之间的两两距离，最好的描述子与其他描述子应该具有最小距离中值。
+    *   最好的描述子与其他描述子应该具有最小距离中值。
+    *   各个观测的描述子和两两距离缓存在mDescriptorMedoid中，只对新增和删除的观测计算距离，
+    *   结果与每次重新计算所有距离相同。
     */
     void MapPoint::ComputeDistinctiveDescriptors()
     {
+        unique_lock<mutex> lockMedoid(mMutexMedoid);
 
-        vector<cv::Mat> vDescriptors;
         mapMapPointObs/*map<KeyFrame *, size_t>*/ observations;
 
         {
@@ -348,58 +417,50 @@ namespace ORB_SLAM2
 
         if (observations.empty())
             return;
-        //分配内存。
-        vDescriptors.reserve(observations.size());
 
-        // 遍历观测到该MapPoint的所有关键帧，获得ORB描述子，插入到vDescriptors中。
+        // 有效的观测，按关键帧Id排序。
+        vector<pair<unsigned long, size_t> > vObs;
+        vector<KeyFrame *> vpObsKFs;
+        vObs.reserve(observations.size());
+        vpObsKFs.reserve(observations.size());
         for (mapMapPointObs/*map<KeyFrame *, size_t>*/::iterator mit = observations.begin(), mend = observations.end();
              mit != mend; mit++)
         {
             KeyFrame *pKF = mit->first;
-
-            if (!pKF->isBad())
-                vDescriptors.push_back(pKF->mDescriptors.row(mit->second));
+            if (pKF->isBad())
+                continue;
+            vObs.push_back(make_pair(pKF->mnId, mit->second));
+            vpObsKFs.push_back(pKF);
         }
 
-        if (vDescriptors.empty())
-            return;
-
-        // 获得描述子的数量。
-        const size_t N = vDescriptors.size();
-        // 描述子两两之间的距离。
-        std::vector<std::vector<float> > Distances;
-        Distances.resize(N, vector<float>(N, 0));
-        for (size_t i = 0; i < N; i++)
+        // 删除不再有效的观测(关键帧变坏、观测被删除或特征点序号改变)。
+        vector<bool> vbCached(vObs.size(), false);
+        for (int i = mDescriptorMedoid.Size() - 1; i >= 0; i--)
         {
-            // Distances[i][i]是描述子自身的距离。
-            Distances[i][i] = 0;
-            for (size_t j = i + 1; j < N; j++)
-            {
-                int distij = ORBmatcher::DescriptorDistance(vDescriptors[i], vDescriptors[j]);
-                Distances[i][j] = distij;
-                Distances[j][i] = distij;
-            }
+            const pair<unsigned long, size_t> key(mDescriptorMedoid.Key(i), mDescriptorMedoid.Index(i));
+            vector<pair<unsigned long, size_t> >::iterator it = lower_bound(vObs.begin(), vObs.end(), key);
+            if (it != vObs.end() && *it == key && !vbCached[it - vObs.begin()])
+                vbCached[it - vObs.begin()] = true;
+            else
+                mDescriptorMedoid.Remove(i);
         }
 
-        // 
-        int BestMedian = INT_MAX;
-        int BestIdx = 0;
-        for (size_t i = 0; i < N; i++)
+        // 加入新的观测。关键帧的特征数据换出时只读取这一个描述子。
+        uchar descriptor[DescriptorBlock::DESC_SIZE] __attribute__((aligned(32)));
+        for (size_t i = 0; i < vObs.size(); i++)
         {
-            // 第i个描述子到其他所有描述子的距离。
-            vector<int> vDists(Distances[i].begin(), Distances[i].end());
-            sort(vDists.begin(), vDists.end());
+            if (vbCached[i])
+                continue;
+            if (vpObsKFs[i]->GetDescriptor(vObs[i].second, descriptor))
+                mDescriptorMedoid.Add(descriptor, vObs[i].first, vObs[i].second);
+        }
 
-            // 获得中值。
-            int median = vDists[0.5 * (N - 1)];
+        UpdateMedoidBytes();
 
-            // 获得描述子去其他描述自的最小中值。
-            if (median < BestMedian)
-            {
-                BestMedian = median;
-                BestIdx = i;
-            }
-        }
+        // 与其他描述子有最小距离中值的描述子。
+        const int BestIdx = mDescriptorMedoid.Best();
+        if (BestIdx < 0)
+            return;
 
         {
             unique_lock<mutex> lock(mMutexFeatures);
@@ -407,17 +468,43 @@ namespace ORB_SLAM2
             // 最好描述子，该描述子相对于其他描述子有最小的中值距离。
             // 中值代表整个描述子到其他描述子的平距离。
             // 最好的描述子和其他描述子的平均距离最小。
-            mDescriptor = vDescriptors[BestIdx].clone();
+            mDescriptor = DescriptorBlock(mDescriptorMedoid.Descriptor(BestIdx), 1);
         }
 
     }
 
 
+    size_t MapPoint::ReleaseDescriptorCache()
+    {
+        unique_lock<mutex> lock(mMutexMedoid);
+        const size_t nBytes = mnMedoidBytes;
+        mDescriptorMedoid.Clear();
+        UpdateMedoidBytes();
+        return nBytes;
+    }
+
+    void MapPoint::UpdateMedoidBytes()
+    {
+        const size_t nBytes = mDescriptorMedoid.Bytes();
+        if (nBytes != mnMedoidBytes)
+        {
+            mpMap->mKeyFrameStore.AddResident((long) nBytes - (long) mnMedoidBytes);
+            mnMedoidBytes = nBytes;
+        }
+    }
+
+
     // 获取MapPoint的描述子。
     cv::Mat MapPoint::GetDescriptor()
     {
         unique_lock<mutex> lock(mMutexFeatures);
-        return mDescriptor.clone();
+        return mDescriptor.Mat().clone();
+    }
+
+    DescriptorBlock MapPoint::GetDescriptorBlock()
+    {
+        unique_lock<mutex> lock(mMutexFeatures);
+        return mDescriptor;
     }
 
 
@@ -425,8 +512,9 @@ namespace ORB_SLAM2
     int MapPoint::GetIndexInKeyFrame(KeyFrame *pKF)
     {
         unique_lock<mutex> lock(mMutexFeatures);
-        if (mObservations.count(pKF))
-            return mObservations[pKF];
+        mapMapPointObs::const_iterator mit = mObservations.find(pKF);
+        if (mit != mObservations.end())
+            return mit->second;
         else
             return -1;
 
@@ -451,7 +539,7 @@ namespace ORB_SLAM2
     {
         mapMapPointObs/*map<KeyFrame *, size_t>*/ observations;
         KeyFrame *pRefKF;
-        cv::Mat Pos;
+        Eigen::Vector3f Pos;
         {
             unique_lock<mutex> lock1(mMutexFeatures);
             unique_lock<mutex> lock2(mMutexPos);
@@ -461,41 +549,47 @@ namespace ORB_SLAM2
             // 获取观测到该MapPoint的所有关键帧。
             observations = mObservations;
             pRefKF = mpRefKF;
-            Pos = mWorldPos.clone();
         }
+        Pos = GetWorldPosEigen();
 
         if (observations.empty())
             return;
 
-        cv::Mat normal = cv::Mat::zeros(3, 1, CV_32F);
+        Eigen::Vector3f normal = Eigen::Vector3f::Zero();
         int n = 0;
         for (mapMapPointObs/*map<KeyFrame *, size_t>*/::iterator mit = observations.begin(), mend = observations.end();
              mit != mend; mit++)
         {
             KeyFrame *pKF = mit->first;
-            cv::Mat Owi = pKF->GetCameraCenter();
-            cv::Mat normali = mWorldPos - Owi;
+            const Eigen::Vector3f normali = Pos - pKF->GetCameraCenterEigen();
             // 所有观测到该MapPoint的关键帧的观测向量归一化求和。
-            normal = normal + normali / cv::norm(normali);
+            normal += normali / normali.norm();
             n++;
         }
 
         // 在世界坐标系下，由参考帧相机指向地图点的向量。
-        cv::Mat PC = Pos - pRefKF->GetCameraCenter();
-        const float dist = cv::norm(PC);
-        const int level = pRefKF->mvKeysUn[observations[pRefKF]].octave;
+        const Eigen::Vector3f PC = Pos - pRefKF->GetCameraCenterEigen();
+        const float dist = PC.norm();
+        const std::shared_ptr<const KeyFrameFeatures> pRefFeatures = pRefKF->GetFeatures();
+        if (!pRefFeatures)
+            return;
+        const int level = pRefFeatures->mvKeysUn[observations[pRefKF]].octave;
         const float levelScaleFactor = pRefKF->mvScaleFactors[level];
         const int nLevels = pRefKF->mnScaleLevels;  // 金字塔层数。
 
         {
             unique_lock<mutex> lock3(mMutexPos);
+            MapPointGeometry geometry = mGeometry.Read();
 
             // 观测到该MapPoint的距离上限。
-            mfMaxDistance = dist * levelScaleFactor;
+            geometry.mfMaxDistance = dist * levelScaleFactor;
             // 观测到该MapPoint的距离下限。
-            mfMinDistance = mfMaxDistance / pRefKF->mvScaleFactors[nLevels - 1];
+            geometry.mfMinDistance = geometry.mfMaxDistance / pRefKF->mvScaleFactors[nLevels - 1];
             // 平均观测方向，个人感觉不需要除n。
-            mNormalVector = normal / n;
+            normal /= n;
+            for (int i = 0; i < 3; i++)
+                geometry.mNormalVector[i] = normal(i);
+            mGeometry.Write(geometry);
         }
 
     }
@@ -504,15 +598,13 @@ namespace ORB_SLAM2
     // 获得该MapPoint最小不变性距离。
     float MapPoint::GetMinDistanceInvariance()
     {
-        unique_lock<mutex> lock(mMutexPos);
-        return 0.8f * mfMinDistance;
+        return 0.8f * mGeometry.Read().mfMinDistance;
     }
 
     // 获得该MapPoint最大不变性距离。
     float MapPoint::GetMaxDistanceInvariance()
     {
-        unique_lock<mutex> lock(mMutexPos);
-        return 1.2f * mfMaxDistance;
+        return 1.2f * mGeometry.Read().mfMaxDistance;
     }
 
 
@@ -528,12 +620,8 @@ namespace ORB_SLAM2
     //            log(1.2) 
     int MapPoint::PredictScale(const float &currentDist, const float &logScaleFactor)
     {
-        float ratio;
-        {
-            unique_lock<mutex> lock3(mMutexPos);
-            // mfMaxDistance为参考帧考虑尺度后的距离。
-            ratio = mfMaxDistance / currentDist;
-        }
+        // mfMaxDistance为参考帧考虑尺度后的距离。
+        const float ratio = mGeometry.Read().mfMaxDistance / currentDist;
 
         // 取log线性化。
         return ceil(log(ratio) / logScaleFactor);
@@ -0,0 +1,1057 @@
+#include "MapSerializer.h"
+#include "Map.h"
+#include "MapPoint.h"
+#include "KeyFrame.h"
+#include "KeyFrameDatabase.h"
+#include "Frame.h"
+#include "Converter.h"
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+
+using namespace std;
+
+namespace ORB_SLAM2
+{
+
+    namespace
+    {
+
+        const char MAP_MAGIC[8] = {'O', 'R', 'B', 'S', 'M', 'A', 'P', '\0'};
+        const uint32_t ENDIAN_CHECK = 0x01020304;
+        const uint32_t END_MARKER = 0x454e444d;         // "MDNE"
+
+        // 关键帧、地图点之间的引用保存为它们在文件中的序号，加载时直接索引。
+        const uint32_t NO_INDEX = 0xffffffff;
+
+        // 文件读取缓冲区
+        const size_t READ_BUFFER_SIZE = 1 << 20;
+
+        // 防止损坏的文件分配过大的内存
+        const uint64_t MAX_ELEMENTS = 1ull << 32;
+
+        // cv::KeyPoint的存储格式，与平台无关。
+        struct KeyPointRecord
+        {
+            float x, y, size, angle, response;
+            int32_t octave, class_id;
+        };
+
+
+        template<typename T>
+        inline void Write(ostream &f, const T &v)
+        {
+            f.write(reinterpret_cast<const char *>(&v), sizeof(T));
+        }
+
+        template<typename T>
+        inline void WriteArray(ostream &f, const T *p, size_t n)
+        {
+            if (n > 0)
+                f.write(reinterpret_cast<const char *>(p), n * sizeof(T));
+        }
+
+        template<typename T>
+        inline void WriteVector(ostream &f, const vector<T> &v)
+        {
+            Write(f, (uint64_t) v.size());
+            WriteArray(f, v.data(), v.size());
+        }
+
+        // 固定大小的Eigen矩阵，按列存放的double。
+        template<typename TMatrix>
+        inline void WriteMatrix(ostream &f, const TMatrix &m)
+        {
+            WriteArray(f, m.data(), (size_t) m.size());
+        }
+
+        // 4x4或3x1的CV_32F矩阵。
+        inline void WriteMat(ostream &f, const cv::Mat &m, const int nElements)
+        {
+            cv::Mat mc = m.isContinuous() ? m : m.clone();
+            WriteArray(f, mc.ptr<float>(0), nElements);
+        }
+
+        void WriteKeyPoints(ostream &f, const vector<cv::KeyPoint> &vKeys)
+        {
+            vector<KeyPointRecord> vRecords(vKeys.size());
+            for (size_t i = 0; i < vKeys.size(); i++)
+            {
+                const cv::KeyPoint &kp = vKeys[i];
+                KeyPointRecord &r = vRecords[i];
+                r.x = kp.pt.x;
+                r.y = kp.pt.y;
+                r.size = kp.size;
+                r.angle = kp.angle;
+                r.response = kp.response;
+                r.octave = kp.octave;
+                r.class_id = kp.class_id;
+            }
+            WriteVector(f, vRecords);
+        }
+
+        template<typename T>
+        inline bool Read(istream &f, T &v)
+        {
+            f.read(reinterpret_cast<char *>(&v), sizeof(T));
+            return (bool) f;
+        }
+
+        template<typename T>
+        inline bool ReadArray(istream &f, T *p, size_t n)
+        {
+            if (n > 0)
+                f.read(reinterpret_cast<char *>(p), n * sizeof(T));
+            return (bool) f;
+        }
+
+        template<typename T>
+        bool ReadVector(istream &f, vector<T> &v)
+        {
+            uint64_t n;
+            if (!Read(f, n) || n > MAX_ELEMENTS)
+                return false;
+            v.resize(n);
+            return ReadArray(f, v.data(), n);
+        }
+
+        template<typename TMatrix>
+        inline bool ReadMatrix(istream &f, TMatrix &m)
+        {
+            return ReadArray(f, m.data(), (size_t) m.size());
+        }
+
+        inline bool ReadMat(istream &f, cv::Mat &m, const int rows, const int cols)
+        {
+            m.create(rows, cols, CV_32F);
+            return ReadArray(f, m.ptr<float>(0), rows * cols);
+        }
+
+        bool ReadKeyPoints(istream &f, vector<cv::KeyPoint> &vKeys)
+        {
+            vector<KeyPointRecord> vRecords;
+            if (!ReadVector(f, vRecords))
+                return false;
+
+            vKeys.resize(vRecords.size());
+            for (size_t i = 0; i < vRecords.size(); i++)
+            {
+                const KeyPointRecord &r = vRecords[i];
+                vKeys[i] = cv::KeyPoint(r.x, r.y, r.size, r.angle, r.response, r.octave, r.class_id);
+            }
+            return true;
+        }
+
+        // 关键帧集合保存为序号，不在地图中的关键帧(已剔除)不保存。
+        template<typename TContainer>
+        void WriteKeyFrameIndices(ostream &f, const TContainer &spKFs, const map<KeyFrame *, uint32_t> &mKFIndex)
+        {
+            vector<uint32_t> vIndices;
+            vIndices.reserve(spKFs.size());
+            for (typename TContainer::const_iterator it = spKFs.begin(); it != spKFs.end(); it++)
+            {
+                map<KeyFrame *, uint32_t>::const_iterator mit = mKFIndex.find(*it);
+                if (mit != mKFIndex.end())
+                    vIndices.push_back(mit->second);
+            }
+            WriteVector(f, vIndices);
+        }
+
+        inline uint32_t KeyFrameIndex(KeyFrame *pKF, const map<KeyFrame *, uint32_t> &mKFIndex)
+        {
+            map<KeyFrame *, uint32_t>::const_iterator mit = mKFIndex.find(pKF);
+            return mit == mKFIndex.end() ? NO_INDEX : mit->second;
+        }
+
+        // 读取关键帧序号并转换为指针，序号越界时失败。
+        bool ReadKeyFrameIndices(istream &f, const vector<KeyFrame *> &vpKFs, vector<KeyFrame *> &vpOut)
+        {
+            vector<uint32_t> vIndices;
+            if (!ReadVector(f, vIndices))
+                return false;
+
+            vpOut.resize(vIndices.size());
+            for (size_t i = 0; i < vIndices.size(); i++)
+            {
+                if (vIndices[i] >= vpKFs.size())
+                    return false;
+                vpOut[i] = vpKFs[vIndices[i]];
+            }
+            return true;
+        }
+
+        inline bool IndexToKeyFrame(const uint32_t idx, const vector<KeyFrame *> &vpKFs, KeyFrame *&pKF)
+        {
+            if (idx == NO_INDEX)
+            {
+                pKF = static_cast<KeyFrame *>(NULL);
+                return true;
+            }
+            if (idx >= vpKFs.size())
+                return false;
+            pKF = vpKFs[idx];
+            return true;
+        }
+
+        // 特征点的金字塔层数之后用来索引尺度因子，必须在[0, nLevels)内。
+        bool CheckOctaves(const vector<cv::KeyPoint> &vKeys, const int nLevels)
+        {
+            for (size_t i = 0; i < vKeys.size(); i++)
+                if (vKeys[i].octave < 0 || vKeys[i].octave >= nLevels)
+                    return false;
+            return true;
+        }
+
+        // k叉L层词汇树(含根节点)的节点数，特征向量中的节点Id必须小于它。
+        uint64_t MaxVocabularyNodes(const int k, const int L)
+        {
+            uint64_t nNodes = 0, nLevelNodes = 1;
+            for (int l = 0; l <= L && nNodes < NO_INDEX; l++)
+            {
+                nNodes += nLevelNodes;
+                nLevelNodes *= (uint64_t) k;
+            }
+            return min(nNodes, (uint64_t) NO_INDEX);
+        }
+
+        // 对象Id不能重复，并且都小于保存的下一个Id，否则之后新建的对象会与它们重复。
+        bool CheckIds(vector<uint64_t> vIds, const uint64_t nNextId)
+        {
+            sort(vIds.begin(), vIds.end());
+            if (!vIds.empty() && vIds.back() >= nNextId)
+                return false;
+            return adjacent_find(vIds.begin(), vIds.end()) == vIds.end();
+        }
+
+    } // namespace
+
+
+    // 文件结构：
+    // 文件头(版本、相机参数、词典大小、VI初始化状态、Id计数)
+    // 关键帧(自身数据) -> 地图点(含观测) -> 关键帧之间的连接和地图点关联 -> 初始关键帧 -> 倒排索引 -> 结束标志
+    bool MapSerializer::Save(const std::string &filename, Map *pMap, KeyFrameDatabase *pKFDB, const ORBVocabulary &voc,
+                             const VINSState &vins)
+    {
+        // 快照已经按id排序
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = pMap->GetKeyFramesSnapshot();
+        const SlotMap<MapPoint>::Snapshot pvpMPs = pMap->GetMapPointsSnapshot();
+        const vector<KeyFrame *> &vpKFs = *pvpKFs;
+
+        if (vpKFs.empty())
+        {
+            cerr << "Map is empty, nothing to save" << endl;
+            return false;
+        }
+
+        ofstream f(filename.c_str(), ios::out | ios::binary);
+        if (!f.is_open())
+        {
+            cerr << "Failed to open map file for writing: " << filename << endl;
+            return false;
+        }
+
+        // 坏的关键帧和地图点已从地图中剔除，只保存地图中的。
+        map<KeyFrame *, uint32_t> mKFIndex;
+        for (size_t i = 0; i < vpKFs.size(); i++)
+            mKFIndex[vpKFs[i]] = (uint32_t) i;
+
+        map<MapPoint *, uint32_t> mMPIndex;
+        vector<MapPoint *> vpMPs;
+        vpMPs.reserve(pvpMPs->size());
+        for (size_t i = 0; i < pvpMPs->size(); i++)
+            if (!(*pvpMPs)[i]->isBad())
+                vpMPs.push_back((*pvpMPs)[i]);
+        for (size_t i = 0; i < vpMPs.size(); i++)
+            mMPIndex[vpMPs[i]] = (uint32_t) i;
+
+        // 步骤1：文件头
+        f.write(MAP_MAGIC, sizeof(MAP_MAGIC));
+        Write(f, (uint32_t) VERSION);
+        Write(f, ENDIAN_CHECK);
+
+        // 相机参数，所有关键帧相同
+        KeyFrame *pKF0 = vpKFs[0];
+        Write(f, Frame::fx);
+        Write(f, Frame::fy);
+        Write(f, Frame::cx);
+        Write(f, Frame::cy);
+        Write(f, Frame::invfx);
+        Write(f, Frame::invfy);
+        Write(f, Frame::mnMinX);
+        Write(f, Frame::mnMaxX);
+        Write(f, Frame::mnMinY);
+        Write(f, Frame::mnMaxY);
+        Write(f, Frame::mfGridElementWidthInv);
+        Write(f, Frame::mfGridElementHeightInv);
+        WriteMat(f, pKF0->mK, 9);
+        Write(f, pKF0->mbf);
+        Write(f, pKF0->mb);
+        Write(f, pKF0->mThDepth);
+        Write(f, (int32_t) pKF0->mnScaleLevels);
+        Write(f, pKF0->mfScaleFactor);
+        Write(f, pKF0->mfLogScaleFactor);
+        WriteVector(f, pKF0->mvScaleFactors);
+        WriteVector(f, pKF0->mvLevelSigma2);
+        WriteVector(f, pKF0->mvInvLevelSigma2);
+
+        // 词袋向量中的单词Id必须对应同一个词典
+        Write(f, (uint64_t) voc.size());
+        Write(f, (int32_t) voc.getBranchingFactor());
+        Write(f, (int32_t) voc.getDepthLevels());
+
+        Write(f, (uint8_t) vins.bInited);
+        if (vins.bInited)
+        {
+            WriteMat(f, vins.GravityVec, 3);
+            WriteMat(f, vins.RwiInit, 9);
+        }
+
+        Write(f, (uint64_t) vpKFs.size());
+        Write(f, (uint64_t) vpMPs.size());
+        Write(f, (uint64_t) KeyFrame::nNextId);
+        Write(f, (uint64_t) MapPoint::nNextId);
+        Write(f, (uint64_t) Frame::nNextId);
+
+        // 步骤2：关键帧
+        for (size_t i = 0; i < vpKFs.size(); i++)
+        {
+            KeyFrame *pKF = vpKFs[i];
+
+            Write(f, (uint64_t) pKF->mnId);
+            Write(f, (uint64_t) pKF->mnFrameId);
+            Write(f, pKF->mTimeStamp);
+            WriteMat(f, pKF->GetPose(), 16);
+
+            const NavState ns = pKF->GetNavState();
+            WriteMatrix(f, ns.Get_P());
+            WriteMatrix(f, ns.Get_V());
+            WriteMatrix(f, ns.Get_R().unit_quaternion().coeffs());
+            WriteMatrix(f, ns.Get_BiasGyr());
+            WriteMatrix(f, ns.Get_BiasAcc());
+            WriteMatrix(f, ns.Get_dBias_Gyr());
+            WriteMatrix(f, ns.Get_dBias_Acc());
+
+            // 换出到磁盘的特征数据读入后再换出，保存时不增加内存
+            const bool bSpilled = !pKF->IsFeaturesResident();
+            const std::shared_ptr<const KeyFrameFeatures> pFeatures = pKF->GetFeatures();
+            if (!pFeatures)
+            {
+                cerr << "Failed to read features of KeyFrame " << pKF->mnId << ", map not saved" << endl;
+                return false;
+            }
+            if (bSpilled)
+                pKF->SpillFeatures();
+
+            const vector<IMUData> &vIMUData = pFeatures->mvIMUData;
+            Write(f, (uint64_t) vIMUData.size());
+            for (size_t j = 0; j < vIMUData.size(); j++)
+            {
+                WriteMatrix(f, vIMUData[j]._g);
+                WriteMatrix(f, vIMUData[j]._a);
+                Write(f, vIMUData[j]._t);
+            }
+
+            const IMUPreintegrator &preint = pKF->GetIMUPreInt();
+            WriteMatrix(f, preint._delta_P);
+            WriteMatrix(f, preint._delta_V);
+            WriteMatrix(f, preint._delta_R);
+            WriteMatrix(f, preint._J_P_Biasg);
+            WriteMatrix(f, preint._J_P_Biasa);
+            WriteMatrix(f, preint._J_V_Biasg);
+            WriteMatrix(f, preint._J_V_Biasa);
+            WriteMatrix(f, preint._J_R_Biasg);
+            WriteMatrix(f, preint._cov_P_V_Phi);
+            Write(f, preint._delta_time);
+
+            // 特征点和描述子
+            Write(f, (int32_t) pKF->N);
+            WriteKeyPoints(f, pFeatures->mvKeys);
+            WriteKeyPoints(f, pFeatures->mvKeysUn);
+            WriteVector(f, pFeatures->mvuRight);
+            WriteVector(f, pFeatures->mvDepth);
+            if (pKF->N > 0)
+                WriteArray(f, pFeatures->mDescriptorBlock.Row(0), (size_t) pKF->N * DescriptorBlock::DESC_SIZE);
+
+            // 词袋向量，加载后不需要重新计算
+            const DBoW2::FlatBowVector &bowVec = pFeatures->mBowVec;
+            Write(f, (uint64_t) bowVec.size());
+            for (size_t j = 0; j < bowVec.size(); j++)
+                Write(f, bowVec.id(j));
+            for (size_t j = 0; j < bowVec.size(); j++)
+                Write(f, bowVec.value(j));
+
+            const DBoW2::FlatFeatureVector &featVec = pFeatures->mFeatVec;
+            Write(f, (uint64_t) featVec.size());
+            for (size_t j = 0; j < featVec.size(); j++)
+            {
+                Write(f, featVec.nodeId(j));
+                Write(f, featVec.nFeatures(j));
+                WriteArray(f, featVec.features(j), featVec.nFeatures(j));
+            }
+
+            WriteVector(f, pFeatures->mvGridOffsets);
+            WriteVector(f, pFeatures->mvGridIndices);
+        }
+
+        // 步骤3：地图点
+        for (size_t i = 0; i < vpMPs.size(); i++)
+        {
+            MapPoint *pMP = vpMPs[i];
+
+            Write(f, (uint64_t) pMP->mnId);
+            Write(f, (int64_t) pMP->mnFirstKFid);
+            Write(f, (int64_t) pMP->mnFirstFrame);
+            WriteMat(f, pMP->GetWorldPos(), 3);
+            WriteMat(f, pMP->GetNormal(), 3);
+
+            const DescriptorBlock desc = pMP->GetDescriptorBlock();
+            uchar descriptor[DescriptorBlock::DESC_SIZE] = {0};
+            if (!desc.Empty())
+                memcpy(descriptor, desc.Row(0), DescriptorBlock::DESC_SIZE);
+            WriteArray(f, descriptor, DescriptorBlock::DESC_SIZE);
+
+            Write(f, KeyFrameIndex(pMP->GetReferenceKeyFrame(), mKFIndex));
+            Write(f, (int32_t) pMP->mnVisible);
+            Write(f, (int32_t) pMP->mnFound);
+            const MapPointGeometry geometry = pMP->mGeometry.Read();
+            Write(f, geometry.mfMinDistance);
+            Write(f, geometry.mfMaxDistance);
+
+            // 观测，只保存地图中的关键帧
+            const mapMapPointObs observations = pMP->GetObservations();
+            vector<uint32_t> vObsKF, vObsIdx;
+            vObsKF.reserve(observations.size());
+            vObsIdx.reserve(observations.size());
+            for (mapMapPointObs::const_iterator mit = observations.begin(); mit != observations.end(); mit++)
+            {
+                const uint32_t idx = KeyFrameIndex(mit->first, mKFIndex);
+                if (idx == NO_INDEX)
+                    continue;
+                vObsKF.push_back(idx);
+                vObsIdx.push_back((uint32_t) mit->second);
+            }
+            WriteVector(f, vObsKF);
+            WriteVector(f, vObsIdx);
+        }
+
+        // 步骤4：关键帧之间的连接(共视图、生成树、闭环边)和地图点关联
+        for (size_t i = 0; i < vpKFs.size(); i++)
+        {
+            KeyFrame *pKF = vpKFs[i];
+
+            Write(f, KeyFrameIndex(pKF->GetPrevKeyFrame(), mKFIndex));
+            Write(f, KeyFrameIndex(pKF->GetNextKeyFrame(), mKFIndex));
+            Write(f, KeyFrameIndex(pKF->GetParent(), mKFIndex));
+
+            {
+                unique_lock<mutex> lock(pKF->mMutexConnections);
+
+                Write(f, (uint8_t) pKF->mbFirstConnection);
+
+                vector<uint32_t> vConnected;
+                vector<int32_t> vWeights;
+                for (map<KeyFrame *, int>::const_iterator mit = pKF->mConnectedKeyFrameWeights.begin();
+                     mit != pKF->mConnectedKeyFrameWeights.end(); mit++)
+                {
+                    const uint32_t idx = KeyFrameIndex(mit->first, mKFIndex);
+                    if (idx == NO_INDEX)
+                        continue;
+                    vConnected.push_back(idx);
+                    vWeights.push_back(mit->second);
+                }
+                WriteVector(f, vConnected);
+                WriteVector(f, vWeights);
+
+                // 排序后的共视关键帧保持原来的顺序(权重相同时的顺序)
+                vConnected.clear();
+                vWeights.clear();
+                for (size_t j = 0; j < pKF->mvpOrderedConnectedKeyFrames.size(); j++)
+                {
+                    const uint32_t idx = KeyFrameIndex(pKF->mvpOrderedConnectedKeyFrames[j], mKFIndex);
+                    if (idx == NO_INDEX)
+                        continue;
+                    vConnected.push_back(idx);
+                    vWeights.push_back(pKF->mvOrderedWeights[j]);
+                }
+                WriteVector(f, vConnected);
+                WriteVector(f, vWeights);
+
+                WriteKeyFrameIndices(f, pKF->mspChildrens, mKFIndex);
+                WriteKeyFrameIndices(f, pKF->mspLoopEdges, mKFIndex);
+            }
+
+            const vector<MapPoint *> vpMatches = pKF->GetMapPointMatches();
+            vector<uint32_t> vMatches(vpMatches.size(), NO_INDEX);
+            for (size_t j = 0; j < vpMatches.size(); j++)
+            {
+                if (!vpMatches[j])
+                    continue;
+                map<MapPoint *, uint32_t>::const_iterator mit = mMPIndex.find(vpMatches[j]);
+                if (mit != mMPIndex.end())
+                    vMatches[j] = mit->second;
+            }
+            WriteVector(f, vMatches);
+        }
+
+        // 步骤5：初始关键帧
+        WriteKeyFrameIndices(f, pMap->mvpKeyFrameOrigins, mKFIndex);
+
+        // 步骤6：倒排索引，只保存非空的单词，保持每个单词中关键帧的顺序
+        {
+            unique_lock<mutex> lock(pKFDB->mMutex);
+
+            Write(f, (uint64_t) pKFDB->mnMaxKFId);
+
+            uint64_t nWords = 0;
+            for (size_t w = 0; w < pKFDB->mvInvertedFile.size(); w++)
+                if (!pKFDB->mvInvertedFile[w].empty())
+                    nWords++;
+            Write(f, nWords);
+
+            vector<uint32_t> vIndices;
+            for (size_t w = 0; w < pKFDB->mvInvertedFile.size(); w++)
+            {
+                const vector<KeyFrame *> &vpWordKFs = pKFDB->mvInvertedFile[w];
+                if (vpWordKFs.empty())
+                    continue;
+
+                vIndices.clear();
+                for (size_t j = 0; j < vpWordKFs.size(); j++)
+                {
+                    // 剔除的关键帧为NULL
+                    if (!vpWordKFs[j])
+                        continue;
+                    const uint32_t idx = KeyFrameIndex(vpWordKFs[j], mKFIndex);
+                    if (idx != NO_INDEX)
+                        vIndices.push_back(idx);
+                }
+                Write(f, (uint32_t) w);
+                WriteVector(f, vIndices);
+            }
+        }
+
+        Write(f, END_MARKER);
+        f.close();
+
+        if (!f)
+        {
+            cerr << "Failed to write map file: " << filename << endl;
+            return false;
+        }
+
+        cout << "Map saved to " << filename << ": " << vpKFs.size() << " keyframes, " << vpMPs.size()
+             << " map points" << endl;
+        return true;
+    }
+
+
+    bool MapSerializer::Load(const std::string &filename, Map *pMap, KeyFrameDatabase *pKFDB, ORBVocabulary *pVoc,
+                             VINSState &vins)
+    {
+        if (pMap->KeyFramesInMap() > 0)
+        {
+            cerr << "Map is not empty, can not load map file" << endl;
+            return false;
+        }
+
+        vector<char> vBuffer(READ_BUFFER_SIZE);
+        ifstream f;
+        f.rdbuf()->pubsetbuf(vBuffer.data(), vBuffer.size());
+        f.open(filename.c_str(), ios::in | ios::binary);
+        if (!f.is_open())
+        {
+            cerr << "Failed to open map file: " << filename << endl;
+            return false;
+        }
+
+        // 步骤1：文件头
+        char magic[sizeof(MAP_MAGIC)];
+        uint32_t version, endian;
+        if (!ReadArray(f, magic, sizeof(magic)) || memcmp(magic, MAP_MAGIC, sizeof(MAP_MAGIC)) != 0 ||
+            !Read(f, version) || !Read(f, endian))
+        {
+            cerr << "Not a map file: " << filename << endl;
+            return false;
+        }
+        if (version != VERSION || endian != ENDIAN_CHECK)
+        {
+            cerr << "Unsupported map file version " << version << " or byte order: " << filename << endl;
+            return false;
+        }
+
+        float fx, fy, cx, cy, invfx, invfy, minX, maxX, minY, maxY, gridWidthInv, gridHeightInv;
+        Read(f, fx);
+        Read(f, fy);
+        Read(f, cx);
+        Read(f, cy);
+        Read(f, invfx);
+        Read(f, invfy);
+        Read(f, minX);
+        Read(f, maxX);
+        Read(f, minY);
+        Read(f, maxY);
+        Read(f, gridWidthInv);
+        Read(f, gridHeightInv);
+
+        // 构造关键帧用的Frame，相机参数相同
+        Frame F;
+        F.mpORBvocabulary = pVoc;
+        F.mpORBextractorLeft = F.mpORBextractorRight = static_cast<ORBextractor *>(NULL);
+        F.mpReferenceKF = static_cast<KeyFrame *>(NULL);
+        int32_t nScaleLevels;
+        ReadMat(f, F.mK, 3, 3);
+        Read(f, F.mbf);
+        Read(f, F.mb);
+        Read(f, F.mThDepth);
+        Read(f, nScaleLevels);
+        Read(f, F.mfScaleFactor);
+        Read(f, F.mfLogScaleFactor);
+        ReadVector(f, F.mvScaleFactors);
+        ReadVector(f, F.mvLevelSigma2);
+        if (!ReadVector(f, F.mvInvLevelSigma2) || nScaleLevels <= 0 ||
+            F.mvScaleFactors.size() != (size_t) nScaleLevels || F.mvLevelSigma2.size() != (size_t) nScaleLevels ||
+            F.mvInvLevelSigma2.size() != (size_t) nScaleLevels)
+        {
+            cerr << "Corrupted map file header: " << filename << endl;
+            return false;
+        }
+        F.mnScaleLevels = nScaleLevels;
+        F.mvInvScaleFactors.resize(nScaleLevels);
+        for (int i = 0; i < nScaleLevels; i++)
+            F.mvInvScaleFactors[i] = 1.0f / F.mvScaleFactors[i];
+
+        uint64_t nWords;
+        int32_t k, L;
+        Read(f, nWords);
+        Read(f, k);
+        if (!Read(f, L) || nWords != pVoc->size() || k != pVoc->getBranchingFactor() || L != pVoc->getDepthLevels())
+        {
+            cerr << "Map file was saved with a different vocabulary: " << filename << endl;
+            return false;
+        }
+
+        uint8_t bVINSInited;
+        MapSerializer::VINSState loadedVINS;
+        Read(f, bVINSInited);
+        loadedVINS.bInited = bVINSInited != 0;
+        if (loadedVINS.bInited)
+        {
+            ReadMat(f, loadedVINS.GravityVec, 3, 1);
+            ReadMat(f, loadedVINS.RwiInit, 3, 3);
+        }
+
+        uint64_t nKFs, nMPs, nNextKFId, nNextMPId, nNextFrameId;
+        Read(f, nKFs);
+        Read(f, nMPs);
+        Read(f, nNextKFId);
+        Read(f, nNextMPId);
+        if (!Read(f, nNextFrameId) || nKFs == 0 || nKFs >= NO_INDEX || nMPs >= NO_INDEX || nNextKFId >= NO_INDEX ||
+            nNextMPId >= NO_INDEX)
+        {
+            cerr << "Corrupted map file header: " << filename << endl;
+            return false;
+        }
+
+        // KeyFrame从Frame的静态成员读取相机参数，之后的第一帧会重新计算相同的值
+        Frame::fx = fx;
+        Frame::fy = fy;
+        Frame::cx = cx;
+        Frame::cy = cy;
+        Frame::invfx = invfx;
+        Frame::invfy = invfy;
+        Frame::mnMinX = minX;
+        Frame::mnMaxX = maxX;
+        Frame::mnMinY = minY;
+        Frame::mnMaxY = maxY;
+        Frame::mfGridElementWidthInv = gridWidthInv;
+        Frame::mfGridElementHeightInv = gridHeightInv;
+
+        // 失败时删除已经创建的对象，并恢复Id计数
+        const long unsigned int nPrevKFNextId = KeyFrame::nNextId;
+        const long unsigned int nPrevMPNextId = MapPoint::nNextId;
+
+        vector<KeyFrame *> vpKFs;
+        vector<MapPoint *> vpMPs;
+        vpKFs.reserve(nKFs);
+        vpMPs.reserve(nMPs);
+
+        // 关键帧、地图点的Id和关键帧对应的帧Id，读取完后检查
+        vector<uint64_t> vKFIds, vMPIds, vFrameIds;
+        vKFIds.reserve(nKFs);
+        vMPIds.reserve(nMPs);
+        vFrameIds.reserve(nKFs);
+
+        const uint64_t nMaxNodes = MaxVocabularyNodes(k, L);
+
+        bool bOK = true;
+
+        // 步骤2：关键帧
+        for (uint64_t i = 0; i < nKFs && bOK; i++)
+        {
+            uint64_t nId, nFrameId;
+            Read(f, nId);
+            Read(f, nFrameId);
+            vKFIds.push_back(nId);
+            vFrameIds.push_back(nFrameId);
+            Read(f, F.mTimeStamp);
+            ReadMat(f, F.mTcw, 4, 4);
+            F.mnId = nFrameId;
+
+            Vector3d P, V, bg, ba, dbg, dba;
+            Quaterniond q;
+            ReadMatrix(f, P);
+            ReadMatrix(f, V);
+            ReadMatrix(f, q.coeffs());
+            ReadMatrix(f, bg);
+            ReadMatrix(f, ba);
+            ReadMatrix(f, dbg);
+            ReadMatrix(f, dba);
+
+            uint64_t nIMUData;
+            if (!Read(f, nIMUData) || nIMUData > MAX_ELEMENTS)
+            {
+                bOK = false;
+                break;
+            }
+            vector<IMUData> vIMUData;
+            vIMUData.reserve(nIMUData);
+            for (uint64_t j = 0; j < nIMUData; j++)
+            {
+                Vector3d g, a;
+                double t;
+                ReadMatrix(f, g);
+                ReadMatrix(f, a);
+                Read(f, t);
+                vIMUData.push_back(IMUData(g(0), g(1), g(2), a(0), a(1), a(2), t));
+            }
+
+            IMUPreintegrator preint;
+            ReadMatrix(f, preint._delta_P);
+            ReadMatrix(f, preint._delta_V);
+            ReadMatrix(f, preint._delta_R);
+            ReadMatrix(f, preint._J_P_Biasg);
+            ReadMatrix(f, preint._J_P_Biasa);
+            ReadMatrix(f, preint._J_V_Biasg);
+            ReadMatrix(f, preint._J_V_Biasa);
+            ReadMatrix(f, preint._J_R_Biasg);
+            ReadMatrix(f, preint._cov_P_V_Phi);
+            Read(f, preint._delta_time);
+
+            // 每个关键帧的特征数据单独一份
+            int32_t N;
+            F.mpFeatures = std::make_shared<FrameFeatures>();
+            FrameFeatures &features = *F.mpFeatures;
+            if (!Read(f, N) || N < 0 || !ReadKeyPoints(f, features.mvKeys) || !ReadKeyPoints(f, features.mvKeysUn) ||
+                !ReadVector(f, features.mvuRight) || !ReadVector(f, features.mvDepth) ||
+                features.mvKeys.size() != (size_t) N || features.mvKeysUn.size() != (size_t) N ||
+                features.mvuRight.size() != (size_t) N || features.mvDepth.size() != (size_t) N ||
+                !CheckOctaves(features.mvKeys, nScaleLevels) || !CheckOctaves(features.mvKeysUn, nScaleLevels))
+            {
+                bOK = false;
+                break;
+            }
+            F.N = N;
+
+            vector<uchar> vDescriptors((size_t) N * DescriptorBlock::DESC_SIZE);
+            ReadArray(f, vDescriptors.data(), vDescriptors.size());
+            features.mDescriptorBlock = DescriptorBlock(vDescriptors.data(), N);
+            features.mDescriptors = features.mDescriptorBlock.Mat();
+
+            uint64_t nBow;
+            if (!Read(f, nBow) || nBow > nWords)
+            {
+                bOK = false;
+                break;
+            }
+            vector<DBoW2::WordId> vWordIds(nBow);
+            vector<DBoW2::WordValue> vWordValues(nBow);
+            ReadArray(f, vWordIds.data(), nBow);
+            ReadArray(f, vWordValues.data(), nBow);
+            features.mBowVec.reserve(nBow);
+            for (uint64_t j = 0; j < nBow; j++)
+            {
+                // 单词Id递增，用于倒排索引
+                if (vWordIds[j] >= nWords || (j > 0 && vWordIds[j] <= vWordIds[j - 1]))
+                {
+                    bOK = false;
+                    break;
+                }
+                features.mBowVec.push_back(vWordIds[j], vWordValues[j]);
+            }
+
+            uint64_t nNodes;
+            if (!bOK || !Read(f, nNodes) || nNodes > (uint64_t) N)
+            {
+                bOK = false;
+                break;
+            }
+            features.mFeatVec.reserve(nNodes, N);
+            vector<unsigned int> vNodeFeatures;
+            uint64_t nTotalFeatures = 0;
+            for (uint64_t j = 0; j < nNodes && bOK; j++)
+            {
+                // 节点Id递增且在词典内，特征序号小于N，特征总数不超过N
+                DBoW2::NodeId nodeId;
+                unsigned int nNodeFeatures;
+                Read(f, nodeId);
+                if (!Read(f, nNodeFeatures) || nodeId >= nMaxNodes ||
+                    (j > 0 && nodeId <= features.mFeatVec.nodeId(j - 1)) ||
+                    (nTotalFeatures += nNodeFeatures) > (uint64_t) N)
+                {
+                    bOK = false;
+                    break;
+                }
+                vNodeFeatures.resize(nNodeFeatures);
+                ReadArray(f, vNodeFeatures.data(), nNodeFeatures);
+                for (unsigned int n = 0; n < nNodeFeatures && bOK; n++)
+                    bOK = vNodeFeatures[n] < (unsigned int) N;
+                if (bOK)
+                    features.mFeatVec.push_back(nodeId, vNodeFeatures.data(), nNodeFeatures);
+            }
+
+            if (!bOK || !ReadVector(f, features.mvGridOffsets) || !ReadVector(f, features.mvGridIndices) ||
+                features.mvGridOffsets.size() != (size_t) FRAME_GRID_COLS * FRAME_GRID_ROWS + 1 ||
+                features.mvGridOffsets.front() != 0 || features.mvGridOffsets.back() != features.mvGridIndices.size())
+            {
+                bOK = false;
+                break;
+            }
+            for (size_t j = 1; j < features.mvGridOffsets.size() && bOK; j++)
+                bOK = features.mvGridOffsets[j - 1] <= features.mvGridOffsets[j];
+            for (size_t j = 0; j < features.mvGridIndices.size() && bOK; j++)
+                bOK = features.mvGridIndices[j] < (size_t) N;
+            if (!bOK)
+                break;
+
+            F.mvpMapPoints.assign(N, static_cast<MapPoint *>(NULL));
+            F.mvbOutlier.assign(N, false);
+
+            KeyFrame *pKF = new KeyFrame(F, pMap, pKFDB, vIMUData, static_cast<KeyFrame *>(NULL));
+            pKF->mnId = nId;
+
+            NavState ns;
+            ns.Set_Pos(P);
+            ns.Set_Vel(V);
+            ns.Set_Rot(Sophus::SO3(q));
+            ns.Set_BiasGyr(bg);
+            ns.Set_BiasAcc(ba);
+            ns.Set_DeltaBiasGyr(dbg);
+            ns.Set_DeltaBiasAcc(dba);
+            pKF->SetNavState(ns);
+            pKF->mIMUPreInt = preint;
+
+            vpKFs.push_back(pKF);
+        }
+
+        // 关键帧Id用于关键帧库按Id索引的数组，帧Id用于之后新建的帧
+        if (bOK)
+            bOK = CheckIds(vKFIds, nNextKFId) && CheckIds(vFrameIds, nNextFrameId);
+
+        // 步骤3：地图点
+        for (uint64_t i = 0; i < nMPs && bOK; i++)
+        {
+            uint64_t nId;
+            int64_t nFirstKFid, nFirstFrame;
+            cv::Mat Pos, Normal;
+            uchar descriptor[DescriptorBlock::DESC_SIZE];
+            uint32_t nRefKF;
+            int32_t nVisible, nFound;
+            float fMinDistance, fMaxDistance;
+
+            Read(f, nId);
+            vMPIds.push_back(nId);
+            Read(f, nFirstKFid);
+            Read(f, nFirstFrame);
+            ReadMat(f, Pos, 3, 1);
+            ReadMat(f, Normal, 3, 1);
+            ReadArray(f, descriptor, DescriptorBlock::DESC_SIZE);
+            Read(f, nRefKF);
+            Read(f, nVisible);
+            Read(f, nFound);
+            Read(f, fMinDistance);
+            Read(f, fMaxDistance);
+
+            vector<uint32_t> vObsKF, vObsIdx;
+            KeyFrame *pRefKF;
+            if (!ReadVector(f, vObsKF) || !ReadVector(f, vObsIdx) || vObsKF.size() != vObsIdx.size() ||
+                !IndexToKeyFrame(nRefKF, vpKFs, pRefKF))
+            {
+                bOK = false;
+                break;
+            }
+
+            MapPoint *pMP = new MapPoint(Pos, pMap, (long int) nFirstKFid, (long int) nFirstFrame);
+            vpMPs.push_back(pMP);
+            pMP->mnId = nId;
+            pMP->SetGeometry(Converter::toVector3f(Pos), Converter::toVector3f(Normal), fMinDistance, fMaxDistance);
+            pMP->mDescriptor = DescriptorBlock(descriptor, 1);
+            pMP->mpRefKF = pRefKF;
+            pMP->mnVisible = nVisible;
+            pMP->mnFound = nFound;
+
+            for (size_t j = 0; j < vObsKF.size(); j++)
+            {
+                if (vObsKF[j] >= vpKFs.size() || vObsIdx[j] >= (uint32_t) vpKFs[vObsKF[j]]->N)
+                {
+                    bOK = false;
+                    break;
+                }
+                // 同一个关键帧只能观测一次
+                KeyFrame *pKF = vpKFs[vObsKF[j]];
+                if (!pMP->mObservations.insert(pKF, vObsIdx[j]))
+                {
+                    bOK = false;
+                    break;
+                }
+                // 单目一个观测，双目和RGBD有右目坐标时两个
+                pMP->nObs += pKF->mvbStereo[vObsIdx[j]] ? 2 : 1;
+            }
+        }
+
+        if (bOK)
+            bOK = CheckIds(vMPIds, nNextMPId);
+
+        // 步骤4：关键帧之间的连接和地图点关联
+        for (uint64_t i = 0; i < nKFs && bOK; i++)
+        {
+            KeyFrame *pKF = vpKFs[i];
+
+            uint32_t nPrev, nNext, nParent;
+            uint8_t bFirstConnection;
+            vector<uint32_t> vConnected, vOrdered, vMatches;
+            vector<int32_t> vWeights, vOrderedWeights;
+            vector<KeyFrame *> vpChildren, vpLoopEdges;
+            Read(f, nPrev);
+            Read(f, nNext);
+            Read(f, nParent);
+            Read(f, bFirstConnection);
+            if (!ReadVector(f, vConnected) || !ReadVector(f, vWeights) || vConnected.size() != vWeights.size() ||
+                !ReadVector(f, vOrdered) || !ReadVector(f, vOrderedWeights) ||
+                vOrdered.size() != vOrderedWeights.size() || !ReadKeyFrameIndices(f, vpKFs, vpChildren) ||
+                !ReadKeyFrameIndices(f, vpKFs, vpLoopEdges) || !ReadVector(f, vMatches) ||
+                vMatches.size() != (size_t) pKF->N || !IndexToKeyFrame(nPrev, vpKFs, pKF->mpPrevKeyFrame) ||
+                !IndexToKeyFrame(nNext, vpKFs, pKF->mpNextKeyFrame) || !IndexToKeyFrame(nParent, vpKFs, pKF->mpParent))
+            {
+                bOK = false;
+                break;
+            }
+
+            pKF->mbFirstConnection = bFirstConnection != 0;
+            for (size_t j = 0; j < vConnected.size() && bOK; j++)
+            {
+                bOK = vConnected[j] < vpKFs.size();
+                if (bOK)
+                    pKF->mConnectedKeyFrameWeights[vpKFs[vConnected[j]]] = vWeights[j];
+            }
+            pKF->mvpOrderedConnectedKeyFrames.resize(vOrdered.size());
+            for (size_t j = 0; j < vOrdered.size() && bOK; j++)
+            {
+                bOK = vOrdered[j] < vpKFs.size();
+                if (bOK)
+                    pKF->mvpOrderedConnectedKeyFrames[j] = vpKFs[vOrdered[j]];
+            }
+            pKF->mvOrderedWeights.assign(vOrderedWeights.begin(), vOrderedWeights.end());
+            pKF->mspChildrens.insert(vpChildren.begin(), vpChildren.end());
+            pKF->mspLoopEdges.insert(vpLoopEdges.begin(), vpLoopEdges.end());
+
+            for (size_t j = 0; j < vMatches.size() && bOK; j++)
+            {
+                if (vMatches[j] == NO_INDEX)
+                    continue;
+                bOK = vMatches[j] < vpMPs.size();
+                if (bOK)
+                    pKF->mvpMapPoints[j] = vpMPs[vMatches[j]];
+            }
+        }
+
+        // 步骤5：初始关键帧
+        vector<KeyFrame *> vpKeyFrameOrigins;
+        if (bOK)
+            bOK = ReadKeyFrameIndices(f, vpKFs, vpKeyFrameOrigins);
+
+        // 步骤6：倒排索引
+        uint64_t nMaxKFId = 0, nInvertedWords = 0;
+        vector<vector<KeyFrame *> > vInvertedFile;
+        if (bOK)
+        {
+            Read(f, nMaxKFId);
+            bOK = Read(f, nInvertedWords) && nInvertedWords <= nWords;
+        }
+        if (bOK)
+        {
+            // 每个单词只保存一次，一个关键帧在同一个单词中只出现一次
+            vInvertedFile.resize(nWords);
+            vector<uint32_t> vIndices;
+            vector<uint64_t> vnLastWord(vpKFs.size(), NO_INDEX);
+            for (uint64_t i = 0; i < nInvertedWords && bOK; i++)
+            {
+                uint32_t w;
+                bOK = Read(f, w) && w < nWords && vInvertedFile[w].empty() && ReadVector(f, vIndices);
+                if (!bOK)
+                    break;
+
+                vector<KeyFrame *> &vpWordKFs = vInvertedFile[w];
+                vpWordKFs.resize(vIndices.size());
+                for (size_t j = 0; j < vIndices.size() && bOK; j++)
+                {
+                    bOK = vIndices[j] < vpKFs.size() && vnLastWord[vIndices[j]] != w;
+                    if (bOK)
+                    {
+                        vnLastWord[vIndices[j]] = w;
+                        vpWordKFs[j] = vpKFs[vIndices[j]];
+                    }
+                }
+            }
+        }
+
+        uint32_t endMarker = 0;
+        if (bOK)
+            bOK = Read(f, endMarker) && endMarker == END_MARKER;
+
+        if (!bOK)
+        {
+            cerr << "Corrupted map file: " << filename << endl;
+
+            for (size_t i = 0; i < vpMPs.size(); i++)
+                delete vpMPs[i];
+            for (size_t i = 0; i < vpKFs.size(); i++)
+                delete vpKFs[i];
+
+            KeyFrame::nNextId = nPrevKFNextId;
+            MapPoint::nNextId = nPrevMPNextId;
+            return false;
+        }
+
+        // 全部读取成功后再加入地图和关键帧库
+        for (size_t i = 0; i < vpKFs.size(); i++)
+            pMap->AddKeyFrame(vpKFs[i]);
+        for (size_t i = 0; i < vpMPs.size(); i++)
+            pMap->AddMapPoint(vpMPs[i]);
+        pMap->mvpKeyFrameOrigins = vpKeyFrameOrigins;
+
+        {
+            unique_lock<mutex> lock(pKFDB->mMutex);
+            pKFDB->mvInvertedFile.swap(vInvertedFile);
+            pKFDB->mvnErased.assign(nWords, 0);
+            // 文件中的最大Id只为兼容格式而读取，按加载的关键帧计算，保证QueryCandidates的数组能索引所有关键帧
+            pKFDB->mnMaxKFId = *max_element(vKFIds.begin(), vKFIds.end());
+        }
+
+        KeyFrame::nNextId = nNextKFId;
+        MapPoint::nNextId = nNextMPId;
+        Frame::nNextId = nNextFrameId;
+
+        vins = loadedVINS;
+
+        cout << "Map loaded from " << filename << ": " << vpKFs.size() << " keyframes, " << vpMPs.size()
+             << " map points" << endl;
+        return true;
+    }
+
+} //namespace ORB_SLAM2
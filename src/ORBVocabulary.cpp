@@ -0,0 +1,40 @@
+#include "ORBVocabulary.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ORB_SLAM2
+{
+
+    void ComputeBowVectors(const ORBVocabulary &voc, const DescriptorBlock &descriptors, const int levelsup,
+                           DBoW2::FlatBowVector &bowVec, DBoW2::FlatFeatureVector &featVec, ThreadPool *pThreadPool)
+    {
+        const int N = descriptors.Rows();
+        if (voc.empty() || N == 0 || !pThreadPool || pThreadPool->GetNumThreads() == 0)
+        {
+            voc.transform(descriptors.Row(0), N, bowVec, featVec, levelsup);
+            return;
+        }
+
+        // 步骤1：各线程查找不同描述子的单词，只读词典。
+        const int BLOCK_SIZE = 64;
+        const int nBlocks = (N + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+        std::vector<DBoW2::WordId> vWordIds(N);
+        std::vector<DBoW2::WordValue> vWeights(N);
+        std::vector<DBoW2::NodeId> vNodeIds(N);
+
+        pThreadPool->ParallelFor(nBlocks, [&](int iBlock)
+        {
+            const int iBegin = iBlock * BLOCK_SIZE;
+            const int n = std::min(BLOCK_SIZE, N - iBegin);
+            voc.transform(descriptors.Row(iBegin), n, &vWordIds[iBegin], &vWeights[iBegin], &vNodeIds[iBegin],
+                          levelsup);
+        });
+
+        // 步骤2：按特征点顺序合并，与串行版本相同。
+        voc.buildVectors(&vWordIds[0], &vWeights[0], &vNodeIds[0], N, bowVec, featVec);
+    }
+
+} //namespace ORB_SLAM2
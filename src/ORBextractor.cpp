@@ -60,10 +60,17 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <vector>
 #include <iterator>
+#include <atomic>
 
 #include "ORBextractor.h"
+#include "ThreadPool.h"
 #include <iostream>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ORB_SIMD_X86
+#include <immintrin.h>
+#endif
+
 
 using namespace cv;
 using namespace std;
@@ -76,6 +83,35 @@ namespace ORB_SLAM2
     const int EDGE_THRESHOLD = 19;
 
 
+    // 当前使用的SIMD内核级别，启动时根据CPU特性检测。
+    static int DetectKernelLevel()
+    {
+#ifdef ORB_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return ORBextractor::KERNEL_AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return ORBextractor::KERNEL_SSE41;
+#endif
+        return ORBextractor::KERNEL_SCALAR;
+    }
+
+    static const int nMaxKernelLevel = DetectKernelLevel();
+    // 提取线程读取，SetKernelLevel可能在其他线程中修改。
+    static std::atomic<int> nKernelLevel(nMaxKernelLevel);
+
+    int ORBextractor::GetKernelLevel()
+    {
+        return nKernelLevel.load(std::memory_order_relaxed);
+    }
+
+    void ORBextractor::SetKernelLevel(int level)
+    {
+        nKernelLevel.store(std::max((int) KERNEL_SCALAR, std::min(level, nMaxKernelLevel)),
+                           std::memory_order_relaxed);
+    }
+
+
     static float IC_Angle(const Mat &image, Point2f pt, const vector<int> &u_max)
     {
         int m_01 = 0, m_10 = 0;
@@ -105,58 +141,218 @@ namespace ORB_SLAM2
         return fastAtan2((float) m_01, (float) m_10);
     }
 
+#ifdef ORB_SIMD_X86
+
+    // IC_Angle的SIMD版本按行读取u=-15..16共32个像素，用权重表屏蔽圆形区域外的像素。
+    // mU[v][k]为第v行第k个像素的u(区域外为0)，mV[v][k]为v(区域外为0)。整数运算，结果与标量版本完全一致。
+    struct ICAngleWeights
+    {
+        explicit ICAngleWeights(const vector<int> &u_max)
+        {
+            for (int v = 0; v <= HALF_PATCH_SIZE; ++v)
+            {
+                const int d = v == 0 ? HALF_PATCH_SIZE : u_max[v];
+                for (int k = 0; k < 32; ++k)
+                {
+                    const int u = k - HALF_PATCH_SIZE;
+                    const bool bIn = u >= -d && u <= d;
+                    mU[v][k] = bIn ? u : 0;
+                    mV[v][k] = bIn ? v : 0;
+                }
+            }
+        }
+
+        short mU[HALF_PATCH_SIZE + 1][32] __attribute__((aligned(32)));
+        short mV[HALF_PATCH_SIZE + 1][32] __attribute__((aligned(32)));
+    };
+
+    static const ICAngleWeights &GetICAngleWeights(const vector<int> &u_max)
+    {
+        // umax只与HALF_PATCH_SIZE有关，所有提取器相同
+        static const ICAngleWeights weights(u_max);
+        return weights;
+    }
+
+    __attribute__((target("sse4.1")))
+    static float IC_Angle_SSE41(const Mat &image, Point2f pt, const vector<int> &u_max)
+    {
+        const ICAngleWeights &W = GetICAngleWeights(u_max);
+
+        const uchar *center = &image.at<uchar>(cvRound(pt.y), cvRound(pt.x));
+        const int step = (int) image.step1();
+
+        __m128i m10 = _mm_setzero_si128();
+        __m128i m01 = _mm_setzero_si128();
+
+        // v=0
+        for (int k = 0; k < 32; k += 8)
+        {
+            __m128i p = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *) (center - HALF_PATCH_SIZE + k)));
+            m10 = _mm_add_epi32(m10, _mm_madd_epi16(p, _mm_load_si128((const __m128i *) &W.mU[0][k])));
+        }
+
+        for (int v = 1; v <= HALF_PATCH_SIZE; ++v)
+        {
+            const uchar *rowPlus = center + v * step - HALF_PATCH_SIZE;
+            const uchar *rowMinus = center - v * step - HALF_PATCH_SIZE;
+            for (int k = 0; k < 32; k += 8)
+            {
+                __m128i p = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *) (rowPlus + k)));
+                __m128i m = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *) (rowMinus + k)));
+                m10 = _mm_add_epi32(m10, _mm_madd_epi16(_mm_add_epi16(p, m),
+                                                        _mm_load_si128((const __m128i *) &W.mU[v][k])));
+                m01 = _mm_add_epi32(m01, _mm_madd_epi16(_mm_sub_epi16(p, m),
+                                                        _mm_load_si128((const __m128i *) &W.mV[v][k])));
+            }
+        }
+
+        m10 = _mm_hadd_epi32(m10, m01);
+        m10 = _mm_hadd_epi32(m10, m10);
+
+        return fastAtan2((float) _mm_extract_epi32(m10, 1), (float) _mm_cvtsi128_si32(m10));
+    }
+
+    __attribute__((target("avx2")))
+    static float IC_Angle_AVX2(const Mat &image, Point2f pt, const vector<int> &u_max)
+    {
+        const ICAngleWeights &W = GetICAngleWeights(u_max);
+
+        const uchar *center = &image.at<uchar>(cvRound(pt.y), cvRound(pt.x));
+        const int step = (int) image.step1();
+
+        // v=0
+        __m256i p0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (center - HALF_PATCH_SIZE)));
+        __m256i p1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (center - HALF_PATCH_SIZE + 16)));
+        __m256i m10 = _mm256_add_epi32(_mm256_madd_epi16(p0, _mm256_load_si256((const __m256i *) &W.mU[0][0])),
+                                       _mm256_madd_epi16(p1, _mm256_load_si256((const __m256i *) &W.mU[0][16])));
+        __m256i m01 = _mm256_setzero_si256();
+
+        for (int v = 1; v <= HALF_PATCH_SIZE; ++v)
+        {
+            const uchar *rowPlus = center + v * step - HALF_PATCH_SIZE;
+            const uchar *rowMinus = center - v * step - HALF_PATCH_SIZE;
+            for (int k = 0; k < 32; k += 16)
+            {
+                __m256i p = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (rowPlus + k)));
+                __m256i m = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (rowMinus + k)));
+                m10 = _mm256_add_epi32(m10, _mm256_madd_epi16(_mm256_add_epi16(p, m),
+                                                              _mm256_load_si256((const __m256i *) &W.mU[v][k])));
+                m01 = _mm256_add_epi32(m01, _mm256_madd_epi16(_mm256_sub_epi16(p, m),
+                                                              _mm256_load_si256((const __m256i *) &W.mV[v][k])));
+            }
+        }
+
+        // 水平求和
+        __m128i s = _mm_hadd_epi32(_mm_add_epi32(_mm256_castsi256_si128(m10), _mm256_extracti128_si256(m10, 1)),
+                                   _mm_add_epi32(_mm256_castsi256_si128(m01), _mm256_extracti128_si256(m01, 1)));
+        s = _mm_hadd_epi32(s, s);
+
+        return fastAtan2((float) _mm_extract_epi32(s, 1), (float) _mm_cvtsi128_si32(s));
+    }
+
+#endif
+
 
     const float factorPI = (float) (CV_PI / 180.f);
 
-    static void computeOrbDescriptor(const KeyPoint &kpt,
-                                     const Mat &img, const Point *pattern,
-                                     uchar *desc)
+    // 按特征点方向旋转描述子采样模式，得到256对采样点相对于中心的偏移，所有内核共用这一步以保证结果一致。
+    static void SteerPattern(const KeyPoint &kpt, const Point *pattern, const int step, int *offsets0, int *offsets1)
     {
         float angle = (float) kpt.angle * factorPI;
         float a = (float) cos(angle), b = (float) sin(angle);
 
+        for (int i = 0; i < 256; ++i)
+        {
+            const Point &p0 = pattern[2 * i];
+            const Point &p1 = pattern[2 * i + 1];
+            offsets0[i] = cvRound(p0.x * b + p0.y * a) * step + cvRound(p0.x * a - p0.y * b);
+            offsets1[i] = cvRound(p1.x * b + p1.y * a) * step + cvRound(p1.x * a - p1.y * b);
+        }
+    }
+
+    static void computeOrbDescriptor(const KeyPoint &kpt,
+                                     const Mat &img, const Point *pattern,
+                                     uchar *desc)
+    {
         const uchar *center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
         const int step = (int) img.step;
 
-#define GET_VALUE(idx) \
-        center[cvRound(pattern[idx].x*b + pattern[idx].y*a)*step + \
-               cvRound(pattern[idx].x*a - pattern[idx].y*b)]
-
+        int offsets0[256], offsets1[256];
+        SteerPattern(kpt, pattern, step, offsets0, offsets1);
 
-        for (int i = 0; i < 32; ++i, pattern += 16)
+        for (int i = 0; i < 32; ++i)
         {
-            int t0, t1, val;
-            t0 = GET_VALUE(0);
-            t1 = GET_VALUE(1);
-            val = t0 < t1;
-            t0 = GET_VALUE(2);
-            t1 = GET_VALUE(3);
-            val |= (t0 < t1) << 1;
-            t0 = GET_VALUE(4);
-            t1 = GET_VALUE(5);
-            val |= (t0 < t1) << 2;
-            t0 = GET_VALUE(6);
-            t1 = GET_VALUE(7);
-            val |= (t0 < t1) << 3;
-            t0 = GET_VALUE(8);
-            t1 = GET_VALUE(9);
-            val |= (t0 < t1) << 4;
-            t0 = GET_VALUE(10);
-            t1 = GET_VALUE(11);
-            val |= (t0 < t1) << 5;
-            t0 = GET_VALUE(12);
-            t1 = GET_VALUE(13);
-            val |= (t0 < t1) << 6;
-            t0 = GET_VALUE(14);
-            t1 = GET_VALUE(15);
-            val |= (t0 < t1) << 7;
+            int val = 0;
+            for (int k = 0; k < 8; ++k)
+                val |= (center[offsets0[8 * i + k]] < center[offsets1[8 * i + k]]) << k;
 
             desc[i] = (uchar) val;
         }
+    }
+
+#ifdef ORB_SIMD_X86
+
+    // 标量取像素，SSE比较并打包，每次处理16对采样点(2字节)。
+    __attribute__((target("sse4.1")))
+    static void computeOrbDescriptor_SSE41(const KeyPoint &kpt,
+                                           const Mat &img, const Point *pattern,
+                                           uchar *desc)
+    {
+        const uchar *center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
+        const int step = (int) img.step;
+
+        int offsets0[256], offsets1[256];
+        SteerPattern(kpt, pattern, step, offsets0, offsets1);
+
+        uchar vals0[256] __attribute__((aligned(16)));
+        uchar vals1[256] __attribute__((aligned(16)));
+        for (int i = 0; i < 256; ++i)
+        {
+            vals0[i] = center[offsets0[i]];
+            vals1[i] = center[offsets1[i]];
+        }
+
+        const __m128i zero = _mm_setzero_si128();
+        for (int i = 0; i < 256; i += 16)
+        {
+            __m128i t0 = _mm_load_si128((const __m128i *) (vals0 + i));
+            __m128i t1 = _mm_load_si128((const __m128i *) (vals1 + i));
+            // t0 < t1 <=> 饱和减法 t1 - t0 不为0
+            __m128i le = _mm_cmpeq_epi8(_mm_subs_epu8(t1, t0), zero);
+            const int mask = ~_mm_movemask_epi8(le) & 0xFFFF;
+            desc[i / 8] = (uchar) (mask & 0xFF);
+            desc[i / 8 + 1] = (uchar) (mask >> 8);
+        }
+    }
+
+    // 用gather一次读取8个采样点，每次比较得到1字节。
+    __attribute__((target("avx2")))
+    static void computeOrbDescriptor_AVX2(const KeyPoint &kpt,
+                                          const Mat &img, const Point *pattern,
+                                          uchar *desc)
+    {
+        const uchar *center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
+        const int step = (int) img.step;
 
-#undef GET_VALUE
+        int offsets0[256] __attribute__((aligned(32)));
+        int offsets1[256] __attribute__((aligned(32)));
+        SteerPattern(kpt, pattern, step, offsets0, offsets1);
+
+        // gather每次读4个字节只取最低字节，多读的3个字节落在行内或图像下面多分配的一行中(ComputeDescriptorsLevel)
+        const __m256i lowByte = _mm256_set1_epi32(0xFF);
+        const int *base = (const int *) center;
+        for (int i = 0; i < 32; ++i)
+        {
+            __m256i idx0 = _mm256_load_si256((const __m256i *) (offsets0 + 8 * i));
+            __m256i idx1 = _mm256_load_si256((const __m256i *) (offsets1 + 8 * i));
+            __m256i t0 = _mm256_and_si256(_mm256_i32gather_epi32(base, idx0, 1), lowByte);
+            __m256i t1 = _mm256_and_si256(_mm256_i32gather_epi32(base, idx1, 1), lowByte);
+            desc[i] = (uchar) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(t1, t0)));
+        }
     }
 
+#endif
+
 
     static int bit_pattern_31_[256 * 4] =
             {
@@ -421,7 +617,7 @@ namespace ORB_SLAM2
     ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels,
                                int _iniThFAST, int _minThFAST) :
             nfeatures(_nfeatures), scaleFactor(_scaleFactor), nlevels(_nlevels),
-            iniThFAST(_iniThFAST), minThFAST(_minThFAST)
+            iniThFAST(_iniThFAST), minThFAST(_minThFAST), mpThreadPool(NULL)
     {
         mvScaleFactor.resize(nlevels);
         mvLevelSigma2.resize(nlevels);
@@ -442,6 +638,15 @@ namespace ORB_SLAM2
         }
 
         mvImagePyramid.resize(nlevels);
+        mvPyramidBuffer.resize(nlevels);
+        mvBlurPyramid.resize(nlevels);
+
+        mvvLevelKeys.resize(nlevels);
+        mvvToDistributeKeys.resize(nlevels);
+        mvvCellKeys.resize(nlevels);
+        mvnLevelOffset.resize(nlevels);
+        mvNodeArena.resize(nlevels);
+        mvFastStrength.resize(nlevels);
 
         mnFeaturesPerLevel.resize(nlevels);
         float factor = 1.0f / scaleFactor;
@@ -483,272 +688,268 @@ namespace ORB_SLAM2
 
     static void computeOrientation(const Mat &image, vector<KeyPoint> &keypoints, const vector<int> &umax)
     {
+        float (*pAngleFunc)(const Mat &, Point2f, const vector<int> &) = IC_Angle;
+#ifdef ORB_SIMD_X86
+        const int nLevel = ORBextractor::GetKernelLevel();
+        if (nLevel == ORBextractor::KERNEL_AVX2)
+            pAngleFunc = IC_Angle_AVX2;
+        else if (nLevel == ORBextractor::KERNEL_SSE41)
+            pAngleFunc = IC_Angle_SSE41;
+#endif
+
         for (vector<KeyPoint>::iterator keypoint = keypoints.begin(),
                      keypointEnd = keypoints.end(); keypoint != keypointEnd; ++keypoint)
         {
-            keypoint->angle = IC_Angle(image, keypoint->pt, umax);
+            keypoint->angle = pAngleFunc(image, keypoint->pt, umax);
         }
     }
 
-    void ExtractorNode::DivideNode(ExtractorNode &n1, ExtractorNode &n2, ExtractorNode &n3, ExtractorNode &n4)
+    // 把节点分成四个子节点，父节点区间内的特征点下标按子节点稳定划分(保持原有顺序)。
+    // 非空子节点追加到vNodes中，children按左上、右上、左下、右下的顺序返回其下标，空子节点为-1。
+    static void DivideNode(ExtractorNodeArena &arena, const vector<cv::KeyPoint> &vKeys, const int nodeIdx,
+                           int children[4])
     {
-        const int halfX = ceil(static_cast<float>(UR.x - UL.x) / 2);
-        const int halfY = ceil(static_cast<float>(BR.y - UL.y) / 2);
+        // vNodes可能扩容，先拷贝父节点
+        const ExtractorNode parent = arena.vNodes[nodeIdx];
 
-        //Define boundaries of childs
-        n1.UL = UL;
-        n1.UR = cv::Point2i(UL.x + halfX, UL.y);
-        n1.BL = cv::Point2i(UL.x, UL.y + halfY);
-        n1.BR = cv::Point2i(UL.x + halfX, UL.y + halfY);
-        n1.vKeys.reserve(vKeys.size());
-
-        n2.UL = n1.UR;
-        n2.UR = UR;
-        n2.BL = n1.BR;
-        n2.BR = cv::Point2i(UR.x, UL.y + halfY);
-        n2.vKeys.reserve(vKeys.size());
-
-        n3.UL = n1.BL;
-        n3.UR = n1.BR;
-        n3.BL = BL;
-        n3.BR = cv::Point2i(n1.BR.x, BL.y);
-        n3.vKeys.reserve(vKeys.size());
-
-        n4.UL = n3.UR;
-        n4.UR = n2.BR;
-        n4.BL = n3.BR;
-        n4.BR = BR;
-        n4.vKeys.reserve(vKeys.size());
+        const int halfX = ceil(static_cast<float>(parent.x1 - parent.x0) / 2);
+        const int halfY = ceil(static_cast<float>(parent.y1 - parent.y0) / 2);
+        const int midX = parent.x0 + halfX;
+        const int midY = parent.y0 + halfY;
+
+        int *pIdx = arena.vKeyIdx.data();
+        int *pTmp = arena.vKeyIdxTmp.data();
 
         //Associate points to childs
-        for (size_t i = 0; i < vKeys.size(); i++)
+        int nCount[4] = {0, 0, 0, 0};
+        for (int k = parent.begin; k < parent.end; k++)
         {
-            const cv::KeyPoint &kp = vKeys[i];
-            if (kp.pt.x < n1.UR.x)
-            {
-                if (kp.pt.y < n1.BR.y)
-                    n1.vKeys.push_back(kp);
-                else
-                    n3.vKeys.push_back(kp);
-            }
-            else if (kp.pt.y < n1.BR.y)
-                n2.vKeys.push_back(kp);
-            else
-                n4.vKeys.push_back(kp);
+            const cv::KeyPoint &kp = vKeys[pIdx[k]];
+            nCount[(kp.pt.x < midX ? 0 : 1) + (kp.pt.y < midY ? 0 : 2)]++;
+        }
+
+        int nCursor[4];
+        nCursor[0] = parent.begin;
+        for (int q = 1; q < 4; q++)
+            nCursor[q] = nCursor[q - 1] + nCount[q - 1];
+
+        for (int k = parent.begin; k < parent.end; k++)
+        {
+            const cv::KeyPoint &kp = vKeys[pIdx[k]];
+            pTmp[nCursor[(kp.pt.x < midX ? 0 : 1) + (kp.pt.y < midY ? 0 : 2)]++] = pIdx[k];
         }
+        std::copy(pTmp + parent.begin, pTmp + parent.end, pIdx + parent.begin);
+
+        //Define boundaries of childs
+        const int vX0[4] = {parent.x0, midX, parent.x0, midX};
+        const int vX1[4] = {midX, parent.x1, midX, parent.x1};
+        const int vY0[4] = {parent.y0, parent.y0, midY, midY};
+        const int vY1[4] = {midY, midY, parent.y1, parent.y1};
 
-        if (n1.vKeys.size() == 1)
-            n1.bNoMore = true;
-        if (n2.vKeys.size() == 1)
-            n2.bNoMore = true;
-        if (n3.vKeys.size() == 1)
-            n3.bNoMore = true;
-        if (n4.vKeys.size() == 1)
-            n4.bNoMore = true;
+        int begin = parent.begin;
+        for (int q = 0; q < 4; q++)
+        {
+            if (nCount[q] == 0)
+            {
+                children[q] = -1;
+                continue;
+            }
 
+            ExtractorNode child;
+            child.x0 = vX0[q];
+            child.x1 = vX1[q];
+            child.y0 = vY0[q];
+            child.y1 = vY1[q];
+            child.begin = begin;
+            child.end = begin + nCount[q];
+            child.prev = child.next = -1;
+            child.bNoMore = nCount[q] == 1;
+
+            children[q] = (int) arena.vNodes.size();
+            arena.vNodes.push_back(child);
+            begin += nCount[q];
+        }
     }
 
-    vector<cv::KeyPoint> ORBextractor::DistributeOctTree(const vector<cv::KeyPoint> &vToDistributeKeys, const int &minX,
-                                                         const int &maxX, const int &minY, const int &maxY,
-                                                         const int &N, const int &level)
+    void ORBextractor::DistributeOctTree(const vector<cv::KeyPoint> &vToDistributeKeys, const int &minX,
+                                         const int &maxX, const int &minY, const int &maxY,
+                                         const int &N, const int &level, vector<cv::KeyPoint> &vResultKeys)
     {
+        ExtractorNodeArena &arena = mvNodeArena[level];
+        vector<ExtractorNode> &vNodes = arena.vNodes;
+        vNodes.clear();
+
+        const int nKeys = (int) vToDistributeKeys.size();
+        arena.vKeyIdx.resize(nKeys);
+        arena.vKeyIdxTmp.resize(nKeys);
+
+        // 节点链表，新节点插入头部，顺序与原先的std::list实现一致
+        int head = -1;
+        int nNodes = 0;
+
+        auto pushFront = [&](const int i)
+        {
+            vNodes[i].prev = -1;
+            vNodes[i].next = head;
+            if (head >= 0)
+                vNodes[head].prev = i;
+            head = i;
+            nNodes++;
+        };
+
+        // 删除节点，返回其后一个节点
+        auto erase = [&](const int i)
+        {
+            const int next = vNodes[i].next;
+            if (vNodes[i].prev >= 0)
+                vNodes[vNodes[i].prev].next = next;
+            else
+                head = next;
+            if (next >= 0)
+                vNodes[next].prev = vNodes[i].prev;
+            nNodes--;
+            return next;
+        };
+
         // Compute how many initial nodes
         const int nIni = round(static_cast<float>(maxX - minX) / (maxY - minY));
 
         const float hX = static_cast<float>(maxX - minX) / nIni;
 
-        list<ExtractorNode> lNodes;
-
-        vector<ExtractorNode *> vpIniNodes;
-        vpIniNodes.resize(nIni);
-
         for (int i = 0; i < nIni; i++)
         {
             ExtractorNode ni;
-            ni.UL = cv::Point2i(hX * static_cast<float>(i), 0);
-            ni.UR = cv::Point2i(hX * static_cast<float>(i + 1), 0);
-            ni.BL = cv::Point2i(ni.UL.x, maxY - minY);
-            ni.BR = cv::Point2i(ni.UR.x, maxY - minY);
-            ni.vKeys.reserve(vToDistributeKeys.size());
-
-            lNodes.push_back(ni);
-            vpIniNodes[i] = &lNodes.back();
+            ni.x0 = hX * static_cast<float>(i);
+            ni.x1 = hX * static_cast<float>(i + 1);
+            ni.y0 = 0;
+            ni.y1 = maxY - minY;
+            ni.begin = ni.end = 0;
+            ni.prev = ni.next = -1;
+            ni.bNoMore = false;
+            vNodes.push_back(ni);
         }
 
         //Associate points to childs
-        for (size_t i = 0; i < vToDistributeKeys.size(); i++)
+        // 先统计每个初始节点的特征点数，再按原有顺序写入各自的区间
+        for (int i = 0; i < nKeys; i++)
+            vNodes[vToDistributeKeys[i].pt.x / hX].end++;
+
+        for (int i = 0, begin = 0; i < nIni; i++)
         {
-            const cv::KeyPoint &kp = vToDistributeKeys[i];
-            vpIniNodes[kp.pt.x / hX]->vKeys.push_back(kp);
+            const int n = vNodes[i].end;
+            vNodes[i].begin = vNodes[i].end = begin;
+            begin += n;
         }
 
-        list<ExtractorNode>::iterator lit = lNodes.begin();
+        for (int i = 0; i < nKeys; i++)
+            arena.vKeyIdx[vNodes[vToDistributeKeys[i].pt.x / hX].end++] = i;
 
-        while (lit != lNodes.end())
+        // 空节点不加入链表，只有一个点的节点不再划分
+        for (int i = nIni - 1; i >= 0; i--)
         {
-            if (lit->vKeys.size() == 1)
-            {
-                lit->bNoMore = true;
-                lit++;
-            }
-            else if (lit->vKeys.empty())
-                lit = lNodes.erase(lit);
-            else
-                lit++;
+            const int n = vNodes[i].end - vNodes[i].begin;
+            if (n == 0)
+                continue;
+            vNodes[i].bNoMore = n == 1;
+            pushFront(i);
         }
 
         bool bFinish = false;
 
         int iteration = 0;
 
-        vector<pair<int, ExtractorNode *> > vSizeAndPointerToNode;
-        vSizeAndPointerToNode.reserve(lNodes.size() * 4);
+        vector<pair<int, int> > &vSizeAndNode = arena.vSizeAndNode;
+        vector<pair<int, int> > &vPrevSizeAndNode = arena.vPrevSizeAndNode;
 
         // 根据兴趣点分布,利用N叉树方法对图像进行划分区域
         while (!bFinish)
         {
             iteration++;
 
-            int prevSize = lNodes.size();
-
-            lit = lNodes.begin();
+            int prevSize = nNodes;
 
             int nToExpand = 0;
 
-            vSizeAndPointerToNode.clear();
+            vSizeAndNode.clear();
 
-            // 将目前的子区域经行划分
-            while (lit != lNodes.end())
+            // 将目前的子区域经行划分，新节点插入头部，本轮不会再被访问
+            int i = head;
+            while (i >= 0)
             {
-                if (lit->bNoMore)
+                if (vNodes[i].bNoMore)
                 {
                     // If node only contains one point do not subdivide and continue
-                    lit++;
+                    i = vNodes[i].next;
                     continue;
                 }
-                else
-                {
-                    // If more than one point, subdivide
-                    ExtractorNode n1, n2, n3, n4;
-                    lit->DivideNode(n1, n2, n3, n4); // 再细分成四个子区域
 
-                    // Add childs if they contain points
-                    if (n1.vKeys.size() > 0)
-                    {
-                        lNodes.push_front(n1);
-                        if (n1.vKeys.size() > 1)
-                        {
-                            nToExpand++;
-                            vSizeAndPointerToNode.push_back(make_pair(n1.vKeys.size(), &lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
-                    }
-                    if (n2.vKeys.size() > 0)
-                    {
-                        lNodes.push_front(n2);
-                        if (n2.vKeys.size() > 1)
-                        {
-                            nToExpand++;
-                            vSizeAndPointerToNode.push_back(make_pair(n2.vKeys.size(), &lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
-                    }
-                    if (n3.vKeys.size() > 0)
-                    {
-                        lNodes.push_front(n3);
-                        if (n3.vKeys.size() > 1)
-                        {
-                            nToExpand++;
-                            vSizeAndPointerToNode.push_back(make_pair(n3.vKeys.size(), &lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
-                    }
-                    if (n4.vKeys.size() > 0)
+                // If more than one point, subdivide
+                int children[4];
+                DivideNode(arena, vToDistributeKeys, i, children); // 再细分成四个子区域
+
+                // Add childs if they contain points
+                for (int q = 0; q < 4; q++)
+                {
+                    if (children[q] < 0)
+                        continue;
+                    pushFront(children[q]);
+                    const int n = vNodes[children[q]].end - vNodes[children[q]].begin;
+                    if (n > 1)
                     {
-                        lNodes.push_front(n4);
-                        if (n4.vKeys.size() > 1)
-                        {
-                            nToExpand++;
-                            vSizeAndPointerToNode.push_back(make_pair(n4.vKeys.size(), &lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
+                        nToExpand++;
+                        vSizeAndNode.push_back(make_pair(n, children[q]));
                     }
-
-                    lit = lNodes.erase(lit);
-                    continue;
                 }
+
+                i = erase(i);
             }
 
             // Finish if there are more nodes than required features
             // or all nodes contain just one point
-            if ((int) lNodes.size() >= N || (int) lNodes.size() == prevSize)
+            if (nNodes >= N || nNodes == prevSize)
             {
                 bFinish = true;
             }
                 // 当再划分之后所有的Node数大于要求数目时
-            else if (((int) lNodes.size() + nToExpand * 3) > N)
+            else if ((nNodes + nToExpand * 3) > N)
             {
 
                 while (!bFinish)
                 {
 
-                    prevSize = lNodes.size();
+                    prevSize = nNodes;
 
-                    vector<pair<int, ExtractorNode *> > vPrevSizeAndPointerToNode = vSizeAndPointerToNode;
-                    vSizeAndPointerToNode.clear();
+                    vPrevSizeAndNode.swap(vSizeAndNode);
+                    vSizeAndNode.clear();
 
                     // 对需要划分的部分进行排序, 即对兴趣点数较多的区域进行划分
-                    sort(vPrevSizeAndPointerToNode.begin(), vPrevSizeAndPointerToNode.end());
-                    for (int j = vPrevSizeAndPointerToNode.size() - 1; j >= 0; j--)
+                    // 点数相同时按节点创建顺序，结果与内存地址无关
+                    sort(vPrevSizeAndNode.begin(), vPrevSizeAndNode.end());
+                    for (int j = (int) vPrevSizeAndNode.size() - 1; j >= 0; j--)
                     {
-                        ExtractorNode n1, n2, n3, n4;
-                        vPrevSizeAndPointerToNode[j].second->DivideNode(n1, n2, n3, n4);
+                        const int nodeIdx = vPrevSizeAndNode[j].second;
+
+                        int children[4];
+                        DivideNode(arena, vToDistributeKeys, nodeIdx, children);
 
                         // Add childs if they contain points
-                        if (n1.vKeys.size() > 0)
+                        for (int q = 0; q < 4; q++)
                         {
-                            lNodes.push_front(n1);
-                            if (n1.vKeys.size() > 1)
-                            {
-                                vSizeAndPointerToNode.push_back(make_pair(n1.vKeys.size(), &lNodes.front()));
-                                lNodes.front().lit = lNodes.begin();
-                            }
-                        }
-                        if (n2.vKeys.size() > 0)
-                        {
-                            lNodes.push_front(n2);
-                            if (n2.vKeys.size() > 1)
-                            {
-                                vSizeAndPointerToNode.push_back(make_pair(n2.vKeys.size(), &lNodes.front()));
-                                lNodes.front().lit = lNodes.begin();
-                            }
-                        }
-                        if (n3.vKeys.size() > 0)
-                        {
-                            lNodes.push_front(n3);
-                            if (n3.vKeys.size() > 1)
-                            {
-                                vSizeAndPointerToNode.push_back(make_pair(n3.vKeys.size(), &lNodes.front()));
-                                lNodes.front().lit = lNodes.begin();
-                            }
-                        }
-                        if (n4.vKeys.size() > 0)
-                        {
-                            lNodes.push_front(n4);
-                            if (n4.vKeys.size() > 1)
-                            {
-                                vSizeAndPointerToNode.push_back(make_pair(n4.vKeys.size(), &lNodes.front()));
-                                lNodes.front().lit = lNodes.begin();
-                            }
+                            if (children[q] < 0)
+                                continue;
+                            pushFront(children[q]);
+                            const int n = vNodes[children[q]].end - vNodes[children[q]].begin;
+                            if (n > 1)
+                                vSizeAndNode.push_back(make_pair(n, children[q]));
                         }
 
-                        lNodes.erase(vPrevSizeAndPointerToNode[j].second->lit);
+                        erase(nodeIdx);
 
-                        if ((int) lNodes.size() >= N)
+                        if (nNodes >= N)
                             break;
                     }
 
-                    if ((int) lNodes.size() >= N || (int) lNodes.size() == prevSize)
+                    if (nNodes >= N || nNodes == prevSize)
                         bFinish = true;
 
                 }
@@ -757,120 +958,334 @@ namespace ORB_SLAM2
 
         // Retain the best point in each node
         // 保留每个区域响应值最大的一个兴趣点
-        vector<cv::KeyPoint> vResultKeys;
+        vResultKeys.clear();
         vResultKeys.reserve(nfeatures);
-        for (list<ExtractorNode>::iterator lit = lNodes.begin(); lit != lNodes.end(); lit++)
+        for (int i = head; i >= 0; i = vNodes[i].next)
         {
-            vector<cv::KeyPoint> &vNodeKeys = lit->vKeys;
-            cv::KeyPoint *pKP = &vNodeKeys[0];
+            const ExtractorNode &node = vNodes[i];
+            const cv::KeyPoint *pKP = &vToDistributeKeys[arena.vKeyIdx[node.begin]];
             float maxResponse = pKP->response;
 
-            for (size_t k = 1; k < vNodeKeys.size(); k++)
+            for (int k = node.begin + 1; k < node.end; k++)
             {
-                if (vNodeKeys[k].response > maxResponse)
+                const cv::KeyPoint &kp = vToDistributeKeys[arena.vKeyIdx[k]];
+                if (kp.response > maxResponse)
                 {
-                    pKP = &vNodeKeys[k];
-                    maxResponse = vNodeKeys[k].response;
+                    pKP = &kp;
+                    maxResponse = kp.response;
                 }
             }
 
             vResultKeys.push_back(*pKP);
         }
+    }
 
-        return vResultKeys;
+    // FAST-9圆周上16个像素相对于中心的偏移，顺序与cv::FAST相同，后9个重复前9个以便处理跨越起点的连续弧。
+    static void MakeFastOffsets(const int step, int pixel[25])
+    {
+        static const int offsets[16][2] =
+                {{0,  3}, {1,  3}, {2,  2}, {3,  1}, {3,  0}, {3,  -1}, {2,  -2}, {1,  -3},
+                 {0, -3}, {-1, -3}, {-2, -2}, {-3, -1}, {-3, 0}, {-3, 1}, {-2, 2}, {-1, 3}};
+
+        for (int k = 0; k < 16; k++)
+            pixel[k] = offsets[k][0] + offsets[k][1] * step;
+        for (int k = 16; k < 25; k++)
+            pixel[k] = pixel[k - 16];
     }
 
-    void ORBextractor::ComputeKeyPointsOctTree(vector<vector<KeyPoint> > &allKeypoints)
+    // FAST角点强度：圆周上连续9个像素与中心灰度差(同号)绝对值的最小值，在所有起点中取最大。
+    // 对任意阈值th，像素是角点当且仅当强度大于th，cv::FAST非极大值抑制使用的响应值为强度减1。
+    static int FastCornerStrength(const uchar *ptr, const int pixel[25])
     {
-        allKeypoints.resize(nlevels);
+        const int v = ptr[0];
+        int d[25];
+        for (int k = 0; k < 25; k++)
+            d[k] = v - ptr[pixel[k]];
 
-        const float W = 30;
+        int a0 = 0, b0 = 0;
+        for (int k = 0; k < 16; k++)
+        {
+            int a = d[k], b = -d[k];
+            for (int m = 1; m < 9; m++)
+            {
+                a = std::min(a, d[k + m]);
+                b = std::min(b, -d[k + m]);
+            }
+            a0 = std::max(a0, a);
+            b0 = std::max(b0, b);
+        }
 
-        // 对每一层图像做处理
-        for (int level = 0; level < nlevels; ++level)
+        return std::max(a0, b0);
+    }
+
+    // 计算一行中[xStart,xEnd)各像素的角点强度，在阈值th下不是角点的记为0。
+    static void FastStrengthRow(const uchar *ptr, uchar *strength, const int xStart, const int xEnd,
+                                const int pixel[25], const int th)
+    {
+        for (int x = xStart; x < xEnd; x++)
         {
-            const int minBorderX = EDGE_THRESHOLD - 3;
-            const int minBorderY = minBorderX;
-            const int maxBorderX = mvImagePyramid[level].cols - EDGE_THRESHOLD + 3;
-            const int maxBorderY = mvImagePyramid[level].rows - EDGE_THRESHOLD + 3;
+            const uchar *p = ptr + x;
+            const int hi = p[0] + th, lo = p[0] - th;
+
+            // 连续9个像素必然包含每组对径点中的一个，先用0/8和4/12两组快速排除
+            const bool bBright = (p[pixel[0]] > hi || p[pixel[8]] > hi) && (p[pixel[4]] > hi || p[pixel[12]] > hi);
+            const bool bDark = (p[pixel[0]] < lo || p[pixel[8]] < lo) && (p[pixel[4]] < lo || p[pixel[12]] < lo);
+            if (!bBright && !bDark)
+            {
+                strength[x] = 0;
+                continue;
+            }
 
-            vector<cv::KeyPoint> vToDistributeKeys;
-            vToDistributeKeys.reserve(nfeatures * 10);
+            const int s = FastCornerStrength(p, pixel);
+            strength[x] = (uchar) (s > th ? s : 0);
+        }
+    }
 
-            const float width = (maxBorderX - minBorderX);
-            const float height = (maxBorderY - minBorderY);
+#ifdef ORB_SIMD_X86
+
+    // AVX2版本，一次检测32个像素，只对检测到的角点计算强度。
+    __attribute__((target("avx2")))
+    static void FastStrengthRow_AVX2(const uchar *ptr, uchar *strength, const int xStart, const int xEnd,
+                                     const int pixel[25], const int th)
+    {
+        // 异或0x80后用有符号比较实现无符号比较
+        const __m256i delta = _mm256_set1_epi8((char) 0x80);
+        const __m256i t = _mm256_set1_epi8((char) th);
+        const __m256i K8 = _mm256_set1_epi8(8);
 
-            const int nCols = width / W;
-            const int nRows = height / W;
-            const int wCell = ceil(width / nCols);
-            const int hCell = ceil(height / nRows);
+        int x = xStart;
+        for (; x + 32 <= xEnd; x += 32)
+        {
+            const uchar *p = ptr + x;
+            __m256i v = _mm256_loadu_si256((const __m256i *) p);
+            const __m256i v0 = _mm256_xor_si256(_mm256_adds_epu8(v, t), delta);
+            const __m256i v1 = _mm256_xor_si256(_mm256_subs_epu8(v, t), delta);
+
+            _mm256_storeu_si256((__m256i *) (strength + x), _mm256_setzero_si256());
+
+            // 快速排除：角点必须有两个相邻的四分点同时偏亮或偏暗
+            __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (p + pixel[0])), delta);
+            __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (p + pixel[4])), delta);
+            __m256i x2 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (p + pixel[8])), delta);
+            __m256i x3 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (p + pixel[12])), delta);
+
+            __m256i b0 = _mm256_cmpgt_epi8(x0, v0), b1 = _mm256_cmpgt_epi8(x1, v0);
+            __m256i b2 = _mm256_cmpgt_epi8(x2, v0), b3 = _mm256_cmpgt_epi8(x3, v0);
+            __m256i d0 = _mm256_cmpgt_epi8(v1, x0), d1 = _mm256_cmpgt_epi8(v1, x1);
+            __m256i d2 = _mm256_cmpgt_epi8(v1, x2), d3 = _mm256_cmpgt_epi8(v1, x3);
+
+            __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(b0, b1), _mm256_and_si256(b1, b2)),
+                                        _mm256_or_si256(_mm256_and_si256(b2, b3), _mm256_and_si256(b3, b0)));
+            m = _mm256_or_si256(m, _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(d0, d1), _mm256_and_si256(d1, d2)),
+                                                   _mm256_or_si256(_mm256_and_si256(d2, d3), _mm256_and_si256(d3, d0))));
+            if (_mm256_movemask_epi8(m) == 0)
+                continue;
 
-            for (int i = 0; i < nRows; i++)
+            // 统计连续偏亮/偏暗像素的最大长度
+            __m256i c0 = _mm256_setzero_si256(), c1 = _mm256_setzero_si256();
+            __m256i max0 = _mm256_setzero_si256(), max1 = _mm256_setzero_si256();
+            for (int k = 0; k < 25; k++)
             {
-                const float iniY = minBorderY + i * hCell;
-                float maxY = iniY + hCell + 6;
+                __m256i xk = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (p + pixel[k])), delta);
+                __m256i m0 = _mm256_cmpgt_epi8(xk, v0);
+                __m256i m1 = _mm256_cmpgt_epi8(v1, xk);
 
-                if (iniY >= maxBorderY - 3)
-                    continue;
-                if (maxY > maxBorderY)
-                    maxY = maxBorderY;
+                c0 = _mm256_and_si256(_mm256_sub_epi8(c0, m0), m0);
+                c1 = _mm256_and_si256(_mm256_sub_epi8(c1, m1), m1);
 
-                for (int j = 0; j < nCols; j++)
-                {
-                    const float iniX = minBorderX + j * wCell;
-                    float maxX = iniX + wCell + 6;
-                    if (iniX >= maxBorderX - 6)
-                        continue;
-                    if (maxX > maxBorderX)
-                        maxX = maxBorderX;
+                max0 = _mm256_max_epu8(max0, c0);
+                max1 = _mm256_max_epu8(max1, c1);
+            }
 
-                    // FAST提取兴趣点, 自适应阈值
-                    vector<cv::KeyPoint> vKeysCell;
-                    FAST(mvImagePyramid[level].rowRange(iniY, maxY).colRange(iniX, maxX),
-                         vKeysCell, iniThFAST, true);
+            unsigned int mask = (unsigned int) _mm256_movemask_epi8(
+                    _mm256_cmpgt_epi8(_mm256_max_epu8(max0, max1), K8));
+            while (mask)
+            {
+                const int j = __builtin_ctz(mask);
+                strength[x + j] = (uchar) FastCornerStrength(p + j, pixel);
+                mask &= mask - 1;
+            }
+        }
 
-                    if (vKeysCell.empty())
-                    {
-                        FAST(mvImagePyramid[level].rowRange(iniY, maxY).colRange(iniX, maxX),
-                             vKeysCell, minThFAST, true);
-                    }
+        FastStrengthRow(ptr, strength, x, xEnd, pixel, th);
+    }
 
-                    if (!vKeysCell.empty())
-                    {
-                        for (vector<cv::KeyPoint>::iterator vit = vKeysCell.begin(); vit != vKeysCell.end(); vit++)
-                        {
-                            (*vit).pt.x += j * wCell;
-                            (*vit).pt.y += i * hCell;
-                            vToDistributeKeys.push_back(*vit);
-                        }
-                    }
+#endif
 
-                }
+    // 按cv::FAST(阈值th，非极大值抑制)的规则，从角点强度图中取出网格[x0,x1)x[y0,y1)内的角点，坐标相对于网格左上角。
+    // 与对该网格调用cv::FAST相同：只检测距网格边界至少3个像素的点，非极大值抑制时网格外和低于阈值的点按0计。
+    static void FastCellFromStrength(const Mat &strength, const int x0, const int y0, const int x1, const int y1,
+                                     const int th, vector<KeyPoint> &keypoints)
+    {
+        keypoints.clear();
+
+        const int xs = x0 + 3, xe = x1 - 3;
+        const int ys = y0 + 3, ye = y1 - 3;
+        const int minStrength = std::min(std::max(th, 0), 255) + 1;
+
+        // 邻域像素的响应值
+        auto score = [&](const int x, const int y) -> int
+        {
+            if (x < xs || x >= xe || y < ys || y >= ye)
+                return 0;
+            const int s = strength.ptr<uchar>(y)[x];
+            return s >= minStrength ? s - 1 : 0;
+        };
+
+        for (int y = ys; y < ye; y++)
+        {
+            const uchar *row = strength.ptr<uchar>(y);
+            for (int x = xs; x < xe; x++)
+            {
+                if (row[x] < minStrength)
+                    continue;
+
+                const int s = row[x] - 1;
+                if (s > score(x - 1, y) && s > score(x + 1, y) &&
+                    s > score(x - 1, y - 1) && s > score(x, y - 1) && s > score(x + 1, y - 1) &&
+                    s > score(x - 1, y + 1) && s > score(x, y + 1) && s > score(x + 1, y + 1))
+                    keypoints.push_back(KeyPoint((float) (x - x0), (float) (y - y0), 7.f, -1, (float) s));
             }
+        }
+    }
 
-            vector<KeyPoint> &keypoints = allKeypoints[level];
-            keypoints.reserve(nfeatures);
+    void ORBextractor::ComputeKeyPointsOctTree(vector<vector<KeyPoint> > &allKeypoints)
+    {
+        allKeypoints.resize(nlevels);
 
-            // 根据mnFeaturesPerLevel,即该层的兴趣点数,对特征点进行剔除
-            keypoints = DistributeOctTree(vToDistributeKeys, minBorderX, maxBorderX,
-                                          minBorderY, maxBorderY, mnFeaturesPerLevel[level], level);
+        // 对每一层图像做处理，各层之间互不依赖，可以并行
+        if (mpThreadPool)
+            mpThreadPool->ParallelFor(nlevels, [&](int level) { ComputeKeyPointsLevel(level, allKeypoints[level]); });
+        else
+            for (int level = 0; level < nlevels; ++level)
+                ComputeKeyPointsLevel(level, allKeypoints[level]);
+    }
 
-            const int scaledPatchSize = PATCH_SIZE * mvScaleFactor[level];
+    void ORBextractor::ComputeKeyPointsLevel(const int level, vector<KeyPoint> &keypoints)
+    {
+        const float W = 30;
+
+        const int minBorderX = EDGE_THRESHOLD - 3;
+        const int minBorderY = minBorderX;
+        const int maxBorderX = mvImagePyramid[level].cols - EDGE_THRESHOLD + 3;
+        const int maxBorderY = mvImagePyramid[level].rows - EDGE_THRESHOLD + 3;
+
+        // 使用该层持久的缓存，图像分辨率不变时不再重新分配内存
+        vector<cv::KeyPoint> &vToDistributeKeys = mvvToDistributeKeys[level];
+        vToDistributeKeys.clear();
+        vToDistributeKeys.reserve(nfeatures * 10);
+
+        const float width = (maxBorderX - minBorderX);
+        const float height = (maxBorderY - minBorderY);
+
+        const int nCols = width / W;
+        const int nRows = height / W;
+        const int wCell = ceil(width / nCols);
+        const int hCell = ceil(height / nRows);
+
+        // 整层一次计算FAST角点强度，两个阈值共用，之后按网格取出角点
+        Mat &strength = mvFastStrength[level];
+        strength.create(mvImagePyramid[level].size(), CV_8UC1);
+
+        int pixel[25];
+        MakeFastOffsets((int) mvImagePyramid[level].step, pixel);
+
+        void (*pStrengthFunc)(const uchar *, uchar *, const int, const int, const int *, const int) = FastStrengthRow;
+#ifdef ORB_SIMD_X86
+        if (GetKernelLevel() == KERNEL_AVX2)
+            pStrengthFunc = FastStrengthRow_AVX2;
+#endif
+
+        // 所有网格检测区域的并集
+        const int xStart = minBorderX + 3, xEnd = maxBorderX - 3;
+        const int yStart = minBorderY + 3, yEnd = maxBorderY - 3;
+        const int lowTh = std::min(std::max(std::min(iniThFAST, minThFAST), 0), 255);
+        const int nRowsPerBlock = 16;
+        const int nBlocks = (yEnd - yStart + nRowsPerBlock - 1) / nRowsPerBlock;
+
+        auto strengthBlock = [&](const int b)
+        {
+            const int y1 = std::min(yStart + (b + 1) * nRowsPerBlock, yEnd);
+            for (int y = yStart + b * nRowsPerBlock; y < y1; y++)
+                pStrengthFunc(mvImagePyramid[level].ptr<uchar>(y), strength.ptr<uchar>(y), xStart, xEnd, pixel, lowTh);
+        };
+
+        if (mpThreadPool)
+            mpThreadPool->ParallelFor(nBlocks, strengthBlock);
+        else
+            for (int b = 0; b < nBlocks; b++)
+                strengthBlock(b);
+
+        // 在第i行第j列的网格中提取FAST角点，坐标相对于(minBorderX, minBorderY)
+        auto detectCell = [&](const int i, const int j, vector<cv::KeyPoint> &vKeysCell)
+        {
+            const float iniY = minBorderY + i * hCell;
+            float maxY = iniY + hCell + 6;
+
+            if (iniY >= maxBorderY - 3)
+                return;
+            if (maxY > maxBorderY)
+                maxY = maxBorderY;
 
-            // Add border to coordinates and scale information
-            const int nkps = keypoints.size();
-            for (int i = 0; i < nkps; i++)
+            const float iniX = minBorderX + j * wCell;
+            float maxX = iniX + wCell + 6;
+            if (iniX >= maxBorderX - 6)
+                return;
+            if (maxX > maxBorderX)
+                maxX = maxBorderX;
+
+            // FAST提取兴趣点, 自适应阈值，结果与对该网格调用cv::FAST相同
+            FastCellFromStrength(strength, iniX, iniY, maxX, maxY, iniThFAST, vKeysCell);
+
+            if (vKeysCell.empty())
+            {
+                FastCellFromStrength(strength, iniX, iniY, maxX, maxY, minThFAST, vKeysCell);
+            }
+
+            for (vector<cv::KeyPoint>::iterator vit = vKeysCell.begin(); vit != vKeysCell.end(); vit++)
             {
-                keypoints[i].pt.x += minBorderX;
-                keypoints[i].pt.y += minBorderY;
-                keypoints[i].octave = level;
-                keypoints[i].size = scaledPatchSize;
+                (*vit).pt.x += j * wCell;
+                (*vit).pt.y += i * hCell;
             }
+        };
+
+        // 每个网格写入各自的容器，再按行列顺序合并，保证并行与单线程结果一致
+        vector<vector<cv::KeyPoint> > &vCellKeys = mvvCellKeys[level];
+        vCellKeys.resize(nRows * nCols);
+
+        auto detect = [&](int c)
+        {
+            vCellKeys[c].clear();
+            detectCell(c / nCols, c % nCols, vCellKeys[c]);
+        };
+
+        if (mpThreadPool)
+            mpThreadPool->ParallelFor(nRows * nCols, detect);
+        else
+            for (int c = 0; c < nRows * nCols; c++)
+                detect(c);
+
+        for (size_t c = 0; c < vCellKeys.size(); c++)
+            vToDistributeKeys.insert(vToDistributeKeys.end(), vCellKeys[c].begin(), vCellKeys[c].end());
+
+        // 根据mnFeaturesPerLevel,即该层的兴趣点数,对特征点进行剔除
+        DistributeOctTree(vToDistributeKeys, minBorderX, maxBorderX,
+                          minBorderY, maxBorderY, mnFeaturesPerLevel[level], level, keypoints);
+
+        const int scaledPatchSize = PATCH_SIZE * mvScaleFactor[level];
+
+        // Add border to coordinates and scale information
+        const int nkps = keypoints.size();
+        for (int i = 0; i < nkps; i++)
+        {
+            keypoints[i].pt.x += minBorderX;
+            keypoints[i].pt.y += minBorderY;
+            keypoints[i].octave = level;
+            keypoints[i].size = scaledPatchSize;
         }
 
         // compute orientations
-        for (int level = 0; level < nlevels; ++level)
-            computeOrientation(mvImagePyramid[level], allKeypoints[level], umax);
+        computeOrientation(mvImagePyramid[level], keypoints, umax);
     }
 
     void ORBextractor::ComputeKeyPointsOld(std::vector<std::vector<KeyPoint> > &allKeypoints)
@@ -1057,8 +1472,17 @@ namespace ORB_SLAM2
     {
         descriptors = Mat::zeros((int) keypoints.size(), 32, CV_8UC1);
 
+        void (*pDescriptorFunc)(const KeyPoint &, const Mat &, const Point *, uchar *) = computeOrbDescriptor;
+#ifdef ORB_SIMD_X86
+        const int nLevel = ORBextractor::GetKernelLevel();
+        if (nLevel == ORBextractor::KERNEL_AVX2)
+            pDescriptorFunc = computeOrbDescriptor_AVX2;
+        else if (nLevel == ORBextractor::KERNEL_SSE41)
+            pDescriptorFunc = computeOrbDescriptor_SSE41;
+#endif
+
         for (size_t i = 0; i < keypoints.size(); i++)
-            computeOrbDescriptor(keypoints[i], image, &pattern[0], descriptors.ptr((int) i));
+            pDescriptorFunc(keypoints[i], image, &pattern[0], descriptors.ptr((int) i));
     }
 
     void ORBextractor::operator()(InputArray _image, InputArray _mask, vector<KeyPoint> &_keypoints,
@@ -1075,7 +1499,7 @@ namespace ORB_SLAM2
         ComputePyramid(image);
 
         // 计算每层图像的兴趣点
-        vector<vector<KeyPoint> > allKeypoints; // vector<vector<KeyPoint>>
+        vector<vector<KeyPoint> > &allKeypoints = mvvLevelKeys; // vector<vector<KeyPoint>>
         ComputeKeyPointsOctTree(allKeypoints);
         //ComputeKeyPointsOld(allKeypoints);
 
@@ -1095,35 +1519,54 @@ namespace ORB_SLAM2
         _keypoints.clear();
         _keypoints.reserve(nkeypoints);
 
-        int offset = 0;
-        for (int level = 0; level < nlevels; ++level)
-        {
-            vector<KeyPoint> &keypoints = allKeypoints[level];
-            int nkeypointsLevel = (int) keypoints.size();
+        // 每层描述子在descriptors中的起始行
+        vector<int> &vLevelOffset = mvnLevelOffset;
+        vLevelOffset[0] = 0;
+        for (int level = 1; level < nlevels; ++level)
+            vLevelOffset[level] = vLevelOffset[level - 1] + (int) allKeypoints[level - 1].size();
 
+        auto computeLevel = [&](int level)
+        {
+            const int nkeypointsLevel = (int) allKeypoints[level].size();
             if (nkeypointsLevel == 0)
-                continue;
+                return;
 
-            // preprocess the resized image 对图像进行高斯模糊
-            Mat workingMat = mvImagePyramid[level].clone();
-            GaussianBlur(workingMat, workingMat, Size(7, 7), 2, 2, BORDER_REFLECT_101);
+            Mat desc = descriptors.rowRange(vLevelOffset[level], vLevelOffset[level] + nkeypointsLevel);
+            ComputeDescriptorsLevel(level, allKeypoints[level], desc);
+        };
 
-            // Compute the descriptors 计算描述子
-            Mat desc = descriptors.rowRange(offset, offset + nkeypointsLevel);
-            computeDescriptors(workingMat, keypoints, desc, pattern);
+        if (mpThreadPool)
+            mpThreadPool->ParallelFor(nlevels, computeLevel);
+        else
+            for (int level = 0; level < nlevels; ++level)
+                computeLevel(level);
 
-            offset += nkeypointsLevel;
+        // And add the keypoints to the output
+        for (int level = 0; level < nlevels; ++level)
+            _keypoints.insert(_keypoints.end(), allKeypoints[level].begin(), allKeypoints[level].end());
+    }
 
-            // Scale keypoint coordinates
-            if (level != 0)
-            {
-                float scale = mvScaleFactor[level]; //getScale(level, firstLevel, scaleFactor);
-                for (vector<KeyPoint>::iterator keypoint = keypoints.begin(),
-                             keypointEnd = keypoints.end(); keypoint != keypointEnd; ++keypoint)
-                    keypoint->pt *= scale;
-            }
-            // And add the keypoints to the output
-            _keypoints.insert(_keypoints.end(), keypoints.begin(), keypoints.end());
+    void ORBextractor::ComputeDescriptorsLevel(const int level, vector<KeyPoint> &keypoints, Mat &descriptors)
+    {
+        // preprocess the resized image 对图像进行高斯模糊
+        // 结果写入持久缓存，BORDER_ISOLATED使边界处理与对拷贝后的图像模糊一致
+        // 缓存比图像多一行，AVX2描述子用gather读取最后一行的采样点时多读的3个字节不会越界
+        const Mat &image = mvImagePyramid[level];
+        Mat &blurBuffer = mvBlurPyramid[level];
+        blurBuffer.create(image.rows + 1, image.cols, image.type());
+        Mat workingMat = blurBuffer.rowRange(0, image.rows);
+        GaussianBlur(image, workingMat, Size(7, 7), 2, 2, BORDER_REFLECT_101 + BORDER_ISOLATED);
+
+        // Compute the descriptors 计算描述子
+        computeDescriptors(workingMat, keypoints, descriptors, pattern);
+
+        // Scale keypoint coordinates
+        if (level != 0)
+        {
+            float scale = mvScaleFactor[level]; //getScale(level, firstLevel, scaleFactor);
+            for (vector<KeyPoint>::iterator keypoint = keypoints.begin(),
+                         keypointEnd = keypoints.end(); keypoint != keypointEnd; ++keypoint)
+                keypoint->pt *= scale;
         }
     }
 
@@ -1138,7 +1581,10 @@ namespace ORB_SLAM2
             float scale = mvInvScaleFactor[level];
             Size sz(cvRound((float) image.cols * scale), cvRound((float) image.rows * scale));
             Size wholeSize(sz.width + EDGE_THRESHOLD * 2, sz.height + EDGE_THRESHOLD * 2);
-            Mat temp(wholeSize, image.type()), masktemp;
+
+            // 带边界的图像缓存跨帧复用，只在分辨率或类型变化时重新分配
+            Mat &temp = mvPyramidBuffer[level];
+            temp.create(wholeSize, image.type());
             mvImagePyramid[level] = temp(Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, sz.width, sz.height));
 
             // Compute the resized image
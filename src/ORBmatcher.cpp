@@ -25,10 +25,19 @@
 #include<opencv2/core/core.hpp>
 #include<opencv2/features2d/features2d.hpp>
 
-#include "Thirdparty/DBoW2/DBoW2/FeatureVector.h"
+#include "Thirdparty/DBoW2/DBoW2/FlatFeatureVector.h"
 
 #include<stdint.h>
 
+#include "ORBextractor.h"
+#include "ThreadPool.h"
+#include "Converter.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ORB_SIMD_X86
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 namespace ORB_SLAM2
@@ -60,95 +69,202 @@ namespace ORB_SLAM2
  * @return             成功匹配的数量
  * @see SearchLocalPoints() isInFrustum()
  */
-    int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint *> &vpMapPoints, const float th)
+    int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint *> &vpMapPoints, const float th,
+                                       ThreadPool *pThreadPool)
     {
+        if (pThreadPool && pThreadPool->GetNumThreads() > 0)
+            return SearchByProjectionParallel(F, vpMapPoints, th, pThreadPool);
+
         int nmatches = 0;
 
-        const bool bFactor = th != 1.0;
+        // 每个MapPoint的候选特征点，跨MapPoint复用
+        vector<size_t> vCandidates;
 
         for (size_t iMP = 0; iMP < vpMapPoints.size(); iMP++)
         {
             MapPoint *pMP = vpMapPoints[iMP];
 
-            // 判断该点是否要投影
-            if (!pMP->mbTrackInView)
+            DescriptorBlock MPdescriptor;
+            if (!ProjectionCandidates(F, pMP, th, MPdescriptor, vCandidates))
                 continue;
 
-            if (pMP->isBad())
-                continue;
+            int bestDist = 256;
+            int bestDist2 = 256;
+            int bestIdx = -1;
+            int bestIdx2 = -1;
 
-            // 通过距离预测的金字塔层数，该层数相对于当前的帧
-            const int &nPredictedLevel = pMP->mnTrackScaleLevel;
+            // Get best and second matches with near keypoints
+            // 根据描述子寻找描述子距离最小和次小的特征点
+            SearchBestDescriptor(MPdescriptor.Row(0), F.mpFeatures->mDescriptorBlock, vCandidates, bestDist, bestIdx,
+                                 bestDist2, bestIdx2);
 
-            // The size of the window will depend on the viewing direction
-            // 搜索窗口的大小取决于视角, 若当前视角和平均视角夹角接近0度时, r取一个较小的值
-            float r = RadiusByViewingCos(pMP->mTrackViewCos);
+            // Apply ratio to second match (only if best and second are in the same scale level)
+            if (bestDist <= TH_HIGH)
+            {
+                const int bestLevel = F.mpFeatures->mvKeysUn[bestIdx].octave;
+                const int bestLevel2 = bestIdx2 >= 0 ? F.mpFeatures->mvKeysUn[bestIdx2].octave : -1;
+                if (bestLevel == bestLevel2 && bestDist > mfNNratio * bestDist2)
+                    continue;
 
-            // 如果需要进行更粗糙的搜索，则增大范围
-            if (bFactor)
-                r *= th;
+                F.mvpMapPoints[bestIdx] = pMP; // 为Frame中的兴趣点增加对应的MapPoint
+                nmatches++;
+            }
+        }
 
-            // 通过投影点(投影到当前帧,见isInFrustum())以及搜索窗口和预测的尺度进行搜索, 找出附近的兴趣点
-            const vector<size_t> vIndices =
-                    F.GetFeaturesInArea(pMP->mTrackProjX, pMP->mTrackProjY, r * F.mvScaleFactors[nPredictedLevel],
-                                        nPredictedLevel - 1, nPredictedLevel);
+        return nmatches;
+    }
 
-            if (vIndices.empty())
-                continue;
+    bool ORBmatcher::ProjectionCandidates(Frame &F, MapPoint *pMP, const float th, DescriptorBlock &MPdescriptor,
+                                          vector<size_t> &vCandidates)
+    {
+        // 判断该点是否要投影
+        if (!pMP->mbTrackInView)
+            return false;
 
-            const cv::Mat MPdescriptor = pMP->GetDescriptor();
+        if (pMP->isBad())
+            return false;
 
-            int bestDist = 256;
-            int bestLevel = -1;
-            int bestDist2 = 256;
-            int bestLevel2 = -1;
-            int bestIdx = -1;
+        // 通过距离预测的金字塔层数，该层数相对于当前的帧
+        const int &nPredictedLevel = pMP->mnTrackScaleLevel;
 
-            // Get best and second matches with near keypoints
-            for (vector<size_t>::const_iterator vit = vIndices.begin(), vend = vIndices.end(); vit != vend; vit++)
-            {
-                const size_t idx = *vit;
+        // The size of the window will depend on the viewing direction
+        // 搜索窗口的大小取决于视角, 若当前视角和平均视角夹角接近0度时, r取一个较小的值
+        float r = RadiusByViewingCos(pMP->mTrackViewCos);
 
-                // 如果Frame中的该兴趣点已经有对应的MapPoint了,则退出该次循环
-                if (F.mvpMapPoints[idx])
-                    if (F.mvpMapPoints[idx]->Observations() > 0)
-                        continue;
+        // 如果需要进行更粗糙的搜索，则增大范围
+        if (th != 1.0)
+            r *= th;
 
-                if (F.mvuRight[idx] > 0)
-                {
-                    const float er = fabs(pMP->mTrackProjXR - F.mvuRight[idx]);
-                    if (er > r * F.mvScaleFactors[nPredictedLevel])
-                        continue;
-                }
+        // 通过投影点(投影到当前帧,见isInFrustum())以及搜索窗口和预测的尺度进行搜索, 找出附近的兴趣点
+        const vector<size_t> vIndices =
+                F.GetFeaturesInArea(pMP->mTrackProjX, pMP->mTrackProjY, r * F.mvScaleFactors[nPredictedLevel],
+                                    nPredictedLevel - 1, nPredictedLevel);
 
-                const cv::Mat &d = F.mDescriptors.row(idx);
+        if (vIndices.empty())
+            return false;
 
-                const int dist = DescriptorDistance(MPdescriptor, d);
+        MPdescriptor = pMP->GetDescriptorBlock();
 
-                // 根据描述子寻找描述子距离最小和次小的特征点
-                if (dist < bestDist)
-                {
-                    bestDist2 = bestDist;
-                    bestDist = dist;
-                    bestLevel2 = bestLevel;
-                    bestLevel = F.mvKeysUn[idx].octave;
-                    bestIdx = idx;
-                }
-                else if (dist < bestDist2)
-                {
-                    bestLevel2 = F.mvKeysUn[idx].octave;
-                    bestDist2 = dist;
-                }
+        // 如果Frame中的该兴趣点已经有对应的MapPoint了,则不参与匹配
+        vCandidates.clear();
+        for (vector<size_t>::const_iterator vit = vIndices.begin(), vend = vIndices.end(); vit != vend; vit++)
+        {
+            const size_t idx = *vit;
+
+            if (F.mvpMapPoints[idx])
+                if (F.mvpMapPoints[idx]->Observations() > 0)
+                    continue;
+
+            if (F.mpFeatures->mvuRight[idx] > 0)
+            {
+                const float er = fabs(pMP->mTrackProjXR - F.mpFeatures->mvuRight[idx]);
+                if (er > r * F.mvScaleFactors[nPredictedLevel])
+                    continue;
             }
 
-            // Apply ratio to second match (only if best and second are in the same scale level)
-            if (bestDist <= TH_HIGH)
+            vCandidates.push_back(idx);
+        }
+
+        return true;
+    }
+
+    // 一组连续MapPoint的候选特征点及描述子距离
+    struct ProjectionBlock
+    {
+        // 第i个MapPoint的候选为[vnBegin[i],vnBegin[i+1])
+        vector<int> vnBegin;
+        vector<size_t> vIndices;
+        vector<int> vDist;
+    };
+
+    int ORBmatcher::SearchByProjectionParallel(Frame &F, const vector<MapPoint *> &vpMapPoints, const float th,
+                                               ThreadPool *pThreadPool)
+    {
+        // 步骤1：并行投影搜索并计算所有候选的描述子距离，此时只读F。
+        // 串行版本中前面的MapPoint匹配的特征点不再参与后面MapPoint的匹配，
+        // 所以步骤2按原顺序重放最小、次小距离的选择，结果与串行版本完全一致。
+        const int BLOCK_SIZE = 64;
+        const int nMPs = (int) vpMapPoints.size();
+        const int nBlocks = (nMPs + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+        vector<ProjectionBlock> vBlocks(nBlocks);
+
+        pThreadPool->ParallelFor(nBlocks, [&](int iBlock)
+        {
+            ProjectionBlock &block = vBlocks[iBlock];
+            const int iBegin = iBlock * BLOCK_SIZE;
+            const int iEnd = std::min(iBegin + BLOCK_SIZE, nMPs);
+
+            vector<size_t> vCandidates;
+            block.vnBegin.resize(iEnd - iBegin + 1);
+            for (int iMP = iBegin; iMP < iEnd; iMP++)
             {
-                if (bestLevel == bestLevel2 && bestDist > mfNNratio * bestDist2)
+                block.vnBegin[iMP - iBegin] = (int) block.vIndices.size();
+
+                DescriptorBlock MPdescriptor;
+                if (!ProjectionCandidates(F, vpMapPoints[iMP], th, MPdescriptor, vCandidates) ||
+                    vCandidates.empty())
                     continue;
 
-                F.mvpMapPoints[bestIdx] = pMP; // 为Frame中的兴趣点增加对应的MapPoint
-                nmatches++;
+                const size_t nBegin = block.vIndices.size();
+                block.vIndices.insert(block.vIndices.end(), vCandidates.begin(), vCandidates.end());
+                block.vDist.resize(block.vIndices.size());
+                DescriptorDistances(MPdescriptor.Row(0), F.mpFeatures->mDescriptorBlock, &vCandidates[0],
+                                    (int) vCandidates.size(), &block.vDist[nBegin]);
+            }
+            block.vnBegin[iEnd - iBegin] = (int) block.vIndices.size();
+        });
+
+        // 步骤2：按顺序选择匹配，跳过本次已经被前面的MapPoint匹配的特征点
+        int nmatches = 0;
+        vector<bool> vbMatched(F.N, false);
+
+        for (int iBlock = 0; iBlock < nBlocks; iBlock++)
+        {
+            const ProjectionBlock &block = vBlocks[iBlock];
+            const int iBegin = iBlock * BLOCK_SIZE;
+
+            for (int i = 0, iend = (int) block.vnBegin.size() - 1; i < iend; i++)
+            {
+                int bestDist = 256;
+                int bestDist2 = 256;
+                int bestIdx = -1;
+                int bestIdx2 = -1;
+
+                for (int k = block.vnBegin[i]; k < block.vnBegin[i + 1]; k++)
+                {
+                    const size_t idx = block.vIndices[k];
+
+                    if (vbMatched[idx])
+                        if (F.mvpMapPoints[idx]->Observations() > 0)
+                            continue;
+
+                    const int dist = block.vDist[k];
+                    if (dist < bestDist)
+                    {
+                        bestDist2 = bestDist;
+                        bestIdx2 = bestIdx;
+                        bestDist = dist;
+                        bestIdx = (int) idx;
+                    }
+                    else if (dist < bestDist2)
+                    {
+                        bestDist2 = dist;
+                        bestIdx2 = (int) idx;
+                    }
+                }
+
+                if (bestDist <= TH_HIGH)
+                {
+                    const int bestLevel = F.mpFeatures->mvKeysUn[bestIdx].octave;
+                    const int bestLevel2 = bestIdx2 >= 0 ? F.mpFeatures->mvKeysUn[bestIdx2].octave : -1;
+                    if (bestLevel == bestLevel2 && bestDist > mfNNratio * bestDist2)
+                        continue;
+
+                    F.mvpMapPoints[bestIdx] = vpMapPoints[iBegin + i];
+                    vbMatched[bestIdx] = true;
+                    nmatches++;
+                }
             }
         }
 
@@ -210,7 +326,12 @@ namespace ORB_SLAM2
 
         vpMapPointMatches = vector<MapPoint *>(F.N, static_cast<MapPoint *>(NULL));
 
-        const DBoW2::FeatureVector &vFeatVecKF = pKF->mFeatVec;
+        // 关键帧的特征数据，换出时读入
+        const std::shared_ptr<const KeyFrameFeatures> pFeaturesKF = pKF->GetFeatures();
+        if (!pFeaturesKF)
+            return 0;
+        const DBoW2::FlatFeatureVector &vFeatVecKF = pFeaturesKF->mFeatVec;
+        const DBoW2::FlatFeatureVector &vFeatVecF = F.mpFeatures->mFeatVec;
 
         int nmatches = 0;
 
@@ -219,22 +340,28 @@ namespace ORB_SLAM2
             rotHist[i].reserve(500);
         const float factor = 1.0f / HISTO_LENGTH;
 
+        // F中尚未匹配的候选特征点
+        vector<size_t> vCandidates;
+
         // We perform the matching over ORB that belong to the same vocabulary node (at a certain level)
         // 将属于同一节点(特定层)的ORB特征进行匹配
-        DBoW2::FeatureVector::const_iterator KFit = vFeatVecKF.begin();
-        DBoW2::FeatureVector::const_iterator Fit = F.mFeatVec.begin();
-        DBoW2::FeatureVector::const_iterator KFend = vFeatVecKF.end();
-        DBoW2::FeatureVector::const_iterator Fend = F.mFeatVec.end();
+        // 节点按id排序，各节点的特征点索引连续存放，直接取指针，不再拷贝索引
+        size_t KFit = 0;
+        size_t Fit = 0;
+        const size_t KFend = vFeatVecKF.size();
+        const size_t Fend = vFeatVecF.size();
 
         while (KFit != KFend && Fit != Fend)
         {
-            if (KFit->first == Fit->first) //步骤1：分别取出属于同一node的ORB特征点(只有属于同一node，才有可能是匹配点)
+            if (vFeatVecKF.nodeId(KFit) == vFeatVecF.nodeId(Fit)) //步骤1：分别取出属于同一node的ORB特征点(只有属于同一node，才有可能是匹配点)
             {
-                const vector<unsigned int> vIndicesKF = KFit->second;
-                const vector<unsigned int> vIndicesF = Fit->second;
+                const unsigned int *vIndicesKF = vFeatVecKF.features(KFit);
+                const unsigned int *vIndicesF = vFeatVecF.features(Fit);
+                const size_t nIndicesKF = vFeatVecKF.nFeatures(KFit);
+                const size_t nIndicesF = vFeatVecF.nFeatures(Fit);
 
                 // 步骤2：遍历KF中属于该node的特征点
-                for (size_t iKF = 0; iKF < vIndicesKF.size(); iKF++)
+                for (size_t iKF = 0; iKF < nIndicesKF; iKF++)
                 {
                     const unsigned int realIdxKF = vIndicesKF[iKF];
 
@@ -246,36 +373,28 @@ namespace ORB_SLAM2
                     if (pMP->isBad())
                         continue;
 
-                    const cv::Mat &dKF = pKF->mDescriptors.row(realIdxKF); // 取出KF中该特征对应的描述子
+                    const uchar *dKF = pFeaturesKF->mDescriptorBlock.Row(realIdxKF); // 取出KF中该特征对应的描述子
 
                     int bestDist1 = 256; // 最好的距离（最小距离）
                     int bestIdxF = -1;
                     int bestDist2 = 256; // 倒数第二好距离（倒数第二小距离）
+                    int bestIdxF2 = -1;
 
                     // 步骤3：遍历F中属于该node的特征点，找到了最佳匹配点
-                    for (size_t iF = 0; iF < vIndicesF.size(); iF++)
+                    vCandidates.clear();
+                    for (size_t iF = 0; iF < nIndicesF; iF++)
                     {
                         const unsigned int realIdxF = vIndicesF[iF];
 
                         if (vpMapPointMatches[realIdxF])// 表明这个点已经被匹配过了，不再匹配，加快速度
                             continue;
 
-                        const cv::Mat &dF = F.mDescriptors.row(realIdxF); // 取出F中该特征对应的描述子
-
-                        const int dist = DescriptorDistance(dKF, dF); // 求描述子的距离
-
-                        if (dist < bestDist1)// dist < bestDist1 < bestDist2，更新bestDist1 bestDist2
-                        {
-                            bestDist2 = bestDist1;
-                            bestDist1 = dist;
-                            bestIdxF = realIdxF;
-                        }
-                        else if (dist < bestDist2)// bestDist1 < dist < bestDist2，更新bestDist2
-                        {
-                            bestDist2 = dist;
-                        }
+                        vCandidates.push_back(realIdxF);
                     }
 
+                    SearchBestDescriptor(dKF, F.mpFeatures->mDescriptorBlock, vCandidates, bestDist1, bestIdxF, bestDist2,
+                                         bestIdxF2);
+
                     // 步骤4：根据阈值 和 角度投票剔除误匹配
                     if (bestDist1 <= TH_LOW) // 匹配距离（误差）小于阈值
                     {
@@ -286,14 +405,14 @@ namespace ORB_SLAM2
                             // 步骤5：更新特征点的MapPoint
                             vpMapPointMatches[bestIdxF] = pMP;
 
-                            const cv::KeyPoint &kp = pKF->mvKeysUn[realIdxKF];
+                            const cv::KeyPoint &kp = pFeaturesKF->mvKeysUn[realIdxKF];
 
                             if (mbCheckOrientation)
                             {
                                 // trick!
                                 // angle：每个特征点在提取描述子时的旋转主方向角度，如果图像旋转了，这个角度将发生改变
                                 // 所有的特征点的角度变化应该是一致的，通过直方图统计得到最准确的角度变化值
-                                float rot = kp.angle - F.mvKeys[bestIdxF].angle;// 该特征点的角度变化值
+                                float rot = kp.angle - F.mpFeatures->mvKeys[bestIdxF].angle;// 该特征点的角度变化值
                                 if (rot < 0.0)
                                     rot += 360.0f;
                                 int bin = round(rot * factor);// 将rot分配到bin组
@@ -311,13 +430,13 @@ namespace ORB_SLAM2
                 KFit++;
                 Fit++;
             }
-            else if (KFit->first < Fit->first)
+            else if (vFeatVecKF.nodeId(KFit) < vFeatVecF.nodeId(Fit))
             {
-                KFit = vFeatVecKF.lower_bound(Fit->first);
+                KFit = vFeatVecKF.lowerBound(vFeatVecF.nodeId(Fit), KFit);
             }
             else
             {
-                Fit = F.mFeatVec.lower_bound(KFit->first);
+                Fit = vFeatVecF.lowerBound(vFeatVecKF.nodeId(KFit), Fit);
             }
         }
 
@@ -354,6 +473,10 @@ namespace ORB_SLAM2
     int ORBmatcher::SearchByProjection(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoints,
                                        vector<MapPoint *> &vpMatched, int th)
     {
+        const std::shared_ptr<const KeyFrameFeatures> pFeaturesKF = pKF->GetFeatures();
+        if (!pFeaturesKF)
+            return 0;
+
         // Get Calibration Parameters for later projection
         const float &fx = pKF->fx;
         const float &fy = pKF->fy;
@@ -363,9 +486,9 @@ namespace ORB_SLAM2
         // Decompose Scw
         cv::Mat sRcw = Scw.rowRange(0, 3).colRange(0, 3);
         const float scw = sqrt(sRcw.row(0).dot(sRcw.row(0)));// 计算得到尺度s
-        cv::Mat Rcw = sRcw / scw;
-        cv::Mat tcw = Scw.rowRange(0, 3).col(3) / scw;// pKF坐标系下，世界坐标系到pKF的位移，方向由世界坐标系指向pKF
-        cv::Mat Ow = -Rcw.t() * tcw;// 世界坐标系下，pKF到世界坐标系的位移（世界坐标系原点相对pKF的位置），方向由pKF指向世界坐标系
+        const Eigen::Matrix3f Rcw = Converter::toMatrix3f(sRcw / scw);
+        const Eigen::Vector3f tcw = Converter::toVector3f(Scw.rowRange(0, 3).col(3) / scw);// pKF坐标系下，世界坐标系到pKF的位移，方向由世界坐标系指向pKF
+        const Eigen::Vector3f Ow = -Rcw.transpose() * tcw;// 世界坐标系下，pKF到世界坐标系的位移（世界坐标系原点相对pKF的位置），方向由pKF指向世界坐标系
 
         // Set of MapPoints already found in the KeyFrame
         // 使用set类型，并去除没有匹配的点，用于快速检索某个MapPoint是否有匹配
@@ -374,6 +497,8 @@ namespace ORB_SLAM2
 
         int nmatches = 0;
 
+        vector<size_t> vCandidates;
+
         // For each Candidate MapPoint Project and Match
         // 遍历所有的MapPoints
         for (int iMP = 0, iendMP = vpPoints.size(); iMP < iendMP; iMP++)
@@ -386,19 +511,19 @@ namespace ORB_SLAM2
                 continue;
 
             // Get 3D Coords.
-            cv::Mat p3Dw = pMP->GetWorldPos();
+            const Eigen::Vector3f p3Dw = pMP->GetWorldPosEigen();
 
             // Transform into Camera Coords.
-            cv::Mat p3Dc = Rcw * p3Dw + tcw;
+            const Eigen::Vector3f p3Dc = Rcw * p3Dw + tcw;
 
             // Depth must be positive
-            if (p3Dc.at<float>(2) < 0.0)
+            if (p3Dc(2) < 0.0)
                 continue;
 
             // Project into Image
-            const float invz = 1 / p3Dc.at<float>(2);
-            const float x = p3Dc.at<float>(0) * invz;
-            const float y = p3Dc.at<float>(1) * invz;
+            const float invz = 1 / p3Dc(2);
+            const float x = p3Dc(0) * invz;
+            const float y = p3Dc(1) * invz;
 
             const float u = fx * x + cx;
             const float v = fy * y + cy;
@@ -411,14 +536,14 @@ namespace ORB_SLAM2
             // 判断距离是否在尺度协方差范围内
             const float maxDistance = pMP->GetMaxDistanceInvariance();
             const float minDistance = pMP->GetMinDistanceInvariance();
-            cv::Mat PO = p3Dw - Ow;
-            const float dist = cv::norm(PO);
+            const Eigen::Vector3f PO = p3Dw - Ow;
+            const float dist = PO.norm();
 
             if (dist < minDistance || dist > maxDistance)
                 continue;
 
             // Viewing angle must be less than 60 deg
-            cv::Mat Pn = pMP->GetNormal();
+            const Eigen::Vector3f Pn = pMP->GetNormalEigen();
 
             if (PO.dot(Pn) < 0.5 * dist)
                 continue;
@@ -429,39 +554,36 @@ namespace ORB_SLAM2
             // 根据尺度确定搜索半径
             const float radius = th * pKF->mvScaleFactors[nPredictedLevel];
 
-            const vector<size_t> vIndices = pKF->GetFeaturesInArea(u, v, radius);
+            const vector<size_t> vIndices = pKF->GetFeaturesInArea(*pFeaturesKF, u, v, radius);
 
             if (vIndices.empty())
                 continue;
 
             // Match to the most similar keypoint in the radius
-            const cv::Mat dMP = pMP->GetDescriptor();
+            const DescriptorBlock dMP = pMP->GetDescriptorBlock();
 
-            int bestDist = 256;
-            int bestIdx = -1;
-            // 遍历搜索区域内所有特征点，与该MapPoint的描述子进行匹配
+            vCandidates.clear();
             for (vector<size_t>::const_iterator vit = vIndices.begin(), vend = vIndices.end(); vit != vend; vit++)
             {
                 const size_t idx = *vit;
                 if (vpMatched[idx])
                     continue;
 
-                const int &kpLevel = pKF->mvKeysUn[idx].octave;
+                const int &kpLevel = pFeaturesKF->mvKeysUn[idx].octave;
 
                 if (kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
                     continue;
 
-                const cv::Mat &dKF = pKF->mDescriptors.row(idx);
-
-                const int dist = DescriptorDistance(dMP, dKF);
-
-                if (dist < bestDist)
-                {
-                    bestDist = dist;
-                    bestIdx = idx;
-                }
+                vCandidates.push_back(idx);
             }
 
+            int bestDist = 256;
+            int bestIdx = -1;
+            int bestDist2 = 256;
+            int bestIdx2 = -1;
+            // 遍历搜索区域内所有特征点，与该MapPoint的描述子进行匹配
+            SearchBestDescriptor(dMP.Row(0), pFeaturesKF->mDescriptorBlock, vCandidates, bestDist, bestIdx, bestDist2, bestIdx2);
+
             // 该MapPoint与bestIdx对应的特征点匹配成功
             if (bestDist <= TH_LOW)
             {
@@ -478,19 +600,21 @@ namespace ORB_SLAM2
                                             vector<int> &vnMatches12, int windowSize)
     {
         int nmatches = 0;
-        vnMatches12 = vector<int>(F1.mvKeysUn.size(), -1);
+        vnMatches12 = vector<int>(F1.mpFeatures->mvKeysUn.size(), -1);
 
         vector<int> rotHist[HISTO_LENGTH];
         for (int i = 0; i < HISTO_LENGTH; i++)
             rotHist[i].reserve(500);
         const float factor = 1.0f / HISTO_LENGTH;
 
-        vector<int> vMatchedDistance(F2.mvKeysUn.size(), INT_MAX);
-        vector<int> vnMatches21(F2.mvKeysUn.size(), -1);
+        vector<int> vMatchedDistance(F2.mpFeatures->mvKeysUn.size(), INT_MAX);
+        vector<int> vnMatches21(F2.mpFeatures->mvKeysUn.size(), -1);
+
+        vector<int> vDist;
 
-        for (size_t i1 = 0, iend1 = F1.mvKeysUn.size(); i1 < iend1; i1++)
+        for (size_t i1 = 0, iend1 = F1.mpFeatures->mvKeysUn.size(); i1 < iend1; i1++)
         {
-            cv::KeyPoint kp1 = F1.mvKeysUn[i1];
+            cv::KeyPoint kp1 = F1.mpFeatures->mvKeysUn[i1];
             int level1 = kp1.octave;
             if (level1 > 0)
                 continue;
@@ -501,19 +625,20 @@ namespace ORB_SLAM2
             if (vIndices2.empty())
                 continue;
 
-            cv::Mat d1 = F1.mDescriptors.row(i1);
+            const uchar *d1 = F1.mpFeatures->mDescriptorBlock.Row(i1);
 
             int bestDist = INT_MAX;
             int bestDist2 = INT_MAX;
             int bestIdx2 = -1;
 
-            for (vector<size_t>::iterator vit = vIndices2.begin(); vit != vIndices2.end(); vit++)
-            {
-                size_t i2 = *vit;
+            vDist.resize(vIndices2.size());
+            DescriptorDistances(d1, F2.mpFeatures->mDescriptorBlock, &vIndices2[0], (int) vIndices2.size(), &vDist[0]);
 
-                cv::Mat d2 = F2.mDescriptors.row(i2);
+            for (size_t k = 0; k < vIndices2.size(); k++)
+            {
+                size_t i2 = vIndices2[k];
 
-                int dist = DescriptorDistance(d1, d2);
+                int dist = vDist[k];
 
                 if (vMatchedDistance[i2] <= dist)
                     continue;
@@ -547,7 +672,7 @@ namespace ORB_SLAM2
 
                     if (mbCheckOrientation)
                     {
-                        float rot = F1.mvKeysUn[i1].angle - F2.mvKeysUn[bestIdx2].angle;
+                        float rot = F1.mpFeatures->mvKeysUn[i1].angle - F2.mpFeatures->mvKeysUn[bestIdx2].angle;
                         if (rot < 0.0)
                             rot += 360.0f;
                         int bin = round(rot * factor);
@@ -589,7 +714,7 @@ namespace ORB_SLAM2
         //Update prev matched
         for (size_t i1 = 0, iend1 = vnMatches12.size(); i1 < iend1; i1++)
             if (vnMatches12[i1] >= 0)
-                vbPrevMatched[i1] = F2.mvKeysUn[vnMatches12[i1]].pt;
+                vbPrevMatched[i1] = F2.mpFeatures->mvKeysUn[vnMatches12[i1]].pt;
 
         return nmatches;
     }
@@ -610,17 +735,23 @@ namespace ORB_SLAM2
     {
         // 详细注释可参见：SearchByBoW(KeyFrame* pKF,Frame &F, vector<MapPoint*> &vpMapPointMatches)
 
-        const vector<cv::KeyPoint> &vKeysUn1 = pKF1->mvKeysUn;
-        const DBoW2::FeatureVector &vFeatVec1 = pKF1->mFeatVec;
         const vector<MapPoint *> vpMapPoints1 = pKF1->GetMapPointMatches();
-        const cv::Mat &Descriptors1 = pKF1->mDescriptors;
-
-        const vector<cv::KeyPoint> &vKeysUn2 = pKF2->mvKeysUn;
-        const DBoW2::FeatureVector &vFeatVec2 = pKF2->mFeatVec;
         const vector<MapPoint *> vpMapPoints2 = pKF2->GetMapPointMatches();
-        const cv::Mat &Descriptors2 = pKF2->mDescriptors;
-
         vpMatches12 = vector<MapPoint *>(vpMapPoints1.size(), static_cast<MapPoint *>(NULL));
+
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures1 = pKF1->GetFeatures();
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures2 = pKF2->GetFeatures();
+        if (!pFeatures1 || !pFeatures2)
+            return 0;
+
+        const vector<cv::KeyPoint> &vKeysUn1 = pFeatures1->mvKeysUn;
+        const DBoW2::FlatFeatureVector &vFeatVec1 = pFeatures1->mFeatVec;
+        const DescriptorBlock &Descriptors1 = pFeatures1->mDescriptorBlock;
+
+        const vector<cv::KeyPoint> &vKeysUn2 = pFeatures2->mvKeysUn;
+        const DBoW2::FlatFeatureVector &vFeatVec2 = pFeatures2->mFeatVec;
+        const DescriptorBlock &Descriptors2 = pFeatures2->mDescriptorBlock;
+
         vector<bool> vbMatched2(vpMapPoints2.size(), false);
 
         vector<int> rotHist[HISTO_LENGTH];
@@ -631,19 +762,21 @@ namespace ORB_SLAM2
 
         int nmatches = 0;
 
-        DBoW2::FeatureVector::const_iterator f1it = vFeatVec1.begin();
-        DBoW2::FeatureVector::const_iterator f2it = vFeatVec2.begin();
-        DBoW2::FeatureVector::const_iterator f1end = vFeatVec1.end();
-        DBoW2::FeatureVector::const_iterator f2end = vFeatVec2.end();
+        vector<size_t> vCandidates;
+
+        size_t f1it = 0;
+        size_t f2it = 0;
+        const size_t f1end = vFeatVec1.size();
+        const size_t f2end = vFeatVec2.size();
 
         while (f1it != f1end && f2it != f2end)
         {
-            if (f1it->first == f2it->first)//步骤1：分别取出属于同一node的ORB特征点(只有属于同一node，才有可能是匹配点)
+            if (vFeatVec1.nodeId(f1it) == vFeatVec2.nodeId(f2it))//步骤1：分别取出属于同一node的ORB特征点(只有属于同一node，才有可能是匹配点)
             {
                 // 步骤2：遍历KF中属于该node的特征点
-                for (size_t i1 = 0, iend1 = f1it->second.size(); i1 < iend1; i1++)
+                for (size_t i1 = 0, iend1 = vFeatVec1.nFeatures(f1it); i1 < iend1; i1++)
                 {
-                    const size_t idx1 = f1it->second[i1];
+                    const size_t idx1 = vFeatVec1.features(f1it)[i1];
 
                     MapPoint *pMP1 = vpMapPoints1[idx1];
                     if (!pMP1)
@@ -651,16 +784,18 @@ namespace ORB_SLAM2
                     if (pMP1->isBad())
                         continue;
 
-                    const cv::Mat &d1 = Descriptors1.row(idx1);
+                    const uchar *d1 = Descriptors1.Row(idx1);
 
                     int bestDist1 = 256;
                     int bestIdx2 = -1;
                     int bestDist2 = 256;
+                    int bestIdx22 = -1;
 
                     // 步骤3：遍历F中属于该node的特征点，找到了最佳匹配点
-                    for (size_t i2 = 0, iend2 = f2it->second.size(); i2 < iend2; i2++)
+                    vCandidates.clear();
+                    for (size_t i2 = 0, iend2 = vFeatVec2.nFeatures(f2it); i2 < iend2; i2++)
                     {
-                        const size_t idx2 = f2it->second[i2];
+                        const size_t idx2 = vFeatVec2.features(f2it)[i2];
 
                         MapPoint *pMP2 = vpMapPoints2[idx2];
 
@@ -670,22 +805,11 @@ namespace ORB_SLAM2
                         if (pMP2->isBad())
                             continue;
 
-                        const cv::Mat &d2 = Descriptors2.row(idx2);
-
-                        int dist = DescriptorDistance(d1, d2);
-
-                        if (dist < bestDist1)
-                        {
-                            bestDist2 = bestDist1;
-                            bestDist1 = dist;
-                            bestIdx2 = idx2;
-                        }
-                        else if (dist < bestDist2)
-                        {
-                            bestDist2 = dist;
-                        }
+                        vCandidates.push_back(idx2);
                     }
 
+                    SearchBestDescriptor(d1, Descriptors2, vCandidates, bestDist1, bestIdx2, bestDist2, bestIdx22);
+
                     // 步骤4：根据阈值 和 角度投票剔除误匹配
                     // 详见SearchByBoW(KeyFrame* pKF,Frame &F, vector<MapPoint*> &vpMapPointMatches)函数步骤4
                     if (bestDist1 < TH_LOW)
@@ -714,13 +838,13 @@ namespace ORB_SLAM2
                 f1it++;
                 f2it++;
             }
-            else if (f1it->first < f2it->first)
+            else if (vFeatVec1.nodeId(f1it) < vFeatVec2.nodeId(f2it))
             {
-                f1it = vFeatVec1.lower_bound(f2it->first);
+                f1it = vFeatVec1.lowerBound(vFeatVec2.nodeId(f2it), f1it);
             }
             else
             {
-                f2it = vFeatVec2.lower_bound(f1it->first);
+                f2it = vFeatVec2.lowerBound(vFeatVec1.nodeId(f1it), f2it);
             }
         }
 
@@ -760,8 +884,15 @@ namespace ORB_SLAM2
     int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F12,
                                            vector<pair<size_t, size_t> > &vMatchedPairs, const bool bOnlyStereo)
     {
-        const DBoW2::FeatureVector &vFeatVec1 = pKF1->mFeatVec;
-        const DBoW2::FeatureVector &vFeatVec2 = pKF2->mFeatVec;
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures1 = pKF1->GetFeatures();
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures2 = pKF2->GetFeatures();
+        if (!pFeatures1 || !pFeatures2)
+        {
+            vMatchedPairs.clear();
+            return 0;
+        }
+        const DBoW2::FlatFeatureVector &vFeatVec1 = pFeatures1->mFeatVec;
+        const DBoW2::FlatFeatureVector &vFeatVec2 = pFeatures2->mFeatVec;
 
         // Compute epipole in second image
         // 计算KF1的相机中心在KF2图像平面的坐标，即极点坐标
@@ -788,26 +919,29 @@ namespace ORB_SLAM2
 
         const float factor = 1.0f / HISTO_LENGTH;
 
+        vector<size_t> vCandidates;
+        vector<int> vDist;
+
         // We perform the matching over ORB that belong to the same vocabulary node (at a certain level)
         // 将属于同一节点(特定层)的ORB特征进行匹配
-        // FeatureVector的数据结构类似于：{(node1,feature_vector1) (node2,feature_vector2)...}
-        // f1it->first对应node编号，f1it->second对应属于该node的所有特特征点编号
-        DBoW2::FeatureVector::const_iterator f1it = vFeatVec1.begin();
-        DBoW2::FeatureVector::const_iterator f2it = vFeatVec2.begin();
-        DBoW2::FeatureVector::const_iterator f1end = vFeatVec1.end();
-        DBoW2::FeatureVector::const_iterator f2end = vFeatVec2.end();
+        // FlatFeatureVector按node编号排序存放：{(node1,feature_vector1) (node2,feature_vector2)...}
+        // vFeatVec1.nodeId(f1it)对应node编号，vFeatVec1.features(f1it)对应属于该node的所有特特征点编号
+        size_t f1it = 0;
+        size_t f2it = 0;
+        const size_t f1end = vFeatVec1.size();
+        const size_t f2end = vFeatVec2.size();
 
         // 步骤1：遍历pKF1和pKF2中的node节点
         while (f1it != f1end && f2it != f2end)
         {
             // 如果f1it和f2it属于同一个node节点
-            if (f1it->first == f2it->first)
+            if (vFeatVec1.nodeId(f1it) == vFeatVec2.nodeId(f2it))
             {
-                // 步骤2：遍历该node节点下(f1it->first)的所有特征点
-                for (size_t i1 = 0, iend1 = f1it->second.size(); i1 < iend1; i1++)
+                // 步骤2：遍历该node节点下(vFeatVec1.nodeId(f1it))的所有特征点
+                for (size_t i1 = 0, iend1 = vFeatVec1.nFeatures(f1it); i1 < iend1; i1++)
                 {
                     // 获取pKF1中属于该node节点的所有特征点索引
-                    const size_t idx1 = f1it->second[i1];
+                    const size_t idx1 = vFeatVec1.features(f1it)[i1];
 
                     // 步骤2.1：通过特征点索引idx1在pKF1中取出对应的MapPoint
                     MapPoint *pMP1 = pKF1->GetMapPoint(idx1);
@@ -818,26 +952,27 @@ namespace ORB_SLAM2
                         continue;
 
                     // 如果mvuRight中的值大于0，表示是双目，且该特征点有深度值
-                    const bool bStereo1 = pKF1->mvuRight[idx1] >= 0;
+                    const bool bStereo1 = pFeatures1->mvuRight[idx1] >= 0;
 
                     if (bOnlyStereo)
                         if (!bStereo1)
                             continue;
 
                     // 步骤2.2：通过特征点索引idx1在pKF1中取出对应的特征点
-                    const cv::KeyPoint &kp1 = pKF1->mvKeysUn[idx1];
+                    const cv::KeyPoint &kp1 = pFeatures1->mvKeysUn[idx1];
 
                     // 步骤2.3：通过特征点索引idx1在pKF1中取出对应的特征点的描述子
-                    const cv::Mat &d1 = pKF1->mDescriptors.row(idx1);
+                    const uchar *d1 = pFeatures1->mDescriptorBlock.Row(idx1);
 
                     int bestDist = TH_LOW;
                     int bestIdx2 = -1;
 
-                    // 步骤3：遍历该node节点下(f2it->first)的所有特征点
-                    for (size_t i2 = 0, iend2 = f2it->second.size(); i2 < iend2; i2++)
+                    // 步骤3：遍历该node节点下(vFeatVec2.nodeId(f2it))的所有特征点
+                    vCandidates.clear();
+                    for (size_t i2 = 0, iend2 = vFeatVec2.nFeatures(f2it); i2 < iend2; i2++)
                     {
                         // 获取pKF2中属于该node节点的所有特征点索引
-                        size_t idx2 = f2it->second[i2];
+                        size_t idx2 = vFeatVec2.features(f2it)[i2];
 
                         // 步骤3.1：通过特征点索引idx2在pKF2中取出对应的MapPoint
                         MapPoint *pMP2 = pKF2->GetMapPoint(idx2);
@@ -848,23 +983,33 @@ namespace ORB_SLAM2
                         if (vbMatched2[idx2] || pMP2)
                             continue;
 
-                        const bool bStereo2 = pKF2->mvuRight[idx2] >= 0;
+                        const bool bStereo2 = pFeatures2->mvuRight[idx2] >= 0;
 
                         if (bOnlyStereo)
                             if (!bStereo2)
                                 continue;
 
-                        // 步骤3.2：通过特征点索引idx2在pKF2中取出对应的特征点的描述子
-                        const cv::Mat &d2 = pKF2->mDescriptors.row(idx2);
+                        vCandidates.push_back(idx2);
+                    }
 
-                        // 计算idx1与idx2在两个关键帧中对应特征点的描述子距离
-                        const int dist = DescriptorDistance(d1, d2);
+                    // 步骤3.2：计算idx1与所有候选特征点在两个关键帧中对应的描述子距离
+                    vDist.resize(vCandidates.size());
+                    if (!vCandidates.empty())
+                        DescriptorDistances(d1, pFeatures2->mDescriptorBlock, &vCandidates[0], (int) vCandidates.size(),
+                                            &vDist[0]);
+
+                    for (size_t k = 0; k < vCandidates.size(); k++)
+                    {
+                        const size_t idx2 = vCandidates[k];
+                        const bool bStereo2 = pFeatures2->mvuRight[idx2] >= 0;
+
+                        const int dist = vDist[k];
 
                         if (dist > TH_LOW || dist > bestDist)
                             continue;
 
                         // 步骤3.3：通过特征点索引idx2在pKF2中取出对应的特征点
-                        const cv::KeyPoint &kp2 = pKF2->mvKeysUn[idx2];
+                        const cv::KeyPoint &kp2 = pFeatures2->mvKeysUn[idx2];
 
                         if (!bStereo1 && !bStereo2)
                         {
@@ -889,7 +1034,7 @@ namespace ORB_SLAM2
                     // 详见SearchByBoW(KeyFrame* pKF,Frame &F, vector<MapPoint*> &vpMapPointMatches)函数步骤4
                     if (bestIdx2 >= 0)
                     {
-                        const cv::KeyPoint &kp2 = pKF2->mvKeysUn[bestIdx2];
+                        const cv::KeyPoint &kp2 = pFeatures2->mvKeysUn[bestIdx2];
                         vMatches12[idx1] = bestIdx2;
                         nmatches++;
 
@@ -910,13 +1055,13 @@ namespace ORB_SLAM2
                 f1it++;
                 f2it++;
             }
-            else if (f1it->first < f2it->first)
+            else if (vFeatVec1.nodeId(f1it) < vFeatVec2.nodeId(f2it))
             {
-                f1it = vFeatVec1.lower_bound(f2it->first);
+                f1it = vFeatVec1.lowerBound(vFeatVec2.nodeId(f2it), f1it);
             }
             else
             {
-                f2it = vFeatVec2.lower_bound(f1it->first);
+                f2it = vFeatVec2.lowerBound(vFeatVec1.nodeId(f1it), f2it);
             }
         }
 
@@ -957,8 +1102,12 @@ namespace ORB_SLAM2
 // 将MapPoints投影到关键帧pKF中，并判断是否有重复的MapPoints，并融合。
     int ORBmatcher::Fuse(KeyFrame *pKF, const vector<MapPoint *> &vpMapPoints, const float th)
     {
-        cv::Mat Rcw = pKF->GetRotation();
-        cv::Mat tcw = pKF->GetTranslation();
+        const std::shared_ptr<const KeyFrameFeatures> pFeaturesKF = pKF->GetFeatures();
+        if (!pFeaturesKF)
+            return 0;
+
+        const Eigen::Matrix3f Rcw = Converter::toMatrix3f(pKF->GetRotation());
+        const Eigen::Vector3f tcw = Converter::toVector3f(pKF->GetTranslation());
 
         const float &fx = pKF->fx;
         const float &fy = pKF->fy;
@@ -966,12 +1115,14 @@ namespace ORB_SLAM2
         const float &cy = pKF->cy;
         const float &bf = pKF->mbf;
 
-        cv::Mat Ow = pKF->GetCameraCenter();
+        const Eigen::Vector3f Ow = pKF->GetCameraCenterEigen();
 
         int nFused = 0;
 
         const int nMPs = vpMapPoints.size();
 
+        vector<size_t> vCandidates;
+
         // 遍历所有的MapPoints
         for (int i = 0; i < nMPs; i++)
         {
@@ -983,17 +1134,17 @@ namespace ORB_SLAM2
             if (pMP->isBad() || pMP->IsInKeyFrame(pKF))
                 continue;
 
-            cv::Mat p3Dw = pMP->GetWorldPos();
-            cv::Mat p3Dc = Rcw * p3Dw + tcw;
+            const Eigen::Vector3f p3Dw = pMP->GetWorldPosEigen();
+            const Eigen::Vector3f p3Dc = Rcw * p3Dw + tcw;
 
             // Depth must be positive
             // 必须是正深度
-            if (p3Dc.at<float>(2) < 0.0f)
+            if (p3Dc(2) < 0.0f)
                 continue;
 
-            const float invz = 1 / p3Dc.at<float>(2);
-            const float x = p3Dc.at<float>(0) * invz;
-            const float y = p3Dc.at<float>(1) * invz;
+            const float invz = 1 / p3Dc(2);
+            const float x = p3Dc(0) * invz;
+            const float y = p3Dc(1) * invz;
 
             const float u = fx * x + cx;
             const float v = fy * y + cy;
@@ -1008,8 +1159,8 @@ namespace ORB_SLAM2
 
             const float maxDistance = pMP->GetMaxDistanceInvariance();
             const float minDistance = pMP->GetMinDistanceInvariance();
-            cv::Mat PO = p3Dw - Ow;
-            const float dist3D = cv::norm(PO);
+            const Eigen::Vector3f PO = p3Dw - Ow;
+            const float dist3D = PO.norm();
 
             // Depth must be inside the scale pyramid of the image
             // 深度必须在尺度金字塔范围内
@@ -1018,7 +1169,7 @@ namespace ORB_SLAM2
 
             // Viewing angle must be less than 60 deg
             // 观察视角
-            cv::Mat Pn = pMP->GetNormal();
+            const Eigen::Vector3f Pn = pMP->GetNormalEigen();
 
             if (PO.dot(Pn) < 0.5 * dist3D)
                 continue;
@@ -1029,23 +1180,22 @@ namespace ORB_SLAM2
 
             // Search in a radius
             const float radius = th * pKF->mvScaleFactors[nPredictedLevel];        // 步骤2：根据MapPoint的深度确定尺度，从而确定搜索范围
-            const vector<size_t> vIndices = pKF->GetFeaturesInArea(u, v, radius);
+            const vector<size_t> vIndices = pKF->GetFeaturesInArea(*pFeaturesKF, u, v, radius);
 
             if (vIndices.empty())
                 continue;
 
             // Match to the most similar keypoint in the radius
 
-            const cv::Mat dMP = pMP->GetDescriptor();
+            const DescriptorBlock dMP = pMP->GetDescriptorBlock();
 
-            int bestDist = 256;
-            int bestIdx = -1;
+            vCandidates.clear();
             for (vector<size_t>::const_iterator vit = vIndices.begin(), vend = vIndices.end();
                  vit != vend; vit++)// 步骤3：遍历搜索范围内的features
             {
                 const size_t idx = *vit;
 
-                const cv::KeyPoint &kp = pKF->mvKeysUn[idx];
+                const cv::KeyPoint &kp = pFeaturesKF->mvKeysUn[idx];
 
                 const int &kpLevel = kp.octave;
 
@@ -1053,12 +1203,12 @@ namespace ORB_SLAM2
                     continue;
 
                 // 计算MapPoint投影的坐标与这个区域特征点的距离，如果偏差很大，直接跳过特征点匹配
-                if (pKF->mvuRight[idx] >= 0)
+                if (pFeaturesKF->mvuRight[idx] >= 0)
                 {
                     // Check reprojection error in stereo
                     const float &kpx = kp.pt.x;
                     const float &kpy = kp.pt.y;
-                    const float &kpr = pKF->mvuRight[idx];
+                    const float &kpr = pFeaturesKF->mvuRight[idx];
                     const float ex = u - kpx;
                     const float ey = v - kpy;
                     const float er = ur - kpr;
@@ -1080,17 +1230,16 @@ namespace ORB_SLAM2
                         continue;
                 }
 
-                const cv::Mat &dKF = pKF->mDescriptors.row(idx);
-
-                const int dist = DescriptorDistance(dMP, dKF);
-
-                if (dist < bestDist)// 找MapPoint在该区域最佳匹配的特征点
-                {
-                    bestDist = dist;
-                    bestIdx = idx;
-                }
+                vCandidates.push_back(idx);
             }
 
+            // 找MapPoint在该区域最佳匹配的特征点
+            int bestDist = 256;
+            int bestIdx = -1;
+            int bestDist2 = 256;
+            int bestIdx2 = -1;
+            SearchBestDescriptor(dMP.Row(0), pFeaturesKF->mDescriptorBlock, vCandidates, bestDist, bestIdx, bestDist2, bestIdx2);
+
             // If there is already a MapPoint replace otherwise add new measurement
             if (bestDist <= TH_LOW)// 找到了MapPoint在该区域最佳匹配的特征点
             {
@@ -1123,6 +1272,10 @@ namespace ORB_SLAM2
     int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoints, float th,
                          vector<MapPoint *> &vpReplacePoint)
     {
+        const std::shared_ptr<const KeyFrameFeatures> pFeaturesKF = pKF->GetFeatures();
+        if (!pFeaturesKF)
+            return 0;
+
         // Get Calibration Parameters for later projection
         const float &fx = pKF->fx;
         const float &fy = pKF->fy;
@@ -1133,9 +1286,9 @@ namespace ORB_SLAM2
         // 将Sim3转化为SE3并分解
         cv::Mat sRcw = Scw.rowRange(0, 3).colRange(0, 3);
         const float scw = sqrt(sRcw.row(0).dot(sRcw.row(0)));// 计算得到尺度s
-        cv::Mat Rcw = sRcw / scw;// 除掉s
-        cv::Mat tcw = Scw.rowRange(0, 3).col(3) / scw;// 除掉s
-        cv::Mat Ow = -Rcw.t() * tcw;
+        const Eigen::Matrix3f Rcw = Converter::toMatrix3f(sRcw / scw);// 除掉s
+        const Eigen::Vector3f tcw = Converter::toVector3f(Scw.rowRange(0, 3).col(3) / scw);// 除掉s
+        const Eigen::Vector3f Ow = -Rcw.transpose() * tcw;
 
         // Set of MapPoints already found in the KeyFrame
         const set<MapPoint *> spAlreadyFound = pKF->GetMapPoints();
@@ -1144,6 +1297,8 @@ namespace ORB_SLAM2
 
         const int nPoints = vpPoints.size();
 
+        vector<size_t> vCandidates;
+
         // For each candidate MapPoint project and match
         // 遍历所有的MapPoints
         for (int iMP = 0; iMP < nPoints; iMP++)
@@ -1155,19 +1310,19 @@ namespace ORB_SLAM2
                 continue;
 
             // Get 3D Coords.
-            cv::Mat p3Dw = pMP->GetWorldPos();
+            const Eigen::Vector3f p3Dw = pMP->GetWorldPosEigen();
 
             // Transform into Camera Coords.
-            cv::Mat p3Dc = Rcw * p3Dw + tcw;
+            const Eigen::Vector3f p3Dc = Rcw * p3Dw + tcw;
 
             // Depth must be positive
-            if (p3Dc.at<float>(2) < 0.0f)
+            if (p3Dc(2) < 0.0f)
                 continue;
 
             // Project into Image
-            const float invz = 1.0 / p3Dc.at<float>(2);
-            const float x = p3Dc.at<float>(0) * invz;
-            const float y = p3Dc.at<float>(1) * invz;
+            const float invz = 1.0 / p3Dc(2);
+            const float x = p3Dc(0) * invz;
+            const float y = p3Dc(1) * invz;
 
             const float u = fx * x + cx;
             const float v = fy * y + cy;// 得到MapPoint在图像上的投影坐标
@@ -1180,14 +1335,14 @@ namespace ORB_SLAM2
             // 根据距离是否在图像合理金字塔尺度范围内和观测角度是否小于60度判断该MapPoint是否正常
             const float maxDistance = pMP->GetMaxDistanceInvariance();
             const float minDistance = pMP->GetMinDistanceInvariance();
-            cv::Mat PO = p3Dw - Ow;
-            const float dist3D = cv::norm(PO);
+            const Eigen::Vector3f PO = p3Dw - Ow;
+            const float dist3D = PO.norm();
 
             if (dist3D < minDistance || dist3D > maxDistance)
                 continue;
 
             // Viewing angle must be less than 60 deg
-            cv::Mat Pn = pMP->GetNormal();
+            const Eigen::Vector3f Pn = pMP->GetNormalEigen();
 
             if (PO.dot(Pn) < 0.5 * dist3D)
                 continue;
@@ -1200,36 +1355,33 @@ namespace ORB_SLAM2
             const float radius = th * pKF->mvScaleFactors[nPredictedLevel];
 
             // 收集pKF在该区域内的特征点
-            const vector<size_t> vIndices = pKF->GetFeaturesInArea(u, v, radius);
+            const vector<size_t> vIndices = pKF->GetFeaturesInArea(*pFeaturesKF, u, v, radius);
 
             if (vIndices.empty())
                 continue;
 
             // Match to the most similar keypoint in the radius
 
-            const cv::Mat dMP = pMP->GetDescriptor();
+            const DescriptorBlock dMP = pMP->GetDescriptorBlock();
 
-            int bestDist = INT_MAX;
-            int bestIdx = -1;
+            vCandidates.clear();
             for (vector<size_t>::const_iterator vit = vIndices.begin(); vit != vIndices.end(); vit++)
             {
                 const size_t idx = *vit;
-                const int &kpLevel = pKF->mvKeysUn[idx].octave;
+                const int &kpLevel = pFeaturesKF->mvKeysUn[idx].octave;
 
                 if (kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
                     continue;
 
-                const cv::Mat &dKF = pKF->mDescriptors.row(idx);
-
-                int dist = DescriptorDistance(dMP, dKF);
-
-                if (dist < bestDist)
-                {
-                    bestDist = dist;
-                    bestIdx = idx;
-                }
+                vCandidates.push_back(idx);
             }
 
+            int bestDist = INT_MAX;
+            int bestIdx = -1;
+            int bestDist2 = INT_MAX;
+            int bestIdx2 = -1;
+            SearchBestDescriptor(dMP.Row(0), pFeaturesKF->mDescriptorBlock, vCandidates, bestDist, bestIdx, bestDist2, bestIdx2);
+
             // If there is already a MapPoint replace otherwise add new measurement
             if (bestDist <= TH_LOW)
             {
@@ -1258,6 +1410,11 @@ namespace ORB_SLAM2
     int ORBmatcher::SearchBySim3(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &vpMatches12,
                                  const float &s12, const cv::Mat &R12, const cv::Mat &t12, const float th)
     {
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures1 = pKF1->GetFeatures();
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures2 = pKF2->GetFeatures();
+        if (!pFeatures1 || !pFeatures2)
+            return 0;
+
         // 步骤1：变量初始化
         const float &fx = pKF1->fx;
         const float &fy = pKF1->fy;
@@ -1287,6 +1444,8 @@ namespace ORB_SLAM2
         vector<bool> vbAlreadyMatched1(N1, false);// 用于记录该特征点是否被处理过
         vector<bool> vbAlreadyMatched2(N2, false);// 用于记录该特征点是否在pKF1中有匹配
 
+        vector<size_t> vCandidates;
+
         // 步骤2：用vpMatches12更新vbAlreadyMatched1和vbAlreadyMatched2
         for (int i = 0; i < N1; i++)
         {
@@ -1354,37 +1513,34 @@ namespace ORB_SLAM2
             const float radius = th * pKF2->mvScaleFactors[nPredictedLevel];
 
             // 取出该区域内的所有特征点
-            const vector<size_t> vIndices = pKF2->GetFeaturesInArea(u, v, radius);
+            const vector<size_t> vIndices = pKF2->GetFeaturesInArea(*pFeatures2, u, v, radius);
 
             if (vIndices.empty())
                 continue;
 
             // Match to the most similar keypoint in the radius
-            const cv::Mat dMP = pMP->GetDescriptor();
+            const DescriptorBlock dMP = pMP->GetDescriptorBlock();
 
-            int bestDist = INT_MAX;
-            int bestIdx = -1;
-            // 遍历搜索区域内的所有特征点，与pMP进行描述子匹配
+            vCandidates.clear();
             for (vector<size_t>::const_iterator vit = vIndices.begin(), vend = vIndices.end(); vit != vend; vit++)
             {
                 const size_t idx = *vit;
 
-                const cv::KeyPoint &kp = pKF2->mvKeysUn[idx];
+                const cv::KeyPoint &kp = pFeatures2->mvKeysUn[idx];
 
                 if (kp.octave < nPredictedLevel - 1 || kp.octave > nPredictedLevel)
                     continue;
 
-                const cv::Mat &dKF = pKF2->mDescriptors.row(idx);
-
-                const int dist = DescriptorDistance(dMP, dKF);
-
-                if (dist < bestDist)
-                {
-                    bestDist = dist;
-                    bestIdx = idx;
-                }
+                vCandidates.push_back(idx);
             }
 
+            int bestDist = INT_MAX;
+            int bestIdx = -1;
+            int bestDist2 = INT_MAX;
+            int bestIdx2 = -1;
+            // 遍历搜索区域内的所有特征点，与pMP进行描述子匹配
+            SearchBestDescriptor(dMP.Row(0), pFeatures2->mDescriptorBlock, vCandidates, bestDist, bestIdx, bestDist2, bestIdx2);
+
             if (bestDist <= TH_HIGH)
             {
                 vnMatch1[i1] = bestIdx;
@@ -1438,36 +1594,33 @@ namespace ORB_SLAM2
             // Search in a radius of 2.5*sigma(ScaleLevel)
             const float radius = th * pKF1->mvScaleFactors[nPredictedLevel];
 
-            const vector<size_t> vIndices = pKF1->GetFeaturesInArea(u, v, radius);
+            const vector<size_t> vIndices = pKF1->GetFeaturesInArea(*pFeatures1, u, v, radius);
 
             if (vIndices.empty())
                 continue;
 
             // Match to the most similar keypoint in the radius
-            const cv::Mat dMP = pMP->GetDescriptor();
+            const DescriptorBlock dMP = pMP->GetDescriptorBlock();
 
-            int bestDist = INT_MAX;
-            int bestIdx = -1;
+            vCandidates.clear();
             for (vector<size_t>::const_iterator vit = vIndices.begin(), vend = vIndices.end(); vit != vend; vit++)
             {
                 const size_t idx = *vit;
 
-                const cv::KeyPoint &kp = pKF1->mvKeysUn[idx];
+                const cv::KeyPoint &kp = pFeatures1->mvKeysUn[idx];
 
                 if (kp.octave < nPredictedLevel - 1 || kp.octave > nPredictedLevel)
                     continue;
 
-                const cv::Mat &dKF = pKF1->mDescriptors.row(idx);
-
-                const int dist = DescriptorDistance(dMP, dKF);
-
-                if (dist < bestDist)
-                {
-                    bestDist = dist;
-                    bestIdx = idx;
-                }
+                vCandidates.push_back(idx);
             }
 
+            int bestDist = INT_MAX;
+            int bestIdx = -1;
+            int bestDist2 = INT_MAX;
+            int bestIdx2 = -1;
+            SearchBestDescriptor(dMP.Row(0), pFeatures1->mDescriptorBlock, vCandidates, bestDist, bestIdx, bestDist2, bestIdx2);
+
             if (bestDist <= TH_HIGH)
             {
                 vnMatch2[i2] = bestIdx;
@@ -1523,6 +1676,10 @@ namespace ORB_SLAM2
 
         const cv::Mat twc = -Rcw.t() * tcw; // twc(w)
 
+        // 投影地图点时使用Eigen，循环内不分配内存。
+        const Eigen::Matrix3f Rcwf = Converter::toMatrix3f(Rcw);
+        const Eigen::Vector3f tcwf = Converter::toVector3f(tcw);
+
         const cv::Mat Rlw = LastFrame.mTcw.rowRange(0, 3).colRange(0, 3);
         const cv::Mat tlw = LastFrame.mTcw.rowRange(0, 3).col(3); // tlw(l)
 
@@ -1533,6 +1690,8 @@ namespace ORB_SLAM2
         const bool bForward = tlc.at<float>(2) > CurrentFrame.mb && !bMono; // 非单目情况，如果Z大于基线，则表示前进
         const bool bBackward = -tlc.at<float>(2) > CurrentFrame.mb && !bMono; // 非单目情况，如果Z小于基线，则表示前进
 
+        vector<size_t> vCandidates;
+
         for (int i = 0; i < LastFrame.N; i++)
         {
             MapPoint *pMP = LastFrame.mvpMapPoints[i];
@@ -1543,12 +1702,11 @@ namespace ORB_SLAM2
                 {
                     // 对上一帧有效的MapPoints进行跟踪
                     // Project
-                    cv::Mat x3Dw = pMP->GetWorldPos();
-                    cv::Mat x3Dc = Rcw * x3Dw + tcw;
+                    const Eigen::Vector3f x3Dc = Rcwf * pMP->GetWorldPosEigen() + tcwf;
 
-                    const float xc = x3Dc.at<float>(0);
-                    const float yc = x3Dc.at<float>(1);
-                    const float invzc = 1.0 / x3Dc.at<float>(2);
+                    const float xc = x3Dc(0);
+                    const float yc = x3Dc(1);
+                    const float invzc = 1.0 / x3Dc(2);
 
                     if (invzc < 0)
                         continue;
@@ -1561,7 +1719,7 @@ namespace ORB_SLAM2
                     if (v < CurrentFrame.mnMinY || v > CurrentFrame.mnMaxY)
                         continue;
 
-                    int nLastOctave = LastFrame.mvKeys[i].octave;
+                    int nLastOctave = LastFrame.mpFeatures->mvKeys[i].octave;
 
                     // Search in a window. Size depends on scale
                     float radius = th * CurrentFrame.mvScaleFactors[nLastOctave]; // 尺度越大，搜索范围越大
@@ -1582,12 +1740,10 @@ namespace ORB_SLAM2
                     if (vIndices2.empty())
                         continue;
 
-                    const cv::Mat dMP = pMP->GetDescriptor();
-
-                    int bestDist = 256;
-                    int bestIdx2 = -1;
+                    const DescriptorBlock dMP = pMP->GetDescriptorBlock();
 
                     // 遍历满足条件的特征点
+                    vCandidates.clear();
                     for (vector<size_t>::const_iterator vit = vIndices2.begin(), vend = vIndices2.end();
                          vit != vend; vit++)
                     {
@@ -1597,26 +1753,25 @@ namespace ORB_SLAM2
                             if (CurrentFrame.mvpMapPoints[i2]->Observations() > 0)
                                 continue;
 
-                        if (CurrentFrame.mvuRight[i2] > 0)
+                        if (CurrentFrame.mpFeatures->mvuRight[i2] > 0)
                         {
                             // 双目和rgbd的情况，需要保证右图的点也在搜索半径以内
                             const float ur = u - CurrentFrame.mbf * invzc;
-                            const float er = fabs(ur - CurrentFrame.mvuRight[i2]);
+                            const float er = fabs(ur - CurrentFrame.mpFeatures->mvuRight[i2]);
                             if (er > radius)
                                 continue;
                         }
 
-                        const cv::Mat &d = CurrentFrame.mDescriptors.row(i2);
-
-                        const int dist = DescriptorDistance(dMP, d);
-
-                        if (dist < bestDist)
-                        {
-                            bestDist = dist;
-                            bestIdx2 = i2;
-                        }
+                        vCandidates.push_back(i2);
                     }
 
+                    int bestDist = 256;
+                    int bestIdx2 = -1;
+                    int bestDist2 = 256;
+                    int bestIdx22 = -1;
+                    SearchBestDescriptor(dMP.Row(0), CurrentFrame.mpFeatures->mDescriptorBlock, vCandidates, bestDist,
+                                         bestIdx2, bestDist2, bestIdx22);
+
                     // 详见SearchByBoW(KeyFrame* pKF,Frame &F, vector<MapPoint*> &vpMapPointMatches)函数步骤4
                     if (bestDist <= TH_HIGH)
                     {
@@ -1625,7 +1780,8 @@ namespace ORB_SLAM2
 
                         if (mbCheckOrientation)
                         {
-                            float rot = LastFrame.mvKeysUn[i].angle - CurrentFrame.mvKeysUn[bestIdx2].angle;
+                            float rot = LastFrame.mpFeatures->mvKeysUn[i].angle -
+                                        CurrentFrame.mpFeatures->mvKeysUn[bestIdx2].angle;
                             if (rot < 0.0)
                                 rot += 360.0f;
                             int bin = round(rot * factor);
@@ -1669,9 +1825,9 @@ namespace ORB_SLAM2
     {
         int nmatches = 0;
 
-        const cv::Mat Rcw = CurrentFrame.mTcw.rowRange(0, 3).colRange(0, 3);
-        const cv::Mat tcw = CurrentFrame.mTcw.rowRange(0, 3).col(3);
-        const cv::Mat Ow = -Rcw.t() * tcw;
+        const Eigen::Matrix3f Rcw = Converter::toMatrix3f(CurrentFrame.mTcw.rowRange(0, 3).colRange(0, 3));
+        const Eigen::Vector3f tcw = Converter::toVector3f(CurrentFrame.mTcw.rowRange(0, 3).col(3));
+        const Eigen::Vector3f Ow = -Rcw.transpose() * tcw;
 
         // Rotation Histogram (to check rotation consistency)
         vector<int> rotHist[HISTO_LENGTH];
@@ -1680,6 +1836,11 @@ namespace ORB_SLAM2
         const float factor = 1.0f / HISTO_LENGTH;
 
         const vector<MapPoint *> vpMPs = pKF->GetMapPointMatches();
+        const std::shared_ptr<const KeyFrameFeatures> pFeaturesKF = pKF->GetFeatures();
+        if (!pFeaturesKF)
+            return 0;
+
+        vector<size_t> vCandidates;
 
         for (size_t i = 0, iend = vpMPs.size(); i < iend; i++)
         {
@@ -1690,12 +1851,12 @@ namespace ORB_SLAM2
                 if (!pMP->isBad() && !sAlreadyFound.count(pMP))
                 {
                     //Project
-                    cv::Mat x3Dw = pMP->GetWorldPos();
-                    cv::Mat x3Dc = Rcw * x3Dw + tcw;
+                    const Eigen::Vector3f x3Dw = pMP->GetWorldPosEigen();
+                    const Eigen::Vector3f x3Dc = Rcw * x3Dw + tcw;
 
-                    const float xc = x3Dc.at<float>(0);
-                    const float yc = x3Dc.at<float>(1);
-                    const float invzc = 1.0 / x3Dc.at<float>(2);
+                    const float xc = x3Dc(0);
+                    const float yc = x3Dc(1);
+                    const float invzc = 1.0 / x3Dc(2);
 
                     const float u = CurrentFrame.fx * xc * invzc + CurrentFrame.cx;
                     const float v = CurrentFrame.fy * yc * invzc + CurrentFrame.cy;
@@ -1706,8 +1867,8 @@ namespace ORB_SLAM2
                         continue;
 
                     // Compute predicted scale level
-                    cv::Mat PO = x3Dw - Ow;
-                    float dist3D = cv::norm(PO);
+                    const Eigen::Vector3f PO = x3Dw - Ow;
+                    float dist3D = PO.norm();
 
                     const float maxDistance = pMP->GetMaxDistanceInvariance();
                     const float minDistance = pMP->GetMinDistanceInvariance();
@@ -1727,28 +1888,25 @@ namespace ORB_SLAM2
                     if (vIndices2.empty())
                         continue;
 
-                    const cv::Mat dMP = pMP->GetDescriptor();
-
-                    int bestDist = 256;
-                    int bestIdx2 = -1;
+                    const DescriptorBlock dMP = pMP->GetDescriptorBlock();
 
+                    vCandidates.clear();
                     for (vector<size_t>::const_iterator vit = vIndices2.begin(); vit != vIndices2.end(); vit++)
                     {
                         const size_t i2 = *vit;
                         if (CurrentFrame.mvpMapPoints[i2])
                             continue;
 
-                        const cv::Mat &d = CurrentFrame.mDescriptors.row(i2);
-
-                        const int dist = DescriptorDistance(dMP, d);
-
-                        if (dist < bestDist)
-                        {
-                            bestDist = dist;
-                            bestIdx2 = i2;
-                        }
+                        vCandidates.push_back(i2);
                     }
 
+                    int bestDist = 256;
+                    int bestIdx2 = -1;
+                    int bestDist2 = 256;
+                    int bestIdx22 = -1;
+                    SearchBestDescriptor(dMP.Row(0), CurrentFrame.mpFeatures->mDescriptorBlock, vCandidates, bestDist,
+                                         bestIdx2, bestDist2, bestIdx22);
+
                     if (bestDist <= ORBdist)
                     {
                         CurrentFrame.mvpMapPoints[bestIdx2] = pMP;
@@ -1757,7 +1915,7 @@ namespace ORB_SLAM2
                         // 详见SearchByBoW(KeyFrame* pKF,Frame &F, vector<MapPoint*> &vpMapPointMatches)函数步骤4
                         if (mbCheckOrientation)
                         {
-                            float rot = pKF->mvKeysUn[i].angle - CurrentFrame.mvKeysUn[bestIdx2].angle;
+                            float rot = pFeaturesKF->mvKeysUn[i].angle - CurrentFrame.mpFeatures->mvKeysUn[bestIdx2].angle;
                             if (rot < 0.0)
                                 rot += 360.0f;
                             int bin = round(rot * factor);
@@ -1843,22 +2001,168 @@ namespace ORB_SLAM2
 
 // Bit set count operation from
 // http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
+// 按64位字计算，描述子为32字节即4个字
     int ORBmatcher::DescriptorDistance(const cv::Mat &a, const cv::Mat &b)
     {
-        const int *pa = a.ptr<int32_t>();
-        const int *pb = b.ptr<int32_t>();
+        return DescriptorDistance(a.ptr<uchar>(), b.ptr<uchar>());
+    }
+
+    int ORBmatcher::DescriptorDistance(const uchar *a, const uchar *b)
+    {
+        const uint64_t *pa = reinterpret_cast<const uint64_t *>(a);
+        const uint64_t *pb = reinterpret_cast<const uint64_t *>(b);
 
         int dist = 0;
 
-        for (int i = 0; i < 8; i++, pa++, pb++)
+        for (int i = 0; i < 4; i++, pa++, pb++)
         {
-            unsigned int v = *pa ^*pb;
-            v = v - ((v >> 1) & 0x55555555);
-            v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
-            dist += (((v + (v >> 4)) & 0xF0F0F0F) * 0x1010101) >> 24;
+            uint64_t v = *pa ^*pb;
+            v = v - ((v >> 1) & 0x5555555555555555ULL);
+            v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+            dist += (int) ((((v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * 0x0101010101010101ULL) >> 56);
         }
 
         return dist;
     }
 
+    static void DescriptorDistancesScalar(const uchar *pa, const DescriptorBlock &descriptors, const size_t *pIndices,
+                                          const int n, int *pDist)
+    {
+        const uint64_t *a = reinterpret_cast<const uint64_t *>(pa);
+        for (int i = 0; i < n; i++)
+        {
+            const uint64_t *b = reinterpret_cast<const uint64_t *>(descriptors.Row((int) pIndices[i]));
+            int dist = 0;
+            for (int k = 0; k < 4; k++)
+            {
+                uint64_t v = a[k] ^ b[k];
+                v = v - ((v >> 1) & 0x5555555555555555ULL);
+                v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+                dist += (int) ((((v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * 0x0101010101010101ULL) >> 56);
+            }
+            pDist[i] = dist;
+        }
+    }
+
+#ifdef ORB_SIMD_X86
+
+    static bool DetectPopcnt()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("popcnt");
+    }
+
+    static const bool bHasPopcnt = DetectPopcnt();
+
+    // 硬件POPCNT，每个描述子4条popcnt指令
+    __attribute__((target("popcnt")))
+    static void DescriptorDistancesPopcnt(const uchar *pa, const DescriptorBlock &descriptors, const size_t *pIndices,
+                                          const int n, int *pDist)
+    {
+        const uint64_t *a = reinterpret_cast<const uint64_t *>(pa);
+        const uint64_t a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+        for (int i = 0; i < n; i++)
+        {
+            const uint64_t *b = reinterpret_cast<const uint64_t *>(descriptors.Row((int) pIndices[i]));
+            pDist[i] = __builtin_popcountll(a0 ^ b[0]) + __builtin_popcountll(a1 ^ b[1]) +
+                       __builtin_popcountll(a2 ^ b[2]) + __builtin_popcountll(a3 ^ b[3]);
+        }
+    }
+
+    // vpshufb查表计算每字节的1的个数，vpsadbw累加为4个64位和
+    __attribute__((target("avx2")))
+    static inline __m256i PopcntBytes_AVX2(const __m256i &x)
+    {
+        const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low = _mm256_set1_epi8(0x0f);
+        const __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)),
+                                            _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+        return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+    }
+
+    __attribute__((target("avx2")))
+    static void DescriptorDistancesAVX2(const uchar *pa, const DescriptorBlock &descriptors, const size_t *pIndices,
+                                        const int n, int *pDist)
+    {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pa));
+
+        int i = 0;
+        // 每次4个候选，4个vpsadbw结果合并为4个32位距离。候选描述子32字节对齐，查询描述子不要求对齐
+        for (; i + 4 <= n; i += 4)
+        {
+            const __m256i s0 = PopcntBytes_AVX2(_mm256_xor_si256(a, _mm256_load_si256(
+                    reinterpret_cast<const __m256i *>(descriptors.Row((int) pIndices[i])))));
+            const __m256i s1 = PopcntBytes_AVX2(_mm256_xor_si256(a, _mm256_load_si256(
+                    reinterpret_cast<const __m256i *>(descriptors.Row((int) pIndices[i + 1])))));
+            const __m256i s2 = PopcntBytes_AVX2(_mm256_xor_si256(a, _mm256_load_si256(
+                    reinterpret_cast<const __m256i *>(descriptors.Row((int) pIndices[i + 2])))));
+            const __m256i s3 = PopcntBytes_AVX2(_mm256_xor_si256(a, _mm256_load_si256(
+                    reinterpret_cast<const __m256i *>(descriptors.Row((int) pIndices[i + 3])))));
+
+            // 每个64位和不超过64，s1/s3移到高32位后与s0/s2合并
+            const __m256i t01 = _mm256_or_si256(s0, _mm256_slli_epi64(s1, 32));
+            const __m256i t23 = _mm256_or_si256(s2, _mm256_slli_epi64(s3, 32));
+            const __m256i u = _mm256_add_epi32(_mm256_unpacklo_epi64(t01, t23), _mm256_unpackhi_epi64(t01, t23));
+            const __m128i d = _mm_add_epi32(_mm256_castsi256_si128(u), _mm256_extracti128_si256(u, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pDist + i), d);
+        }
+
+        for (; i < n; i++)
+        {
+            const __m256i s = PopcntBytes_AVX2(_mm256_xor_si256(a, _mm256_load_si256(
+                    reinterpret_cast<const __m256i *>(descriptors.Row((int) pIndices[i])))));
+            const __m128i h = _mm_add_epi64(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+            pDist[i] = _mm_cvtsi128_si32(h) + _mm_extract_epi32(h, 2);
+        }
+    }
+
+#endif
+
+    void ORBmatcher::DescriptorDistances(const uchar *pa, const DescriptorBlock &descriptors, const size_t *pIndices,
+                                         const int n, int *pDist)
+    {
+#ifdef ORB_SIMD_X86
+        const int level = ORBextractor::GetKernelLevel();
+        if (level == ORBextractor::KERNEL_AVX2)
+            return DescriptorDistancesAVX2(pa, descriptors, pIndices, n, pDist);
+        if (level != ORBextractor::KERNEL_SCALAR && bHasPopcnt)
+            return DescriptorDistancesPopcnt(pa, descriptors, pIndices, n, pDist);
+#endif
+        DescriptorDistancesScalar(pa, descriptors, pIndices, n, pDist);
+    }
+
+    void ORBmatcher::SearchBestDescriptor(const uchar *a, const DescriptorBlock &descriptors,
+                                          const vector<size_t> &vIndices, int &bestDist, int &bestIdx,
+                                          int &bestDist2, int &bestIdx2)
+    {
+        // 分块计算距离，避免分配内存
+        const int CHUNK = 64;
+        int vDist[CHUNK];
+
+        const int N = (int) vIndices.size();
+        for (int i0 = 0; i0 < N; i0 += CHUNK)
+        {
+            const int n = std::min(CHUNK, N - i0);
+            DescriptorDistances(a, descriptors, &vIndices[i0], n, vDist);
+
+            for (int i = 0; i < n; i++)
+            {
+                const int dist = vDist[i];
+                if (dist < bestDist)
+                {
+                    bestDist2 = bestDist;
+                    bestIdx2 = bestIdx;
+                    bestDist = dist;
+                    bestIdx = (int) vIndices[i0 + i];
+                }
+                else if (dist < bestDist2)
+                {
+                    bestDist2 = dist;
+                    bestIdx2 = (int) vIndices[i0 + i];
+                }
+            }
+        }
+    }
+
 } //namespace ORB_SLAM
@@ -0,0 +1,97 @@
+#include "ObservationVector.h"
+#include "KeyFrame.h"
+
+#include <algorithm>
+
+
+namespace ORB_SLAM2
+{
+
+    ObservationVector::ObservationVector(const ObservationVector &other) : mpData(mInline), mnSize(0),
+                                                                          mnCapacity(INLINE_CAPACITY)
+    {
+        *this = other;
+    }
+
+    ObservationVector &ObservationVector::operator=(const ObservationVector &other)
+    {
+        if (this == &other)
+            return *this;
+
+        if (other.mnSize > mnCapacity)
+        {
+            if (mpData != mInline)
+                delete[] mpData;
+            mpData = new value_type[other.mnSize];
+            mnCapacity = other.mnSize;
+        }
+        std::copy(other.begin(), other.end(), mpData);
+        mnSize = other.mnSize;
+        return *this;
+    }
+
+    ObservationVector::iterator ObservationVector::InsertPosition(KeyFrame *pKF)
+    {
+        if (mnSize == mnCapacity)
+        {
+            value_type *pData = new value_type[2 * mnCapacity];
+            std::copy(begin(), end(), pData);
+            if (mpData != mInline)
+                delete[] mpData;
+            mpData = pData;
+            mnCapacity *= 2;
+        }
+
+        // 新关键帧的Id一般最大，从后往前找。
+        iterator it = end();
+        while (it != begin() && (it - 1)->first->mnId > pKF->mnId)
+            it--;
+        std::copy_backward(it, end(), end() + 1);
+        mnSize++;
+        return it;
+    }
+
+    bool ObservationVector::insert(KeyFrame *pKF, const size_t idx)
+    {
+        if (count(pKF))
+            return false;
+
+        iterator it = InsertPosition(pKF);
+        it->first = pKF;
+        it->second = idx;
+        return true;
+    }
+
+    size_t &ObservationVector::operator[](KeyFrame *pKF)
+    {
+        iterator it = find(pKF);
+        if (it != end())
+            return it->second;
+
+        it = InsertPosition(pKF);
+        it->first = pKF;
+        it->second = 0;
+        return it->second;
+    }
+
+    size_t ObservationVector::erase(const KeyFrame *pKF)
+    {
+        iterator it = find(pKF);
+        if (it == end())
+            return 0;
+
+        std::copy(it + 1, end(), it);
+        mnSize--;
+        return 1;
+    }
+
+    void ObservationVector::clear()
+    {
+        if (mpData != mInline)
+            delete[] mpData;
+        mpData = mInline;
+        mnSize = 0;
+        mnCapacity = INLINE_CAPACITY;
+    }
+
+} //namespace ORB_SLAM2
@@ -339,7 +339,7 @@ namespace ORB_SLAM2
         {
             MapPoint *pMP = *lit;
 
-            Vector3d Pw = Converter::toVector3d(pMP->GetWorldPos());
+            Vector3d Pw = pMP->GetWorldPosEigen().cast<double>();
             KeyFrame *pRefKF = pMP->GetReferenceKeyFrame();
 
             if (!pRefKF)
@@ -364,6 +364,10 @@ namespace ORB_SLAM2
                 continue;
             }
 
+            const std::shared_ptr<const KeyFrameFeatures> pRefFeatures = pRefKF->GetFeatures();
+            if (!pRefFeatures)
+                continue;
+
             // IDP 顶点
             int mpVertexId = pMP->mnId + maxKFid + 1;
             g2o::VertexIDP *vPoint = new g2o::VertexIDP();
@@ -379,7 +383,7 @@ namespace ORB_SLAM2
             size_t kpIdxInRefKF = observations[pRefKF];
 
             // 投影到归一化相平面
-            const cv::KeyPoint &kpRefUn = pRefKF->mvKeysUn[kpIdxInRefKF];
+            const cv::KeyPoint &kpRefUn = pRefFeatures->mvKeysUn[kpIdxInRefKF];
             double normx = (kpRefUn.pt.x - pRefKF->cx) / pRefKF->fx;
             double normy = (kpRefUn.pt.y - pRefKF->cy) / pRefKF->fy;
             vRefNormXY[mpcnt] << normx, normy;
@@ -399,10 +403,13 @@ namespace ORB_SLAM2
 
                 if (!pKFi->isBad())
                 {
-                    const cv::KeyPoint &kpUn = pKFi->mvKeysUn[mit->second];
+                    const std::shared_ptr<const KeyFrameFeatures> pFeaturesi = pKFi->GetFeatures();
+                    if (!pFeaturesi)
+                        continue;
+                    const cv::KeyPoint &kpUn = pFeaturesi->mvKeysUn[mit->second];
 
                     // 单目观测
-                    if (pKFi->mvuRight[mit->second] < 0)
+                    if (pFeaturesi->mvuRight[mit->second] < 0)
                     {
                         if (!baddmpvertex)
                         {
@@ -629,8 +636,10 @@ namespace ORB_SLAM2
     void Optimizer::GlobalBundleAdjustmentNavStatePRV(Map *pMap, const cv::Mat &gw, int nIterations, bool *pbStopFlag,
                                                       const unsigned long nLoopKF, const bool bRobust)
     {
-        vector<KeyFrame *> vpKFs = pMap->GetAllKeyFrames();
-        vector<MapPoint *> vpMP = pMap->GetAllMapPoints();
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = pMap->GetKeyFramesSnapshot();
+        const SlotMap<MapPoint>::Snapshot pvpMPs = pMap->GetMapPointsSnapshot();
+        const vector<KeyFrame *> &vpKFs = *pvpKFs;
+        const vector<MapPoint *> &vpMP = *pvpMPs;
 
         // V-I 外参
         Matrix4d Tbc = ConfigParam::GetEigTbc();
@@ -783,7 +792,7 @@ namespace ORB_SLAM2
                 continue;
 
             g2o::VertexSBAPointXYZ *vPoint = new g2o::VertexSBAPointXYZ();
-            vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
+            vPoint->setEstimate(pMP->GetWorldPosEigen().cast<double>());
             const int id = pMP->mnId + maxKFid + 1;
             vPoint->setId(id);
             vPoint->setMarginalized(true);
@@ -801,10 +810,14 @@ namespace ORB_SLAM2
                 if (pKF->isBad() || 3 * pKF->mnId > maxKFid)
                     continue;
 
+                const std::shared_ptr<const KeyFrameFeatures> pFeatures = pKF->GetFeatures();
+                if (!pFeatures)
+                    continue;
+
                 nEdges++;
 
-                const cv::KeyPoint &kpUn = pKF->mvKeysUn[mit->second];
-                if (pKF->mvuRight[mit->second] < 0)
+                const cv::KeyPoint &kpUn = pFeatures->mvKeysUn[mit->second];
+                if (pFeatures->mvuRight[mit->second] < 0)
                 {
 
                     Eigen::Matrix<double, 2, 1> obs;
@@ -1199,7 +1212,7 @@ namespace ORB_SLAM2
         {
             MapPoint *pMP = *lit;
             g2o::VertexSBAPointXYZ *vPoint = new g2o::VertexSBAPointXYZ();
-            vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
+            vPoint->setEstimate(pMP->GetWorldPosEigen().cast<double>());
             int id = pMP->mnId + maxKFid + 1;
             vPoint->setId(id);
             vPoint->setMarginalized(true);
@@ -1218,9 +1231,12 @@ namespace ORB_SLAM2
                 if (!pKFi->isBad())
                 {
 
-                    const cv::KeyPoint &kpUn = pKFi->mvKeysUn[mit->second];
+                    const std::shared_ptr<const KeyFrameFeatures> pFeaturesi = pKFi->GetFeatures();
+                    if (!pFeaturesi)
+                        continue;
+                    const cv::KeyPoint &kpUn = pFeaturesi->mvKeysUn[mit->second];
 
-                    if (pKFi->mvuRight[mit->second] < 0)
+                    if (pFeaturesi->mvuRight[mit->second] < 0)
                     {
                         Eigen::Matrix<double, 2, 1> obs;
                         obs << kpUn.pt.x, kpUn.pt.y;
@@ -1393,8 +1409,10 @@ namespace ORB_SLAM2
                                                    const unsigned long nLoopKF, const bool bRobust)
     {
 
-        vector<KeyFrame *> vpKFs = pMap->GetAllKeyFrames();
-        vector<MapPoint *> vpMP = pMap->GetAllMapPoints();
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = pMap->GetKeyFramesSnapshot();
+        const SlotMap<MapPoint>::Snapshot pvpMPs = pMap->GetMapPointsSnapshot();
+        const vector<KeyFrame *> &vpKFs = *pvpKFs;
+        const vector<MapPoint *> &vpMP = *pvpMPs;
 
         // 外参
         Matrix4d Tbc = ConfigParam::GetEigTbc();
@@ -1531,7 +1549,7 @@ namespace ORB_SLAM2
                 continue;
 
             g2o::VertexSBAPointXYZ *vPoint = new g2o::VertexSBAPointXYZ();
-            vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
+            vPoint->setEstimate(pMP->GetWorldPosEigen().cast<double>());
             const int id = pMP->mnId + maxKFid + 1;
             vPoint->setId(id);
             vPoint->setMarginalized(true);
@@ -1547,11 +1565,15 @@ namespace ORB_SLAM2
                 if (pKF->isBad() || 2 * pKF->mnId > maxKFid)
                     continue;
 
+                const std::shared_ptr<const KeyFrameFeatures> pFeatures = pKF->GetFeatures();
+                if (!pFeatures)
+                    continue;
+
                 nEdges++;
 
-                const cv::KeyPoint &kpUn = pKF->mvKeysUn[mit->second];
+                const cv::KeyPoint &kpUn = pFeatures->mvKeysUn[mit->second];
 
-                if (pKF->mvuRight[mit->second] < 0)
+                if (pFeatures->mvuRight[mit->second] < 0)
                 {
                     Eigen::Matrix<double, 2, 1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
@@ -1813,13 +1835,13 @@ namespace ORB_SLAM2
                 if (pMP)
                 {
                     // Mono
-                    if (pFrame->mvuRight[i] < 0)
+                    if (pFrame->mpFeatures->mvuRight[i] < 0)
                     {
                         nInitialCorrespondences++;
                         pFrame->mvbOutlier[i] = false;
 
                         Eigen::Matrix<double, 2, 1> obs;
-                        const cv::KeyPoint &kpUn = pFrame->mvKeysUn[i];
+                        const cv::KeyPoint &kpUn = pFrame->mpFeatures->mvKeysUn[i];
                         obs << kpUn.pt.x, kpUn.pt.y;
 
                         g2o::EdgeNavStatePVRPointXYZOnlyPose *e = new g2o::EdgeNavStatePVRPointXYZOnlyPose();
@@ -1834,7 +1856,7 @@ namespace ORB_SLAM2
                         rk->setDelta(deltaMono);
 
                         e->SetParams(pFrame->fx, pFrame->fy, pFrame->cx, pFrame->cy, Rbc, Pbc,
-                                     Converter::toVector3d(pMP->GetWorldPos()));
+                                     pMP->GetWorldPosEigen().cast<double>());
 
                         optimizer.addEdge(e);
 
@@ -1856,12 +1878,12 @@ namespace ORB_SLAM2
                 if (pMP)
                 {
                     // Mono
-                    if (pLastFrame->mvuRight[i] < 0)
+                    if (pLastFrame->mpFeatures->mvuRight[i] < 0)
                     {
                         pLastFrame->mvbOutlier[i] = false;
 
                         Eigen::Matrix<double, 2, 1> obs;
-                        const cv::KeyPoint &kpUn = pLastFrame->mvKeysUn[i];
+                        const cv::KeyPoint &kpUn = pLastFrame->mpFeatures->mvKeysUn[i];
                         obs << kpUn.pt.x, kpUn.pt.y;
 
                         g2o::EdgeNavStatePVRPointXYZOnlyPose *e = new g2o::EdgeNavStatePVRPointXYZOnlyPose();
@@ -1877,7 +1899,7 @@ namespace ORB_SLAM2
                         rk->setDelta(deltaMono);
 
                         e->SetParams(pLastFrame->fx, pLastFrame->fy, pLastFrame->cx, pLastFrame->cy, Rbc, Pbc,
-                                     Converter::toVector3d(pMP->GetWorldPos()));
+                                     pMP->GetWorldPosEigen().cast<double>());
 
                         optimizer.addEdge(e);
 
@@ -2165,13 +2187,13 @@ namespace ORB_SLAM2
 
                 if (pMP)
                 {
-                    if (pFrame->mvuRight[i] < 0)
+                    if (pFrame->mpFeatures->mvuRight[i] < 0)
                     {
                         nInitialCorrespondences++;
                         pFrame->mvbOutlier[i] = false;
 
                         Eigen::Matrix<double, 2, 1> obs;
-                        const cv::KeyPoint &kpUn = pFrame->mvKeysUn[i];
+                        const cv::KeyPoint &kpUn = pFrame->mpFeatures->mvKeysUn[i];
                         obs << kpUn.pt.x, kpUn.pt.y;
 
                         g2o::EdgeNavStatePVRPointXYZOnlyPose *e = new g2o::EdgeNavStatePVRPointXYZOnlyPose();
@@ -2186,7 +2208,7 @@ namespace ORB_SLAM2
                         rk->setDelta(deltaMono);
 
                         e->SetParams(pFrame->fx, pFrame->fy, pFrame->cx, pFrame->cy, Rbc, Pbc,
-                                     Converter::toVector3d(pMP->GetWorldPos()));
+                                     pMP->GetWorldPosEigen().cast<double>());
 
                         optimizer.addEdge(e);
 
@@ -2583,7 +2605,7 @@ namespace ORB_SLAM2
         {
             MapPoint *pMP = *lit;
             g2o::VertexSBAPointXYZ *vPoint = new g2o::VertexSBAPointXYZ();
-            vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
+            vPoint->setEstimate(pMP->GetWorldPosEigen().cast<double>());
             int id = pMP->mnId + maxKFid + 1;
             vPoint->setId(id);
             vPoint->setMarginalized(true);
@@ -2602,9 +2624,12 @@ namespace ORB_SLAM2
                 if (!pKFi->isBad())
                 {
 
-                    const cv::KeyPoint &kpUn = pKFi->mvKeysUn[mit->second];
+                    const std::shared_ptr<const KeyFrameFeatures> pFeaturesi = pKFi->GetFeatures();
+                    if (!pFeaturesi)
+                        continue;
+                    const cv::KeyPoint &kpUn = pFeaturesi->mvKeysUn[mit->second];
 
-                    if (pKFi->mvuRight[mit->second] < 0)
+                    if (pFeaturesi->mvuRight[mit->second] < 0)
                     {
                         Eigen::Matrix<double, 2, 1> obs;
                         obs << kpUn.pt.x, kpUn.pt.y;
@@ -3125,7 +3150,7 @@ namespace ORB_SLAM2
             // 顶点MP
             MapPoint *pMP = *lit;
             g2o::VertexSBAPointXYZ *vPoint = new g2o::VertexSBAPointXYZ();
-            vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
+            vPoint->setEstimate(pMP->GetWorldPosEigen().cast<double>());
             int id = pMP->mnId + maxKFid + 1;
             vPoint->setId(id);
             vPoint->setMarginalized(true);
@@ -3139,11 +3164,14 @@ namespace ORB_SLAM2
 
                 if (!pKFi->isBad())
                 {
-                    const cv::KeyPoint &kpUn = pKFi->mvKeysUn[mit->second];
+                    const std::shared_ptr<const KeyFrameFeatures> pFeaturesi = pKFi->GetFeatures();
+                    if (!pFeaturesi)
+                        continue;
+                    const cv::KeyPoint &kpUn = pFeaturesi->mvKeysUn[mit->second];
 
                     // 投影误差边
                     // 单目
-                    if (pKFi->mvuRight[mit->second] < 0)
+                    if (pFeaturesi->mvuRight[mit->second] < 0)
                     {
                         Eigen::Matrix<double, 2, 1> obs;
                         obs << kpUn.pt.x, kpUn.pt.y;
@@ -3173,7 +3201,7 @@ namespace ORB_SLAM2
                     else
                     {
                         Eigen::Matrix<double, 3, 1> obs;
-                        const float kp_ur = pKFi->mvuRight[mit->second];
+                        const float kp_ur = pFeaturesi->mvuRight[mit->second];
                         obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
                         g2o::EdgeStereoSE3ProjectXYZ *e = new g2o::EdgeStereoSE3ProjectXYZ();
@@ -3347,8 +3375,10 @@ namespace ORB_SLAM2
                                            const bool bRobust)
     {
         // 获取当前地图的所有关键帧和点云。
-        vector<KeyFrame *> vpKFs = pMap->GetAllKeyFrames();
-        vector<MapPoint *> vpMP = pMap->GetAllMapPoints();
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = pMap->GetKeyFramesSnapshot();
+        const SlotMap<MapPoint>::Snapshot pvpMPs = pMap->GetMapPointsSnapshot();
+        const vector<KeyFrame *> &vpKFs = *pvpKFs;
+        const vector<MapPoint *> &vpMP = *pvpMPs;
         BundleAdjustment(vpKFs, vpMP, nIterations, pbStopFlag, nLoopKF, bRobust);
 
     }
@@ -3428,7 +3458,7 @@ namespace ORB_SLAM2
             if (pMP->isBad())
                 continue;
             g2o::VertexSBAPointXYZ *vPoint = new g2o::VertexSBAPointXYZ();
-            vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));         // 设置估计量，即迭代初值。
+            vPoint->setEstimate(pMP->GetWorldPosEigen().cast<double>());         // 设置估计量，即迭代初值。
             const int id = pMP->mnId + maxKFid + 1;
             vPoint->setId(id);
             vPoint->setMarginalized(true);
@@ -3447,12 +3477,16 @@ namespace ORB_SLAM2
                 if (pKF->isBad() || pKF->mnId > maxKFid)
                     continue;
 
+                const std::shared_ptr<const KeyFrameFeatures> pFeatures = pKF->GetFeatures();
+                if (!pFeatures)
+                    continue;
+
                 nEdges++;
 
-                const cv::KeyPoint &kpUn = pKF->mvKeysUn[mit->second];
+                const cv::KeyPoint &kpUn = pFeatures->mvKeysUn[mit->second];
 
                 // 单目或RGB-D。
-                if (pKF->mvuRight[mit->second] < 0)
+                if (pFeatures->mvuRight[mit->second] < 0)
                 {
                     Eigen::Matrix<double, 2, 1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
@@ -3486,7 +3520,7 @@ namespace ORB_SLAM2
                 else
                 {
                     Eigen::Matrix<double, 3, 1> obs;
-                    const float kp_ur = pKF->mvuRight[mit->second];
+                    const float kp_ur = pFeatures->mvuRight[mit->second];
                     obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
                     g2o::EdgeStereoSE3ProjectXYZ *e = new g2o::EdgeStereoSE3ProjectXYZ();
@@ -3661,13 +3695,13 @@ namespace ORB_SLAM2
                 {
 
                     // 单目。
-                    if (pFrame->mvuRight[i] < 0)
+                    if (pFrame->mpFeatures->mvuRight[i] < 0)
                     {
                         nInitialCorrespondences++;
                         pFrame->mvbOutlier[i] = false;
 
                         Eigen::Matrix<double, 2, 1> obs;
-                        const cv::KeyPoint &kpUn = pFrame->mvKeysUn[i];
+                        const cv::KeyPoint &kpUn = pFrame->mpFeatures->mvKeysUn[i];
                         obs << kpUn.pt.x, kpUn.pt.y;
 
                         g2o::EdgeSE3ProjectXYZOnlyPose *e = new g2o::EdgeSE3ProjectXYZOnlyPose();
@@ -3688,10 +3722,7 @@ namespace ORB_SLAM2
                         e->fy = pFrame->fy;
                         e->cx = pFrame->cx;
                         e->cy = pFrame->cy;
-                        cv::Mat Xw = pMP->GetWorldPos();
-                        e->Xw[0] = Xw.at<float>(0);
-                        e->Xw[1] = Xw.at<float>(1);
-                        e->Xw[2] = Xw.at<float>(2);
+                        e->Xw = pMP->GetWorldPosEigen().cast<double>();
 
                         optimizer.addEdge(e);
 
@@ -3707,8 +3738,8 @@ namespace ORB_SLAM2
                         pFrame->mvbOutlier[i] = false;
 
                         Eigen::Matrix<double, 3, 1> obs;
-                        const cv::KeyPoint &kpUn = pFrame->mvKeysUn[i];
-                        const float &kp_ur = pFrame->mvuRight[i];
+                        const cv::KeyPoint &kpUn = pFrame->mpFeatures->mvKeysUn[i];
+                        const float &kp_ur = pFrame->mpFeatures->mvuRight[i];
                         obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
                         g2o::EdgeStereoSE3ProjectXYZOnlyPose *e = new g2o::EdgeStereoSE3ProjectXYZOnlyPose();
@@ -3728,10 +3759,7 @@ namespace ORB_SLAM2
                         e->cx = pFrame->cx;
                         e->cy = pFrame->cy;
                         e->bf = pFrame->mbf;
-                        cv::Mat Xw = pMP->GetWorldPos();
-                        e->Xw[0] = Xw.at<float>(0);
-                        e->Xw[1] = Xw.at<float>(1);
-                        e->Xw[2] = Xw.at<float>(2);
+                        e->Xw = pMP->GetWorldPosEigen().cast<double>();
 
                         optimizer.addEdge(e);
 
@@ -3994,7 +4022,7 @@ namespace ORB_SLAM2
             // 添加顶点，局部MapPoints。
             MapPoint *pMP = *lit;
             g2o::VertexSBAPointXYZ *vPoint = new g2o::VertexSBAPointXYZ();
-            vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));          // 设置迭代初值。
+            vPoint->setEstimate(pMP->GetWorldPosEigen().cast<double>());          // 设置迭代初值。
             int id = pMP->mnId + maxKFid + 1;                                           // 防止id和LocalKF冲突。
             vPoint->setId(id);
             vPoint->setMarginalized(true);                                            // 边缘化，方便求解。
@@ -4011,10 +4039,13 @@ namespace ORB_SLAM2
 
                 if (!pKFi->isBad())
                 {
-                    const cv::KeyPoint &kpUn = pKFi->mvKeysUn[mit->second];
+                    const std::shared_ptr<const KeyFrameFeatures> pFeaturesi = pKFi->GetFeatures();
+                    if (!pFeaturesi)
+                        continue;
+                    const cv::KeyPoint &kpUn = pFeaturesi->mvKeysUn[mit->second];
 
                     // 单目。
-                    if (pKFi->mvuRight[mit->second] < 0)
+                    if (pFeaturesi->mvuRight[mit->second] < 0)
                     {
 
                         Eigen::Matrix<double, 2, 1> obs;
@@ -4053,7 +4084,7 @@ namespace ORB_SLAM2
                     else
                     {
                         Eigen::Matrix<double, 3, 1> obs;
-                        const float kp_ur = pKFi->mvuRight[mit->second];
+                        const float kp_ur = pFeaturesi->mvuRight[mit->second];
                         obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
                         g2o::EdgeStereoSE3ProjectXYZ *e = new g2o::EdgeStereoSE3ProjectXYZ();
@@ -4265,8 +4296,10 @@ namespace ORB_SLAM2
         solver->setUserLambdaInit(1e-16);       // L-M中的lambda。
         optimizer.setAlgorithm(solver);
 
-        const vector<KeyFrame *> vpKFs = pMap->GetAllKeyFrames();
-        const vector<MapPoint *> vpMPs = pMap->GetAllMapPoints();
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = pMap->GetKeyFramesSnapshot();
+        const SlotMap<MapPoint>::Snapshot pvpMPs = pMap->GetMapPointsSnapshot();
+        const vector<KeyFrame *> &vpKFs = *pvpKFs;
+        const vector<MapPoint *> &vpMPs = *pvpMPs;
 
         const unsigned int nMaxKFid = pMap->GetMaxKFid();
 
@@ -4579,6 +4612,12 @@ namespace ORB_SLAM2
     int Optimizer::OptimizeSim3(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &vpMatches1, g2o::Sim3 &g2oS12,
                                 const float th2, const bool bFixScale)
     {
+        // 两关键帧的特征点，读取失败时不优化。
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures1 = pKF1->GetFeatures();
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures2 = pKF2->GetFeatures();
+        if (!pFeatures1 || !pFeatures2)
+            return 0;
+
         // 步骤1 初始化g2o求解器。
         g2o::SparseOptimizer optimizer;                             // 构造求解器。
 
@@ -4680,7 +4719,7 @@ namespace ORB_SLAM2
             nCorrespondences++;
 
             Eigen::Matrix<double, 2, 1> obs1;
-            const cv::KeyPoint &kpUn1 = pKF1->mvKeysUn[i];
+            const cv::KeyPoint &kpUn1 = pFeatures1->mvKeysUn[i];
             obs1 << kpUn1.pt.x, kpUn1.pt.y;
 
             // 步骤2.3 设置边。
@@ -4698,7 +4737,7 @@ namespace ORB_SLAM2
             optimizer.addEdge(e12);
 
             Eigen::Matrix<double, 2, 1> obs2;
-            const cv::KeyPoint &kpUn2 = pKF2->mvKeysUn[i2];
+            const cv::KeyPoint &kpUn2 = pFeatures2->mvKeysUn[i2];
             obs2 << kpUn2.pt.x, kpUn2.pt.y;
 
             // 从pKF1->pKF2的重投影误差。
@@ -81,7 +81,7 @@ namespace ORB_SLAM2
                 if (!pMP->isBad())
                 {
                     // 获得二维特征点。
-                    const cv::KeyPoint &kp = F.mvKeysUn[i];
+                    const cv::KeyPoint &kp = F.mpFeatures->mvKeysUn[i];
 
                     mvP2D.push_back(kp.pt);
                     mvSigma2.push_back(F.mvLevelSigma2[kp.octave]);     // 记录特征点提取的金字塔层数。
@@ -45,8 +45,12 @@ namespace ORB_SLAM2
 
         mvAllIndices.reserve(mN1);
 
+        // 特征点读取失败时没有匹配，不计算Sim3。
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures1 = pKF1->GetFeatures();
+        const std::shared_ptr<const KeyFrameFeatures> pFeatures2 = pKF2->GetFeatures();
+
         size_t idx = 0;
-        for (int i1 = 0; i1 < mN1; i1++)
+        for (int i1 = 0; i1 < mN1 && pFeatures1 && pFeatures2; i1++)
         {
             if (vpMatched12[i1])
             {
@@ -68,8 +72,8 @@ namespace ORB_SLAM2
                     continue;
 
                 // 两帧对应的匹配特征点。
-                const cv::KeyPoint &kp1 = pKF1->mvKeysUn[indexKF1];
-                const cv::KeyPoint &kp2 = pKF2->mvKeysUn[indexKF2];
+                const cv::KeyPoint &kp1 = pFeatures1->mvKeysUn[indexKF1];
+                const cv::KeyPoint &kp2 = pFeatures2->mvKeysUn[indexKF2];
 
                 // 提取特征对应的图像金字塔的尺度。
                 const float sigmaSquare1 = pKF1->mvLevelSigma2[kp1.octave];
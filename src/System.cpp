@@ -3,6 +3,7 @@
 /***调用 SLAM.mpTracker(System类中Tracking型的私有成员变量)->GrabImageMonocluar(Tracking类中成员函数)，传入图像和时间戳，进入Tracking。 ***/
 #include "System.h"
 #include "Converter.h"
+#include "MapSerializer.h"
 
 #include <thread>
 #include <pangolin/pangolin.h>
@@ -36,8 +37,9 @@ namespace ORB_SLAM2
     {
         cout << endl << "Saving keyframe NavState to " << filename << " ..." << endl;
 
-        vector<KeyFrame *> vpKFs = mpMap->GetAllKeyFrames();
-        sort(vpKFs.begin(), vpKFs.end(), KeyFrame::lId);
+        // 快照已经按id排序
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = mpMap->GetKeyFramesSnapshot();
+        const vector<KeyFrame *> &vpKFs = *pvpKFs;
 
         ofstream f;
         f.open(filename.c_str());
@@ -162,6 +164,9 @@ namespace ORB_SLAM2
             bVocLoad = mpVocabulary->loadFromTextFile(strVocFile);
         else if (has_suffix(strVocFile, ".bin"))
             bVocLoad = mpVocabulary->loadFromBinaryFile(strVocFile);
+        // 由Vocabulary/map_vocabulary转换得到的扁平词典，只读映射到内存，不需要解析。
+        else if (has_suffix(strVocFile, ".mvoc"))
+            bVocLoad = mpVocabulary->loadFromMappedFile(strVocFile);
         else
             bVocLoad = false;
 
@@ -174,6 +179,14 @@ namespace ORB_SLAM2
         }
         cout << "Vocabulary loaded!" << endl << endl;    // 加载成功
 
+        // 词典树的扁平存储，子节点描述子连续存放，计算词袋向量更快，结果不变。
+        int nFlatVocabulary = fsSetting["Vocabulary.Flat"];
+        if (nFlatVocabulary && !mpVocabulary->isMapped())
+        {
+            mpVocabulary->flatten();
+            cout << "Vocabulary flattened" << endl << endl;
+        }
+
         ConfigParam config(strSettingsFile);
 
         // 创建关键帧库类的对象，闭环检测时与当前帧匹配。
@@ -181,6 +194,21 @@ namespace ORB_SLAM2
         mpKeyFrameDatabase = new KeyFrameDatabase(*mpVocabulary);
         // 创建地图类的对象。
         mpMap = new Map();
+
+        // 剔除的关键帧和点云在各线程都不再使用后释放，0为关闭(不释放)。
+        int nReclaimMemory = fsSetting["Map.ReclaimMemory"];
+        mpMap->mEpochManager.SetEnabled(nReclaimMemory);
+
+        // 关键帧特征数据的内存预算(MB)，超过时换出到磁盘，0为关闭。
+        int nMemoryBudget = fsSetting["Map.MemoryBudget"];
+        if (nMemoryBudget > 0)
+        {
+            string strSpillFile = (string) fsSetting["Map.SpillFile"];
+            if (strSpillFile.empty())
+                strSpillFile = "KeyFrameStore.bin";
+            if (!mpMap->mKeyFrameStore.Open(strSpillFile, (size_t) nMemoryBudget))
+                cerr << "Keyframe features are kept in memory" << endl;
+        }
         // 创建显示类的对象，用于显示地图点云和帧位置。
         mpFrameDrawer = new FrameDrawer(mpMap);
         mpMapDrawer = new MapDrawer(mpMap, strSettingsFile);
@@ -227,6 +255,12 @@ namespace ORB_SLAM2
             mptLocalMappingVIOInit = new thread(&ORB_SLAM2::LocalMapping::VINSInitThread, mpLocalMapper);
         }
 
+        // 加载之前保存的地图，Shutdown时保存地图。
+        const string strMapLoadFile = (string) fsSetting["Map.LoadFile"];
+        mstrMapSaveFile = (string) fsSetting["Map.SaveFile"];
+        if (!strMapLoadFile.empty() && !LoadMap(strMapLoadFile))
+            cerr << "Starting with an empty map" << endl;
+
     }
 
 
@@ -408,6 +442,9 @@ namespace ORB_SLAM2
     // 停止SLAM系统。
     void System::Shutdown()
     {
+        // 跟踪前端流水线中剩余的帧。
+        mpTracker->FlushMonoVI();
+
         // 请求结束局部见图，闭环检测和视图线程。
         mpLocalMapper->RequestFinish();
         mpLoopCloser->RequestFinish();
@@ -421,8 +458,74 @@ namespace ORB_SLAM2
             std::this_thread::sleep_for(std::chrono::milliseconds(5));
         }
 
+        // 地图中的关键帧和点云，以及剔除后等待释放和已经释放的数量。
+        size_t nPendingMPs, nPendingKFs;
+        unsigned long nReclaimedMPs, nReclaimedKFs;
+        mpMap->mEpochManager.GetStats(nPendingMPs, nPendingKFs, nReclaimedMPs, nReclaimedKFs);
+        cout << endl << "Map: " << mpMap->KeyFramesInMap() << " keyframes, " << mpMap->MapPointsInMap()
+             << " map points" << endl;
+        if (mpMap->mEpochManager.IsEnabled())
+        {
+            cout << "- culled, waiting: " << nPendingKFs << " keyframes, " << nPendingMPs << " map points" << endl;
+            cout << "- culled, freed: " << nReclaimedKFs << " keyframes, " << nReclaimedMPs << " map points" << endl;
+        }
+        if (mpMap->mKeyFrameStore.IsEnabled())
+        {
+            size_t nResidentBytes, nFileBytes;
+            unsigned long nSpills, nPageIns;
+            double meanPageInMs, maxPageInMs;
+            mpMap->mKeyFrameStore.GetStats(nResidentBytes, nFileBytes, nSpills, nPageIns, meanPageInMs, maxPageInMs);
+            cout << "- keyframe features: " << (nResidentBytes >> 20) << " MB in memory, " << (nFileBytes >> 20)
+                 << " MB on disk, " << nSpills << " spilled, " << nPageIns << " paged in (mean " << meanPageInMs
+                 << " ms, max " << maxPageInMs << " ms)" << endl;
+        }
+
         pangolin::BindToContext("ORB_SLAM2: Map Viewer");
 
+        if (!mstrMapSaveFile.empty())
+            SaveMap(mstrMapSaveFile);
+
+    }
+
+
+    // 保存地图。
+    bool System::SaveMap(const string &filename)
+    {
+        cout << endl << "Saving map to " << filename << " ..." << endl;
+
+        MapSerializer::VINSState vins;
+        vins.bInited = mpLocalMapper->GetVINSInited();
+        if (vins.bInited)
+        {
+            vins.GravityVec = mpLocalMapper->GetGravityVec();
+            vins.RwiInit = mpLocalMapper->GetRwiInit();
+        }
+
+        unique_lock<mutex> lock(mpMap->mMutexMapUpdate);
+        return MapSerializer::Save(filename, mpMap, mpKeyFrameDatabase, *mpVocabulary, vins);
+    }
+
+
+    // 加载地图，恢复VI初始化结果，进入定位模式。
+    bool System::LoadMap(const string &filename)
+    {
+        cout << endl << "Loading map from " << filename << " ..." << endl;
+
+        MapSerializer::VINSState vins;
+        {
+            unique_lock<mutex> lock(mpMap->mMutexMapUpdate);
+            if (!MapSerializer::Load(filename, mpMap, mpKeyFrameDatabase, mpVocabulary, vins))
+                return false;
+        }
+
+        if (vins.bInited)
+            mpLocalMapper->SetVINSInitState(vins.GravityVec, vins.RwiInit);
+
+        // 没有上一帧，从重定位开始跟踪。
+        mpTracker->mState = Tracking::LOST;
+        ActivateLocalizationMode();
+
+        return true;
     }
 
 
@@ -436,8 +539,9 @@ namespace ORB_SLAM2
 
         cout << endl << "Saving camera trajectory to " << filename << "..." << endl;
 
-        vector<KeyFrame *> vpKFs = mpMap->GetAllKeyFrames();
-        sort(vpKFs.begin(), vpKFs.end(), KeyFrame::lId);
+        // 快照已经按id排序
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = mpMap->GetKeyFramesSnapshot();
+        const vector<KeyFrame *> &vpKFs = *pvpKFs;
 
         // 对关键帧位姿进行变换，使第一帧关键帧位于原点。
         // 在闭环检测后第一帧关键帧可能不在原点。
@@ -496,8 +600,9 @@ namespace ORB_SLAM2
     {
         cout << endl << "Saving KeyFrame trajectory to " << filename << "..." << endl;
 
-        vector<KeyFrame *> vpKFs = mpMap->GetAllKeyFrames();
-        sort(vpKFs.begin(), vpKFs.end(), KeyFrame::lId);
+        // 快照已经按id排序
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = mpMap->GetKeyFramesSnapshot();
+        const vector<KeyFrame *> &vpKFs = *pvpKFs;
 
         // 对关键帧位姿进行变换，使第一帧关键帧位于原点。
         // 在闭环检测后第一帧关键帧可能不在原点。
@@ -534,8 +639,9 @@ namespace ORB_SLAM2
 
         cout << endl << "Saving camera trajectory to " << filename << " ..." << endl;
 
-        vector<KeyFrame *> vpKFs = mpMap->GetAllKeyFrames();
-        sort(vpKFs.begin(), vpKFs.end(), KeyFrame::lId);
+        // 快照已经按id排序
+        const SlotMap<KeyFrame>::Snapshot pvpKFs = mpMap->GetKeyFramesSnapshot();
+        const vector<KeyFrame *> &vpKFs = *pvpKFs;
 
         // 对关键帧位姿进行变换，使第一帧关键帧位于原点。
         // 在闭环检测后第一帧关键帧可能不在原点。
@@ -0,0 +1,113 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <algorithm>
+#include <memory>
+
+namespace ORB_SLAM2
+{
+
+    // 一次ParallelFor调用的共享状态，调用线程和工作线程都从mnNext中领取下标。
+    struct ParallelJob
+    {
+        ParallelJob(int n, const std::function<void(int)> &func) : mnNext(0), mnRemaining(n), N(n), mFunc(func)
+        {}
+
+        // 领取下标并执行，直到没有剩余下标。
+        void Work()
+        {
+            int i;
+            while ((i = mnNext.fetch_add(1)) < N)
+            {
+                mFunc(i);
+                if (mnRemaining.fetch_sub(1) == 1)
+                {
+                    std::unique_lock<std::mutex> lock(mMutexDone);
+                    mCondDone.notify_all();
+                }
+            }
+        }
+
+        std::atomic<int> mnNext;
+        std::atomic<int> mnRemaining;
+        const int N;
+        const std::function<void(int)> &mFunc;
+
+        std::mutex mMutexDone;
+        std::condition_variable mCondDone;
+    };
+
+
+    ThreadPool::ThreadPool(int nThreads) : mbFinishRequested(false)
+    {
+        for (int i = 0; i < nThreads; i++)
+            mvThreads.push_back(std::thread(&ThreadPool::Run, this));
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutexTasks);
+            mbFinishRequested = true;
+        }
+        mCondTasks.notify_all();
+
+        for (size_t i = 0; i < mvThreads.size(); i++)
+            mvThreads[i].join();
+    }
+
+    void ThreadPool::Run()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutexTasks);
+                while (!mbFinishRequested && mqTasks.empty())
+                    mCondTasks.wait(lock);
+
+                if (mqTasks.empty())
+                    return;
+
+                task = mqTasks.front();
+                mqTasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    void ThreadPool::ParallelFor(int n, const std::function<void(int)> &func)
+    {
+        if (n <= 0)
+            return;
+
+        if (n == 1 || mvThreads.empty())
+        {
+            for (int i = 0; i < n; i++)
+                func(i);
+            return;
+        }
+
+        std::shared_ptr<ParallelJob> pJob = std::make_shared<ParallelJob>(n, func);
+
+        // 最多唤醒n-1个工作线程，剩下的由调用线程自己完成。
+        const int nHelpers = std::min(n - 1, (int) mvThreads.size());
+        {
+            std::unique_lock<std::mutex> lock(mMutexTasks);
+            for (int i = 0; i < nHelpers; i++)
+                mqTasks.push_back([pJob]() { pJob->Work(); });
+        }
+        if (nHelpers == 1)
+            mCondTasks.notify_one();
+        else
+            mCondTasks.notify_all();
+
+        pJob->Work();
+
+        // 等待其他线程手上的下标完成。
+        std::unique_lock<std::mutex> lock(pJob->mMutexDone);
+        while (pJob->mnRemaining.load() > 0)
+            pJob->mCondDone.wait(lock);
+    }
+
+} //namespace ORB_SLAM2
@@ -17,10 +17,13 @@
 
 #include "Optimizer.h"
 #include "PnPsolver.h"
+#include "ThreadPool.h"
 
 #include <iostream>
 #include <cmath>
 #include <mutex>
+#include <algorithm>
+#include <set>
 
 
 #define TRACK_WITH_IMU
@@ -485,6 +488,18 @@ namespace ORB_SLAM2
     // VI Tracking线程入口
     cv::Mat Tracking::GrabImageMonoVI(const cv::Mat &im, const std::vector<IMUData> &vimu, const double &timestamp)
     {
+        // 流水线模式：提交当前图像，跟踪之前提交的一帧，同时构造线程构造下一帧
+        if (mpFramePipeline)
+        {
+            mpFramePipeline->Submit(im, vimu, timestamp);
+
+            FramePipeline::Job *pJob = mpFramePipeline->Pop(false);
+            if (!pJob)
+                return cv::Mat();
+
+            return TrackPipelinedFrame(pJob);
+        }
+
         // 保存上一帧关键帧到当前帧的IMU数据
         mvIMUSinceLastKF.insert(mvIMUSinceLastKF.end(), vimu.begin(), vimu.end());
         mImGray = im;
@@ -512,11 +527,90 @@ namespace ORB_SLAM2
                                   mThDepth, mpLastKeyFrame);
 
         Track();
+        ReclaimBadObjects();
 
         return mCurrentFrame.mTcw.clone();
 
     }
 
+    void Tracking::BuildFrameMonoVI(FramePipeline::Job &job)
+    {
+        cv::Mat &imGray = job.mIm;
+
+        if (imGray.channels() == 3)
+        {
+            if (mbRGB)
+                cvtColor(imGray, imGray, CV_RGB2GRAY);
+            else
+                cvtColor(imGray, imGray, CV_BGR2GRAY);
+        }
+        else if (imGray.channels() == 4)
+        {
+            if (mbRGB)
+                cvtColor(imGray, imGray, CV_RGBA2GRAY);
+            else
+                cvtColor(imGray, imGray, CV_BGRA2GRAY);
+        }
+
+        // 构造函数不使用上一关键帧，这里不读取跟踪线程中的mpLastKeyFrame
+        if (job.mbIniExtractor)
+            job.mFrame = Frame(imGray, job.mTimestamp, job.mvIMU, mpIniORBextractor, mpORBVocabulary, mK, mDistCoef,
+                               mbf, mThDepth);
+        else
+            job.mFrame = Frame(imGray, job.mTimestamp, job.mvIMU, mpORBextractorLeft, mpORBVocabulary, mK, mDistCoef,
+                               mbf, mThDepth);
+    }
+
+    cv::Mat Tracking::TrackPipelinedFrame(FramePipeline::Job *pJob)
+    {
+        // 该帧构造时上一帧还没有跟踪完，如果跟踪状态的变化(初始化完成)改变了应使用的提取器，
+        // 暂停构造线程，用正确的提取器重新构造，并沿用原来的帧id，与顺序执行的结果一致。
+        const bool bIni = mState == NOT_INITIALIZED || mState == NO_IMAGES_YET;
+        if (pJob->mbIniExtractor != bIni)
+        {
+            mpFramePipeline->Pause();
+            Frame::nNextId = pJob->mFrame.mnId;
+            pJob->mbIniExtractor = bIni;
+            BuildFrameMonoVI(*pJob);
+            mpFramePipeline->CountRebuilt();
+            mpFramePipeline->Resume(bIni);
+        }
+
+        // 保存上一帧关键帧到当前帧的IMU数据
+        mvIMUSinceLastKF.insert(mvIMUSinceLastKF.end(), pJob->mvIMU.begin(), pJob->mvIMU.end());
+        mImGray = pJob->mIm;
+        mCurrentFrame = pJob->mFrame;
+
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        Track();
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+        ReclaimBadObjects();
+
+        mpFramePipeline->SetIniExtractor(mState == NOT_INITIALIZED || mState == NO_IMAGES_YET);
+        mpFramePipeline->FinishFrame(*pJob,
+                                     std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(
+                                             t2 - t1).count());
+        delete pJob;
+
+        return mCurrentFrame.mTcw.clone();
+    }
+
+    void Tracking::FlushMonoVI()
+    {
+        if (!mpFramePipeline)
+            return;
+
+        FramePipeline::Job *pJob;
+        while ((pJob = mpFramePipeline->Pop(true)))
+            TrackPipelinedFrame(pJob);
+
+        FramePipeline::Stats stats = mpFramePipeline->GetStats();
+        cout << endl << "Frame pipeline: " << stats.nFrames << " frames, " << stats.nRebuilt << " rebuilt" << endl;
+        cout << "- throughput: " << stats.mThroughput << " Hz" << endl;
+        cout << "- latency mean: " << stats.mLatencyMean << " ms, max: " << stats.mLatencyMax << " ms" << endl;
+        cout << "- frame build mean: " << stats.mBuildMean << " ms, track mean: " << stats.mTrackMean << " ms" << endl;
+    }
+
 
 
     /**********************************************************/
@@ -533,6 +627,13 @@ namespace ORB_SLAM2
         mbRelocBiasPrepare = false;
         mpParams = pParams;
 
+        mpReferenceKF = static_cast<KeyFrame *>(NULL);
+        mpLastKeyFrame = static_cast<KeyFrame *>(NULL);
+
+        // 调用Track的线程也要注册，用于回收坏关键帧和坏点云。
+        mnEpochThreadId = mpMap->mEpochManager.RegisterThread();
+        mnLastRetiredCount = 0;
+
         // 加载相机标定参数。
         cv::FileStorage fSettings(strSettingPath, cv::FileStorage::READ);
         float fx = fSettings["Camera.fx"];
@@ -565,6 +666,9 @@ namespace ORB_SLAM2
         }
         DistCoef.copyTo(mDistCoef);
 
+        // 特征点去畸变查找表。
+        SetUndistortionMap(fSettings);
+
         // bf= 双目基线*fx。
         mbf = fSettings["Camera.bf"];
 
@@ -611,6 +715,9 @@ namespace ORB_SLAM2
         // 默认阈值无法提取足够的fast特征点，使用最小阈值8。
         int fMinThFAST = fSettings["ORBextractor.minThFAST"];
 
+        // 特征提取线程数，不大于1时在跟踪线程中单线程提取。
+        int nExtractorThreads = fSettings["ORBextractor.nThreads"];
+
         // 构造了一个ORBextractor类型的对象，跟踪过程都会用到mpORBextractorLeft作为特征点提取器，设置提取orb特征的性质。
         mpORBextractorLeft = new ORBextractor(nFeatures, fScaleFactor, nLevels, fIniThFAST, fMinThFAST);
         // 双目时，Tracking过程还会构造一个mpORBextractorRight做特征点提取器。
@@ -621,6 +728,19 @@ namespace ORB_SLAM2
         if (sensor == System::MONOCULAR)
             mpIniORBextractor = new ORBextractor(2 * nFeatures, fScaleFactor, nLevels, fIniThFAST, fMinThFAST);
 
+        // 多线程提取时，各提取器、局部地图投影匹配、词袋向量和关键帧库相似度计算共享一个线程池，跟踪线程本身也参与计算。
+        mpThreadPool = static_cast<ThreadPool *>(NULL);
+        if (nExtractorThreads > 1)
+        {
+            mpThreadPool = new ThreadPool(nExtractorThreads - 1);
+            mpKeyFrameDB->SetThreadPool(mpThreadPool);
+            mpORBextractorLeft->SetThreadPool(mpThreadPool);
+            if (sensor == System::STEREO)
+                mpORBextractorRight->SetThreadPool(mpThreadPool);
+            if (sensor == System::MONOCULAR)
+                mpIniORBextractor->SetThreadPool(mpThreadPool);
+        }
+
         // 输出ORB特征点提取信息。
         cout << endl << "ORB Extractor Parameters: " << endl;
         cout << "- Number of Features: " << nFeatures << endl;
@@ -628,6 +748,17 @@ namespace ORB_SLAM2
         cout << "- Scale Factor: " << fScaleFactor << endl;
         cout << "- Initial Fast Threshold: " << fIniThFAST << endl;
         cout << "- Minimum Fast Threshold: " << fMinThFAST << endl;
+        cout << "- Extractor Threads: " << (mpThreadPool ? nExtractorThreads : 1) << endl;
+
+        // 单目VI前端流水线，跟踪当前帧的同时构造后续帧，0为关闭。
+        mpFramePipeline = static_cast<FramePipeline *>(NULL);
+        int nPipelineDepth = fSettings["Tracking.PipelineDepth"];
+        if (sensor == System::MONOCULAR && nPipelineDepth > 0)
+        {
+            mpFramePipeline = new FramePipeline(std::bind(&Tracking::BuildFrameMonoVI, this, std::placeholders::_1),
+                                                nPipelineDepth);
+            cout << "- Frame Pipeline Depth: " << nPipelineDepth << endl;
+        }
 
         if (sensor == System::STEREO || sensor == System::RGBD)
         {
@@ -707,6 +838,7 @@ namespace ORB_SLAM2
                               mK, mDistCoef, mbf, mThDepth);
         // 步骤3：跟踪
         Track();
+        ReclaimBadObjects();
 
         return mCurrentFrame.mTcw.clone();
     }
@@ -746,6 +878,7 @@ namespace ORB_SLAM2
 
         // 步骤4：跟踪
         Track();
+        ReclaimBadObjects();
 
         return mCurrentFrame.mTcw.clone();
     }
@@ -784,6 +917,7 @@ namespace ORB_SLAM2
 
         // 步骤3：Tracking线程入口
         Track();
+        ReclaimBadObjects();
 
         return mCurrentFrame.mTcw.clone();
     }
@@ -925,102 +1059,95 @@ namespace ORB_SLAM2
                 }
             }
 
+                // 定位模式，不进行局部地图。
             else
             {
-                cerr << "Localization mode not supported yet" << endl;
-            }
+                // 步骤2.1 跟踪上一帧||参考帧||重定位。
+
+                // 跟踪丢失，重定位。
+                if (mState == LOST)
+                {
+                    bOK = Relocalization();
+                }
+
+                else
+                {
+                    // mbVO是跟踪模式下出现的变量。
+                    // mbVO=false 表示跟踪正常，很多匹配；  mbVO=true 表示匹配了很少的地图点云，要GG。
+
+                    // 跟踪正常。
+                    if (!mbVO)
+                    {
+                        if (!mVelocity.empty())
+                        {
+                            // 恒速模型跟踪。
+                            bOK = TrackWithMotionModel();
 
+                            // 恒速模型失败，参考帧跟踪。
+                            if (!bOK)
+                                bOK = TrackReferenceKeyFrame();
+                        }
 
-//             // 定位模式，不进行局部地图。
-//             else
-//             {
-//                 // 步骤2.1 跟踪上一帧||参考帧||重定位。
-// 
-//                 // 跟踪丢失，重定位。
-//                 if(mState==LOST)
-//                 {
-//                     bOK = Relocalization();
-//                 }
-// 
-//                 else
-//                 {
-//                     // mbVO是跟踪模式下出现的变量。
-//                     // mbVO=false 表示跟踪正常，很多匹配；  mbVO=true 表示匹配了很少的地图点云，要GG。
-//                     
-//                     // 跟踪正常。
-//                     if(!mbVO)
-//                     {
-//                         if(!mVelocity.empty())
-//                         {
-//                             // 恒速模型跟踪。
-//                             bOK = TrackWithMotionModel();
-//                             
-//                             // 恒速模型失败，参考帧跟踪。
-// 							if(!bOK)
-//                               bOK = TrackReferenceKeyFrame();
-//                         }
-// 
-//                         // 没有恒速跟踪模型。
-//                         else
-//                         {
-//                             bOK = TrackReferenceKeyFrame();
-//                         }
-//                     }
-// 
-//                     // 跟踪效果不好，要GG了。
-//                     else
-//                     {
-// 
-//                         // 同时进行跟踪和重定位。
-//                         // 如果重定位成功，使用重定位的结果。否则保持跟踪视觉里里程计点。
-//                         bool bOKMM = false;         // 恒速模型运行标志位。
-//                         bool bOKReloc =false;       // 重定位运行标志位。
-//                         vector<MapPoint *> vpMPsMM; // 恒速模型匹配地图点云
-//                         vector<bool> vbOutMM;       // 恒速模型匹配异常值情况。
-//                         cv::Mat TcwMM;              // 恒速模型位姿。
-// 
-//                         // 进行恒速模型匹配。
-//                         if(!mVelocity.empty())
-//                         {
-//                             bOKMM = TrackWithMotionModel();
-//                             vpMPsMM = mCurrentFrame.mvpMapPoints;
-//                             vbOutMM = mCurrentFrame.mvbOutlier;
-//                             TcwMM = mCurrentFrame.mTcw.clone();
-//                         }
-//                         // 进行重定位。
-//                         bOKReloc = Relocalization();
-// 
-//                         // 跟踪成功，重定位失败。
-//                         if(bOKMM && !bOKReloc)
-//                         {
-//                             mCurrentFrame.SetPose(TcwMM);
-//                             mCurrentFrame.mvpMapPoints = vpMPsMM;
-//                             mCurrentFrame.mvbOutlier = vbOutMM;
-//                             
-//                             // 处理的不是一个东西，应该在TrackLocalMap函数中吧。
-//                             // 更新当前帧的MapPoints被观测程度。
-//                             if (mbVO)
-//                             {
-//                                for (int i=0; i<mCurrentFrame.N; i++)
-//                                {
-//                                     // 有匹配点，且不是外点，加入。
-//                                     if(mCurrentFrame.mvpMapPoints[i] && !mCurrentFrame.mvbOutlier[i])
-//                                     {
-//                                         mCurrentFrame.mvpMapPoints[i]->IncreaseFound();
-//                                     }
-//                                }
-//                             }
-//                         }
-//                         // 重定位成功表示跟踪正常，更相信定位结果。
-//                         else if(bOKReloc)
-//                         {
-//                             mbVO = false;
-//                         }
-// 
-//                         bOK = bOKReloc || bOKMM;
-//                     }   // 跟踪效果不好
-//                 }   // 没跟丢
-//             }   // 定位模式 
+                            // 没有恒速跟踪模型。
+                        else
+                        {
+                            bOK = TrackReferenceKeyFrame();
+                        }
+                    }
+
+                        // 跟踪效果不好，要GG了。
+                    else
+                    {
+
+                        // 同时进行跟踪和重定位。
+                        // 如果重定位成功，使用重定位的结果。否则保持跟踪视觉里里程计点。
+                        bool bOKMM = false;         // 恒速模型运行标志位。
+                        bool bOKReloc = false;      // 重定位运行标志位。
+                        vector<MapPoint *> vpMPsMM; // 恒速模型匹配地图点云
+                        vector<bool> vbOutMM;       // 恒速模型匹配异常值情况。
+                        cv::Mat TcwMM;              // 恒速模型位姿。
+
+                        // 进行恒速模型匹配。
+                        if (!mVelocity.empty())
+                        {
+                            bOKMM = TrackWithMotionModel();
+                            vpMPsMM = mCurrentFrame.mvpMapPoints;
+                            vbOutMM = mCurrentFrame.mvbOutlier;
+                            TcwMM = mCurrentFrame.mTcw.clone();
+                        }
+                        // 进行重定位。
+                        bOKReloc = Relocalization();
+
+                        // 跟踪成功，重定位失败。
+                        if (bOKMM && !bOKReloc)
+                        {
+                            mCurrentFrame.SetPose(TcwMM);
+                            mCurrentFrame.mvpMapPoints = vpMPsMM;
+                            mCurrentFrame.mvbOutlier = vbOutMM;
+
+                            // 更新当前帧的MapPoints被观测程度。
+                            if (mbVO)
+                            {
+                                for (int i = 0; i < mCurrentFrame.N; i++)
+                                {
+                                    // 有匹配点，且不是外点，加入。
+                                    if (mCurrentFrame.mvpMapPoints[i] && !mCurrentFrame.mvbOutlier[i])
+                                    {
+                                        mCurrentFrame.mvpMapPoints[i]->IncreaseFound();
+                                    }
+                                }
+                            }
+                        }
+                            // 重定位成功表示跟踪正常，更相信定位结果。
+                        else if (bOKReloc)
+                        {
+                            mbVO = false;
+                        }
+
+                        bOK = bOKReloc || bOKMM;
+                    }   // 跟踪效果不好
+                }   // 没跟丢
+            }   // 定位模式
 
             // 将最新的关键帧作为参考帧, mpReferenceKF在初始化MonocularInitialization()中完成。
             mCurrentFrame.mpReferenceKF = mpReferenceKF;
@@ -1060,10 +1187,9 @@ namespace ORB_SLAM2
                 // 定位模式。
             else
             {
-                cerr << "Localization mode not supported yet" << endl;
                 // mbVO=true 表示地图效果不好，不能提取局部地图因而无法运行TrackLocalMap(),如果系统重定位，执行局部地图构建。
-//                 if(bOK && !mbVO)
-//                     bOK = TrackLocalMap();
+                if (bOK && !mbVO)
+                    bOK = TrackLocalMap();
             }
 
             // bOK表示之前所有过程的结果，如果完成表示Tracking成功，否则只要有一个有问题，就GG。
@@ -1183,8 +1309,8 @@ namespace ORB_SLAM2
 
             }   // 更新速率模型，插入关键帧判断。
 
-            // 跟踪失败，且没有完成VI初始化(地图点很少)，使能Reset 
-            if (mState == LOST)
+            // 跟踪失败，且没有完成VI初始化(地图点很少)，使能Reset。定位模式下不清除地图，继续重定位。
+            if (mState == LOST && !mbOnlyTracking)
             {
                 // if(mpMap->KeyFramesInMap()<=5)
                 if (!mpLocalMapper->GetVINSInited())
@@ -1207,7 +1333,8 @@ namespace ORB_SLAM2
 
 
         // 步骤3 记录位姿信息，用于轨迹复现。
-        if (!mCurrentFrame.mTcw.empty())
+        // 加载地图后，第一次跟踪成功之前没有参考关键帧和上一次的记录。
+        if (!mCurrentFrame.mTcw.empty() && mCurrentFrame.mpReferenceKF)
         {
             // 计算相对姿态 T_currentFrame_referenceKeyFrame
             cv::Mat Tcr = mCurrentFrame.mTcw * mCurrentFrame.mpReferenceKF->GetPoseInverse();
@@ -1216,7 +1343,7 @@ namespace ORB_SLAM2
             mlFrameTimes.push_back(mCurrentFrame.mTimeStamp);
             mlbLost.push_back(mState == LOST);
         }
-        else
+        else if (!mlRelativeFramePoses.empty())
         {
             // 如果跟踪失败，相对位姿使用上一次的值。
             mlRelativeFramePoses.push_back(mlRelativeFramePoses.back());
@@ -1258,7 +1385,7 @@ namespace ORB_SLAM2
             // 步骤4：为每个特征点构造MapPoint
             for (int i = 0; i < mCurrentFrame.N; i++)
             {
-                float z = mCurrentFrame.mvDepth[i];
+                float z = mCurrentFrame.mpFeatures->mvDepth[i];
                 if (z > 0)
                 {
                     // 步骤4.1：通过反投影得到该特征点的3D坐标
@@ -1327,16 +1454,16 @@ namespace ORB_SLAM2
             // 清空从上一帧关键帧到当前帧的IMU数据
             mvIMUSinceLastKF.clear();
             // 初始帧的特征数>100
-            if (mCurrentFrame.mvKeys.size() > 100)
+            if (mCurrentFrame.mpFeatures->mvKeys.size() > 100)
             {
                 // 步骤1 得到用于初始化的第一帧，初始化需要两帧。
                 mInitialFrame = Frame(mCurrentFrame);
                 // 保存当前帧状态，用于获取第二帧初始帧后进行匹配。
                 mLastFrame = Frame(mCurrentFrame);
                 // mvbPrevMatched最大的情况就是所有的特征都被跟踪了。
-                mvbPrevMatched.resize(mCurrentFrame.mvKeysUn.size());
-                for (size_t i = 0; i < mCurrentFrame.mvKeysUn.size(); i++)
-                    mvbPrevMatched[i] = mCurrentFrame.mvKeysUn[i].pt;
+                mvbPrevMatched.resize(mCurrentFrame.mpFeatures->mvKeysUn.size());
+                for (size_t i = 0; i < mCurrentFrame.mpFeatures->mvKeysUn.size(); i++)
+                    mvbPrevMatched[i] = mCurrentFrame.mpFeatures->mvKeysUn[i].pt;
 
                 // 防止引用和野指针创建。
                 if (mpInitializer)
@@ -1357,7 +1484,7 @@ namespace ORB_SLAM2
         {
             // 步骤2 特征点数>100，得到初始化的第二帧。
             // 只要连续两帧的特征点都大于100，才能继续初始化，否则重新构造初始器。
-            if ((int) mCurrentFrame.mvKeys.size() <= 100)
+            if ((int) mCurrentFrame.mpFeatures->mvKeys.size() <= 100)
             {
                 delete mpInitializer;
                 mpInitializer = static_cast<Initializer *>(NULL);
@@ -1447,10 +1574,10 @@ namespace ORB_SLAM2
         mvIMUSinceLastKF.clear();
 
         // 步骤1 初始化关键帧的描述子转为BoW。
-        pKFini->ComputeBoW();
+        pKFini->ComputeBoW(mpThreadPool);
 
         // 步骤2 将当前关键帧的描述自转为BoW。
-        pKFcur->ComputeBoW();
+        pKFcur->ComputeBoW(mpThreadPool);
 
         // 步骤3 将两帧关键帧插入到地图中。
         mpMap->AddKeyFrame(pKFini);
@@ -1580,6 +1707,133 @@ namespace ORB_SLAM2
     }
 
 
+    // 回收坏关键帧和坏点云，在每一帧跟踪完成后调用(Map.ReclaimMemory为0时不执行)。
+    // 1.去掉Tracking保存的坏对象，告知EpochManager这个线程不再持有它们。
+    // 2.释放所有线程都不再持有的坏点云，坏关键帧攒够一批后修改轨迹再释放。
+    void Tracking::ReclaimBadObjects()
+    {
+        EpochManager &epoch = mpMap->mEpochManager;
+        if (!epoch.IsEnabled())
+            return;
+
+        // 步骤1 上次检查之后有新的坏对象时才需要检查。计数要在检查之前读取，检查之后变坏的对象下一次再检查。
+        const unsigned long nRetired = epoch.RetiredCount();
+        if (nRetired != mnLastRetiredCount)
+        {
+            EraseBadObjects();
+            mnLastRetiredCount = nRetired;
+        }
+        epoch.Quiesce(mnEpochThreadId);
+
+        // 步骤2 释放点云。
+        vector<MapPoint *> vpMPs;
+        vector<KeyFrame *> vpKFs;
+        epoch.Collect(vpMPs, vpKFs);
+
+        for (size_t i = 0; i < vpMPs.size(); i++)
+        {
+            MapPoint *pMP = vpMPs[i];
+
+            // SetBadFlag之后其他线程可能又添加了观测，从这些关键帧中去掉该点云。
+            const mapMapPointObs observations = pMP->GetObservations();
+            for (mapMapPointObs::const_iterator mit = observations.begin(), mend = observations.end();
+                 mit != mend; mit++)
+            {
+                if (mit->first->GetMapPoint(mit->second) == pMP)
+                    mit->first->EraseMapPointMatch(mit->second);
+            }
+
+            delete pMP;
+        }
+
+        // 修改轨迹需要遍历所有帧，关键帧攒够一批后一起释放。
+        mvpBadKeyFramesToFree.insert(mvpBadKeyFramesToFree.end(), vpKFs.begin(), vpKFs.end());
+        if (mvpBadKeyFramesToFree.size() >= 20)
+            FreeBadKeyFrames();
+    }
+
+
+    // 去掉Tracking保存的坏点云和坏关键帧。
+    void Tracking::EraseBadObjects()
+    {
+        // 上一帧的坏点云换成替换它的点云，与CheckReplacedInLastFrame相同，没有替换的去掉。
+        for (size_t i = 0; i < mLastFrame.mvpMapPoints.size(); i++)
+        {
+            MapPoint *pMP = mLastFrame.mvpMapPoints[i];
+            if (pMP && pMP->isBad())
+            {
+                MapPoint *pRep = pMP->GetReplaced();
+                if (pRep && !pRep->isBad())
+                    mLastFrame.mvpMapPoints[i] = pRep;
+                else
+                {
+                    mLastFrame.mvpMapPoints[i] = static_cast<MapPoint *>(NULL);
+                    mLastFrame.mvbOutlier[i] = false;
+                }
+            }
+        }
+
+        // 局部地图。
+        mvpLocalMapPoints.erase(remove_if(mvpLocalMapPoints.begin(), mvpLocalMapPoints.end(),
+                                          [](MapPoint *pMP) { return pMP->isBad(); }), mvpLocalMapPoints.end());
+        mvpLocalKeyFrames.erase(remove_if(mvpLocalKeyFrames.begin(), mvpLocalKeyFrames.end(),
+                                          [](KeyFrame *pKF) { return pKF->isBad(); }), mvpLocalKeyFrames.end());
+
+        // Viewer绘制的参考点云由Tracking设置。
+        vector<MapPoint *> vpRefMPs = mpMap->GetReferenceMapPoints();
+        const size_t nRefMPs = vpRefMPs.size();
+        vpRefMPs.erase(remove_if(vpRefMPs.begin(), vpRefMPs.end(), [](MapPoint *pMP) { return pMP->isBad(); }),
+                       vpRefMPs.end());
+        if (vpRefMPs.size() != nRefMPs)
+            mpMap->SetReferenceMapPoints(vpRefMPs);
+
+        // 参考关键帧和最后一个关键帧被剔除后仍会读取它们的点云(FreeBadKeyFrames不释放它们)，
+        // 剔除之后变坏的点云不会再从中删除，这里删除。
+        if (mpReferenceKF && mpReferenceKF->isBad())
+            mpReferenceKF->EraseBadMapPointMatches();
+        if (mpLastKeyFrame && mpLastKeyFrame != mpReferenceKF && mpLastKeyFrame->isBad())
+            mpLastKeyFrame->EraseBadMapPointMatches();
+    }
+
+
+    // 释放一批坏关键帧。
+    // 轨迹中参考这些关键帧的帧，改为参考它的父关键帧，相对位姿乘上mTcp，与SaveTrajectoryTUM中沿生成树的计算相同。
+    // 子关键帧一定比父关键帧先被剔除，按退休顺序释放保证父关键帧还在。
+    // 参考关键帧、最后一个关键帧和局部建图的当前关键帧还在使用，从它开始等到下一次。
+    void Tracking::FreeBadKeyFrames()
+    {
+        const KeyFrame *pLocalMapperKF = mpLocalMapper->GetCurrentKF();
+        size_t nFree = 0;
+        while (nFree < mvpBadKeyFramesToFree.size())
+        {
+            const KeyFrame *pKF = mvpBadKeyFramesToFree[nFree];
+            if (pKF == mpReferenceKF || pKF == mLastFrame.mpReferenceKF || pKF == mpLastKeyFrame ||
+                pKF == pLocalMapperKF)
+                break;
+            nFree++;
+        }
+        if (nFree == 0)
+            return;
+
+        const set<KeyFrame *> spFree(mvpBadKeyFramesToFree.begin(), mvpBadKeyFramesToFree.begin() + nFree);
+
+        list<KeyFrame *>::iterator lRit = mlpReferences.begin();
+        for (list<cv::Mat>::iterator lit = mlRelativeFramePoses.begin(), lend = mlRelativeFramePoses.end();
+             lit != lend; lit++, lRit++)
+        {
+            while (spFree.count(*lRit))
+            {
+                *lit = (*lit) * (*lRit)->mTcp;
+                *lRit = (*lRit)->GetParent();
+            }
+        }
+
+        for (size_t i = 0; i < nFree; i++)
+            delete mvpBadKeyFramesToFree[i];
+        mvpBadKeyFramesToFree.erase(mvpBadKeyFramesToFree.begin(), mvpBadKeyFramesToFree.begin() + nFree);
+    }
+
+
     // 对参考关键帧的MapPoint进行跟踪，一般情况下的参考帧是当前关键帧或者与当前帧公视最高的关键帧。
     // 计算位姿没有使用EPnP, 对当前帧赋予参考帧位姿，BA迭代优化。
     // 1.计算当前帧的BoW，将当前帧的特征点分到特定层的nodes上。
@@ -1590,7 +1844,7 @@ namespace ORB_SLAM2
     bool Tracking::TrackReferenceKeyFrame()
     {
         // 步骤1 将当前特征描述自转换维BoW
-        mCurrentFrame.ComputeBoW();
+        mCurrentFrame.ComputeBoW(mpThreadPool);
 
 
         // 步骤2 通过特征点的BoW加快当前帧与参考帧之间的特征点匹配。
@@ -1667,7 +1921,7 @@ namespace ORB_SLAM2
 
         for (int i = 0; i < mLastFrame.N; i++)
         {
-            float z = mLastFrame.mvDepth[i];
+            float z = mLastFrame.mpFeatures->mvDepth[i];
             if (z > 0)
             {
                 vDepthIdx.push_back(make_pair(z, i));
@@ -1910,7 +2164,7 @@ namespace ORB_SLAM2
         {
             for (int i = 0; i < mCurrentFrame.N; i++)
             {
-                if (mCurrentFrame.mvDepth[i] > 0 && mCurrentFrame.mvDepth[i] < mThDepth)
+                if (mCurrentFrame.mpFeatures->mvDepth[i] > 0 && mCurrentFrame.mpFeatures->mvDepth[i] < mThDepth)
                 {
                     nTotal++;   // 可以添加MapPoints的总数。
                     if (mCurrentFrame.mvpMapPoints[i])
@@ -2040,7 +2294,7 @@ namespace ORB_SLAM2
             vDepthIdx.reserve(mCurrentFrame.N);
             for (int i = 0; i < mCurrentFrame.N; i++)
             {
-                float z = mCurrentFrame.mvDepth[i];
+                float z = mCurrentFrame.mpFeatures->mvDepth[i];
                 if (z > 0)
                 {
                     vDepthIdx.push_back(make_pair(z, i));
@@ -2169,7 +2423,8 @@ namespace ORB_SLAM2
                 th = 5;
 
             // 步骤2.2 对视野范围内的MapPoint通过投影进行特征点匹配，匹配的点云添加在当前帧MP中。
-            matcher.SearchByProjection(mCurrentFrame, mvpLocalMapPoints, th);
+            // 有线程池时并行搜索，结果与单线程相同。
+            matcher.SearchByProjection(mCurrentFrame, mvpLocalMapPoints, th, mpThreadPool);
         }
     }
 
@@ -2240,10 +2495,10 @@ namespace ORB_SLAM2
                 if (!pMP->isBad())
                 {
                     // 能观测到当前帧MapPoints的关键帧。
-                    const mapMapPointObs/*map<KeyFrame*, size_t>*/ observations = pMP->GetObservations();
-                    for (mapMapPointObs/*map<KeyFrame*, size_t>*/::const_iterator it = observations.begin(), itend = observations.end();
-                         it != itend; it++)
-                        keyframeCounter[it->first]++;
+                    pMP->ForEachObservation([&](KeyFrame *pKFi, size_t)
+                                            {
+                                                keyframeCounter[pKFi]++;
+                                            });
                 }
                 else
                 {
@@ -2389,7 +2644,7 @@ namespace ORB_SLAM2
     {
 
         // 步骤1 计算当前帧特征点的BoW
-        mCurrentFrame.ComputeBoW();
+        mCurrentFrame.ComputeBoW(mpThreadPool);
 
         // 步骤2 找到与当前帧相似的候选关键帧。
         vector<KeyFrame *> vpCandidateKFs = mpKeyFrameDB->DetectRelocalizationCandidates(&mCurrentFrame);
@@ -2554,12 +2809,17 @@ namespace ORB_SLAM2
             return false;
         else
         {
+            mnLastRelocFrameId = mCurrentFrame.mnId;
+
+            // 定位模式下不创建关键帧，不需要重新计算IMU偏移。
+            if (mbOnlyTracking)
+                return true;
+
             //Test log
             if (!mpLocalMapper->GetVINSInited())
                 cerr << "VINS not inited? why." << endl;
 
             mbRelocBiasPrepare = true;
-            mnLastRelocFrameId = mCurrentFrame.mnId;
             return true;
         }
     }
@@ -2579,6 +2839,10 @@ namespace ORB_SLAM2
             std::this_thread::sleep_for(std::chrono::milliseconds(3));
         }
 
+        // 暂停前端流水线，已构造的帧在重置后重新构造
+        if (mpFramePipeline)
+            mpFramePipeline->Pause();
+
         // 重置局部地图线程。
         cout << "Reseting Local Mapper ...";
         mpLocalMapper->RequestReset();
@@ -2597,6 +2861,18 @@ namespace ORB_SLAM2
         // 清空地图。
         mpMap->clear();
 
+        // 已经从EpochManager取出、等待修改轨迹的坏关键帧。
+        for (size_t i = 0; i < mvpBadKeyFramesToFree.size(); i++)
+            delete mvpBadKeyFramesToFree[i];
+        mvpBadKeyFramesToFree.clear();
+
+        // 地图对象都已释放，不再保存它们的指针。
+        mvpLocalMapPoints.clear();
+        mvpLocalKeyFrames.clear();
+        fill(mLastFrame.mvpMapPoints.begin(), mLastFrame.mvpMapPoints.end(), static_cast<MapPoint *>(NULL));
+        mpReferenceKF = static_cast<KeyFrame *>(NULL);
+        mpLastKeyFrame = static_cast<KeyFrame *>(NULL);
+
         KeyFrame::nNextId = 0;
         Frame::nNextId = 0;
         mState = NO_IMAGES_YET;
@@ -2612,6 +2888,9 @@ namespace ORB_SLAM2
         mlFrameTimes.clear();
         mlbLost.clear();
 
+        if (mpFramePipeline)
+            mpFramePipeline->Resume(true);
+
         mpViewer->Release();
 
     }
@@ -2619,6 +2898,9 @@ namespace ORB_SLAM2
     // 修改设置参数。
     void Tracking::ChangeCalibration(const string &strSettingPath)
     {
+        // 构造线程会读取标定参数，修改期间暂停流水线，已构造的帧用新参数重新构造
+        if (mpFramePipeline)
+            mpFramePipeline->Pause();
 
         cv::FileStorage fSettings(strSettingPath, cv::FileStorage::READ);
         float fx = fSettings["Camera.fx"];
@@ -2646,10 +2928,36 @@ namespace ORB_SLAM2
         }
         DistCoef.copyTo(mDistCoef);
 
+        // 旧的查找表对应原来的标定参数，需要重新生成
+        SetUndistortionMap(fSettings);
+
         mbf = fSettings["Camera.bf"];
 
         Frame::mbInitialComputations = true;
 
+        if (mpFramePipeline)
+            mpFramePipeline->Resume(mState == NOT_INITIALIZED || mState == NO_IMAGES_YET);
+
+    }
+
+    void Tracking::SetUndistortionMap(const cv::FileStorage &fSettings)
+    {
+        Frame::mpUndistortionMap.reset();
+
+        // 格点间距(像素)，需要图像尺寸Camera.width和Camera.height。
+        float step = fSettings["Camera.UndistortStep"];
+        int width = fSettings["Camera.width"];
+        int height = fSettings["Camera.height"];
+
+        // 无畸变时不需要校正
+        if (step <= 0 || width <= 0 || height <= 0 || mDistCoef.at<float>(0) == 0.0)
+            return;
+
+        std::shared_ptr<UndistortionMap> pMap = std::make_shared<UndistortionMap>(mK, mDistCoef, width, height, step);
+        cout << endl << "Undistortion map: " << width << "x" << height << ", step " << step << " px, max error "
+             << pMap->MaxError() << " px" << endl;
+
+        Frame::mpUndistortionMap = pMap;
     }
 
     void Tracking::InformOnlyTracking(const bool &flag)
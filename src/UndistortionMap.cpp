@@ -0,0 +1,111 @@
+#include "UndistortionMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace ORB_SLAM2
+{
+
+    UndistortionMap::UndistortionMap(const cv::Mat &K, const cv::Mat &distCoef, const int width, const int height,
+                                     const float step) :
+            mK(K.clone()), mDistCoef(distCoef.clone()), mfStep(step), mfInvStep(1.0f / step)
+    {
+        CV_Assert(width > 0 && height > 0 && step > 0);
+
+        // 最后一个格点不小于图像边界
+        mnCols = (int) ceil(width * mfInvStep) + 1;
+        mnRows = (int) ceil(height * mfInvStep) + 1;
+
+        cv::Mat mat(mnRows * mnCols, 1, CV_32FC2);
+        for (int iy = 0; iy < mnRows; iy++)
+            for (int ix = 0; ix < mnCols; ix++)
+                mat.at<cv::Point2f>(iy * mnCols + ix) = cv::Point2f(ix * mfStep, iy * mfStep);
+
+        cv::undistortPoints(mat, mat, mK, mDistCoef, cv::Mat(), mK);
+
+        const cv::Point2f *pTable = mat.ptr<cv::Point2f>(0);
+        mvTable.assign(pTable, pTable + mnRows * mnCols);
+    }
+
+    bool UndistortionMap::Lookup(const float x, const float y, cv::Point2f &pt) const
+    {
+        const float fx = x * mfInvStep;
+        const float fy = y * mfInvStep;
+
+        // 写成取反的形式，NaN也返回false
+        if (!(fx >= 0 && fy >= 0 && fx <= mnCols - 1 && fy <= mnRows - 1))
+            return false;
+
+        // 落在最后一个格点上时使用最后一个格子
+        const int ix = std::min((int) fx, mnCols - 2);
+        const int iy = std::min((int) fy, mnRows - 2);
+        const float tx = fx - ix;
+        const float ty = fy - iy;
+
+        const cv::Point2f *p = &mvTable[iy * mnCols + ix];
+        const cv::Point2f &p00 = p[0];
+        const cv::Point2f &p10 = p[1];
+        const cv::Point2f &p01 = p[mnCols];
+        const cv::Point2f &p11 = p[mnCols + 1];
+
+        pt.x = (1 - ty) * ((1 - tx) * p00.x + tx * p10.x) + ty * ((1 - tx) * p01.x + tx * p11.x);
+        pt.y = (1 - ty) * ((1 - tx) * p00.y + tx * p10.y) + ty * ((1 - tx) * p01.y + tx * p11.y);
+        return true;
+    }
+
+    void UndistortionMap::Undistort(const std::vector<cv::KeyPoint> &vKeys, std::vector<cv::KeyPoint> &vKeysUn) const
+    {
+        vKeysUn.resize(vKeys.size());
+
+        std::vector<size_t> vMissing;
+        for (size_t i = 0; i < vKeys.size(); i++)
+        {
+            cv::KeyPoint kp = vKeys[i];
+            if (!Lookup(kp.pt.x, kp.pt.y, kp.pt))
+                vMissing.push_back(i);
+            vKeysUn[i] = kp;
+        }
+
+        if (vMissing.empty())
+            return;
+
+        // 表外的点与原来一样迭代求解
+        cv::Mat mat((int) vMissing.size(), 1, CV_32FC2);
+        for (size_t i = 0; i < vMissing.size(); i++)
+            mat.at<cv::Point2f>((int) i) = vKeys[vMissing[i]].pt;
+
+        cv::undistortPoints(mat, mat, mK, mDistCoef, cv::Mat(), mK);
+
+        for (size_t i = 0; i < vMissing.size(); i++)
+            vKeysUn[vMissing[i]].pt = mat.at<cv::Point2f>((int) i);
+    }
+
+    float UndistortionMap::MaxError() const
+    {
+        // 格子较小时每隔几个格子检查一次，检查点间距约1像素
+        const int nStride = std::max(1, cvRound(mfInvStep));
+
+        std::vector<cv::Point2f> vPoints;
+        for (int iy = 0; iy < mnRows - 1; iy += nStride)
+            for (int ix = 0; ix < mnCols - 1; ix += nStride)
+                vPoints.push_back(cv::Point2f((ix + 0.5f) * mfStep, (iy + 0.5f) * mfStep));
+
+        cv::Mat mat((int) vPoints.size(), 1, CV_32FC2, &vPoints[0]);
+        cv::Mat matUn;
+        cv::undistortPoints(mat, matUn, mK, mDistCoef, cv::Mat(), mK);
+
+        float maxError = 0;
+        for (size_t i = 0; i < vPoints.size(); i++)
+        {
+            cv::Point2f pt;
+            Lookup(vPoints[i].x, vPoints[i].y, pt);
+            const cv::Point2f d = pt - matUn.at<cv::Point2f>((int) i);
+            maxError = std::max(maxError, (float) sqrt(d.x * d.x + d.y * d.y));
+        }
+
+        return maxError;
+    }
+
+} //namespace ORB_SLAM2
@@ -82,6 +82,9 @@ namespace ORB_SLAM2
         bool bFollow = true;
         bool bLocalizationMode = false;
 
+        // 每次绘制之后不再持有地图对象。
+        EpochManager::Registration epoch(&mpMapDrawer->mpMap->mEpochManager);
+
         while (1)
         {
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -149,11 +152,15 @@ namespace ORB_SLAM2
             {
                 while (isStopped())
                 {
+                    epoch.Quiesce();
+
                     // 延时3000us。
                     std::this_thread::sleep_for(std::chrono::milliseconds(3));
                 }
             }
 
+            epoch.Quiesce();
+
             if (CheckFinish())
                 break;
         }